@@ -11,29 +11,209 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <limits.h>
 #include <math.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mead_core.h"
+#include "mead_kernel.h"
+#include "mead_sweep.h"
+#include "mead_inverse.h"
+#include "mead_output.h"
+#include "mead_record.h"
+#include "mead_service.h"
+#include "mead_honeydb.h"
+#include "mead_montecarlo.h"
+#include "mead_ferment.h"
+#include "mead_fleet.h"
+#include "mead_stats.h"
+#include "mead_telemetry.h"
+#include "mead_history.h"
+#include "mead_shard.h"
 
 // --- Constants ---
 
-// The approximate gravity points per pound of honey per gallon of water (for calculation purposes).
-// This is a standard estimate for most floral honeys (35 PPG).
-#define GRAVITY_POINTS_PER_UNIT 35.0
+// Batch mode limits. Each record is read into a fixed line buffer, so memory
+// use stays constant regardless of the size of the input stream.
+#define BATCH_LINE_MAX 1024
+#define BATCH_BLOCK_SIZE 256
+
+// Parallel batch mode: input bytes per chunk handed to a worker thread. Chunk
+// boundaries move forward to the next line start, so no record is ever split.
+#define BATCH_CHUNK_BYTES (1 << 20)
+
+// Parallel batch mode: chunks in flight (being rendered or waiting for their turn to be
+// written) per worker thread. Bounds the rendered output held in memory.
+#define BATCH_WINDOW_PER_THREAD 4
+
+// Largest batch volume accepted by sweep mode; keeps every CSV row within MEAD_SWEEP_ROW_MAX.
+#define SWEEP_VOLUME_MAX 1000000.0
 
-// Conversion factors
-#define KG_TO_LBS 2.20462 // 1 kg = 2.20462 lbs
-#define L_TO_GAL 0.264172 // 1 L = 0.264172 gallons
-#define VERSION_STRING  "0.1.1"
+// Co-process mode: longest request ID echoed back in responses.
+#define COPROC_ID_MAX 64
+
+// Monte Carlo mode: arena chunk for per-record worker state (two sketches per thread).
+#define MC_SCRATCH_CHUNK (1 << 20)
+
+// Service mode listens here unless --socket or --port is given.
+#define SERVE_DEFAULT_SOCKET "/tmp/meadGenerator.sock"
 
 // --- Function Prototyypes ---
 void display_menu();
-double get_target_og(int abv, const char* sweetness, int is_turbo);
-void calculate_us_imperial(double volume_gal, double target_og);
-void calculate_metric(double volume_L, double target_og);
+void print_usage(const char *program);
+void print_us_imperial(const MeadResult *result);
+void print_metric(const MeadResult *result);
+int run_batch_mode(const char *path, MeadOutputFormat format, int fixed_point, int threads, const MeadShard *shard,
+                   const MeadHoneyDb *honey_db, const char *history_path);
+int run_sweep_mode(int argc, char *argv[]);
+int run_montecarlo_mode(int argc, char *argv[]);
+int run_ferment_mode(int argc, char *argv[]);
+int run_fleet_mode(int argc, char *argv[], const MeadHoneyDb *honey_db);
+int run_inverse_mode(const char *path);
+int run_serve_mode(int argc, char *argv[], const MeadHoneyDb *honey_db, const char *history_path);
+int run_coproc_mode(const MeadHoneyDb *honey_db);
+int run_honeydb_build(const char *csv_path, const char *db_path);
+int run_history_query_mode(const char *path, int argc, char *argv[]);
+int run_merge_mode(int count, char *paths[]);
 double convert_kg_to_lbs(double kg); // Note: Only used for conversion factor definition now
 double convert_L_to_gal(double L);
 
+/**
+ * @brief atexit handler for --stats: writes the merged statistics to stderr.
+ */
+static void print_stats(void) {
+    static MeadStatsSnapshot snap;
+    static MeadWriter err;
+
+    mead_stats_snapshot(&snap);
+    mead_writer_init(&err, STDERR_FILENO);
+    mead_stats_write_text(&err, &snap);
+    mead_writer_flush(&err);
+}
+
 // --- Main Application ---
-int main() {
+int main(int argc, char *argv[]) {
+    MeadHoneyDb honey_db_storage;
+    const MeadHoneyDb *honey_db = NULL;
+    int stats_requested = 0;
+    const char *history_path = NULL;
+
+    // --stats, --honeydb FILE and --history FILE (in any order) apply to the mode that follows them
+    for (;;) {
+        if (argc > 2 && strcmp(argv[1], "--stats") == 0 && !stats_requested) {
+            stats_requested = 1;
+            mead_stats_enable();
+            atexit(print_stats);
+            argv[1] = argv[0];
+            argv++;
+            argc--;
+        } else if (argc > 3 && strcmp(argv[1], "--honeydb") == 0 && !honey_db) {
+            if (mead_honeydb_open(&honey_db_storage, argv[2]) != 0) {
+                fprintf(stderr, "Error: Cannot load honey database '%s'.\n", argv[2]);
+                return 1;
+            }
+            honey_db = &honey_db_storage;
+            argv[2] = argv[0];
+            argv += 2;
+            argc -= 2;
+        } else if (argc > 2 && strcmp(argv[1], "--history") == 0 && !history_path) {
+            history_path = argv[2];
+            argv[2] = argv[0];
+            argv += 2;
+            argc -= 2;
+        } else {
+            break;
+        }
+    }
+
+    if (argc > 1) {
+        if (strcmp(argv[1], "--batch") == 0) {
+            MeadOutputFormat format = MEAD_FORMAT_CSV;
+            int fixed_point = 0;
+            int threads = 0;
+            MeadShard shard = { 0, 1 };
+            int sharded = 0;
+            int arg = 2;
+            for (;;) {
+                if (arg + 1 < argc && strcmp(argv[arg], "--format") == 0) {
+                    if (mead_parse_output_format(argv[arg + 1], &format) != 0) {
+                        fprintf(stderr, "Error: Unknown output format '%s' (use csv, json, human or binary).\n",
+                                argv[arg + 1]);
+                        return 1;
+                    }
+                    arg += 2;
+                } else if (arg < argc && strcmp(argv[arg], "--fixed") == 0) {
+                    fixed_point = 1;
+                    arg++;
+                } else if (arg + 1 < argc && strcmp(argv[arg], "--threads") == 0) {
+                    char *end;
+                    long n = strtol(argv[arg + 1], &end, 10);
+                    if (end == argv[arg + 1] || *end != '\0' || n < 0 || n > INT_MAX) {
+                        fprintf(stderr, "Error: Invalid thread count '%s'.\n", argv[arg + 1]);
+                        return 1;
+                    }
+                    threads = (int)n;
+                    arg += 2;
+                } else if (arg + 1 < argc && strcmp(argv[arg], "--shard") == 0) {
+                    if (mead_parse_shard(argv[arg + 1], &shard) != 0) {
+                        fprintf(stderr, "Error: Invalid shard '%s' (use i/N with 0 <= i < N <= %d).\n",
+                                argv[arg + 1], MEAD_SHARD_MAX);
+                        return 1;
+                    }
+                    sharded = 1;
+                    arg += 2;
+                } else {
+                    break;
+                }
+            }
+            if (argc - arg <= 1) {
+                // Read from the named file, or from stdin when no file (or "-") is given
+                return run_batch_mode(arg < argc ? argv[arg] : "-", format, fixed_point, threads,
+                                      sharded ? &shard : NULL, honey_db, history_path);
+            }
+        }
+        if (strcmp(argv[1], "--inverse") == 0 && argc <= 3) {
+            return run_inverse_mode(argc == 3 ? argv[2] : "-");
+        }
+        if (strcmp(argv[1], "--sweep") == 0) {
+            return run_sweep_mode(argc - 2, argv + 2);
+        }
+        if (strcmp(argv[1], "--montecarlo") == 0) {
+            return run_montecarlo_mode(argc - 2, argv + 2);
+        }
+        if (strcmp(argv[1], "--ferment") == 0) {
+            return run_ferment_mode(argc - 2, argv + 2);
+        }
+        if (strcmp(argv[1], "--fleet") == 0) {
+            return run_fleet_mode(argc - 2, argv + 2, honey_db);
+        }
+        if (strcmp(argv[1], "--serve") == 0) {
+            return run_serve_mode(argc - 2, argv + 2, honey_db, history_path);
+        }
+        if (strcmp(argv[1], "--coproc") == 0 && argc == 2) {
+            return run_coproc_mode(honey_db);
+        }
+        if (strcmp(argv[1], "--honeydb-build") == 0 && argc == 4) {
+            return run_honeydb_build(argv[2], argv[3]);
+        }
+        if (strcmp(argv[1], "--history-query") == 0 && argc >= 3) {
+            return run_history_query_mode(argv[2], argc - 3, argv + 3);
+        }
+        if (strcmp(argv[1], "--merge") == 0 && argc >= 3) {
+            return run_merge_mode(argc - 2, argv + 2);
+        }
+        print_usage(argv[0]);
+        return (strcmp(argv[1], "--help") == 0) ? 0 : 1;
+    }
+
     display_menu();
 
     int choice;
@@ -45,7 +225,7 @@ int main() {
 
     double volume;
     int abv;
-    char sweetness_str[20];
+    char sweetness_str[20]; // Longest valid input is "Semi-Sweet"; scanf is limited to 19 characters
     int is_turbo_mode; // New variable to track turbo mode
 
     // Get batch volume
@@ -65,7 +245,7 @@ int main() {
 
     // Get sweetness level
     printf("Enter sweetness level (Dry, Semi-Sweet, Sweet, Dessert): ");
-    if (scanf("%s", sweetness_str) != 1) {
+    if (scanf("%19s", sweetness_str) != 1) {
         printf("Invalid sweetness input. Exiting.\n");
         return 1;
     }
@@ -78,17 +258,25 @@ int main() {
     }
 
 
-    // Calculate Target Original Gravity (OG)
-    double target_og = get_target_og(abv, sweetness_str, is_turbo_mode);
+    // Calculate Target Original Gravity (OG), honey and water
+    MeadUnit unit = (choice == 1) ? MEAD_UNIT_US_IMPERIAL : MEAD_UNIT_METRIC;
+    MeadResult result;
+
+    // Turbo mode forces FG to 1.000, so the sweetness entry is not used and not validated
+    MeadSweetness sweetness = (is_turbo_mode == 2) ? MEAD_SWEETNESS_DRY : mead_parse_sweetness(sweetness_str);
 
-    if (target_og == 0.0) {
+    if (mead_calculate(unit, volume, abv, sweetness, is_turbo_mode, MEAD_DEFAULT_FG_TABLE, &result) != MEAD_OK) {
         printf("Error: Invalid sweetness level entered. Please use Dry, Semi-Sweet, Sweet, or Dessert.\n");
         return 1;
     }
 
+    if (is_turbo_mode == 2) {
+        printf("\nNOTE: Turbo Yeast selected. Final Gravity (FG) forced to 1.000.\n");
+    }
+
     // Sanity Check: If calculated OG is unrealistically high, stop and warn the user.
-    if (target_og > 1.225) {
-        printf("\nWARNING: Calculated Original Gravity (OG=%.3f) is extremely high.\n", target_og);
+    if (result.og_too_high) {
+        printf("\nWARNING: Calculated Original Gravity (OG=%.3f) is extremely high.\n", result.og);
         printf("This OG requires an impractical amount of honey and exceeds the tolerance of most mead yeasts (max OG is usually around 1.220).\n");
         printf("Please try a lower ABV or a smaller batch size.\n");
         return 1;
@@ -96,13 +284,28 @@ int main() {
 
     // Perform calculation based on chosen unit system
     printf("\n--- Calculation Results ---\n");
-    if (choice == 1) {
-        calculate_us_imperial(volume, target_og);
+    if (unit == MEAD_UNIT_US_IMPERIAL) {
+        print_us_imperial(&result);
     } else {
-        calculate_metric(volume, target_og);
+        print_metric(&result);
     }
 
     printf("\nCalculation complete. Remember this is an ESTIMATE and specific yeast/flavorings are required.\n");
+
+    if (history_path) {
+        MeadHistoryWriter history;
+        MeadHistoryRecipe recipe = { mead_history_now_ms(), unit, volume, abv, sweetness, is_turbo_mode,
+                                     result.og, result.honey, result.water };
+        if (mead_history_writer_open(&history, history_path, MEAD_HISTORY_RECIPES) != 0) {
+            fprintf(stderr, "Error: Cannot open history '%s'.\n", history_path);
+            return 1;
+        }
+        mead_history_append_recipe(&history, &recipe);
+        if (mead_history_writer_close(&history) != 0) {
+            fprintf(stderr, "Error: Failed writing history '%s'.\n", history_path);
+            return 1;
+        }
+    }
     return 0;
 }
 
@@ -124,103 +327,2423 @@ void display_menu() {
 }
 
 /**
- * @brief Calculates the required Original Gravity (OG) based on target ABV and sweetness.
- * * @param abv Target Alcohol by Volume percentage.
- * @param sweetness String representing the desired sweetness level.
- * @param is_turbo Flag: 1 for Standard, 2 for Turbo Yeast.
- * @return double The required Original Gravity (e.g., 1.100), or 0.0 on error.
+ * @brief Prints the command line options.
+ * @param program The name the program was started with (argv[0]).
+ */
+void print_usage(const char *program) {
+    printf("Usage: %s [--batch [--format F] [--fixed] [--threads N] [--shard I/N] [FILE] | --inverse [FILE] |\n",
+           program);
+    printf("        --sweep [SWEEP OPTIONS] |\n");
+    printf("        --montecarlo [MC OPTIONS] [FILE] | --ferment [FERMENT OPTIONS] [FILE] |\n");
+    printf("        --fleet --inventory CSV [--objective O] [FILE] |\n");
+    printf("        --serve [--socket PATH] [--port N] [--telemetry-port N] | --coproc |\n");
+    printf("        --honeydb-build CSV FILE | --history-query FILE [QUERY OPTIONS] | --merge FILE...]\n");
+    printf("  --honeydb FILE  Before --batch, --fleet, --serve or --coproc: load a honey lot database so\n");
+    printf("                  records may name a lot (6th CSV field or \"lot\" key) with measured PPG.\n");
+    printf("  --honeydb-build CSV FILE  Build a honey lot database from lot_id,varietal,ppg,moisture,density.\n");
+    printf("  --history FILE  Before --batch, --serve or interactive mode: append every calculated\n");
+    printf("                  recipe (and with --telemetry-port, every reading) to a history file.\n");
+    printf("  --stats         Before any mode: print record counts, rejections and per-stage\n");
+    printf("                  latency percentiles to stderr on exit (--serve also has GET /metrics).\n");
+    printf("  (no options)    Interactive mode, prompts for each value.\n");
+    printf("  --batch [FILE]  Read recipes from FILE (or stdin if FILE is omitted or \"-\")\n");
+    printf("                  and write one result row per input record.\n");
+    printf("    --format F            csv (default), json (one object per line), human or binary\n");
+    printf("                          (a header, then fixed-width little-endian records; see\n");
+    printf("                          mead_output.h)\n");
+    printf("    --fixed               Integer gravity point arithmetic: the target OG is rounded once\n");
+    printf("                          to whole points and never converted back (results may differ\n");
+    printf("                          from the default in the last printed digit).\n");
+    printf("    --threads N           Worker threads for a FILE input (default: one per CPU); rows\n");
+    printf("                          keep the input order. stdin is always read by one thread.\n");
+    printf("    --shard I/N           Compute only shard I of N (0-based) and write a partial result\n");
+    printf("                          file for --merge. Also for --sweep and --montecarlo.\n");
+    printf("  --inverse [FILE]  Answer honey inventory queries, one CSV line each:\n");
+    printf("                  unit,honey,sweetness,yeast,abv,volume with either abv (gives the\n");
+    printf("                  largest batch volume) or volume (gives the ABV reached) left empty.\n");
+    printf("  --sweep         Write the full volume x ABV x sweetness x yeast mode matrix as CSV.\n");
+    printf("    --unit U              Gallons or Liters (default Liters)\n");
+    printf("    --volume START:STOP:STEP  Batch volumes (default 5:2000:5)\n");
+    printf("    --abv MIN:MAX         Integer ABV range (default 5:25)\n");
+    printf("    --threads N           Worker threads (default: one per CPU)\n");
+    printf("    --format F            csv (default) or binary\n");
+    printf("  --montecarlo [MC OPTIONS] [FILE]  Read batch records and write honey/water mean and\n");
+    printf("                  5th/50th/95th percentiles over random model parameters, as CSV.\n");
+    printf("    --trials N            Trials per record (default %d)\n", MEAD_MC_DEFAULT_TRIALS);
+    printf("    --ppg DIST            Honey PPG (default normal:35:1.5)\n");
+    printf("    --displacement DIST   Liters displaced per kg of honey (default normal:0.74:0.03)\n");
+    printf("    --abv-factor DIST     ABV factor (default normal:131.25:2)\n");
+    printf("    --seed S, --threads N Random seed (default 1), worker threads (default: one per CPU)\n");
+    printf("                  DIST is a number, uniform:MIN:MAX, normal:MEAN:SD or triangular:MIN:MODE:MAX.\n");
+    printf("  --ferment [FERMENT OPTIONS] [FILE]  Simulate batch records as fermenters, day by day.\n");
+    printf("    --days N              Days to simulate (default 90, max %d)\n", MEAD_FERMENT_MAX_DAYS);
+    printf("    --temp C              Fermentation temperature in Celsius (default 20)\n");
+    printf("    --feed DAY:POINTS     Step feeding: add gravity points on DAY (up to %d times)\n", MEAD_FERMENT_MAX_FEEDS);
+    printf("    --curve               Write the SG of every batch for every day instead of a summary\n");
+    printf("  --fleet --inventory CSV [FILE]  Plan which batch records (fermenters) to fill from the\n");
+    printf("                  honey in stock (lot_id,kg,cost_per_kg; PPG from --honeydb if loaded).\n");
+    printf("                  A record's lot pins that fermenter to one lot; others blend the cheapest.\n");
+    printf("    --objective O         volume (default: fill the most volume) or cost (the most\n");
+    printf("                          volume at the lowest honey cost)\n");
+    printf("  --serve         Run as a calculation service (Ctrl+C to stop). Clients send batch\n");
+    printf("                  records one per line, or HTTP \"POST /calculate\" with records in the body;\n");
+    printf("                  every record is answered with one JSON line (HTTP with\n");
+    printf("                  \"Accept: %s\": one binary format body instead).\n", MEAD_SERVICE_BINARY_TYPE);
+    printf("    --socket PATH         Unix socket (default %s)\n", SERVE_DEFAULT_SOCKET);
+    printf("    --port N              Also serve on 127.0.0.1:N\n");
+    printf("    --telemetry-port N    Receive hydrometer readings on UDP port N (all interfaces),\n");
+    printf("                          one \"fermenter,sg[,temperature[,og]]\" line or JSON object each;\n");
+    printf("                          GET /telemetry returns the latest OG, SG and ABV per fermenter.\n");
+    printf("  --coproc        Pipe peer mode: read \"ID RECORD\" lines from stdin, answer each with\n");
+    printf("                  \"ID ok OG,HONEY,WATER,GRAVITY_POINTS\" or \"ID err MESSAGE\" (flushed per line).\n");
+    printf("  --history-query FILE  Write the rows of a history file as CSV, oldest block first.\n");
+    printf("    --kind K              readings (default) or recipes\n");
+    printf("    --from T, --to T      Only rows in this time range; T is YYYY-MM-DD[THH:MM[:SS]] (UTC)\n");
+    printf("                          or seconds since the epoch. A --to date includes the whole day.\n");
+    printf("    --fermenter ID        Only the readings of one fermenter\n");
+    printf("    --format F            csv (default) or json (one object per line)\n");
+    printf("  --merge FILE... Combine the partial result files of all N shards of one --batch, --sweep\n");
+    printf("                  or --montecarlo run into the output the unsharded run would have written.\n");
+    printf("Batch records are CSV lines or NDJSON objects:\n");
+    printf("  unit,volume,abv,sweetness,yeast[,lot]\n");
+    printf("  {\"unit\":\"Liters\",\"volume\":20,\"abv\":14,\"sweetness\":\"Dry\",\"yeast\":1,\"lot\":\"CL-2025-01\"}\n");
+    printf("unit is Gallons/Liters (or 1/2), yeast is Standard/Turbo (or 1/2).\n");
+}
+
+/**
+ * @brief Prints calculation results in US Imperial units (Gallons/Lbs).
+ * @param result Result of mead_calculate() with MEAD_UNIT_US_IMPERIAL.
+ */
+void print_us_imperial(const MeadResult *result) {
+    printf("Target Original Gravity (OG): %.3f\n", result->og);
+    printf("Required Honey:             %.2f lbs (pounds)\n", result->honey);
+
+    // Added clarification for when water volume is zero or negative
+    if (result->water_clamped) {
+        printf("Required Water (to top off):  0.00 gallons (Honey volume meets or exceeds batch volume.)\n");
+    } else {
+        printf("Required Water (to top off):  %.2f gallons\n", result->water);
+    }
+
+    printf("Total Gravity Points Needed:  %.0f\n", result->gravity_points);
+}
+
+/**
+ * @brief Prints calculation results in Metric units (Liters/Kg).
+ * @param result Result of mead_calculate() with MEAD_UNIT_METRIC.
+ */
+void print_metric(const MeadResult *result) {
+    printf("Target Original Gravity (OG): %.3f\n", result->og);
+    printf("Required Honey:             %.2f kg (kilograms)\n", result->honey);
+
+    // Added clarification for when water volume is zero or negative
+    if (result->water_clamped) {
+        printf("Required Water (to top off):  0.00 liters (Honey volume meets or exceeds batch volume.)\n");
+    } else {
+        printf("Required Water (to top off):  %.2f liters\n", result->water);
+    }
+
+    printf("Total Gravity Points Needed:  %.0f (Based on US Gal/Lbs)\n", result->gravity_points);
+}
+
+// --- Batch Mode ---
+
+// Records are buffered in fixed-size structure-of-arrays blocks so the honey/water
+// math runs through the SIMD batch kernel instead of one record at a time.
+typedef struct {
+    int count;
+    int fixed_point;                       // Non-zero to use the integer gravity point path
+    MeadStats *stats;                      // This thread's statistics, or NULL if off
+    MeadHistoryWriter *history;            // Recipes history, or NULL if off
+    const MeadShard *shard;                // Only this shard's lines are computed, or NULL for all
+    MeadWriter *row;                       // With a shard: memory writer each row is framed from
+    long line_no[BATCH_BLOCK_SIZE];
+    const char *error[BATCH_BLOCK_SIZE];   // NULL if the record is valid
+    int has_inputs[BATCH_BLOCK_SIZE];      // Non-zero if rec[] was parsed (printed even on error)
+    const MeadHoneyLot *lot[BATCH_BLOCK_SIZE]; // Honey lot of the record, or NULL for the default model
+    unsigned char og_too_high[BATCH_BLOCK_SIZE]; // Rejected for an OG above MEAD_MAX_OG
+    MeadRecord rec[BATCH_BLOCK_SIZE];
+    double volume[BATCH_BLOCK_SIZE];
+    double og[BATCH_BLOCK_SIZE];
+    int32_t og_points[BATCH_BLOCK_SIZE];   // Target OG as gravity points (fixed_point only)
+    unsigned char units[BATCH_BLOCK_SIZE];
+    double honey[BATCH_BLOCK_SIZE];
+    double water[BATCH_BLOCK_SIZE];
+    double gravity_points[BATCH_BLOCK_SIZE];
+} BatchBlock;
+
+/**
+ * @brief Appends one record (or error) to the block; invalid slots get neutral kernel inputs.
  */
-double get_target_og(int abv, const char* sweetness, int is_turbo) {
-    double fg;
+static void batch_block_add(BatchBlock *block, long line_no, const MeadRecord *rec, const char *err,
+                            const MeadHoneyDb *honey_db) {
+    if (!mead_shard_owns(block->shard, (uint64_t)(line_no - 1))) {
+        return; // Another shard's line
+    }
+    int i = block->count++;
 
-    // Standard FG estimates for different sweetness levels (used only if not turbo)
-    if (is_turbo == 1) {
-        if (strcasecmp(sweetness, "Dry") == 0) {
-            fg = 1.000;
-        } else if (strcasecmp(sweetness, "Semi-Sweet") == 0) {
-            fg = 1.010;
-        } else if (strcasecmp(sweetness, "Sweet") == 0) {
-            fg = 1.020;
-        } else if (strcasecmp(sweetness, "Dessert") == 0) {
-            fg = 1.030;
+    block->line_no[i] = line_no;
+    block->error[i] = err;
+    block->has_inputs[i] = (rec != NULL);
+    block->lot[i] = NULL;
+    block->og_too_high[i] = 0;
+    block->volume[i] = 0.0;
+    block->og[i] = 1.000;
+    block->og_points[i] = 0;
+    block->units[i] = MEAD_UNIT_US_IMPERIAL;
+    mead_stats_count(block->stats, MEAD_STAT_RECORDS, 1);
+    if (!rec) {
+        mead_stats_count(block->stats, MEAD_STAT_PARSE_ERRORS, 1);
+    }
+
+    if (rec) {
+        block->rec[i] = *rec;
+        double og;
+        int og_too_high;
+        if (block->fixed_point) {
+            int32_t points = mead_og_points(MEAD_DEFAULT_FG_TABLE, rec->abv, rec->sweetness, rec->yeast_mode);
+            og = MEAD_POINTS_TO_OG(points);
+            og_too_high = points > MEAD_MAX_OG_POINTS;
+            block->og_points[i] = og_too_high ? 0 : points;
         } else {
-            return 0.0; // Invalid sweetness
+            og = mead_target_og(MEAD_DEFAULT_FG_TABLE, rec->abv, rec->sweetness, rec->yeast_mode);
+            og_too_high = og > MEAD_MAX_OG;
         }
+        const char *lot_err = mead_honeydb_resolve(honey_db, rec->lot, &block->lot[i]);
+        if (og_too_high) {
+            block->error[i] = "OG too high (above 1.225)";
+            block->og_too_high[i] = 1;
+            mead_stats_count(block->stats, MEAD_STAT_OG_REJECTS, 1);
+        } else if (lot_err) {
+            block->error[i] = lot_err;
+            mead_stats_count(block->stats, MEAD_STAT_LOT_ERRORS, 1);
+        } else if (!err) {
+            block->volume[i] = rec->volume;
+            block->og[i] = og;
+            block->units[i] = (unsigned char)rec->unit;
+        }
+    }
+}
+
+/**
+ * @brief Runs the batch kernel over the buffered records and renders one row per record
+ * (with a shard, one frame per row).
+ * @param block Buffered records; emptied on return.
+ * @param out Output buffer (flushed by the caller).
+ * @param format Output format.
+ * @return int The number of records in the block that failed.
+ */
+static int batch_block_flush(BatchBlock *block, MeadWriter *out, MeadOutputFormat format) {
+    int failures = 0;
+    uint64_t start = block->stats ? mead_stats_now() : 0;
+
+    mead_stats_gauge_set(block->stats, MEAD_GAUGE_QUEUE_DEPTH, block->count);
+    if (block->fixed_point) {
+        mead_compute_batch_points((size_t)block->count, block->volume, block->og_points, block->units,
+                                  block->honey, block->water, block->gravity_points);
     } else {
-        // TURBO YEAST MODE: Assumes fermentation goes to bone dry
-        fg = 1.000;
-        printf("\nNOTE: Turbo Yeast selected. Final Gravity (FG) forced to 1.000.\n");
+        mead_compute_batch((size_t)block->count, block->volume, block->og, block->units,
+                           block->honey, block->water, block->gravity_points);
+    }
+
+    for (int i = 0; i < block->count; i++) {
+        const MeadRecord *rec = &block->rec[i];
+
+        if (block->lot[i] && !block->error[i]) {
+            // Lots have their own PPG and displacement, so they leave the kernel's default model
+            MeadModel model;
+            MeadResult result;
+            mead_honey_lot_model(block->lot[i], &MEAD_DEFAULT_MODEL, &model);
+            if (block->fixed_point) {
+                mead_model_compute_points(&model, (MeadUnit)rec->unit, rec->volume, block->og_points[i], &result);
+            } else {
+                mead_model_compute_ingredients(&model, (MeadUnit)rec->unit, rec->volume, block->og[i], &result);
+            }
+            block->honey[i] = result.honey;
+            block->water[i] = result.water;
+            block->gravity_points[i] = result.gravity_points;
+        }
+    }
+    mead_stats_record_since(block->stats, MEAD_STAGE_COMPUTE, start);
+
+    if (block->history) {
+        int64_t now_ms = mead_history_now_ms();
+        for (int i = 0; i < block->count; i++) {
+            const MeadRecord *rec = &block->rec[i];
+            if (!block->error[i]) {
+                MeadHistoryRecipe recipe = { now_ms, (MeadUnit)rec->unit, rec->volume, rec->abv, rec->sweetness,
+                                             rec->yeast_mode, block->og[i], block->honey[i], block->water[i] };
+                mead_history_append_recipe(block->history, &recipe);
+            }
+        }
     }
 
+    start = block->stats ? mead_stats_now() : 0;
+    for (int i = 0; i < block->count; i++) {
+        const MeadRecord *rec = &block->rec[i];
+        MeadOutputRecord row = { block->line_no[i], block->has_inputs[i], (MeadUnit)rec->unit, rec->volume,
+                                 rec->abv, rec->sweetness, rec->yeast_mode, block->error[i],
+                                 block->og[i], block->honey[i], block->water[i], block->gravity_points[i],
+                                 block->lot[i] ? rec->lot : NULL, block->og_too_high[i] };
 
-    // Mead/Wine ABV formula approximation: ABV = (OG - FG) * 131.25
-    // Rearranging for OG: OG = FG + (ABV / 131.25)
-    double og = fg + ((double)abv / 131.25);
+        if (block->row) {
+            mead_write_record(block->row, format, &row);
+            mead_shard_write_rows(out, (uint64_t)block->line_no[i], block->error[i] ? MEAD_SHARD_FAILED : 0,
+                                  block->row);
+        } else {
+            mead_write_record(out, format, &row);
+        }
+        failures += (block->error[i] != NULL);
+    }
+    mead_stats_record_since(block->stats, MEAD_STAGE_FORMAT, start);
 
-    // OG is represented as 1.XXX, so we round the result
-    return round(og * 1000.0) / 1000.0;
+    block->count = 0;
+    return failures;
 }
 
 /**
- * @brief Performs calculations in US Imperial units (Gallons/Lbs).
- * * @param volume_gal Batch volume in Gallons.
- * @param target_og The calculated Original Gravity.
+ * @brief Parses one input line (without its newline) into the block. Blank lines,
+ * comments and a CSV header on line 1 are skipped.
  */
-void calculate_us_imperial(double volume_gal, double target_og) {
-    // Gravity Points needed = (Target OG - 1.000) * 1000
-    double gravity_points_needed = (target_og - 1.000) * 1000.0 * volume_gal;
+static void batch_add_line(BatchBlock *block, long line_no, char *line, const MeadHoneyDb *honey_db) {
+    if (!mead_shard_owns(block->shard, (uint64_t)(line_no - 1))) {
+        return; // Another shard's line, not even parsed
+    }
+    char *rec_str = mead_trim_space(line);
+    if (*rec_str == '\0' || *rec_str == '#') {
+        return; // Blank line or comment
+    }
+
+    MeadRecord rec;
+    uint64_t start = block->stats ? mead_stats_now() : 0;
+    const char *err = mead_parse_record(rec_str, &rec);
+    if (err && line_no == 1 && *rec_str != '{' && strncasecmp(rec_str, "unit", 4) == 0) {
+        return; // CSV header row
+    }
+    mead_stats_record_since(block->stats, MEAD_STAGE_PARSE, start);
+    batch_block_add(block, line_no, err ? NULL : &rec, err, honey_db);
+}
 
-    // Honey Lbs = Gravity Points needed / Gravity Points per unit
-    double honey_lbs = gravity_points_needed / GRAVITY_POINTS_PER_UNIT;
+// --- Parallel Batch Mode ---
 
-    // Water volume: assume honey displaces 0.65 gallons per 10 lbs.
-    double honey_volume_gal = honey_lbs / 10.0 * 0.65;
-    double water_gal = volume_gal - honey_volume_gal;
+// A mapped input file split into BATCH_CHUNK_BYTES chunks. Workers claim chunks from a
+// shared counter, like the sweep runner. Before parsing, each worker counts the lines
+// in its chunk and takes its first line number from a running total, handed on in
+// chunk order. Counting is much faster than parsing, so this wait is short. Rows
+// are rendered into the worker's memory writer and written out in chunk order.
+// With a history file, each worker appends its recipes through its own writer.
+// With a shard, workers still count every line but only compute their shard's.
+//
+// Chunk costs vary a lot: a megabyte of short records takes far longer to process
+// than a megabyte of comments. An idle worker always claims the next chunk, so no worker
+// runs out of work while chunks remain. Per-worker deques with stealing would not
+// help: output must follow input order, so the expensive part of skew is a worker
+// blocked behind a slow earlier chunk, not one without a chunk. A finished chunk
+// whose turn has not come is therefore parked and its worker moves on; whoever
+// writes a chunk also writes the parked chunks after it. At most `window` chunks
+// past the next one to write are claimed, which bounds the memory held.
+typedef struct {
+    char *mem;                  // Rendered rows (a memory writer's block)
+    size_t len;
+    size_t cap;
+    int ready;                  // Set once the chunk is parked here
+} BatchParked;
 
-    printf("Target Original Gravity (OG): %.3f\n", target_og);
-    printf("Required Honey:             %.2f lbs (pounds)\n", honey_lbs);
+typedef struct {
+    const char *data;
+    size_t size;
+    size_t chunks;
+    MeadOutputFormat format;
+    int fixed_point;
+    const MeadHoneyDb *honey_db;
+    const char *history_path;   // Recipes history, or NULL
+    const MeadShard *shard;     // Shard to compute, or NULL for all lines
+    atomic_size_t next_chunk;   // Next chunk to claim
+    size_t window;              // Chunks in flight past next_write, at most
+    BatchParked *parked;        // window slots, chunk index % window; guarded by lock
+    pthread_mutex_t lock;
+    pthread_cond_t turn;
+    size_t next_count;          // Next chunk allowed to take its first line number; guarded by lock
+    long lines;                 // Lines in chunks before next_count; guarded by lock
+    size_t next_write;          // Next chunk allowed to write; guarded by lock
+    int failures;               // Failed records so far; guarded by lock
+    int failed;                 // Set on allocation or write failure; guarded by lock
+    int history_failed;         // Set if a history writer failed; guarded by lock
+} BatchJob;
 
-    // Added clarification for when water volume is zero or negative
-    if (water_gal <= 0.0) {
-        printf("Required Water (to top off):  0.00 gallons (Honey volume meets or exceeds batch volume.)\n");
-    } else {
-        printf("Required Water (to top off):  %.2f gallons\n", water_gal);
+typedef struct {
+    BatchBlock block;
+    MeadWriter out;             // Memory writer (fd -1) holding one chunk's rows
+    MeadWriter row;             // Memory writer for framing one row (shard only)
+    MeadHistoryWriter history;
+} BatchWorker;
+
+// Offset of the first line starting in chunk index (size if there is none).
+static size_t batch_chunk_start(const BatchJob *job, size_t index) {
+    size_t pos = index * (size_t)BATCH_CHUNK_BYTES;
+    if (index == 0) {
+        return 0;
+    }
+    if (pos >= job->size) {
+        return job->size;
+    }
+    const char *nl = memchr(job->data + pos - 1, '\n', job->size - (pos - 1));
+    return nl ? (size_t)(nl - job->data) + 1 : job->size;
+}
+
+// Lines in [start, end), counting an unterminated last line of the file.
+static long batch_count_lines(const BatchJob *job, size_t start, size_t end) {
+    long lines = 0;
+    const char *p = job->data + start;
+    const char *stop = job->data + end;
+
+    while (p < stop && (p = memchr(p, '\n', (size_t)(stop - p))) != NULL) {
+        lines++;
+        p++;
+    }
+    if (end == job->size && end > start && job->data[end - 1] != '\n') {
+        lines++;
+    }
+    return lines;
+}
+
+// Parses, computes and renders every line in [start, end) into worker->out.
+static int batch_process_chunk(const BatchJob *job, BatchWorker *worker, size_t start, size_t end, long line_no) {
+    BatchBlock *block = &worker->block;
+    char line[BATCH_LINE_MAX];
+    int failures = 0;
+    const char *p = job->data + start;
+    const char *stop = job->data + end;
+
+    while (p < stop) {
+        const char *nl = memchr(p, '\n', (size_t)(stop - p));
+        const char *line_end = nl ? nl : stop;
+        size_t len = (size_t)(line_end - p);
+        line_no++;
+
+        // Same limit as the streaming reader: the line and its newline must fit in line[]
+        if (len >= sizeof(line) - 1) {
+            batch_block_add(block, line_no, NULL, "line too long", job->honey_db);
+        } else {
+            memcpy(line, p, len);
+            line[len] = '\0';
+            batch_add_line(block, line_no, line, job->honey_db);
+        }
+        if (block->count == BATCH_BLOCK_SIZE) {
+            failures += batch_block_flush(block, &worker->out, job->format);
+        }
+        p = line_end + 1;
+    }
+    failures += batch_block_flush(block, &worker->out, job->format);
+    mead_writer_flush(&worker->out);
+    return failures;
+}
+
+static void batch_fail(BatchJob *job) {
+    pthread_mutex_lock(&job->lock);
+    job->failed = 1;
+    pthread_cond_broadcast(&job->turn);
+    pthread_mutex_unlock(&job->lock);
+}
+
+static void *batch_worker(void *arg) {
+    BatchJob *job = arg;
+
+    // Allocated before claiming work so a failure can never strand a chunk
+    BatchWorker *worker = malloc(sizeof(*worker));
+    if (!worker) {
+        batch_fail(job);
+        return NULL;
+    }
+    worker->block.count = 0;
+    worker->block.fixed_point = job->fixed_point;
+    worker->block.stats = mead_stats_thread();
+    worker->block.history = NULL;
+    worker->block.shard = job->shard;
+    worker->block.row = job->shard ? &worker->row : NULL;
+    mead_writer_init(&worker->row, -1);
+    if (job->history_path) {
+        if (mead_history_writer_open(&worker->history, job->history_path, MEAD_HISTORY_RECIPES) != 0) {
+            free(worker);
+            pthread_mutex_lock(&job->lock);
+            job->history_failed = 1;
+            pthread_mutex_unlock(&job->lock);
+            batch_fail(job);
+            return NULL;
+        }
+        worker->block.history = &worker->history;
+    }
+    mead_writer_init(&worker->out, -1);
+    MeadStats *stats = worker->block.stats;
+
+    for (;;) {
+        size_t index = atomic_fetch_add(&job->next_chunk, 1);
+        if (index >= job->chunks) {
+            break;
+        }
+
+        size_t start = batch_chunk_start(job, index);
+        size_t end = batch_chunk_start(job, index + 1);
+        long lines = batch_count_lines(job, start, end);
+
+        // Line numbers continue from the previous chunk; the chunk must also fit the window
+        pthread_mutex_lock(&job->lock);
+        while ((job->next_count != index || index >= job->next_write + job->window) && !job->failed) {
+            pthread_cond_wait(&job->turn, &job->lock);
+        }
+        long first_line = job->lines;
+        job->lines += lines;
+        job->next_count++;
+        pthread_cond_broadcast(&job->turn);
+        int stop = job->failed;
+        pthread_mutex_unlock(&job->lock);
+        if (stop) {
+            break;
+        }
+
+        int failures = batch_process_chunk(job, worker, start, end, first_line);
+
+        // Ordered commit: park the rows unless every earlier chunk has been written
+        pthread_mutex_lock(&job->lock);
+        stop = job->failed || worker->out.error;
+        job->failures += failures;
+        if (!stop && job->next_write != index) {
+            // Trade buffers with the slot, so parking never copies or allocates
+            BatchParked *slot = &job->parked[index % job->window];
+            char *mem = slot->mem;
+            size_t cap = slot->cap;
+            slot->mem = worker->out.mem;
+            slot->len = worker->out.mem_len;
+            slot->cap = worker->out.mem_cap;
+            slot->ready = 1;
+            worker->out.mem = mem;
+            worker->out.mem_cap = cap;
+        } else if (!stop) {
+            uint64_t write_start = stats ? mead_stats_now() : 0;
+            stop = mead_write_all(STDOUT_FILENO, worker->out.mem, worker->out.mem_len) != 0;
+            job->next_write++;
+            for (BatchParked *slot = &job->parked[job->next_write % job->window];
+                 !stop && job->next_write < job->chunks && slot->ready;
+                 slot = &job->parked[job->next_write % job->window]) {
+                stop = mead_write_all(STDOUT_FILENO, slot->mem, slot->len) != 0;
+                slot->ready = 0;
+                job->next_write++;
+            }
+            mead_stats_record_since(stats, MEAD_STAGE_WRITE, write_start);
+        }
+        worker->out.mem_len = 0;
+        if (stop) {
+            job->failed = 1;
+        }
+        pthread_cond_broadcast(&job->turn);
+        pthread_mutex_unlock(&job->lock);
+
+        if (stop) {
+            break;
+        }
     }
 
-    printf("Total Gravity Points Needed:  %.0f\n", gravity_points_needed);
+    mead_writer_release(&worker->out);
+    mead_writer_release(&worker->row);
+    if (worker->block.history && mead_history_writer_close(worker->block.history) != 0) {
+        pthread_mutex_lock(&job->lock);
+        job->history_failed = 1;
+        pthread_mutex_unlock(&job->lock);
+    }
+    free(worker);
+    return NULL;
 }
 
 /**
- * @brief Performs calculations and converts output to Metric units (Liters/Kg).
- * * @param volume_L Batch volume in Liters.
- * @param target_og The calculated Original Gravity.
+ * @brief Runs batch mode over a mapped input file on several threads (see BatchJob).
+ * The header must already have been written to stdout.
+ * @param history_failed Output: non-zero if the history file could not be opened or written.
+ * @return int The number of failed records, or -1 if memory or a write failed.
  */
-void calculate_metric(double volume_L, double target_og) {
-    // Convert target volume to gallons for consistent calculation using PPG constant
-    double volume_gal = volume_L * L_TO_GAL;
+static int run_parallel_batch(const char *data, size_t size, MeadOutputFormat format, int fixed_point,
+                              int threads, const MeadShard *shard, const MeadHoneyDb *honey_db,
+                              const char *history_path, int *history_failed) {
+    BatchJob job;
+    job.data = data;
+    job.size = size;
+    job.chunks = (size + BATCH_CHUNK_BYTES - 1) / BATCH_CHUNK_BYTES;
+    job.format = format;
+    job.fixed_point = fixed_point;
+    job.honey_db = honey_db;
+    job.history_path = history_path;
+    job.shard = shard;
+    atomic_init(&job.next_chunk, 0);
+    job.window = (size_t)threads * BATCH_WINDOW_PER_THREAD;
+    job.parked = calloc(job.window, sizeof(*job.parked));
+    if (!job.parked) {
+        *history_failed = 0;
+        return -1;
+    }
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.turn, NULL);
+    job.next_count = 0;
+    job.lines = 0;
+    job.next_write = 0;
+    job.failures = 0;
+    job.failed = 0;
+    job.history_failed = 0;
 
-    // Calculate honey needed in pounds (Lbs) using the US Imperial function's logic
-    double gravity_points_needed = (target_og - 1.000) * 1000.0 * volume_gal;
-    double honey_lbs_calc = gravity_points_needed / GRAVITY_POINTS_PER_UNIT;
+    if ((size_t)threads > job.chunks) {
+        threads = (int)job.chunks;
+    }
 
-    // Convert honey from Lbs to Kilograms (CORRECTION APPLIED HERE: Division instead of multiplication)
-    double honey_kg = honey_lbs_calc / KG_TO_LBS;
+    // The calling thread works too, so only threads - 1 extra workers are started
+    pthread_t *workers = (threads > 1) ? malloc(sizeof(pthread_t) * (size_t)(threads - 1)) : NULL;
+    int started = 0;
+    if (workers) {
+        while (started < threads - 1 && pthread_create(&workers[started], NULL, batch_worker, &job) == 0) {
+            started++;
+        }
+    }
+    batch_worker(&job);
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    free(workers);
 
-    // Honey volume: assume 1 kg displaces ~0.74 Liters
-    double honey_volume_L = honey_kg * 0.74;
-    double water_L = volume_L - honey_volume_L;
+    for (size_t i = 0; i < job.window; i++) {
+        free(job.parked[i].mem);
+    }
+    free(job.parked);
+    pthread_cond_destroy(&job.turn);
+    pthread_mutex_destroy(&job.lock);
+    *history_failed = job.history_failed;
+    return (job.failed || job.next_write != job.chunks) ? -1 : job.failures;
+}
 
-    printf("Target Original Gravity (OG): %.3f\n", target_og);
-    printf("Required Honey:             %.2f kg (kilograms)\n", honey_kg);
+/**
+ * @brief Maps a regular, non-empty input file for the parallel batch path.
+ * @return const char* The mapping (size bytes long), or NULL to fall back to streaming.
+ */
+static const char *batch_map_input(const char *path, size_t *size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    void *data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+    madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+    *size = (size_t)st.st_size;
+    return data;
+}
 
-    // Added clarification for when water volume is zero or negative
-    if (water_L <= 0.0) {
-        printf("Required Water (to top off):  0.00 liters (Honey volume meets or exceeds batch volume.)\n");
-    } else {
-        printf("Required Water (to top off):  %.2f liters\n", water_L);
+/**
+ * @brief Appends the size of a regular input file to a shard job description, so the
+ * partial files of different inputs do not merge (pipes cannot be checked).
+ */
+static void shard_job_input(char *job, size_t capacity, const char *path) {
+    struct stat st;
+    int ok = (strcmp(path, "-") == 0) ? fstat(STDIN_FILENO, &st) == 0 : stat(path, &st) == 0;
+    if (ok && S_ISREG(st.st_mode)) {
+        size_t len = strlen(job);
+        snprintf(job + len, capacity - len, " input-bytes=%lld", (long long)st.st_size);
+    }
+}
+
+/**
+ * @brief Writes the header of batch output, or with a shard, of a partial result file.
+ */
+static void batch_write_header(MeadWriter *out, MeadOutputFormat format, int fixed_point, const MeadShard *shard,
+                               const MeadHoneyDb *honey_db, const char *path) {
+    if (!shard) {
+        mead_write_header(out, format);
+        return;
+    }
+    char job[MEAD_SHARD_JOB_MAX];
+    snprintf(job, sizeof(job), "batch fixed=%d lots=%u", fixed_point, honey_db ? (unsigned)honey_db->count : 0u);
+    shard_job_input(job, sizeof(job), path);
+    mead_shard_write_header(out, MEAD_SHARD_BATCH, format, shard, job);
+}
+
+// --- Batch Mode Entry ---
+
+/**
+ * @brief Reads recipe records from a file or stdin and writes one result row per record.
+ * Records are read one line at a time into a fixed buffer and computed in fixed-size
+ * blocks, so memory use does not grow with the input size. Invalid records produce an
+ * error row instead of stopping the run. Rows go through a MeadWriter straight to
+ * stdout, bypassing stdio. A regular input file is mapped and processed by several
+ * threads when threads is not 1; the output is the same as with one thread.
+ * With a shard, only the lines (l - 1) % N == i are computed and the rows are written
+ * as a partial result file (mead_shard.h) for run_merge_mode().
+ * @param path Input file path, or "-" for stdin.
+ * @param format Output format (CSV, NDJSON or human-readable).
+ * @param fixed_point Non-zero to compute with integer gravity points (mead_og_points()).
+ * @param threads Worker threads for a file input (<= 0 for one per online CPU).
+ * @param shard Shard to compute, or NULL for the whole input.
+ * @param honey_db Honey lot database for records that name a lot, or NULL.
+ * @param history_path History file to append the calculated recipes to, or NULL.
+ * @return int 0 if every record was calculated, 1 if any record failed or the input could not be read.
+ */
+int run_batch_mode(const char *path, MeadOutputFormat format, int fixed_point, int threads, const MeadShard *shard,
+                   const MeadHoneyDb *honey_db, const char *history_path) {
+    static MeadWriter out;
+    static MeadWriter row;
+
+    if (threads <= 0) {
+        threads = mead_sweep_default_threads();
+    }
+    if (threads > 1 && strcmp(path, "-") != 0) {
+        size_t size;
+        const char *data = batch_map_input(path, &size);
+        if (data) {
+            mead_writer_init(&out, STDOUT_FILENO);
+            batch_write_header(&out, format, fixed_point, shard, honey_db, path);
+            int history_failed = 0;
+            int failures = (mead_writer_flush(&out) == 0)
+                               ? run_parallel_batch(data, size, format, fixed_point, threads, shard, honey_db,
+                                                    history_path, &history_failed)
+                               : -1;
+            munmap((void *)data, size);
+            if (history_failed) {
+                fprintf(stderr, "Error: Failed writing history '%s'.\n", history_path);
+                return 1;
+            }
+            if (failures < 0) {
+                fprintf(stderr, "Error: Failed writing batch output.\n");
+                return 1;
+            }
+            return failures ? 1 : 0;
+        }
+    }
+
+    FILE *in = (strcmp(path, "-") == 0) ? stdin : fopen(path, "r");
+    if (!in) {
+        fprintf(stderr, "Error: Cannot open batch input '%s'.\n", path);
+        return 1;
+    }
+
+    static BatchBlock block;
+    static MeadHistoryWriter history;
+    char line[BATCH_LINE_MAX];
+    long line_no = 0;
+    int failures = 0;
+
+    block.fixed_point = fixed_point;
+    block.stats = mead_stats_thread();
+    block.history = NULL;
+    block.shard = shard;
+    block.row = shard ? &row : NULL;
+    mead_writer_init(&row, -1);
+    if (history_path) {
+        if (mead_history_writer_open(&history, history_path, MEAD_HISTORY_RECIPES) != 0) {
+            fprintf(stderr, "Error: Cannot open history '%s'.\n", history_path);
+            if (in != stdin) {
+                fclose(in);
+            }
+            return 1;
+        }
+        block.history = &history;
+    }
+    mead_writer_init(&out, STDOUT_FILENO);
+    batch_write_header(&out, format, fixed_point, shard, honey_db, path);
+
+    while (fgets(line, sizeof(line), in)) {
+        line_no++;
+
+        // A line that does not fit the buffer is rejected and the rest of it skipped
+        size_t len = strlen(line);
+        if (len == sizeof(line) - 1 && line[len - 1] != '\n' && !feof(in)) {
+            int c;
+            while ((c = fgetc(in)) != EOF && c != '\n');
+            batch_block_add(&block, line_no, NULL, "line too long", honey_db);
+        } else {
+            batch_add_line(&block, line_no, line, honey_db);
+        }
+
+        if (block.count == BATCH_BLOCK_SIZE) {
+            failures += batch_block_flush(&block, &out, format);
+        }
+    }
+    failures += batch_block_flush(&block, &out, format);
+    mead_writer_release(&row);
+
+    int read_error = ferror(in);
+    if (in != stdin) {
+        fclose(in);
+    }
+    if (block.history && mead_history_writer_close(block.history) != 0) {
+        fprintf(stderr, "Error: Failed writing history '%s'.\n", history_path);
+        mead_writer_flush(&out);
+        return 1;
+    }
+    if (mead_writer_flush(&out) != 0) {
+        fprintf(stderr, "Error: Failed writing batch output.\n");
+        return 1;
+    }
+    if (read_error) {
+        fprintf(stderr, "Error: Failed reading batch input '%s'.\n", path);
+        return 1;
+    }
+    return failures ? 1 : 0;
+}
+
+// --- Inverse Mode ---
+
+// One inverse query: honey on hand plus either a target ABV or a batch volume.
+typedef struct {
+    MeadRecord base;   // unit, sweetness and yeast_mode, plus abv or volume
+    double honey;       // lbs or kg
+    int solve_volume;   // Non-zero: find the largest volume for base.abv; zero: find the ABV for base.volume
+} InverseRecord;
+
+/**
+ * @brief Parses an inverse CSV record: unit,honey,sweetness,yeast,abv,volume.
+ * Exactly one of abv and volume must be given; the other is left empty.
+ * @return const char* NULL on success, otherwise an error message.
+ */
+static const char *parse_inverse_record(char *line, InverseRecord *rec) {
+    char *fields[6];
+    int count = 0;
+
+    for (char *field = line; count < 6; count++) {
+        fields[count] = field;
+        char *comma = strchr(field, ',');
+        if (!comma) {
+            count++;
+            break;
+        }
+        *comma = '\0';
+        field = comma + 1;
     }
+    if (count != 6 || strchr(fields[5], ',')) {
+        return "expected 6 fields (unit,honey,sweetness,yeast,abv,volume)";
+    }
+    for (int i = 0; i < 6; i++) {
+        fields[i] = mead_trim_field(fields[i]);
+    }
+
+    const char *err;
+    char *end;
+    if ((err = mead_set_record_field(&rec->base, 0, fields[0])) != NULL) return err;
+    if ((err = mead_set_record_field(&rec->base, 3, fields[2])) != NULL) return err;
+    if ((err = mead_set_record_field(&rec->base, 4, fields[3])) != NULL) return err;
+
+    rec->honey = strtod(fields[1], &end);
+    if (end == fields[1] || *end != '\0' || !(rec->honey > 0.0)) {
+        return "invalid honey amount";
+    }
+
+    rec->solve_volume = (*fields[4] != '\0');
+    if (rec->solve_volume == (*fields[5] != '\0')) {
+        return "give either abv or volume (not both)";
+    }
+    return rec->solve_volume ? mead_set_record_field(&rec->base, 2, fields[4])
+                             : mead_set_record_field(&rec->base, 1, fields[5]);
+}
+
+/**
+ * @brief Reads honey inventory queries and answers each with the largest batch volume
+ * (for a target ABV) or the ABV reached (for a batch volume), one CSV row per query.
+ * @param path Input file path, or "-" for stdin.
+ * @return int 0 if every query was answered, 1 otherwise.
+ */
+int run_inverse_mode(const char *path) {
+    FILE *in = (strcmp(path, "-") == 0) ? stdin : fopen(path, "r");
+    if (!in) {
+        fprintf(stderr, "Error: Cannot open inverse input '%s'.\n", path);
+        return 1;
+    }
+
+    char line[BATCH_LINE_MAX];
+    long line_no = 0;
+    int failures = 0;
+
+    printf("line,unit,honey,sweetness,yeast,abv,volume,og,fg,water,status\n");
+
+    while (fgets(line, sizeof(line), in)) {
+        line_no++;
+
+        size_t len = strlen(line);
+        if (len == sizeof(line) - 1 && line[len - 1] != '\n' && !feof(in)) {
+            int c;
+            while ((c = fgetc(in)) != EOF && c != '\n');
+            printf("%ld,,,,,,,,,,error: line too long\n", line_no);
+            failures++;
+            continue;
+        }
+
+        char *rec_str = mead_trim_space(line);
+        if (*rec_str == '\0' || *rec_str == '#') {
+            continue;
+        }
+
+        InverseRecord rec;
+        const char *err = parse_inverse_record(rec_str, &rec);
+        if (err && line_no == 1 && strncasecmp(rec_str, "unit", 4) == 0) {
+            continue; // CSV header row
+        }
+        if (err) {
+            printf("%ld,,,,,,,,,,error: %s\n", line_no, err);
+            failures++;
+            continue;
+        }
+
+        MeadInverseResult result;
+        MeadUnit unit = (MeadUnit)rec.base.unit;
+        if (rec.solve_volume) {
+            mead_solve_volume(unit, rec.honey, rec.base.abv, rec.base.sweetness, rec.base.yeast_mode,
+                              MEAD_DEFAULT_FG_TABLE, &result);
+        } else {
+            mead_solve_abv(unit, rec.honey, rec.base.volume, rec.base.sweetness, rec.base.yeast_mode,
+                           MEAD_DEFAULT_FG_TABLE, &result);
+        }
+
+        const char *status = "ok";
+        if (result.abv <= 0.0) {
+            status = "error: not enough honey to reach the final gravity";
+            failures++;
+        } else if (result.og_too_high) {
+            status = "warning: OG above 1.225";
+        } else if (result.abv < MEAD_MIN_ABV || result.abv > MEAD_MAX_ABV) {
+            status = "warning: ABV outside 5-25%";
+        }
+
+        printf("%ld,%s,%.2f,%s,%s,%.2f,%.2f,%.3f,%.3f,%.2f,%s\n", line_no,
+               (unit == MEAD_UNIT_US_IMPERIAL) ? "Gallons" : "Liters", rec.honey,
+               mead_sweetness_name(rec.base.sweetness), (rec.base.yeast_mode == 1) ? "Standard" : "Turbo",
+               result.abv, result.volume, result.og, result.fg, result.water, status);
+    }
+
+    int read_error = ferror(in);
+    if (in != stdin) {
+        fclose(in);
+    }
+    if (read_error) {
+        fprintf(stderr, "Error: Failed reading inverse input '%s'.\n", path);
+        return 1;
+    }
+    return failures ? 1 : 0;
+}
+
+// --- Sweep Mode ---
+
+/**
+ * @brief Parses "A:B" or "A:B:C" into up to three doubles.
+ * @return int The number of values parsed.
+ */
+static int parse_range(const char *s, double *a, double *b, double *c) {
+    char tail;
+    int n = sscanf(s, "%lf:%lf:%lf%c", a, b, c, &tail);
+    if (n == 3) return 3;
+    n = sscanf(s, "%lf:%lf%c", a, b, &tail);
+    return (n == 2) ? 2 : 0;
+}
+
+// Appends a string to a sweep row.
+static size_t row_append(char *row, size_t n, const char *s) {
+    size_t len = strlen(s);
+    memcpy(row + n, s, len);
+    return n + len;
+}
+
+// Appends a fixed-precision number and its trailing separator to a sweep row.
+static size_t row_fixed(char *row, size_t n, double value, int decimals, char sep) {
+    n += mead_format_fixed(row + n, value, decimals);
+    row[n++] = sep;
+    return n;
+}
+
+/**
+ * @brief Sweep sink: renders one chunk of cells as CSV rows (runs on the worker threads).
+ * Same output as "%.2f,%s,%d,%s,%s,%.3f,%.3f,%.2f,%.2f,%.0f", without the printf overhead.
+ */
+static size_t format_sweep_csv(const MeadSweepChunk *chunk, char *buf, size_t capacity, void *user) {
+    (void)user;
+    size_t len = 0;
+
+    for (size_t i = 0; i < chunk->count; i++) {
+        // Every number is formatted into room for MEAD_FIXED_MAX bytes, then copied
+        char row[MEAD_SWEEP_ROW_MAX + MEAD_FIXED_MAX];
+        size_t n = row_fixed(row, 0, chunk->volume[i], 2, ',');
+        n = row_append(row, n, (chunk->units[i] == MEAD_UNIT_US_IMPERIAL) ? "Gallons," : "Liters,");
+        n = row_fixed(row, n, (double)chunk->abv[i], 0, ',');
+        n = row_append(row, n, mead_sweetness_name(chunk->sweetness[i]));
+        n = row_append(row, n, (chunk->yeast_mode[i] == 1) ? ",Standard," : ",Turbo,");
+        n = row_fixed(row, n, chunk->og[i], 3, ',');
+        n = row_fixed(row, n, chunk->fg[i], 3, ',');
+        n = row_fixed(row, n, chunk->honey[i], 2, ',');
+        n = row_fixed(row, n, chunk->water[i], 2, ',');
+        n = row_fixed(row, n, chunk->gravity_points[i], 0, '\n');
 
-    printf("Total Gravity Points Needed:  %.0f (Based on US Gal/Lbs)\n", gravity_points_needed);
+        if (n > MEAD_SWEEP_ROW_MAX || n > capacity - len) {
+            break; // Cannot happen with SWEEP_VOLUME_MAX; rows are bounded by MEAD_SWEEP_ROW_MAX
+        }
+        memcpy(buf + len, row, n);
+        len += n;
+    }
+    return len;
+}
+
+/**
+ * @brief Sweep sink: renders one chunk of cells as binary records (runs on the worker threads).
+ */
+static size_t format_sweep_binary(const MeadSweepChunk *chunk, char *buf, size_t capacity, void *user) {
+    (void)user;
+    size_t len = 0;
+
+    for (size_t i = 0; i < chunk->count && capacity - len >= sizeof(MeadBinaryRecord); i++) {
+        MeadBinaryRecord rec = { (int64_t)(chunk->first + i + 1), chunk->volume[i], (double)chunk->abv[i],
+                                 chunk->og[i], chunk->fg[i], chunk->honey[i], chunk->water[i],
+                                 chunk->gravity_points[i], chunk->units[i], (uint8_t)chunk->sweetness[i],
+                                 chunk->yeast_mode[i], 0, 0 };
+        rec.flags = ((chunk->water[i] > 0.0) ? 0 : MEAD_BINARY_WATER_CLAMPED) |
+                    ((chunk->og[i] > MEAD_MAX_OG) ? MEAD_BINARY_OG_TOO_HIGH : 0);
+        len += mead_format_binary_record(buf + len, &rec);
+    }
+    return len;
+}
+
+/**
+ * @brief Sweep sink: writes a formatted chunk to stdout (called in cell order).
+ */
+static int write_sweep_stdout(const char *buf, size_t len, void *user) {
+    (void)user;
+    return (fwrite(buf, 1, len, stdout) == len) ? 0 : -1;
+}
+
+/**
+ * @brief Sweep sink for --shard: frames each chunk formatted by the sink in user,
+ * keyed by the chunk's first cell (runs on the worker threads).
+ */
+static size_t format_sweep_shard(const MeadSweepChunk *chunk, char *buf, size_t capacity, void *user) {
+    const MeadSweepSink *inner = user;
+    size_t len = inner->format(chunk, buf + sizeof(MeadShardFrame), capacity - sizeof(MeadShardFrame), inner->user);
+    return mead_shard_format_frame(buf, chunk->first, 0, len) + len;
+}
+
+/**
+ * @brief Writes the CSV column names or the binary header that start sweep output.
+ */
+static void write_sweep_header(MeadWriter *out, MeadOutputFormat format) {
+    if (format == MEAD_FORMAT_BINARY) {
+        char header[sizeof(MeadBinaryHeader)];
+        mead_writer_put(out, header, mead_format_binary_header(header));
+    } else {
+        mead_writer_puts(out, "volume,unit,abv,sweetness,yeast,og,fg,honey,water,gravity_points\n");
+    }
+}
+
+/**
+ * @brief Runs the full volume x ABV x sweetness x yeast mode matrix and writes it as CSV
+ * or binary records. Sweep cells are never rejected: a cell above MEAD_MAX_OG is
+ * calculated and, in binary, flagged with MEAD_BINARY_OG_TOO_HIGH.
+ * Options: --unit Gallons|Liters, --volume START:STOP:STEP, --abv MIN:MAX, --threads N,
+ * --format csv|binary, --shard I/N (write a partial result file of one contiguous
+ * part of the matrix instead).
+ * @return int 0 on success, 1 on invalid options or output failure.
+ */
+int run_sweep_mode(int argc, char *argv[]) {
+    MeadSweepSpec spec = { MEAD_UNIT_METRIC, 5.0, 2000.0, 5.0, MEAD_MIN_ABV, MEAD_MAX_ABV };
+    MeadOutputFormat format = MEAD_FORMAT_CSV;
+    int threads = 0;
+    MeadShard shard = { 0, 1 };
+    int sharded = 0;
+
+    for (int i = 0; i < argc; i++) {
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        double a, b, c;
+
+        if (!value) {
+            fprintf(stderr, "Error: Missing value for sweep option '%s'.\n", argv[i]);
+            return 1;
+        } else if (strcmp(argv[i], "--unit") == 0) {
+            spec.unit = (MeadUnit)mead_parse_unit(value);
+        } else if (strcmp(argv[i], "--volume") == 0 && parse_range(value, &a, &b, &c) == 3) {
+            spec.volume_start = a;
+            spec.volume_stop = b;
+            spec.volume_step = c;
+        } else if (strcmp(argv[i], "--abv") == 0 && parse_range(value, &a, &b, &c) == 2 &&
+                   a >= MEAD_MIN_ABV && b <= MEAD_MAX_ABV && a == floor(a) && b == floor(b)) {
+            spec.abv_min = (int)a;
+            spec.abv_max = (int)b;
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            char *end;
+            long n = strtol(value, &end, 10);
+            if (end == value || *end != '\0' || n < 0 || n > INT_MAX) {
+                fprintf(stderr, "Error: Invalid sweep option '%s %s'.\n", argv[i], value);
+                return 1;
+            }
+            threads = (int)n;
+        } else if (strcmp(argv[i], "--format") == 0 &&
+                   (strcasecmp(value, "csv") == 0 || strcasecmp(value, "binary") == 0)) {
+            format = (strcasecmp(value, "binary") == 0) ? MEAD_FORMAT_BINARY : MEAD_FORMAT_CSV;
+        } else if (strcmp(argv[i], "--shard") == 0 && mead_parse_shard(value, &shard) == 0) {
+            sharded = 1;
+        } else {
+            fprintf(stderr, "Error: Invalid sweep option '%s %s'.\n", argv[i], value);
+            return 1;
+        }
+        i++;
+    }
+
+    if (mead_sweep_validate(&spec) != 0 || spec.volume_stop > SWEEP_VOLUME_MAX) {
+        fprintf(stderr, "Error: Invalid sweep range (volume 0 < START <= STOP <= %g, STEP > 0; ABV %d-%d).\n",
+                SWEEP_VOLUME_MAX, MEAD_MIN_ABV, MEAD_MAX_ABV);
+        return 1;
+    }
+
+    // The header goes out before any chunk, so stdio has nothing buffered yet
+    static MeadWriter out;
+    mead_writer_init(&out, STDOUT_FILENO);
+    if (sharded) {
+        char job[MEAD_SHARD_JOB_MAX];
+        snprintf(job, sizeof(job), "sweep unit=%d volume=%.17g:%.17g:%.17g abv=%d:%d", (int)spec.unit,
+                 spec.volume_start, spec.volume_stop, spec.volume_step, spec.abv_min, spec.abv_max);
+        mead_shard_write_header(&out, MEAD_SHARD_SWEEP, format, &shard, job);
+    } else {
+        write_sweep_header(&out, format);
+    }
+    if (mead_writer_flush(&out) != 0) {
+        fprintf(stderr, "Error: Sweep failed.\n");
+        return 1;
+    }
+
+    MeadSweepSink rows = { (format == MEAD_FORMAT_BINARY) ? format_sweep_binary : format_sweep_csv,
+                           write_sweep_stdout, NULL };
+    MeadSweepSink framed = { format_sweep_shard, write_sweep_stdout, &rows };
+    if (mead_sweep_run_shard(&spec, shard.index, shard.count, threads, sharded ? &framed : &rows) != 0 ||
+        fflush(stdout) != 0) {
+        fprintf(stderr, "Error: Sweep failed.\n");
+        return 1;
+    }
+    return 0;
+}
+
+// --- Monte Carlo Mode ---
+
+// Reported percentiles of honey and water, in CSV column order.
+static const double MC_PERCENTILES[] = { 0.05, 0.50, 0.95 };
+
+static const char MC_CSV_HEADER[] =
+    "line,unit,volume,abv,sweetness,yeast,trials,honey_unit,honey_mean,honey_p5,honey_p50,"
+    "honey_p95,water_unit,water_mean,water_p5,water_p50,water_p95,og_too_high_pct,status\n";
+
+/**
+ * @brief Writes one Monte Carlo CSV row: mean and percentiles of honey and water.
+ */
+static void write_montecarlo_row(MeadWriter *out, long line_no, const MeadRecord *rec, const char *err,
+                                 const MeadMonteCarloSummary *summary) {
+    int imperial = (rec && rec->unit == MEAD_UNIT_US_IMPERIAL);
+
+    mead_writer_long(out, line_no);
+    if (!rec) {
+        mead_writer_puts(out, ",,,,,,,,,,,,,,,,,,error: ");
+        mead_writer_puts(out, err);
+        mead_writer_puts(out, "\n");
+        return;
+    }
+
+    mead_writer_puts(out, imperial ? ",Gallons," : ",Liters,");
+    mead_writer_fixed(out, rec->volume, 2);
+    mead_writer_puts(out, ",");
+    mead_writer_number(out, rec->abv);
+    mead_writer_puts(out, ",");
+    mead_writer_puts(out, mead_sweetness_name(rec->sweetness));
+    mead_writer_puts(out, (rec->yeast_mode == 1) ? ",Standard," : ",Turbo,");
+    if (err) {
+        mead_writer_puts(out, ",,,,,,,,,,,,error: ");
+        mead_writer_puts(out, err);
+        mead_writer_puts(out, "\n");
+        return;
+    }
+
+    mead_writer_long(out, (long)summary->trials);
+    mead_writer_puts(out, imperial ? ",lbs," : ",kg,");
+    mead_writer_fixed(out, summary->honey_mean, 2);
+    for (size_t i = 0; i < sizeof(MC_PERCENTILES) / sizeof(MC_PERCENTILES[0]); i++) {
+        mead_writer_puts(out, ",");
+        mead_writer_fixed(out, mead_sketch_quantile(&summary->honey, MC_PERCENTILES[i]), 2);
+    }
+    mead_writer_puts(out, imperial ? ",gallons," : ",liters,");
+    mead_writer_fixed(out, summary->water_mean, 2);
+    for (size_t i = 0; i < sizeof(MC_PERCENTILES) / sizeof(MC_PERCENTILES[0]); i++) {
+        mead_writer_puts(out, ",");
+        mead_writer_fixed(out, mead_sketch_quantile(&summary->water, MC_PERCENTILES[i]), 2);
+    }
+    mead_writer_puts(out, ",");
+    mead_writer_fixed(out, 100.0 * (double)summary->og_too_high / (double)summary->trials, 2);
+    mead_writer_puts(out, ",ok\n");
+}
+
+/**
+ * @brief Reads batch records and writes honey/water confidence intervals for each.
+ * Options: --trials N, --seed S, --threads N, --ppg DIST, --displacement DIST,
+ * --abv-factor DIST (see mead_parse_distribution()), --shard I/N, then an optional input FILE.
+ * Each record's trial stream is keyed by its line number, so a record gives the same
+ * result wherever it appears in the file and whatever the thread count. With a shard,
+ * every record gets only that shard's trials, and the record and its packed summary
+ * are written as a frame of a partial result file (error rows as text frames).
+ * @return int 0 if every record was calculated, 1 on invalid options, failed records or I/O errors.
+ */
+int run_montecarlo_mode(int argc, char *argv[]) {
+    MeadMonteCarloConfig config;
+    const char *path = "-";
+    MeadShard shard = { 0, 1 };
+    int sharded = 0;
+
+    mead_montecarlo_defaults(&config);
+    for (int i = 0; i < argc; i++) {
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        char *end = NULL;
+        int ok = 1;
+
+        if (!value && i == argc - 1 && strncmp(argv[i], "--", 2) != 0) {
+            path = argv[i];
+            break;
+        }
+        if (!value) {
+            fprintf(stderr, "Error: Missing value for Monte Carlo option '%s'.\n", argv[i]);
+            return 1;
+        } else if (strcmp(argv[i], "--trials") == 0) {
+            config.trials = strtol(value, &end, 10);
+            ok = *end == '\0' && config.trials > 0 && config.trials <= MEAD_MC_MAX_TRIALS;
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            config.seed = strtoull(value, &end, 10);
+            ok = *end == '\0' && end != value;
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            long threads = strtol(value, &end, 10);
+            ok = *end == '\0' && end != value && threads >= 0 && threads <= INT_MAX;
+            config.threads = (int)threads;
+        } else if (strcmp(argv[i], "--ppg") == 0) {
+            ok = mead_parse_distribution(value, &config.ppg) == 0;
+        } else if (strcmp(argv[i], "--displacement") == 0) {
+            ok = mead_parse_distribution(value, &config.displacement) == 0;
+        } else if (strcmp(argv[i], "--abv-factor") == 0) {
+            ok = mead_parse_distribution(value, &config.abv_factor) == 0;
+        } else if (strcmp(argv[i], "--shard") == 0) {
+            ok = mead_parse_shard(value, &shard) == 0;
+            sharded = 1;
+        } else {
+            ok = 0;
+        }
+        if (!ok) {
+            fprintf(stderr, "Error: Invalid Monte Carlo option '%s %s'.\n", argv[i], value);
+            return 1;
+        }
+        i++;
+    }
+
+    FILE *in = (strcmp(path, "-") == 0) ? stdin : fopen(path, "r");
+    if (!in) {
+        fprintf(stderr, "Error: Cannot open Monte Carlo input '%s'.\n", path);
+        return 1;
+    }
+
+    static MeadMonteCarloSummary summary;
+    static MeadWriter out;
+    static MeadWriter row;   // With a shard: memory writer error rows are framed from
+    MeadWriter *rows = sharded ? &row : &out;
+    MeadArena scratch; // Worker state, reused by every record
+    char line[BATCH_LINE_MAX];
+    long line_no = 0;
+    int failures = 0;
+
+    mead_arena_init(&scratch, MC_SCRATCH_CHUNK, 0);
+    config.scratch = &scratch;
+    config.shard_index = shard.index;
+    config.shard_count = shard.count;
+    mead_writer_init(&out, STDOUT_FILENO);
+    mead_writer_init(&row, -1);
+    if (sharded) {
+        const MeadDistribution *d[3] = { &config.ppg, &config.displacement, &config.abv_factor };
+        char job[MEAD_SHARD_JOB_MAX];
+        snprintf(job, sizeof(job), "montecarlo trials=%ld seed=%llu", config.trials, (unsigned long long)config.seed);
+        for (int k = 0; k < 3; k++) {
+            size_t len = strlen(job);
+            snprintf(job + len, sizeof(job) - len, " %d:%.17g:%.17g:%.17g", (int)d[k]->kind, d[k]->a, d[k]->b,
+                     d[k]->c);
+        }
+        shard_job_input(job, sizeof(job), path);
+        mead_shard_write_header(&out, MEAD_SHARD_MONTECARLO, MEAD_FORMAT_CSV, &shard, job);
+    } else {
+        mead_writer_puts(&out, MC_CSV_HEADER);
+    }
+
+    while (fgets(line, sizeof(line), in)) {
+        line_no++;
+
+        size_t len = strlen(line);
+        if (len == sizeof(line) - 1 && line[len - 1] != '\n' && !feof(in)) {
+            int c;
+            while ((c = fgetc(in)) != EOF && c != '\n');
+            write_montecarlo_row(rows, line_no, NULL, "line too long", NULL);
+            if (sharded) {
+                mead_shard_write_rows(&out, (uint64_t)line_no, MEAD_SHARD_FAILED, &row);
+            }
+            failures++;
+            continue;
+        }
+        char *rec_str = mead_trim_space(line);
+        if (*rec_str == '\0' || *rec_str == '#') {
+            continue;
+        }
+
+        MeadRecord rec;
+        const char *err = mead_parse_record(rec_str, &rec);
+        if (err && line_no == 1 && *rec_str != '{' && strncasecmp(rec_str, "unit", 4) == 0) {
+            continue; // CSV header row
+        }
+        if (err) {
+            write_montecarlo_row(rows, line_no, NULL, err, NULL);
+        } else if (rec.lot[0] != '\0') {
+            err = "honey lots are not supported in Monte Carlo mode (set --ppg instead)";
+            write_montecarlo_row(rows, line_no, &rec, err, NULL);
+        } else if (mead_montecarlo_run(&config, (uint64_t)line_no, (MeadUnit)rec.unit, rec.volume, rec.abv,
+                                       rec.sweetness, rec.yeast_mode, &summary) != 0) {
+            err = "out of memory";
+            write_montecarlo_row(rows, line_no, &rec, err, NULL);
+        } else if (sharded) {
+            // The record and its packed summary, in the scratch arena until the next run resets it
+            size_t size = sizeof(rec) + mead_montecarlo_packed_size(&summary);
+            char *data = mead_arena_alloc(&scratch, size);
+            if (data) {
+                memcpy(data, &rec, sizeof(rec));
+                mead_montecarlo_pack(&summary, data + sizeof(rec));
+                mead_shard_write_frame(&out, (uint64_t)line_no, MEAD_SHARD_SUMMARY, data, size);
+            } else {
+                err = "out of memory";
+                write_montecarlo_row(rows, line_no, &rec, err, NULL);
+            }
+        } else {
+            write_montecarlo_row(&out, line_no, &rec, NULL, &summary);
+        }
+        if (err && sharded) {
+            mead_shard_write_rows(&out, (uint64_t)line_no, MEAD_SHARD_FAILED, &row);
+        }
+        failures += (err != NULL);
+    }
+    mead_arena_free(&scratch);
+    mead_writer_release(&row);
+
+    int read_error = ferror(in);
+    if (in != stdin) {
+        fclose(in);
+    }
+    if (mead_writer_flush(&out) != 0) {
+        fprintf(stderr, "Error: Failed writing Monte Carlo output.\n");
+        return 1;
+    }
+    if (read_error) {
+        fprintf(stderr, "Error: Failed reading Monte Carlo input '%s'.\n", path);
+        return 1;
+    }
+    return failures ? 1 : 0;
+}
+
+// --- Fermentation Mode ---
+
+// One record of a fermentation run; err is NULL if the batch was simulated.
+typedef struct {
+    long line_no;
+    const char *err;
+    int has_inputs;
+    MeadRecord rec;
+    int32_t og_points;
+    size_t batch;       // Index in the cellar
+} FermentEntry;
+
+/**
+ * @brief Parses "DAY:POINTS" for --feed.
+ * @return int 0 on success, -1 if malformed or out of range.
+ */
+static int parse_feed(const char *s, int *day, double *points) {
+    char tail;
+    if (sscanf(s, "%d:%lf%c", day, points, &tail) != 2) {
+        return -1;
+    }
+    return (*day >= 0 && *day < MEAD_FERMENT_MAX_DAYS && *points > 0.0 && *points <= MEAD_MAX_OG_POINTS) ? 0 : -1;
+}
+
+// Writes a gravity given in points as SG, e.g. 7.2 -> "1.007".
+static void write_sg(MeadWriter *out, double points) {
+    mead_writer_fixed(out, 1.000 + points / MEAD_SG_SCALE, 3);
+}
+
+/**
+ * @brief Reads batch records as a cellar of fermenters and simulates them day by day.
+ * Options: --days N (default 90), --temp C (default 20), --feed DAY:POINTS (up to
+ * MEAD_FERMENT_MAX_FEEDS, applied to every batch), --curve, then an optional FILE.
+ * Writes one summary row per record, or with --curve the gravity of every batch at the
+ * end of every day.
+ * @return int 0 if every record was simulated, 1 on invalid options, failed records or I/O errors.
+ */
+int run_ferment_mode(int argc, char *argv[]) {
+    const char *path = "-";
+    int days = 90, curve_output = 0, feeds = 0;
+    int feed_day[MEAD_FERMENT_MAX_FEEDS];
+    double feed_points[MEAD_FERMENT_MAX_FEEDS];
+    double temperature = 20.0;
+
+    for (int i = 0; i < argc; i++) {
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        char *end = NULL;
+        int ok = 1;
+
+        if (strcmp(argv[i], "--curve") == 0) {
+            curve_output = 1;
+            continue;
+        }
+        if (!value && i == argc - 1 && strncmp(argv[i], "--", 2) != 0) {
+            path = argv[i];
+            break;
+        }
+        if (!value) {
+            fprintf(stderr, "Error: Missing value for fermentation option '%s'.\n", argv[i]);
+            return 1;
+        } else if (strcmp(argv[i], "--days") == 0) {
+            days = (int)strtol(value, &end, 10);
+            ok = *end == '\0' && days > 0 && days <= MEAD_FERMENT_MAX_DAYS;
+        } else if (strcmp(argv[i], "--temp") == 0) {
+            temperature = strtod(value, &end);
+            ok = *end == '\0' && end != value && temperature > -10.0 && temperature < 60.0;
+        } else if (strcmp(argv[i], "--feed") == 0) {
+            ok = feeds < MEAD_FERMENT_MAX_FEEDS && parse_feed(value, &feed_day[feeds], &feed_points[feeds]) == 0;
+            feeds += ok;
+        } else {
+            ok = 0;
+        }
+        if (!ok) {
+            fprintf(stderr, "Error: Invalid fermentation option '%s %s'.\n", argv[i], value);
+            return 1;
+        }
+        i++;
+    }
+
+    FILE *in = (strcmp(path, "-") == 0) ? stdin : fopen(path, "r");
+    if (!in) {
+        fprintf(stderr, "Error: Cannot open fermentation input '%s'.\n", path);
+        return 1;
+    }
+
+    // The whole cellar is simulated at once, so every record is read first
+    FermentEntry *entries = NULL;
+    size_t count = 0, cap = 0, batches_needed = 0;
+    char line[BATCH_LINE_MAX];
+    long line_no = 0;
+    int failures = 0;
+
+    while (fgets(line, sizeof(line), in)) {
+        line_no++;
+        if (count == cap) {
+            cap = cap ? cap * 2 : 256;
+            FermentEntry *grown = realloc(entries, cap * sizeof(*entries));
+            if (!grown) {
+                free(entries);
+                fprintf(stderr, "Error: Out of memory reading fermentation input.\n");
+                return 1;
+            }
+            entries = grown;
+        }
+        FermentEntry *e = &entries[count];
+        e->line_no = line_no;
+        e->has_inputs = 0;
+
+        size_t len = strlen(line);
+        if (len == sizeof(line) - 1 && line[len - 1] != '\n' && !feof(in)) {
+            int c;
+            while ((c = fgetc(in)) != EOF && c != '\n');
+            e->err = "line too long";
+            count++;
+            continue;
+        }
+        char *rec_str = mead_trim_space(line);
+        if (*rec_str == '\0' || *rec_str == '#') {
+            continue;
+        }
+        e->err = mead_parse_record(rec_str, &e->rec);
+        if (e->err && line_no == 1 && *rec_str != '{' && strncasecmp(rec_str, "unit", 4) == 0) {
+            continue; // CSV header row
+        }
+        if (!e->err) {
+            e->has_inputs = 1;
+            e->og_points = mead_og_points(MEAD_DEFAULT_FG_TABLE, e->rec.abv, e->rec.sweetness, e->rec.yeast_mode);
+            if (e->og_points > MEAD_MAX_OG_POINTS) {
+                e->err = "OG too high (above 1.225)";
+            } else if (e->rec.lot[0] != '\0') {
+                e->err = "honey lots are not supported in fermentation mode";
+            } else {
+                e->batch = batches_needed++;
+            }
+        }
+        count++;
+    }
+    int read_error = ferror(in);
+    if (in != stdin) {
+        fclose(in);
+    }
+
+    MeadFermentBatches cellar;
+    double *curve = NULL;
+    if (batches_needed > 0) {
+        if (mead_ferment_alloc(&cellar, batches_needed, ABV_FACTOR) != 0 ||
+            (curve_output && !(curve = malloc(sizeof(double) * (size_t)days * batches_needed)))) {
+            fprintf(stderr, "Error: Out of memory for %zu fermenters.\n", batches_needed);
+            free(entries);
+            return 1;
+        }
+        for (size_t i = 0; i < count; i++) {
+            const FermentEntry *e = &entries[i];
+            if (e->err) {
+                continue;
+            }
+            mead_ferment_set_batch(&cellar, e->batch, e->og_points, e->rec.abv, e->rec.yeast_mode, temperature);
+            for (int k = 0; k < feeds; k++) {
+                cellar.feed_day[k][e->batch] = feed_day[k];
+                cellar.feed_points[k][e->batch] = feed_points[k];
+            }
+        }
+        mead_ferment_run(&cellar, days, curve);
+    }
+
+    static MeadWriter out;
+    mead_writer_init(&out, STDOUT_FILENO);
+    mead_writer_puts(&out, curve_output ? "line,day,sg\n"
+                                        : "line,unit,volume,abv,sweetness,yeast,og,sg,abv_reached,finished_day,status\n");
+
+    for (size_t i = 0; i < count; i++) {
+        const FermentEntry *e = &entries[i];
+        const MeadRecord *rec = &e->rec;
+
+        if (curve_output) {
+            for (int d = 0; d < days && !e->err; d++) {
+                mead_writer_long(&out, e->line_no);
+                mead_writer_puts(&out, ",");
+                mead_writer_long(&out, d + 1);
+                mead_writer_puts(&out, ",");
+                write_sg(&out, curve[(size_t)d * batches_needed + e->batch]);
+                mead_writer_puts(&out, "\n");
+            }
+            failures += (e->err != NULL);
+            continue;
+        }
+
+        mead_writer_long(&out, e->line_no);
+        if (!e->has_inputs) {
+            mead_writer_puts(&out, ",,,,,,,,,,error: ");
+            mead_writer_puts(&out, e->err);
+            mead_writer_puts(&out, "\n");
+            failures++;
+            continue;
+        }
+        mead_writer_puts(&out, (rec->unit == MEAD_UNIT_US_IMPERIAL) ? ",Gallons," : ",Liters,");
+        mead_writer_fixed(&out, rec->volume, 2);
+        mead_writer_puts(&out, ",");
+        mead_writer_number(&out, rec->abv);
+        mead_writer_puts(&out, ",");
+        mead_writer_puts(&out, mead_sweetness_name(rec->sweetness));
+        mead_writer_puts(&out, (rec->yeast_mode == 1) ? ",Standard," : ",Turbo,");
+        if (e->err) {
+            mead_writer_puts(&out, ",,,,error: ");
+            mead_writer_puts(&out, e->err);
+            mead_writer_puts(&out, "\n");
+            failures++;
+            continue;
+        }
+
+        int finished = cellar.finished_day[e->batch];
+        write_sg(&out, (double)e->og_points);
+        mead_writer_puts(&out, ",");
+        write_sg(&out, cellar.points[e->batch]);
+        mead_writer_puts(&out, ",");
+        mead_writer_fixed(&out, mead_ferment_abv(&cellar, e->batch), 1);
+        mead_writer_puts(&out, ",");
+        if (finished >= 0) {
+            mead_writer_long(&out, finished);
+        }
+        mead_writer_puts(&out, (finished >= 0) ? ",finished\n" : ",fermenting\n");
+    }
+
+    if (batches_needed > 0) {
+        mead_ferment_free(&cellar);
+    }
+    free(curve);
+    free(entries);
+    if (mead_writer_flush(&out) != 0) {
+        fprintf(stderr, "Error: Failed writing fermentation output.\n");
+        return 1;
+    }
+    if (read_error) {
+        fprintf(stderr, "Error: Failed reading fermentation input '%s'.\n", path);
+        return 1;
+    }
+    return failures ? 1 : 0;
+}
+
+// --- Fleet Mode ---
+
+// One record of a fleet plan; err is NULL if the record became a fermenter.
+typedef struct {
+    long line_no;
+    const char *err;
+    int has_inputs;
+    MeadRecord rec;
+    size_t fermenter;   // Index in the fermenter array
+} FleetEntry;
+
+/**
+ * @brief Reads batch records as fermenters and assigns the honey inventory to them.
+ * Options: --inventory CSV (required), --objective volume|cost, then an optional FILE.
+ * Writes one row per record with the honey taken from each lot, followed by '#' comment
+ * lines with the plan totals and what is left of each lot.
+ * @return int 0 if every record was planned (filled or not), 1 on invalid options,
+ * failed records or I/O errors.
+ */
+int run_fleet_mode(int argc, char *argv[], const MeadHoneyDb *honey_db) {
+    const char *path = "-";
+    const char *inventory_path = NULL;
+    MeadFleetObjective objective = MEAD_FLEET_MAX_VOLUME;
+
+    for (int i = 0; i < argc; i++) {
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (!value && i == argc - 1 && strncmp(argv[i], "--", 2) != 0) {
+            path = argv[i];
+            break;
+        }
+        if (!value) {
+            fprintf(stderr, "Error: Missing value for fleet option '%s'.\n", argv[i]);
+            return 1;
+        } else if (strcmp(argv[i], "--inventory") == 0) {
+            inventory_path = value;
+        } else if (strcmp(argv[i], "--objective") != 0 || mead_fleet_parse_objective(value, &objective) != 0) {
+            fprintf(stderr, "Error: Invalid fleet option '%s %s'.\n", argv[i], value);
+            return 1;
+        }
+        i++;
+    }
+    if (!inventory_path) {
+        fprintf(stderr, "Error: Fleet mode needs --inventory CSV.\n");
+        return 1;
+    }
+
+    MeadFleetLot *lots = NULL;
+    size_t lot_count = 0;
+    long error_line;
+    if (mead_fleet_load_inventory(inventory_path, honey_db, &lots, &lot_count, &error_line) != 0) {
+        if (error_line > 0) {
+            fprintf(stderr, "Error: %s:%ld: expected lot_id,kg,cost_per_kg with a unique%s lot ID.\n",
+                    inventory_path, error_line, honey_db ? ", known" : "");
+        } else {
+            fprintf(stderr, "Error: Cannot read honey inventory '%s'.\n", inventory_path);
+        }
+        return 1;
+    }
+
+    FILE *in = (strcmp(path, "-") == 0) ? stdin : fopen(path, "r");
+    if (!in) {
+        fprintf(stderr, "Error: Cannot open fleet input '%s'.\n", path);
+        free(lots);
+        return 1;
+    }
+
+    // Every fermenter competes for the same honey, so every record is read first
+    FleetEntry *entries = NULL;
+    MeadFleetFermenter *fermenters = NULL;
+    size_t count = 0, cap = 0, fermenter_count = 0;
+    char line[BATCH_LINE_MAX];
+    long line_no = 0;
+    int failures = 0;
+
+    while (fgets(line, sizeof(line), in)) {
+        line_no++;
+        if (count == cap) {
+            cap = cap ? cap * 2 : 256;
+            FleetEntry *grown = realloc(entries, cap * sizeof(*entries));
+            MeadFleetFermenter *grown_f = grown ? realloc(fermenters, cap * sizeof(*fermenters)) : NULL;
+            if (grown) {
+                entries = grown;
+            }
+            if (!grown_f) {
+                free(entries);
+                free(fermenters);
+                free(lots);
+                fprintf(stderr, "Error: Out of memory reading fleet input.\n");
+                return 1;
+            }
+            fermenters = grown_f;
+        }
+        FleetEntry *e = &entries[count];
+        e->line_no = line_no;
+        e->has_inputs = 0;
+
+        size_t len = strlen(line);
+        if (len == sizeof(line) - 1 && line[len - 1] != '\n' && !feof(in)) {
+            int c;
+            while ((c = fgetc(in)) != EOF && c != '\n');
+            e->err = "line too long";
+            count++;
+            continue;
+        }
+        char *rec_str = mead_trim_space(line);
+        if (*rec_str == '\0' || *rec_str == '#') {
+            continue;
+        }
+        e->err = mead_parse_record(rec_str, &e->rec);
+        if (e->err && line_no == 1 && *rec_str != '{' && strncasecmp(rec_str, "unit", 4) == 0) {
+            continue; // CSV header row
+        }
+        if (!e->err) {
+            MeadFleetFermenter *f = &fermenters[fermenter_count];
+            e->has_inputs = 1;
+            f->unit = (MeadUnit)e->rec.unit;
+            f->volume = e->rec.volume;
+            f->og_points = mead_og_points(MEAD_DEFAULT_FG_TABLE, e->rec.abv, e->rec.sweetness, e->rec.yeast_mode);
+            f->pinned_lot = (e->rec.lot[0] != '\0') ? mead_fleet_find_lot(lots, lot_count, e->rec.lot) : -1;
+            if (f->og_points > MEAD_MAX_OG_POINTS) {
+                e->err = "OG too high (above 1.225)";
+            } else if (e->rec.lot[0] != '\0' && f->pinned_lot < 0) {
+                e->err = "honey lot is not in the inventory";
+            } else {
+                e->fermenter = fermenter_count++;
+            }
+        }
+        count++;
+    }
+    int read_error = ferror(in);
+    if (in != stdin) {
+        fclose(in);
+    }
+
+    MeadFleetPlan plan;
+    MeadFleetAssignment *assignments = malloc(sizeof(*assignments) *
+                                              (MEAD_FLEET_MAX_ASSIGNMENTS(fermenter_count, lot_count) + 1));
+    if (!assignments || mead_fleet_allocate(fermenters, fermenter_count, lots, lot_count, objective,
+                                            assignments, &plan) != 0) {
+        fprintf(stderr, "Error: Out of memory for %zu fermenters.\n", fermenter_count);
+        free(assignments);
+        free(fermenters);
+        free(entries);
+        free(lots);
+        return 1;
+    }
+
+    static MeadWriter out;
+    mead_writer_init(&out, STDOUT_FILENO);
+    mead_writer_puts(&out, "line,unit,volume,abv,sweetness,yeast,og,honey,water,cost,status,lots\n");
+
+    for (size_t i = 0; i < count; i++) {
+        const FleetEntry *e = &entries[i];
+        const MeadRecord *rec = &e->rec;
+
+        mead_writer_long(&out, e->line_no);
+        if (!e->has_inputs) {
+            mead_writer_puts(&out, ",,,,,,,,,,error: ");
+            mead_writer_puts(&out, e->err);
+            mead_writer_puts(&out, ",\n");
+            failures++;
+            continue;
+        }
+        mead_writer_puts(&out, (rec->unit == MEAD_UNIT_US_IMPERIAL) ? ",Gallons," : ",Liters,");
+        mead_writer_fixed(&out, rec->volume, 2);
+        mead_writer_puts(&out, ",");
+        mead_writer_number(&out, rec->abv);
+        mead_writer_puts(&out, ",");
+        mead_writer_puts(&out, mead_sweetness_name(rec->sweetness));
+        mead_writer_puts(&out, (rec->yeast_mode == 1) ? ",Standard," : ",Turbo,");
+        if (e->err) {
+            mead_writer_puts(&out, ",,,,error: ");
+            mead_writer_puts(&out, e->err);
+            mead_writer_puts(&out, ",\n");
+            failures++;
+            continue;
+        }
+
+        const MeadFleetFermenter *f = &fermenters[e->fermenter];
+        write_sg(&out, (double)f->og_points);
+        if (!f->filled) {
+            mead_writer_puts(&out, ",,,,unfilled,\n");
+            continue;
+        }
+        mead_writer_puts(&out, ",");
+        mead_writer_fixed(&out, f->honey, 2);
+        mead_writer_puts(&out, ",");
+        mead_writer_fixed(&out, f->water, 2);
+        mead_writer_puts(&out, ",");
+        mead_writer_fixed(&out, f->cost, 2);
+        mead_writer_puts(&out, ",filled,");
+        // LOT:AMOUNT pairs in the record's honey unit, separated by ';'
+        for (size_t k = 0; k < f->assignment_count; k++) {
+            const MeadFleetAssignment *a = &assignments[f->first_assignment + k];
+            double amount = (f->unit == MEAD_UNIT_US_IMPERIAL) ? a->kg * lots[a->lot].model.kg_to_lbs : a->kg;
+            if (k > 0) {
+                mead_writer_puts(&out, ";");
+            }
+            mead_writer_puts(&out, lots[a->lot].lot_id);
+            mead_writer_puts(&out, ":");
+            mead_writer_fixed(&out, amount, 2);
+        }
+        mead_writer_puts(&out, "\n");
+    }
+
+    mead_writer_puts(&out, "# filled ");
+    mead_writer_long(&out, (long)plan.filled);
+    mead_writer_puts(&out, " of ");
+    mead_writer_long(&out, (long)fermenter_count);
+    mead_writer_puts(&out, " fermenters, ");
+    mead_writer_fixed(&out, plan.volume_l, 2);
+    mead_writer_puts(&out, " L, honey cost ");
+    mead_writer_fixed(&out, plan.cost, 2);
+    mead_writer_puts(&out, "\n");
+    for (size_t l = 0; l < lot_count; l++) {
+        mead_writer_puts(&out, "# lot ");
+        mead_writer_puts(&out, lots[l].lot_id);
+        mead_writer_puts(&out, ": ");
+        mead_writer_fixed(&out, lots[l].stock_kg - lots[l].remaining_kg, 2);
+        mead_writer_puts(&out, " of ");
+        mead_writer_fixed(&out, lots[l].stock_kg, 2);
+        mead_writer_puts(&out, " kg used\n");
+    }
+
+    free(assignments);
+    free(fermenters);
+    free(entries);
+    free(lots);
+    if (mead_writer_flush(&out) != 0) {
+        fprintf(stderr, "Error: Failed writing fleet output.\n");
+        return 1;
+    }
+    if (read_error) {
+        fprintf(stderr, "Error: Failed reading fleet input '%s'.\n", path);
+        return 1;
+    }
+    return failures ? 1 : 0;
+}
+
+// --- Service Mode ---
+
+static volatile sig_atomic_t serve_stop;
+
+static void on_serve_signal(int sig) {
+    (void)sig;
+    serve_stop = 1;
+}
+
+/**
+ * @brief Runs the calculation service until SIGINT or SIGTERM.
+ * Options: --socket PATH, --port N, --telemetry-port N. Without a socket or port,
+ * listens on SERVE_DEFAULT_SOCKET.
+ * @param history_path History file for calculated recipes and telemetry readings, or NULL.
+ * @return int 0 after a clean shutdown, 1 on invalid options or if the service cannot start.
+ */
+int run_serve_mode(int argc, char *argv[], const MeadHoneyDb *honey_db, const char *history_path) {
+    MeadServiceConfig config = { NULL, 0, honey_db, NULL, NULL };
+    MeadTelemetryConfig telemetry_config = { 0, 1, 0.0, history_path };
+    static MeadHistoryWriter history;
+
+    for (int i = 0; i < argc; i += 2) {
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        char *end;
+
+        if (!value) {
+            fprintf(stderr, "Error: Missing value for serve option '%s'.\n", argv[i]);
+            return 1;
+        } else if (strcmp(argv[i], "--socket") == 0) {
+            config.socket_path = value;
+        } else if (strcmp(argv[i], "--port") == 0) {
+            long port = strtol(value, &end, 10);
+            if (end == value || *end != '\0' || port < 1 || port > 65535) {
+                fprintf(stderr, "Error: Invalid port '%s'.\n", value);
+                return 1;
+            }
+            config.tcp_port = (int)port;
+        } else if (strcmp(argv[i], "--telemetry-port") == 0) {
+            long port = strtol(value, &end, 10);
+            if (end == value || *end != '\0' || port < 1 || port > 65535) {
+                fprintf(stderr, "Error: Invalid telemetry port '%s'.\n", value);
+                return 1;
+            }
+            telemetry_config.udp_port = (int)port;
+        } else {
+            fprintf(stderr, "Error: Invalid serve option '%s %s'.\n", argv[i], value);
+            return 1;
+        }
+    }
+    if (!config.socket_path && config.tcp_port == 0) {
+        config.socket_path = SERVE_DEFAULT_SOCKET;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_serve_signal; // No SA_RESTART: the signal must interrupt epoll_wait
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    if (history_path) {
+        if (mead_history_writer_open(&history, history_path, MEAD_HISTORY_RECIPES) != 0) {
+            fprintf(stderr, "Error: Cannot open history '%s'.\n", history_path);
+            return 1;
+        }
+        config.history = &history;
+    }
+
+    MeadTelemetry *telemetry = NULL;
+    if (telemetry_config.udp_port) {
+        telemetry = mead_telemetry_start(&telemetry_config);
+        if (!telemetry) {
+            fprintf(stderr, "Error: Cannot receive telemetry on UDP port %d: %s\n",
+                    telemetry_config.udp_port, strerror(errno));
+            if (config.history) {
+                mead_history_writer_close(config.history);
+            }
+            return 1;
+        }
+        config.telemetry = telemetry;
+    }
+
+    int rc = mead_service_run(&config, &serve_stop);
+    mead_telemetry_stop(telemetry);
+    if (config.history && mead_history_writer_close(config.history) != 0) {
+        fprintf(stderr, "Error: Failed writing history '%s'.\n", history_path);
+        rc = -1;
+    }
+    return (rc != 0) ? 1 : 0;
+}
+
+// --- Co-Process Mode ---
+
+/**
+ * @brief Writes one co-process response line and flushes it.
+ * @return int 0 on success, -1 if stdout is gone.
+ */
+static int coproc_reply(MeadWriter *out, const char *id, const char *err, const MeadResult *result) {
+    mead_writer_puts(out, id);
+    if (err) {
+        mead_writer_puts(out, " err ");
+        mead_writer_puts(out, err);
+    } else {
+        mead_writer_puts(out, " ok ");
+        mead_writer_fixed(out, result->og, 3);
+        mead_writer_put(out, ",", 1);
+        mead_writer_fixed(out, result->honey, 2);
+        mead_writer_put(out, ",", 1);
+        mead_writer_fixed(out, result->water, 2);
+        mead_writer_put(out, ",", 1);
+        mead_writer_fixed(out, result->gravity_points, 0);
+    }
+    mead_writer_put(out, "\n", 1);
+    return mead_writer_flush(out);
+}
+
+/**
+ * @brief Answers one co-process request line in place.
+ * @param line Request: an ID token, whitespace, then a batch record (CSV or NDJSON).
+ * @param id Output: the request ID, or "-" if the line has none.
+ * @param result Output: the calculation when the return value is NULL.
+ * @return const char* NULL on success, otherwise an error message.
+ */
+static const char *coproc_answer(char *line, char id[COPROC_ID_MAX + 1], MeadResult *result,
+                                 const MeadHoneyDb *honey_db) {
+    size_t id_len = strcspn(line, " \t");
+
+    strcpy(id, "-");
+    if (line[id_len] == '\0') {
+        return "expected: ID RECORD";
+    }
+    if (id_len > COPROC_ID_MAX) {
+        return "request ID too long";
+    }
+    memcpy(id, line, id_len);
+    id[id_len] = '\0';
+
+    MeadRecord rec;
+    const char *err = mead_parse_record(mead_trim_space(line + id_len + 1), &rec);
+    if (err) {
+        return err;
+    }
+
+    const MeadHoneyLot *lot;
+    MeadModel model = MEAD_DEFAULT_MODEL;
+    if ((err = mead_honeydb_resolve(honey_db, rec.lot, &lot)) != NULL) {
+        return err;
+    }
+    if (lot) {
+        mead_honey_lot_model(lot, &model, &model);
+    }
+    if (mead_model_calculate(&model, (MeadUnit)rec.unit, rec.volume, rec.abv, rec.sweetness, rec.yeast_mode,
+                             result) != MEAD_OK) {
+        return "invalid record";
+    }
+    return result->og_too_high ? "OG too high (above 1.225)" : NULL;
+}
+
+/**
+ * @brief Serves one request per stdin line until EOF, for callers that keep the process
+ * open as a pipe peer. Every response carries the request's ID and is written with its
+ * own write() so the peer can read it immediately; requests may be pipelined and are
+ * answered in order. Malformed lines get an "err" response and the loop continues.
+ * @param honey_db Honey lot database for requests that name a lot, or NULL.
+ * @return int 0 at EOF, 1 if reading stdin or writing stdout fails.
+ */
+int run_coproc_mode(const MeadHoneyDb *honey_db) {
+    static MeadWriter out;
+    char line[BATCH_LINE_MAX];
+    char id[COPROC_ID_MAX + 1];
+
+    mead_writer_init(&out, STDOUT_FILENO);
+
+    while (fgets(line, sizeof(line), stdin)) {
+        MeadResult result;
+        const char *err;
+
+        size_t len = strlen(line);
+        if (len == sizeof(line) - 1 && line[len - 1] != '\n' && !feof(stdin)) {
+            int c;
+            while ((c = fgetc(stdin)) != EOF && c != '\n');
+            line[strcspn(line, " \t")] = '\0';
+            snprintf(id, sizeof(id), "%s", line);
+            err = "line too long";
+        } else {
+            char *req = mead_trim_space(line);
+            if (*req == '\0' || *req == '#') {
+                continue;
+            }
+            err = coproc_answer(req, id, &result, honey_db);
+        }
+
+        if (coproc_reply(&out, id, err, &result) != 0) {
+            return 1;
+        }
+    }
+    return ferror(stdin) ? 1 : 0;
+}
+
+// --- Honey Database ---
+
+/**
+ * @brief Builds a honey lot database from CSV (lot_id,varietal,ppg,moisture,density).
+ * @return int 0 on success, 1 on error.
+ */
+int run_honeydb_build(const char *csv_path, const char *db_path) {
+    long error_line;
+    int count = mead_honeydb_build(csv_path, db_path, &error_line);
+
+    if (count < 0) {
+        if (error_line > 0) {
+            fprintf(stderr, "Error: %s:%ld: invalid or duplicate honey lot "
+                    "(expected lot_id,varietal,ppg,moisture,density).\n", csv_path, error_line);
+        } else {
+            fprintf(stderr, "Error: Cannot build honey database '%s' from '%s'.\n", db_path, csv_path);
+        }
+        return 1;
+    }
+    printf("Wrote %d honey lots to %s.\n", count, db_path);
+    return 0;
+}
+
+// --- History Query Mode ---
+
+// Output state shared by the history scan callbacks.
+typedef struct {
+    MeadWriter out;
+    int json;
+} HistoryQueryOutput;
+
+/**
+ * @brief Parses a --from/--to time: YYYY-MM-DD, YYYY-MM-DDTHH:MM[:SS] (UTC) or epoch seconds.
+ * @param end_of_day Non-zero to move a bare date to the last millisecond of that day.
+ * @return int 0 on success, -1 if the value is not a time.
+ */
+static int parse_history_time(const char *value, int end_of_day, int64_t *ms) {
+    struct tm tm;
+    int year, month, day, hour = 0, minute = 0, second = 0, n = 0;
+    char *end;
+
+    memset(&tm, 0, sizeof(tm));
+    if (sscanf(value, "%4d-%2d-%2d%n", &year, &month, &day, &n) == 3 && n == 10) {
+        const char *rest = value + n;
+        int has_time = (*rest == 'T' || *rest == ' ');
+        if (has_time) {
+            int m = 0;
+            if (sscanf(rest + 1, "%2d:%2d%n:%2d%n", &hour, &minute, &m, &second, &m) < 2) {
+                return -1;
+            }
+            rest += 1 + m;
+        }
+        if (*rest != '\0' || month < 1 || month > 12 || day < 1 || day > 31 ||
+            hour > 23 || minute > 59 || second > 60) {
+            return -1;
+        }
+        tm.tm_year = year - 1900;
+        tm.tm_mon = month - 1;
+        tm.tm_mday = day;
+        tm.tm_hour = hour;
+        tm.tm_min = minute;
+        tm.tm_sec = second;
+        *ms = (int64_t)timegm(&tm) * 1000;
+        if (end_of_day && !has_time) {
+            *ms += 86400000 - 1;
+        }
+        return 0;
+    }
+
+    long long seconds = strtoll(value, &end, 10);
+    if (end == value || *end != '\0' || seconds < 0) {
+        return -1;
+    }
+    *ms = (int64_t)seconds * 1000;
+    return 0;
+}
+
+/**
+ * @brief Writes a history time as ISO 8601 UTC with milliseconds (2025-01-31T18:05:00.250Z).
+ */
+static void write_history_time(MeadWriter *w, int64_t ms) {
+    char buf[80];
+    time_t seconds = (time_t)(ms / 1000);
+    struct tm tm;
+
+    gmtime_r(&seconds, &tm);
+    snprintf(buf, sizeof(buf), "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ", tm.tm_year + 1900, tm.tm_mon + 1,
+             tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, (int)(ms % 1000));
+    mead_writer_puts(w, buf);
+}
+
+static int write_history_reading(const MeadHistoryReading *reading, void *user) {
+    HistoryQueryOutput *q = user;
+    MeadWriter *w = &q->out;
+
+    if (q->json) {
+        // Names with quotes or backslashes are rejected on ingest (mead_telemetry_parse())
+        mead_writer_puts(w, "{\"fermenter\":\"");
+        mead_writer_puts(w, reading->fermenter);
+        mead_writer_puts(w, "\",\"time\":\"");
+        write_history_time(w, reading->time_ms);
+        mead_writer_puts(w, "\",\"gravity\":");
+        mead_writer_fixed(w, reading->gravity, 4);
+        mead_writer_puts(w, ",\"temperature\":");
+        if (isnan(reading->temperature)) {
+            mead_writer_puts(w, "null");
+        } else {
+            mead_writer_fixed(w, reading->temperature, 2);
+        }
+        mead_writer_puts(w, "}\n");
+    } else {
+        mead_writer_puts(w, reading->fermenter);
+        mead_writer_put(w, ",", 1);
+        write_history_time(w, reading->time_ms);
+        mead_writer_put(w, ",", 1);
+        mead_writer_fixed(w, reading->gravity, 4);
+        mead_writer_put(w, ",", 1);
+        if (!isnan(reading->temperature)) {
+            mead_writer_fixed(w, reading->temperature, 2);
+        }
+        mead_writer_put(w, "\n", 1);
+    }
+    return w->error ? 1 : 0;
+}
+
+static int write_history_recipe(const MeadHistoryRecipe *recipe, void *user) {
+    HistoryQueryOutput *q = user;
+    MeadWriter *w = &q->out;
+    int imperial = (recipe->unit == MEAD_UNIT_US_IMPERIAL);
+
+    if (q->json) {
+        mead_writer_puts(w, "{\"time\":\"");
+        write_history_time(w, recipe->time_ms);
+        mead_writer_puts(w, imperial ? "\",\"unit\":\"Gallons\",\"volume\":" : "\",\"unit\":\"Liters\",\"volume\":");
+        mead_writer_number(w, recipe->volume);
+        mead_writer_puts(w, ",\"abv\":");
+        mead_writer_number(w, recipe->abv);
+        mead_writer_puts(w, ",\"sweetness\":\"");
+        mead_writer_puts(w, mead_sweetness_name(recipe->sweetness));
+        mead_writer_puts(w, (recipe->yeast_mode == 1) ? "\",\"yeast\":\"Standard\",\"og\":" : "\",\"yeast\":\"Turbo\",\"og\":");
+        mead_writer_fixed(w, recipe->og, 4);
+        mead_writer_puts(w, ",\"honey\":");
+        mead_writer_fixed(w, recipe->honey, 3);
+        mead_writer_puts(w, ",\"water\":");
+        mead_writer_fixed(w, recipe->water, 3);
+        mead_writer_puts(w, "}\n");
+    } else {
+        write_history_time(w, recipe->time_ms);
+        mead_writer_puts(w, imperial ? ",Gallons," : ",Liters,");
+        mead_writer_number(w, recipe->volume);
+        mead_writer_put(w, ",", 1);
+        mead_writer_number(w, recipe->abv);
+        mead_writer_put(w, ",", 1);
+        mead_writer_puts(w, mead_sweetness_name(recipe->sweetness));
+        mead_writer_puts(w, (recipe->yeast_mode == 1) ? ",Standard," : ",Turbo,");
+        mead_writer_fixed(w, recipe->og, 4);
+        mead_writer_put(w, ",", 1);
+        mead_writer_fixed(w, recipe->honey, 3);
+        mead_writer_put(w, ",", 1);
+        mead_writer_fixed(w, recipe->water, 3);
+        mead_writer_put(w, "\n", 1);
+    }
+    return w->error ? 1 : 0;
+}
+
+/**
+ * @brief Writes the readings or recipes of a history file that match the query options.
+ * Options: --kind readings|recipes, --from T, --to T, --fermenter ID, --format csv|json.
+ * Only the blocks overlapping the time range are decoded (see mead_history.h).
+ * @param path History file written by --history.
+ * @return int 0 on success, 1 on invalid options or if the file cannot be read or the output written.
+ */
+int run_history_query_mode(const char *path, int argc, char *argv[]) {
+    static HistoryQueryOutput q;
+    MeadHistoryQuery query = { INT64_MIN, INT64_MAX, NULL };
+    int recipes = 0;
+
+    q.json = 0;
+    for (int i = 0; i < argc; i += 2) {
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (!value) {
+            fprintf(stderr, "Error: Missing value for history option '%s'.\n", argv[i]);
+            return 1;
+        } else if (strcmp(argv[i], "--kind") == 0 && (strcmp(value, "readings") == 0 || strcmp(value, "recipes") == 0)) {
+            recipes = (strcmp(value, "recipes") == 0);
+        } else if (strcmp(argv[i], "--from") == 0 && parse_history_time(value, 0, &query.from_ms) == 0) {
+            continue;
+        } else if (strcmp(argv[i], "--to") == 0 && parse_history_time(value, 1, &query.to_ms) == 0) {
+            continue;
+        } else if (strcmp(argv[i], "--fermenter") == 0) {
+            query.fermenter = value;
+        } else if (strcmp(argv[i], "--format") == 0 && (strcmp(value, "csv") == 0 || strcmp(value, "json") == 0)) {
+            q.json = (strcmp(value, "json") == 0);
+        } else {
+            fprintf(stderr, "Error: Invalid history option '%s %s'.\n", argv[i], value);
+            return 1;
+        }
+    }
+
+    MeadHistory history;
+    if (mead_history_open(&history, path) != 0) {
+        fprintf(stderr, "Error: Cannot open history '%s'.\n", path);
+        return 1;
+    }
+
+    mead_writer_init(&q.out, STDOUT_FILENO);
+    if (!q.json) {
+        mead_writer_puts(&q.out, recipes ? "time,unit,volume,abv,sweetness,yeast,og,honey,water\n"
+                                         : "fermenter,time,gravity,temperature\n");
+    }
+    if (recipes) {
+        mead_history_scan_recipes(&history, &query, write_history_recipe, &q);
+    } else {
+        mead_history_scan_readings(&history, &query, write_history_reading, &q);
+    }
+    mead_history_close(&history);
+
+    if (mead_writer_flush(&q.out) != 0) {
+        fprintf(stderr, "Error: Failed writing history output.\n");
+        return 1;
+    }
+    return 0;
+}
+
+// --- Merge Mode ---
+
+// One partial result file being merged, with its current frame.
+typedef struct {
+    MeadShardFile file;
+    MeadShardFrame frame;
+    const char *data;
+    int state;              // mead_shard_next(): 1 while frame is valid, 0 at the end, -1 if truncated
+} MergeInput;
+
+static void merge_advance(MergeInput *in) {
+    in->state = mead_shard_next(&in->file, &in->frame, &in->data);
+}
+
+/**
+ * @brief Merges sweep or batch frames: every key belongs to one shard, so the frame
+ * with the smallest key is written next.
+ * @return int The number of failed rows, or -1 if a file is truncated or two frames share a key.
+ */
+static int merge_frames(MergeInput *inputs, int count, MeadWriter *out) {
+    uint64_t last = 0;
+    int failures = 0;
+
+    for (int written = 0;; written = 1) {
+        MergeInput *next = NULL;
+        for (int s = 0; s < count; s++) {
+            if (inputs[s].state < 0) {
+                return -1;
+            }
+            if (inputs[s].state > 0 && (!next || inputs[s].frame.key < next->frame.key)) {
+                next = &inputs[s];
+            }
+        }
+        if (!next) {
+            return failures;
+        }
+        if (written && next->frame.key <= last) {
+            return -1;
+        }
+        last = next->frame.key;
+        mead_writer_put(out, next->data, next->frame.size);
+        failures += (next->frame.flags & MEAD_SHARD_FAILED) != 0;
+        merge_advance(next);
+    }
+}
+
+/**
+ * @brief Merges Monte Carlo frames: every shard has a frame for every record, so the
+ * files are read in lockstep and the packed summaries of each record are merged.
+ * @return int The number of failed rows, or -1 if the files do not line up.
+ */
+static int merge_montecarlo(MergeInput *inputs, int count, MeadWriter *out) {
+    static MeadMonteCarloSummary summary;
+    const char **packed = malloc(sizeof(*packed) * (size_t)count);
+    size_t *sizes = malloc(sizeof(*sizes) * (size_t)count);
+    int failures = 0;
+
+    while (failures >= 0 && packed && sizes && inputs[0].state > 0) {
+        const MergeInput *failed = NULL;
+        uint64_t key = inputs[0].frame.key;
+        for (int s = 0; s < count && failures >= 0; s++) {
+            const MergeInput *in = &inputs[s];
+            if (in->state <= 0 || in->frame.key != key) {
+                failures = -1;
+            } else if (in->frame.flags & MEAD_SHARD_FAILED) {
+                failed = failed ? failed : in;
+            } else if (!(in->frame.flags & MEAD_SHARD_SUMMARY) || in->frame.size < sizeof(MeadRecord)) {
+                failures = -1;
+            } else {
+                packed[s] = in->data + sizeof(MeadRecord);
+                sizes[s] = in->frame.size - sizeof(MeadRecord);
+            }
+        }
+        if (failures < 0) {
+            break;
+        }
+
+        // Error rows are the same in every shard; a shard that ran out of memory wins
+        if (failed) {
+            mead_writer_put(out, failed->data, failed->frame.size);
+            failures++;
+        } else {
+            MeadRecord rec;
+            memcpy(&rec, inputs[0].data, sizeof(rec));
+            if (mead_montecarlo_merge(packed, sizes, count, &summary) != 0) {
+                failures = -1;
+                break;
+            }
+            write_montecarlo_row(out, (long)key, &rec, NULL, &summary);
+        }
+        for (int s = 0; s < count; s++) {
+            merge_advance(&inputs[s]);
+        }
+    }
+    for (int s = 0; s < count; s++) {
+        if (inputs[s].state != 0) {
+            failures = -1; // Truncated, or longer than the others
+        }
+    }
+    if (!packed || !sizes) {
+        failures = -1;
+    }
+    free(packed);
+    free(sizes);
+    return failures;
+}
+
+/**
+ * @brief Opens the partial files of one run into inputs[], in shard order.
+ * @return int 0 on success, -1 (with a message) if a file cannot be read, does not
+ * belong to the same run as the others, or a shard is missing or given twice.
+ */
+static int merge_open(MergeInput *inputs, int count, char *paths[]) {
+    const MeadShardFile *first = NULL;
+
+    for (int i = 0; i < count; i++) {
+        MeadShardFile file;
+        if (mead_shard_open(&file, paths[i]) != 0) {
+            fprintf(stderr, "Error: '%s' is not a partial result file.\n", paths[i]);
+            return -1;
+        }
+        const MeadShardHeader *h = &file.header;
+        int mismatch = first && (h->kind != first->header.kind || h->format != first->header.format ||
+                                 strcmp(file.job, first->job) != 0);
+        if (mismatch || h->kind < MEAD_SHARD_SWEEP || h->kind > MEAD_SHARD_MONTECARLO) {
+            fprintf(stderr, "Error: '%s' (shard %u/%u of \"%s\") does not belong with the other %d file(s).\n",
+                    paths[i], h->index, h->count, file.job, count - 1);
+            mead_shard_close(&file);
+            return -1;
+        }
+        if (h->count != (uint32_t)count) {
+            fprintf(stderr, "Error: '%s' is shard %u/%u of \"%s\": the run has %u shards, got %d file(s).\n",
+                    paths[i], h->index, h->count, file.job, h->count, count);
+            mead_shard_close(&file);
+            return -1;
+        }
+        if (inputs[h->index].file.map) {
+            fprintf(stderr, "Error: '%s' is shard %u/%u of \"%s\", which was already given.\n",
+                    paths[i], h->index, h->count, file.job);
+            mead_shard_close(&file);
+            return -1;
+        }
+        inputs[h->index].file = file;
+        first = first ? first : &inputs[h->index].file;
+    }
+    return 0;
+}
+
+/**
+ * @brief Combines the partial result files of all shards of one --shard run and writes
+ * the output the unsharded run would have written (see mead_shard.h). Only the partial
+ * files are read; Monte Carlo quantiles come from the merged sketches.
+ * @param count Number of files; must equal the shard count of the run.
+ * @return int 0 on success, 1 if any record failed or the files do not merge.
+ */
+int run_merge_mode(int count, char *paths[]) {
+    if (count > MEAD_SHARD_MAX) {
+        fprintf(stderr, "Error: At most %d partial files can be merged.\n", MEAD_SHARD_MAX);
+        return 1;
+    }
+    MergeInput *inputs = calloc((size_t)count, sizeof(*inputs));
+    if (!inputs) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        return 1;
+    }
+
+    static MeadWriter out;
+    int failures = -1;
+    if (merge_open(inputs, count, paths) == 0) {
+        MeadShardKind kind = (MeadShardKind)inputs[0].file.header.kind;
+        MeadOutputFormat format = (MeadOutputFormat)inputs[0].file.header.format;
+        for (int s = 0; s < count; s++) {
+            merge_advance(&inputs[s]);
+        }
+
+        mead_writer_init(&out, STDOUT_FILENO);
+        if (kind == MEAD_SHARD_SWEEP) {
+            write_sweep_header(&out, format);
+        } else if (kind == MEAD_SHARD_BATCH) {
+            mead_write_header(&out, format);
+        } else {
+            mead_writer_puts(&out, MC_CSV_HEADER);
+        }
+        failures = (kind == MEAD_SHARD_MONTECARLO) ? merge_montecarlo(inputs, count, &out)
+                                                   : merge_frames(inputs, count, &out);
+        if (failures < 0) {
+            fprintf(stderr, "Error: A partial result file is truncated or does not match the others.\n");
+        }
+        if (mead_writer_flush(&out) != 0) {
+            fprintf(stderr, "Error: Failed writing merged output.\n");
+            failures = -1;
+        }
+    }
+    for (int s = 0; s < count; s++) {
+        mead_shard_close(&inputs[s].file);
+    }
+    free(inputs);
+    return (failures == 0) ? 0 : 1;
 }
 
 /**
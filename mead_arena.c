@@ -0,0 +1,116 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mead_arena.h"
+
+// Chunk data starts right after the header, which keeps malloc()'s alignment.
+#define CHUNK_DATA(chunk) ((char *)(chunk) + sizeof(MeadArenaChunk))
+
+/**
+ * @brief Prepares an empty arena; no memory is taken until the first allocation.
+ * @param chunk_size Bytes per chunk (e.g. the expected size of one batch).
+ * @param limit Largest total size of all chunks, or 0 for no limit.
+ */
+void mead_arena_init(MeadArena *arena, size_t chunk_size, size_t limit) {
+    memset(arena, 0, sizeof(*arena));
+    arena->chunk_size = chunk_size;
+    arena->limit = limit;
+}
+
+// Offset of the first address in chunk at or after offset that is a multiple of align.
+static size_t align_offset(const MeadArenaChunk *chunk, size_t offset, size_t align) {
+    uintptr_t addr = (uintptr_t)(CHUNK_DATA(chunk) + offset);
+    return offset + (size_t)((align - (addr & (align - 1))) & (align - 1));
+}
+
+/**
+ * @brief Allocates size bytes aligned to align (a power of two). Moves on to the next
+ * kept chunk when the current one is full, and only calls malloc() when no kept
+ * chunk is left that fits.
+ * @return void* The memory, or NULL if out of memory or over the arena's limit.
+ */
+void *mead_arena_alloc_aligned(MeadArena *arena, size_t size, size_t align) {
+    MeadArenaChunk *chunk = arena->current;
+
+    while (chunk) {
+        size_t offset = align_offset(chunk, arena->used, align);
+        if (offset <= chunk->size && chunk->size - offset >= size) {
+            arena->used = offset + size;
+            return CHUNK_DATA(chunk) + offset;
+        }
+        if (!chunk->next) {
+            break;
+        }
+        chunk = arena->current = chunk->next;
+        arena->used = 0;
+    }
+
+    // Nothing kept fits: add a chunk after the current one
+    size_t need = size + align;
+    size_t bytes = (need > arena->chunk_size) ? need : arena->chunk_size;
+    if (arena->limit && (bytes > arena->limit || arena->capacity > arena->limit - bytes)) {
+        return NULL;
+    }
+    MeadArenaChunk *fresh = malloc(sizeof(MeadArenaChunk) + bytes);
+    if (!fresh) {
+        return NULL;
+    }
+    fresh->size = bytes;
+    arena->capacity += bytes;
+    if (chunk) {
+        fresh->next = chunk->next;
+        chunk->next = fresh;
+    } else {
+        fresh->next = NULL;
+        arena->first = fresh;
+    }
+    arena->current = fresh;
+    arena->used = align_offset(fresh, 0, align) + size;
+    return CHUNK_DATA(fresh) + arena->used - size;
+}
+
+void *mead_arena_alloc(MeadArena *arena, size_t size) {
+    return mead_arena_alloc_aligned(arena, size, MEAD_ARENA_ALIGN);
+}
+
+/**
+ * @brief Copies len bytes of s into the arena and NUL-terminates the copy.
+ * @return char* The copy, or NULL if out of memory.
+ */
+char *mead_arena_strndup(MeadArena *arena, const char *s, size_t len) {
+    char *copy = mead_arena_alloc_aligned(arena, len + 1, 1);
+    if (copy) {
+        memcpy(copy, s, len);
+        copy[len] = '\0';
+    }
+    return copy;
+}
+
+/**
+ * @brief Releases everything allocated since the last reset, in O(1). All chunks are
+ * kept and handed out again, in order, by later allocations.
+ */
+void mead_arena_reset(MeadArena *arena) {
+    arena->current = arena->first;
+    arena->used = 0;
+}
+
+/**
+ * @brief Returns every chunk to the system; the arena can be used again afterwards.
+ */
+void mead_arena_free(MeadArena *arena) {
+    MeadArenaChunk *chunk = arena->first;
+    while (chunk) {
+        MeadArenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    mead_arena_init(arena, arena->chunk_size, arena->limit);
+}
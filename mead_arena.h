@@ -0,0 +1,41 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+#ifndef MEAD_ARENA_H
+#define MEAD_ARENA_H
+
+#include <stddef.h>
+
+// Bump allocator for memory that lives exactly as long as one batch (a record, a
+// block, a request). Allocation is a pointer increment inside a chunk; nothing is
+// freed individually. mead_arena_reset() rewinds to the first chunk in O(1) and keeps
+// every chunk for the next batch, so once the largest batch has been seen the hot
+// path makes no malloc() or free() calls. An optional limit caps the total size.
+
+#define MEAD_ARENA_ALIGN 16 // Alignment of mead_arena_alloc() results
+
+typedef struct MeadArenaChunk {
+    struct MeadArenaChunk *next;
+    size_t size;                // Usable bytes after the header
+} MeadArenaChunk;
+
+typedef struct {
+    MeadArenaChunk *first;      // Kept across resets
+    MeadArenaChunk *current;    // Chunk being allocated from
+    size_t used;                // Bytes used in current
+    size_t chunk_size;          // Size of new chunks (larger requests get their own)
+    size_t capacity;            // Usable bytes in all chunks
+    size_t limit;               // Largest allowed capacity, or 0 for no limit
+} MeadArena;
+
+void mead_arena_init(MeadArena *arena, size_t chunk_size, size_t limit);
+void *mead_arena_alloc(MeadArena *arena, size_t size);
+void *mead_arena_alloc_aligned(MeadArena *arena, size_t size, size_t align);
+char *mead_arena_strndup(MeadArena *arena, const char *s, size_t len);
+void mead_arena_reset(MeadArena *arena);
+void mead_arena_free(MeadArena *arena);
+
+#endif // MEAD_ARENA_H
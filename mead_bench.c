@@ -0,0 +1,307 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// Benchmarks for the calculation core, result formatting and batch-mode I/O.
+// Every result is printed as one JSON object per line so runs from different
+// releases can be collected and compared by scripts.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "mead_core.h"
+#include "mead_kernel.h"
+#include "mead_output.h"
+
+// Elements per kernel call; large enough to amortise dispatch, small enough for L2.
+#define KERNEL_BATCH 4096
+
+static volatile double sink; // Keeps results alive so the compiler cannot drop the work
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Prints one benchmark result as a JSON line.
+ * @param name Benchmark name.
+ * @param variant Implementation variant (e.g. "string", "avx2").
+ * @param ops Number of operations timed.
+ * @param seconds Elapsed wall-clock time.
+ */
+static void report(const char *name, const char *variant, double ops, double seconds) {
+    printf("{\"benchmark\":\"%s\",\"variant\":\"%s\",\"version\":\"%s\",\"ops\":%.0f,"
+           "\"seconds\":%.6f,\"ns_per_op\":%.3f,\"ops_per_sec\":%.0f}\n",
+           name, variant, VERSION_STRING, ops, seconds, seconds * 1e9 / ops, ops / seconds);
+    fflush(stdout);
+}
+
+// --- Target OG ---
+
+static void bench_target_og(long iterations) {
+    static const char *const names[] = { "Dry", "Semi-Sweet", "Sweet", "Dessert" };
+    double total = 0.0;
+
+    double start = now_seconds();
+    for (long i = 0; i < iterations; i++) {
+        total += mead_get_target_og(MEAD_MIN_ABV + (int)(i % MEAD_ABV_COUNT), names[i & 3], 1 + (int)((i >> 2) & 1));
+    }
+    report("target_og", "string", (double)iterations, now_seconds() - start);
+
+    start = now_seconds();
+    for (long i = 0; i < iterations; i++) {
+        total += mead_target_og(MEAD_DEFAULT_FG_TABLE, (double)(MEAD_MIN_ABV + (int)(i % MEAD_ABV_COUNT)),
+                                (MeadSweetness)(i & 3), 1 + (int)((i >> 2) & 1));
+    }
+    report("target_og", "enum_table", (double)iterations, now_seconds() - start);
+
+    start = now_seconds();
+    for (long i = 0; i < iterations; i++) {
+        total += mead_target_og(MEAD_DEFAULT_FG_TABLE, MEAD_MIN_ABV + 0.5 + (double)(i % (MEAD_ABV_COUNT - 1)),
+                                (MeadSweetness)(i & 3), 1 + (int)((i >> 2) & 1));
+    }
+    report("target_og", "enum_formula", (double)iterations, now_seconds() - start);
+
+    sink = total;
+}
+
+// --- Honey/Water Kernels ---
+
+static double volume[KERNEL_BATCH], og[KERNEL_BATCH], honey[KERNEL_BATCH], water[KERNEL_BATCH];
+static int32_t og_points[KERNEL_BATCH];
+static unsigned char units[KERNEL_BATCH];
+
+/**
+ * @brief Times the core function and every supported kernel on the current inputs.
+ * @param name Benchmark name, which records the unit layout of the inputs.
+ */
+static void run_kernels(const char *name, long rounds) {
+    // Per-record reference: the single-recipe core function
+    double start = now_seconds();
+    for (long r = 0; r < rounds; r++) {
+        for (int i = 0; i < KERNEL_BATCH; i++) {
+            MeadResult result;
+            mead_compute_ingredients((MeadUnit)units[i], volume[i], og[i], &result);
+            honey[i] = result.honey;
+        }
+        sink = honey[r % KERNEL_BATCH];
+    }
+    report(name, "core_single", (double)(rounds * KERNEL_BATCH), now_seconds() - start);
+
+    for (int k = MEAD_KERNEL_SCALAR; k <= MEAD_KERNEL_NEON; k++) {
+        if (!mead_kernel_supported((MeadKernel)k)) {
+            continue;
+        }
+        start = now_seconds();
+        for (long r = 0; r < rounds; r++) {
+            mead_compute_batch_kernel((MeadKernel)k, KERNEL_BATCH, volume, og, units, honey, water, NULL);
+            sink = water[r % KERNEL_BATCH];
+        }
+        report(name, mead_kernel_name((MeadKernel)k), (double)(rounds * KERNEL_BATCH), now_seconds() - start);
+    }
+
+    // Fixed-point inputs: int32_t gravity points instead of double OG
+    for (int k = MEAD_KERNEL_SCALAR; k <= MEAD_KERNEL_NEON; k++) {
+        if (!mead_kernel_supported((MeadKernel)k)) {
+            continue;
+        }
+        char variant[32];
+        snprintf(variant, sizeof(variant), "points_%s", mead_kernel_name((MeadKernel)k));
+        start = now_seconds();
+        for (long r = 0; r < rounds; r++) {
+            mead_compute_batch_points_kernel((MeadKernel)k, KERNEL_BATCH, volume, og_points, units, honey, water, NULL);
+            sink = water[r % KERNEL_BATCH];
+        }
+        report(name, variant, (double)(rounds * KERNEL_BATCH), now_seconds() - start);
+    }
+}
+
+static void bench_kernels(long elements) {
+    long rounds = elements / KERNEL_BATCH;
+
+    for (int i = 0; i < KERNEL_BATCH; i++) {
+        volume[i] = 1.0 + (i % 2000);
+        og[i] = MEAD_OG_TABLE[0][i & 3][i % MEAD_ABV_COUNT].og;
+        og_points[i] = MEAD_OG_POINTS_TABLE[0][i & 3][i % MEAD_ABV_COUNT];
+    }
+
+    // Alternating units: every tile mixes unit systems and takes the per-lane path
+    for (int i = 0; i < KERNEL_BATCH; i++) {
+        units[i] = (i & 1) ? MEAD_UNIT_METRIC : MEAD_UNIT_US_IMPERIAL;
+    }
+    run_kernels("honey_water", rounds);
+
+    // One unit per half: every tile is single-unit and takes the specialized loops
+    for (int i = 0; i < KERNEL_BATCH; i++) {
+        units[i] = (i < KERNEL_BATCH / 2) ? MEAD_UNIT_US_IMPERIAL : MEAD_UNIT_METRIC;
+    }
+    run_kernels("honey_water_blocked", rounds);
+}
+
+// --- Formatting ---
+
+static void bench_format(long iterations) {
+    char row[256];
+    size_t total = 0;
+
+    double start = now_seconds();
+    for (long i = 0; i < iterations; i++) {
+        double volume = 1.0 + (double)(i % 2000);
+        total += (size_t)snprintf(row, sizeof(row), "%ld,%s,%.2f,%g,%s,%s,%.3f,%.2f,%s,%.2f,%s,%.0f,ok\n",
+                                  i, "Liters", volume, 14.0, "Semi-Sweet", "Standard",
+                                  1.117, volume * 0.3472, "kg", volume * 0.743, "liters", volume * 30.9);
+    }
+    report("format_row", "snprintf", (double)iterations, now_seconds() - start);
+
+    // Same rows through the buffered writer (what batch mode uses), flushed to /dev/null
+    static MeadWriter out;
+    mead_writer_init(&out, open("/dev/null", O_WRONLY));
+    start = now_seconds();
+    for (long i = 0; i < iterations; i++) {
+        double volume = 1.0 + (double)(i % 2000);
+        MeadOutputRecord rec = { i, 1, MEAD_UNIT_METRIC, volume, 14.0, MEAD_SWEETNESS_SEMI_SWEET, 1, NULL,
+                                 1.117, volume * 0.3472, volume * 0.743, volume * 30.9, NULL, 0 };
+        total += out.len;
+        mead_write_record(&out, MEAD_FORMAT_CSV, &rec);
+    }
+    mead_writer_flush(&out);
+    report("format_row", "writer", (double)iterations, now_seconds() - start);
+    if (out.fd >= 0) {
+        close(out.fd);
+    }
+    sink = (double)total;
+}
+
+// --- End-to-End Batch Mode ---
+
+/**
+ * @brief Writes a synthetic CSV batch file with records cycling through the input domain.
+ * @return int 0 on success, -1 on I/O error.
+ */
+static int write_synthetic_batch(const char *path, long records) {
+    static const char *const units[] = { "Gallons", "Liters" };
+    static const char *const names[] = { "Dry", "Semi-Sweet", "Sweet", "Dessert" };
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        return -1;
+    }
+
+    setvbuf(out, NULL, _IOFBF, 1 << 20);
+    for (long i = 0; i < records; i++) {
+        fprintf(out, "%s,%ld,%ld,%s,%ld\n", units[i & 1], 5 + i % 1996, MEAD_MIN_ABV + (i >> 1) % MEAD_ABV_COUNT,
+                names[(i >> 2) & 3], 1 + ((i >> 4) & 1));
+    }
+    return (fclose(out) == 0) ? 0 : -1;
+}
+
+/**
+ * @brief Times "cli --batch" reading the file on stdin with output discarded.
+ * @return double Elapsed seconds, or a negative value if the run failed.
+ */
+static double time_batch_run(const char *cli, const char *input) {
+    double start = now_seconds();
+    pid_t pid = fork();
+    if (pid < 0) {
+        return -1.0;
+    }
+    if (pid == 0) {
+        int in = open(input, O_RDONLY);
+        int out = open("/dev/null", O_WRONLY);
+        if (in < 0 || out < 0 || dup2(in, STDIN_FILENO) < 0 || dup2(out, STDOUT_FILENO) < 0) {
+            _exit(127);
+        }
+        execl(cli, cli, "--batch", (char *)NULL);
+        _exit(127);
+    }
+
+    int status;
+    if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        return -1.0;
+    }
+    return now_seconds() - start;
+}
+
+static void bench_batch_e2e(const char *cli, const char *tmpdir, const char *record_list) {
+    char list[256];
+    snprintf(list, sizeof(list), "%s", record_list);
+
+    for (char *item = strtok(list, ","); item; item = strtok(NULL, ",")) {
+        long records = atol(item);
+        char path[512];
+        char variant[64];
+
+        if (records <= 0) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/mead_bench_%ld_%ld.csv", tmpdir, (long)getpid(), records);
+        snprintf(variant, sizeof(variant), "%ld_records", records);
+
+        if (write_synthetic_batch(path, records) != 0) {
+            fprintf(stderr, "Warning: Cannot write synthetic batch file '%s', skipping.\n", path);
+            unlink(path);
+            continue;
+        }
+        double seconds = time_batch_run(cli, path);
+        unlink(path);
+
+        if (seconds < 0.0) {
+            fprintf(stderr, "Warning: '%s --batch' failed, skipping end-to-end benchmark.\n", cli);
+            return;
+        }
+        report("batch_e2e", variant, (double)records, seconds);
+    }
+}
+
+// --- Main ---
+
+static void print_bench_usage(const char *program) {
+    printf("Usage: %s [--quick] [--only NAME] [--cli PATH] [--records N[,N...]] [--tmpdir DIR]\n", program);
+    printf("  --quick          Fewer iterations (for smoke tests)\n");
+    printf("  --only NAME      Run one group: target_og, honey_water (alternating and\n");
+    printf("                   blocked units), format_row or batch_e2e\n");
+    printf("  --cli PATH       meadGenerator binary for batch_e2e (default ./meadGenerator)\n");
+    printf("  --records LIST   Synthetic batch sizes for batch_e2e (default 1000000,100000000)\n");
+    printf("  --tmpdir DIR     Where the synthetic batch files are written (default /tmp)\n");
+    printf("Results are printed as one JSON object per line.\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *only = NULL;
+    const char *cli = "./meadGenerator";
+    const char *records = "1000000,100000000";
+    const char *tmpdir = "/tmp";
+    long scale = 20000000;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            scale = 200000;
+            records = "100000";
+        } else if (strcmp(argv[i], "--only") == 0 && i + 1 < argc) {
+            only = argv[++i];
+        } else if (strcmp(argv[i], "--cli") == 0 && i + 1 < argc) {
+            cli = argv[++i];
+        } else if (strcmp(argv[i], "--records") == 0 && i + 1 < argc) {
+            records = argv[++i];
+        } else if (strcmp(argv[i], "--tmpdir") == 0 && i + 1 < argc) {
+            tmpdir = argv[++i];
+        } else {
+            print_bench_usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+
+    if (!only || strcmp(only, "target_og") == 0) bench_target_og(scale);
+    if (!only || strcmp(only, "honey_water") == 0) bench_kernels(scale);
+    if (!only || strcmp(only, "format_row") == 0) bench_format(scale / 4);
+    if (!only || strcmp(only, "batch_e2e") == 0) bench_batch_e2e(cli, tmpdir, records);
+    return 0;
+}
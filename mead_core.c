@@ -0,0 +1,365 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+
+#include "mead_core.h"
+
+// Standard FG estimates for different sweetness levels (used only if not turbo)
+const double MEAD_DEFAULT_FG_TABLE[MEAD_SWEETNESS_COUNT] = {
+    MEAD_FG_DRY,
+    MEAD_FG_SEMI_SWEET,
+    MEAD_FG_SWEET,
+    MEAD_FG_DESSERT
+};
+
+const MeadModel MEAD_DEFAULT_MODEL = {
+    GRAVITY_POINTS_PER_UNIT,
+    KG_TO_LBS,
+    L_TO_GAL,
+    DISPLACEMENT_GAL_PER_10_LBS,
+    DISPLACEMENT_L_PER_KG,
+    ABV_FACTOR,
+    MEAD_MAX_OG,
+    { MEAD_FG_DRY, MEAD_FG_SEMI_SWEET, MEAD_FG_SWEET, MEAD_FG_DESSERT }
+};
+
+// The OG table is expanded by the preprocessor and folded by the compiler, so the fast
+// path in mead_og_entry() is a single indexed load. OG_ENTRY mirrors the formula
+// fallback: OG = FG + ABV / 131.25, rounded to 1.XXX (all values are positive, so
+// adding 0.5 before truncating rounds the same way as round()).
+#define OG_ROUND(og) ((int)((og) * 1000.0 + 0.5) / 1000.0)
+#define OG_ENTRY(fg, abv) { OG_ROUND((fg) + (abv) / ABV_FACTOR), (OG_ROUND((fg) + (abv) / ABV_FACTOR) - 1.000) * 1000.0 }
+#define OG_ROW(fg) {                                                                               \
+    OG_ENTRY(fg, 5.0),  OG_ENTRY(fg, 6.0),  OG_ENTRY(fg, 7.0),  OG_ENTRY(fg, 8.0),  OG_ENTRY(fg, 9.0),  \
+    OG_ENTRY(fg, 10.0), OG_ENTRY(fg, 11.0), OG_ENTRY(fg, 12.0), OG_ENTRY(fg, 13.0), OG_ENTRY(fg, 14.0), \
+    OG_ENTRY(fg, 15.0), OG_ENTRY(fg, 16.0), OG_ENTRY(fg, 17.0), OG_ENTRY(fg, 18.0), OG_ENTRY(fg, 19.0), \
+    OG_ENTRY(fg, 20.0), OG_ENTRY(fg, 21.0), OG_ENTRY(fg, 22.0), OG_ENTRY(fg, 23.0), OG_ENTRY(fg, 24.0), \
+    OG_ENTRY(fg, 25.0) }
+
+const MeadOgEntry MEAD_OG_TABLE[2][MEAD_SWEETNESS_COUNT][MEAD_ABV_COUNT] = {
+    // Standard yeast: FG by sweetness level
+    { OG_ROW(MEAD_FG_DRY), OG_ROW(MEAD_FG_SEMI_SWEET), OG_ROW(MEAD_FG_SWEET), OG_ROW(MEAD_FG_DESSERT) },
+    // Turbo yeast: FG forced to 1.000 for every sweetness level
+    { OG_ROW(1.000), OG_ROW(1.000), OG_ROW(1.000), OG_ROW(1.000) }
+};
+
+// Fixed-point table: FG points plus ABV points, each rounded on its own, as in og_points().
+// No integer ABV lands on a half point (ABV * 1000 / 131.25 = ABV * 160 / 21), so every
+// cell equals the gravity points of the rounded OG in MEAD_OG_TABLE.
+#define OG_POINTS(fg, abv) ((int32_t)(((fg) - 1.000) * MEAD_SG_SCALE + 0.5) + (int32_t)((abv) * MEAD_SG_SCALE / ABV_FACTOR + 0.5))
+#define OG_POINTS_ROW(fg) {                                                                                 \
+    OG_POINTS(fg, 5.0),  OG_POINTS(fg, 6.0),  OG_POINTS(fg, 7.0),  OG_POINTS(fg, 8.0),  OG_POINTS(fg, 9.0),  \
+    OG_POINTS(fg, 10.0), OG_POINTS(fg, 11.0), OG_POINTS(fg, 12.0), OG_POINTS(fg, 13.0), OG_POINTS(fg, 14.0), \
+    OG_POINTS(fg, 15.0), OG_POINTS(fg, 16.0), OG_POINTS(fg, 17.0), OG_POINTS(fg, 18.0), OG_POINTS(fg, 19.0), \
+    OG_POINTS(fg, 20.0), OG_POINTS(fg, 21.0), OG_POINTS(fg, 22.0), OG_POINTS(fg, 23.0), OG_POINTS(fg, 24.0), \
+    OG_POINTS(fg, 25.0) }
+
+const int32_t MEAD_OG_POINTS_TABLE[2][MEAD_SWEETNESS_COUNT][MEAD_ABV_COUNT] = {
+    { OG_POINTS_ROW(MEAD_FG_DRY), OG_POINTS_ROW(MEAD_FG_SEMI_SWEET), OG_POINTS_ROW(MEAD_FG_SWEET),
+      OG_POINTS_ROW(MEAD_FG_DESSERT) },
+    { OG_POINTS_ROW(1.000), OG_POINTS_ROW(1.000), OG_POINTS_ROW(1.000), OG_POINTS_ROW(1.000) }
+};
+
+static const char *const SWEETNESS_NAMES[MEAD_SWEETNESS_COUNT] = {
+    "Dry", "Semi-Sweet", "Sweet", "Dessert"
+};
+
+/**
+ * @brief Converts a sweetness level name to its enum value (case-insensitive).
+ * @param sweetness "Dry", "Semi-Sweet", "Sweet" or "Dessert".
+ * @return MeadSweetness The level, or MEAD_SWEETNESS_INVALID if not recognised.
+ */
+MeadSweetness mead_parse_sweetness(const char *sweetness) {
+    for (int i = 0; i < MEAD_SWEETNESS_COUNT; i++) {
+        if (strcasecmp(sweetness, SWEETNESS_NAMES[i]) == 0) {
+            return (MeadSweetness)i;
+        }
+    }
+    return MEAD_SWEETNESS_INVALID;
+}
+
+/**
+ * @brief Returns the display name of a sweetness level, or "Invalid".
+ */
+const char *mead_sweetness_name(MeadSweetness sweetness) {
+    if ((unsigned)sweetness >= MEAD_SWEETNESS_COUNT) {
+        return "Invalid";
+    }
+    return SWEETNESS_NAMES[sweetness];
+}
+
+/**
+ * @brief Returns the assumed Final Gravity (FG) for a sweetness level.
+ * @param fg_table FG per sweetness level, e.g. MEAD_DEFAULT_FG_TABLE.
+ * @param sweetness A valid sweetness level.
+ * @param is_turbo Flag: 1 for Standard, 2 for Turbo Yeast.
+ * @return double The FG (e.g., 1.010).
+ */
+double mead_final_gravity(const double *fg_table, MeadSweetness sweetness, int is_turbo) {
+    // TURBO YEAST MODE: Assumes fermentation goes to bone dry
+    return (is_turbo == 1) ? fg_table[sweetness] : 1.000;
+}
+
+// Returns the ABV index into the compile-time OG tables, or -1 if the formula must be used.
+// The tables are only valid for the default FG values and ABV factor, so any other model
+// takes the formula.
+static int og_table_index(const double *fg_table, double abv_factor, double abv) {
+    if (abv >= MEAD_MIN_ABV && abv <= MEAD_MAX_ABV && abv_factor == ABV_FACTOR &&
+        (fg_table == MEAD_DEFAULT_FG_TABLE || memcmp(fg_table, MEAD_DEFAULT_FG_TABLE, sizeof(MEAD_DEFAULT_FG_TABLE)) == 0)) {
+        int index = (int)abv - MEAD_MIN_ABV;
+        if (index + MEAD_MIN_ABV == abv) {
+            return index;
+        }
+    }
+    return -1;
+}
+
+// Shared by mead_og_entry() and mead_model_og_entry().
+static MeadOgEntry og_entry(const double *fg_table, double abv_factor, double abv, MeadSweetness sweetness,
+                            int is_turbo) {
+    int index = og_table_index(fg_table, abv_factor, abv);
+    if (index >= 0) {
+        return MEAD_OG_TABLE[is_turbo != 1][sweetness][index];
+    }
+
+    double fg = mead_final_gravity(fg_table, sweetness, is_turbo);
+
+    // Rearranging the ABV formula for OG: OG = FG + (ABV / 131.25)
+    double og = fg + (abv / abv_factor);
+
+    // OG is represented as 1.XXX, so we round the result
+    MeadOgEntry entry;
+    entry.og = round(og * 1000.0) / 1000.0;
+    entry.gravity_points = (entry.og - 1.000) * 1000.0;
+    return entry;
+}
+
+/**
+ * @brief Looks up the target OG and gravity points per gallon for a recipe.
+ * Integer ABV within MEAD_MIN_ABV..MEAD_MAX_ABV with the default FG values is read from
+ * MEAD_OG_TABLE; fractional ABV or a custom FG table falls back to the formula.
+ * @param fg_table FG per sweetness level, e.g. MEAD_DEFAULT_FG_TABLE.
+ * @param abv Target Alcohol by Volume percentage.
+ * @param sweetness A valid sweetness level.
+ * @param is_turbo Flag: 1 for Standard, 2 for Turbo Yeast.
+ * @return MeadOgEntry The target OG and its gravity points per gallon.
+ */
+MeadOgEntry mead_og_entry(const double *fg_table, double abv, MeadSweetness sweetness, int is_turbo) {
+    return og_entry(fg_table, ABV_FACTOR, abv, sweetness, is_turbo);
+}
+
+/**
+ * @brief Calculates the required Original Gravity (OG) based on target ABV and sweetness.
+ * @param fg_table FG per sweetness level, e.g. MEAD_DEFAULT_FG_TABLE.
+ * @param abv Target Alcohol by Volume percentage.
+ * @param sweetness A valid sweetness level.
+ * @param is_turbo Flag: 1 for Standard, 2 for Turbo Yeast.
+ * @return double The required Original Gravity (e.g., 1.100).
+ */
+double mead_target_og(const double *fg_table, double abv, MeadSweetness sweetness, int is_turbo) {
+    return mead_og_entry(fg_table, abv, sweetness, is_turbo).og;
+}
+
+/**
+ * @brief String convenience wrapper around mead_target_og() with the default FG table.
+ * Prefer parsing the sweetness once with mead_parse_sweetness() on hot paths.
+ * @return double The required Original Gravity, or 0.0 if the sweetness is invalid.
+ */
+double mead_get_target_og(int abv, const char *sweetness, int is_turbo) {
+    MeadSweetness level = mead_parse_sweetness(sweetness);
+    if (level == MEAD_SWEETNESS_INVALID) {
+        return 0.0;
+    }
+    return mead_target_og(MEAD_DEFAULT_FG_TABLE, abv, level, is_turbo);
+}
+
+/**
+ * @brief Fills the og-dependent result fields from a target OG and its gravity points per gallon.
+ */
+static void compute_from_entry(const MeadModel *model, MeadUnit unit, double volume, MeadOgEntry entry,
+                               MeadResult *out) {
+    MeadUnitCoeffs coeffs;
+    mead_model_unit_coeffs(model, unit, &coeffs);
+
+    out->og = entry.og;
+    out->og_too_high = entry.og > model->max_og;
+
+    // Same operations, in the same order, as the batch kernels (mead_kernel.c)
+    double point_volumes = entry.gravity_points * volume;
+    out->honey = point_volumes / coeffs.yield;
+    out->gravity_points = point_volumes * coeffs.to_gallons;
+
+    double water = volume - out->honey / coeffs.honey_step * coeffs.displacement;
+    out->water_clamped = !(water > 0.0);
+    out->water = out->water_clamped ? 0.0 : water;
+}
+
+/**
+ * @brief Computes honey, water and gravity points for a known target OG.
+ * Only og-dependent fields are filled in; out->fg is left untouched.
+ * @param unit Unit system of volume and of the results.
+ * @param volume Batch volume in Gallons or Liters.
+ * @param target_og The calculated Original Gravity.
+ * @param out Result struct to fill.
+ */
+void mead_compute_ingredients(MeadUnit unit, double volume, double target_og, MeadResult *out) {
+    mead_model_compute_ingredients(&MEAD_DEFAULT_MODEL, unit, volume, target_og, out);
+}
+
+/**
+ * @brief Performs the full recipe calculation: target OG, FG, honey and water.
+ * @param unit Unit system of volume and of the results.
+ * @param volume Batch volume in Gallons or Liters.
+ * @param abv Target Alcohol by Volume percentage.
+ * @param sweetness Sweetness level from mead_parse_sweetness().
+ * @param is_turbo Flag: 1 for Standard, 2 for Turbo Yeast.
+ * @param fg_table FG per sweetness level, e.g. MEAD_DEFAULT_FG_TABLE.
+ * @param out Result struct to fill.
+ * @return MeadStatus MEAD_OK, or MEAD_ERR_SWEETNESS if the sweetness is invalid.
+ */
+MeadStatus mead_calculate(MeadUnit unit, double volume, double abv, MeadSweetness sweetness, int is_turbo,
+                          const double *fg_table, MeadResult *out) {
+    if ((unsigned)sweetness >= MEAD_SWEETNESS_COUNT) {
+        return MEAD_ERR_SWEETNESS;
+    }
+
+    out->fg = mead_final_gravity(fg_table, sweetness, is_turbo);
+    compute_from_entry(&MEAD_DEFAULT_MODEL, unit, volume, mead_og_entry(fg_table, abv, sweetness, is_turbo), out);
+    return MEAD_OK;
+}
+
+// --- Model API ---
+
+/**
+ * @brief Fills a model with the standard parameters (a copy of MEAD_DEFAULT_MODEL).
+ */
+void mead_model_init(MeadModel *model) {
+    *model = MEAD_DEFAULT_MODEL;
+}
+
+/**
+ * @brief Folds a model's conversion factors into the coefficients of one unit system.
+ * Any unit other than MEAD_UNIT_METRIC is taken as US Imperial.
+ */
+void mead_model_unit_coeffs(const MeadModel *model, MeadUnit unit, MeadUnitCoeffs *out) {
+    if (unit == MEAD_UNIT_METRIC) {
+        out->yield = model->ppg * model->kg_to_lbs / model->l_to_gal;
+        out->honey_step = MEAD_METRIC_HONEY_STEP;
+        out->displacement = model->displacement_l_per_kg;
+        out->to_gallons = model->l_to_gal;
+    } else {
+        out->yield = model->ppg;
+        out->honey_step = MEAD_IMPERIAL_HONEY_STEP;
+        out->displacement = model->displacement_gal_per_10_lbs;
+        out->to_gallons = MEAD_IMPERIAL_TO_GAL;
+    }
+}
+
+/**
+ * @brief Returns the assumed Final Gravity (FG) for a sweetness level under a model.
+ */
+double mead_model_final_gravity(const MeadModel *model, MeadSweetness sweetness, int is_turbo) {
+    return mead_final_gravity(model->fg_table, sweetness, is_turbo);
+}
+
+/**
+ * @brief Target OG and gravity points per gallon under a model (see mead_og_entry()).
+ */
+MeadOgEntry mead_model_og_entry(const MeadModel *model, double abv, MeadSweetness sweetness, int is_turbo) {
+    return og_entry(model->fg_table, model->abv_factor, abv, sweetness, is_turbo);
+}
+
+/**
+ * @brief Computes honey, water and gravity points for a known target OG under a model.
+ * Only og-dependent fields are filled in; out->fg is left untouched.
+ */
+void mead_model_compute_ingredients(const MeadModel *model, MeadUnit unit, double volume, double target_og,
+                                    MeadResult *out) {
+    MeadOgEntry entry = { target_og, (target_og - 1.000) * 1000.0 };
+    compute_from_entry(model, unit, volume, entry, out);
+}
+
+/**
+ * @brief Performs the full recipe calculation under a model. Reentrant: reads only
+ * *model and writes only *out, so any number of threads may share one model.
+ * @param model Model parameters, e.g. &MEAD_DEFAULT_MODEL.
+ * @param unit Unit system of volume and of the results.
+ * @param volume Batch volume in Gallons or Liters.
+ * @param abv Target Alcohol by Volume percentage.
+ * @param sweetness Sweetness level from mead_parse_sweetness().
+ * @param is_turbo Flag: 1 for Standard, 2 for Turbo Yeast.
+ * @param out Result struct to fill.
+ * @return MeadStatus MEAD_OK, or MEAD_ERR_SWEETNESS if the sweetness is invalid.
+ */
+MeadStatus mead_model_calculate(const MeadModel *model, MeadUnit unit, double volume, double abv,
+                                MeadSweetness sweetness, int is_turbo, MeadResult *out) {
+    if ((unsigned)sweetness >= MEAD_SWEETNESS_COUNT) {
+        return MEAD_ERR_SWEETNESS;
+    }
+
+    out->fg = mead_model_final_gravity(model, sweetness, is_turbo);
+    compute_from_entry(model, unit, volume, mead_model_og_entry(model, abv, sweetness, is_turbo), out);
+    return MEAD_OK;
+}
+
+// --- Fixed-Point Gravity ---
+
+// Rounds half away from zero without libm; FG below 1.000 gives negative points.
+static int32_t round_points(double points) {
+    return (points >= 0.0) ? (int32_t)(points + 0.5) : -(int32_t)(0.5 - points);
+}
+
+static int32_t og_points(const double *fg_table, double abv_factor, double abv, MeadSweetness sweetness,
+                         int is_turbo) {
+    int index = og_table_index(fg_table, abv_factor, abv);
+    if (index >= 0) {
+        return MEAD_OG_POINTS_TABLE[is_turbo != 1][sweetness][index];
+    }
+
+    double fg = mead_final_gravity(fg_table, sweetness, is_turbo);
+    return round_points((fg - 1.000) * MEAD_SG_SCALE) + round_points(abv * MEAD_SG_SCALE / abv_factor);
+}
+
+/**
+ * @brief Target OG as integer gravity points per gallon (1.107 -> 107).
+ * Integer ABV with the default FG values is read from MEAD_OG_POINTS_TABLE; otherwise
+ * the FG and ABV contributions are each rounded to whole points and added, so the
+ * result never depends on how an intermediate double OG happened to round.
+ * @param fg_table FG per sweetness level, e.g. MEAD_DEFAULT_FG_TABLE.
+ * @param abv Target Alcohol by Volume percentage.
+ * @param sweetness A valid sweetness level.
+ * @param is_turbo Flag: 1 for Standard, 2 for Turbo Yeast.
+ * @return int32_t Gravity points per gallon; the OG is MEAD_POINTS_TO_OG() of it.
+ */
+int32_t mead_og_points(const double *fg_table, double abv, MeadSweetness sweetness, int is_turbo) {
+    return og_points(fg_table, ABV_FACTOR, abv, sweetness, is_turbo);
+}
+
+/**
+ * @brief Target OG as integer gravity points under a model (see mead_og_points()).
+ */
+int32_t mead_model_og_points(const MeadModel *model, double abv, MeadSweetness sweetness, int is_turbo) {
+    return og_points(model->fg_table, model->abv_factor, abv, sweetness, is_turbo);
+}
+
+/**
+ * @brief Computes honey, water and gravity points from integer gravity points per gallon.
+ * Equivalent to mead_model_compute_ingredients() without the OG -> points round trip:
+ * the points enter the volume product exactly. Only og-dependent fields are filled in.
+ * @param model Model parameters, e.g. &MEAD_DEFAULT_MODEL.
+ * @param unit Unit system of volume and of the results.
+ * @param volume Batch volume in Gallons or Liters.
+ * @param og_points Target OG as gravity points, e.g. from mead_og_points().
+ * @param out Result struct to fill.
+ */
+void mead_model_compute_points(const MeadModel *model, MeadUnit unit, double volume, int32_t og_points,
+                               MeadResult *out) {
+    MeadOgEntry entry = { MEAD_POINTS_TO_OG(og_points), (double)og_points };
+    compute_from_entry(model, unit, volume, entry, out);
+}
@@ -0,0 +1,180 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+#ifndef MEAD_CORE_H
+#define MEAD_CORE_H
+
+#include <stdint.h>
+
+// Shared calculation core for the CLI (meadGenerator.c) and the GTK app (mead_gtk_app.c).
+// Everything in here is pure math: no printing, no widgets and no allocation.
+
+// --- Constants ---
+
+#define VERSION_STRING  "0.1.1"
+
+// The approximate gravity points per pound of honey per gallon of water (for calculation purposes).
+// This is a standard estimate for most floral honeys (35 PPG).
+#define GRAVITY_POINTS_PER_UNIT 35.0
+
+// Conversion factors
+#define KG_TO_LBS 2.20462 // 1 kg = 2.20462 lbs
+#define L_TO_GAL 0.264172 // 1 L = 0.264172 gallons
+
+// Mead/Wine ABV formula approximation: ABV = (OG - FG) * 131.25
+#define ABV_FACTOR 131.25
+
+// Honey displacement: 0.65 gallons per 10 lbs, or ~0.74 liters per kg
+#define DISPLACEMENT_GAL_PER_10_LBS 0.65
+#define DISPLACEMENT_L_PER_KG 0.74
+
+// Unit systems. Recipes are calculated in their own units: the unit conversions are
+// folded into one coefficient set per system (MeadUnitCoeffs), so honey and water
+// follow from the gravity points per gallon times the batch volume ("point-volumes")
+// without converting liters to gallons or pounds to kilograms on the way. Only the
+// reported gravity_points, which are US gallon based, are converted, at the output.
+// These are the coefficients of the standard model, as compile-time constants; the
+// expressions match mead_model_unit_coeffs() operation for operation.
+#define MEAD_IMPERIAL_YIELD GRAVITY_POINTS_PER_UNIT                         // Point-gallons per lb
+#define MEAD_METRIC_YIELD (GRAVITY_POINTS_PER_UNIT * KG_TO_LBS / L_TO_GAL)   // Point-liters per kg
+#define MEAD_IMPERIAL_HONEY_STEP 10.0                                        // Displacement per 10 lbs
+#define MEAD_METRIC_HONEY_STEP 1.0                                           //   and per kg
+#define MEAD_IMPERIAL_DISPLACEMENT DISPLACEMENT_GAL_PER_10_LBS
+#define MEAD_METRIC_DISPLACEMENT DISPLACEMENT_L_PER_KG
+#define MEAD_IMPERIAL_TO_GAL 1.0
+#define MEAD_METRIC_TO_GAL L_TO_GAL
+
+// Above this OG the recipe exceeds the tolerance of most mead yeasts (max OG is usually around 1.220).
+#define MEAD_MAX_OG 1.225
+
+// Supported target ABV range (max 25 to support turbo yeast)
+#define MEAD_MIN_ABV 5
+#define MEAD_MAX_ABV 25
+#define MEAD_ABV_COUNT (MEAD_MAX_ABV - MEAD_MIN_ABV + 1)
+
+// Standard FG estimates per sweetness level (see MEAD_DEFAULT_FG_TABLE)
+#define MEAD_FG_DRY 1.000
+#define MEAD_FG_SEMI_SWEET 1.010
+#define MEAD_FG_SWEET 1.020
+#define MEAD_FG_DESSERT 1.030
+
+// Fixed-point gravity: an SG of 1.XXX is held as the integer gravity points XXX
+// ((SG - 1.000) * MEAD_SG_SCALE), so 1.107 is 107 and 0.996 is -4. Rounding happens
+// once, when the points are derived; the fixed-point functions never convert back.
+#define MEAD_SG_SCALE 1000
+#define MEAD_POINTS_TO_OG(points) ((double)(MEAD_SG_SCALE + (points)) / MEAD_SG_SCALE)
+#define MEAD_MAX_OG_POINTS 225 // MEAD_MAX_OG as gravity points
+
+// --- Types ---
+
+typedef enum {
+    MEAD_UNIT_US_IMPERIAL = 1, // Gallons / Lbs
+    MEAD_UNIT_METRIC = 2       // Liters / Kg
+} MeadUnit;
+
+// Sweetness levels, in the order shown by both front ends. Parse strings with
+// mead_parse_sweetness() once at the input boundary; the math only uses this enum.
+typedef enum {
+    MEAD_SWEETNESS_INVALID = -1,
+    MEAD_SWEETNESS_DRY = 0,
+    MEAD_SWEETNESS_SEMI_SWEET,
+    MEAD_SWEETNESS_SWEET,
+    MEAD_SWEETNESS_DESSERT,
+    MEAD_SWEETNESS_COUNT
+} MeadSweetness;
+
+typedef enum {
+    MEAD_OK = 0,
+    MEAD_ERR_SWEETNESS, // Sweetness is not Dry, Semi-Sweet, Sweet or Dessert
+    MEAD_ERR_RANGE      // A numeric input is zero, negative or otherwise out of range
+} MeadStatus;
+
+// The result of one recipe calculation. Honey and water are in the units of the
+// requested unit system (lbs/gallons or kg/liters).
+typedef struct {
+    double og;             // Target Original Gravity (e.g. 1.107)
+    double fg;             // Assumed Final Gravity
+    double honey;          // Required honey, lbs or kg
+    double water;          // Water to top off, gallons or liters (never negative)
+    double gravity_points; // Total gravity points needed (based on US Gal/Lbs)
+    int water_clamped;     // Non-zero if honey volume meets or exceeds batch volume
+    int og_too_high;       // Non-zero if og > MEAD_MAX_OG
+} MeadResult;
+
+// Parameters of the honey/fermentation model. Every calculation reads its constants
+// from one of these, so threads can run different models side by side: the model is
+// only read, and all results go to caller-owned structs. Start from
+// MEAD_DEFAULT_MODEL (or mead_model_init()) and override fields as needed.
+typedef struct {
+    double ppg;                         // Gravity points per lb per US gallon (GRAVITY_POINTS_PER_UNIT)
+    double kg_to_lbs;                   // KG_TO_LBS
+    double l_to_gal;                    // L_TO_GAL
+    double displacement_gal_per_10_lbs; // Gallons displaced by 10 lbs of honey (0.65)
+    double displacement_l_per_kg;       // Liters displaced by 1 kg of honey (0.74)
+    double abv_factor;                  // ABV = (OG - FG) * abv_factor (ABV_FACTOR)
+    double max_og;                      // og_too_high threshold (MEAD_MAX_OG)
+    double fg_table[MEAD_SWEETNESS_COUNT]; // FG per MeadSweetness for Standard yeast
+} MeadModel;
+
+// A model's constants for one unit system (see MEAD_IMPERIAL_YIELD):
+//   honey = point_volumes / yield, water = volume - honey / honey_step * displacement,
+//   gravity_points = point_volumes * to_gallons.
+// (Dividing by a honey_step of 1.0 is exact, so metric pays no rounding for it.)
+typedef struct {
+    double yield;          // Point-volumes per unit of honey (lb or kg)
+    double honey_step;     // Honey that displaces `displacement` (10 lbs or 1 kg)
+    double displacement;   // Volume (gallons or liters) displaced by honey_step of honey
+    double to_gallons;     // US gallons per unit of volume
+} MeadUnitCoeffs;
+
+// Target OG and gravity points per gallon ((OG - 1.000) * 1000) for one table cell.
+typedef struct {
+    double og;
+    double gravity_points;
+} MeadOgEntry;
+
+// Standard FG estimates, indexed by MeadSweetness (Dry 1.000 ... Dessert 1.030).
+extern const double MEAD_DEFAULT_FG_TABLE[MEAD_SWEETNESS_COUNT];
+
+// The standard model: 35 PPG floral honey and the MEAD_FG_* estimates.
+extern const MeadModel MEAD_DEFAULT_MODEL;
+
+// Every integer-ABV target OG for the default FG table, computed at compile time.
+// Indexed by [is_turbo == 1 ? 0 : 1][sweetness][abv - MEAD_MIN_ABV].
+extern const MeadOgEntry MEAD_OG_TABLE[2][MEAD_SWEETNESS_COUNT][MEAD_ABV_COUNT];
+
+// The same table as integer gravity points per gallon, indexed like MEAD_OG_TABLE.
+extern const int32_t MEAD_OG_POINTS_TABLE[2][MEAD_SWEETNESS_COUNT][MEAD_ABV_COUNT];
+
+// --- Functions ---
+
+MeadSweetness mead_parse_sweetness(const char *sweetness);
+const char *mead_sweetness_name(MeadSweetness sweetness);
+double mead_final_gravity(const double *fg_table, MeadSweetness sweetness, int is_turbo);
+MeadOgEntry mead_og_entry(const double *fg_table, double abv, MeadSweetness sweetness, int is_turbo);
+double mead_target_og(const double *fg_table, double abv, MeadSweetness sweetness, int is_turbo);
+double mead_get_target_og(int abv, const char *sweetness, int is_turbo);
+void mead_compute_ingredients(MeadUnit unit, double volume, double target_og, MeadResult *out);
+MeadStatus mead_calculate(MeadUnit unit, double volume, double abv, MeadSweetness sweetness, int is_turbo,
+                          const double *fg_table, MeadResult *out);
+
+// Reentrant model API: same results as the functions above for MEAD_DEFAULT_MODEL.
+void mead_model_init(MeadModel *model);
+void mead_model_unit_coeffs(const MeadModel *model, MeadUnit unit, MeadUnitCoeffs *out);
+double mead_model_final_gravity(const MeadModel *model, MeadSweetness sweetness, int is_turbo);
+MeadOgEntry mead_model_og_entry(const MeadModel *model, double abv, MeadSweetness sweetness, int is_turbo);
+void mead_model_compute_ingredients(const MeadModel *model, MeadUnit unit, double volume, double target_og,
+                                    MeadResult *out);
+MeadStatus mead_model_calculate(const MeadModel *model, MeadUnit unit, double volume, double abv,
+                                MeadSweetness sweetness, int is_turbo, MeadResult *out);
+
+// Fixed-point gravity API: target OG as integer gravity points (see MEAD_SG_SCALE).
+int32_t mead_og_points(const double *fg_table, double abv, MeadSweetness sweetness, int is_turbo);
+int32_t mead_model_og_points(const MeadModel *model, double abv, MeadSweetness sweetness, int is_turbo);
+void mead_model_compute_points(const MeadModel *model, MeadUnit unit, double volume, int32_t og_points,
+                               MeadResult *out);
+
+#endif // MEAD_CORE_H
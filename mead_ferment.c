@@ -0,0 +1,296 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "mead_core.h"
+#include "mead_kernel.h"
+#include "mead_ferment.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MEAD_HAVE_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define MEAD_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Double arrays: og, terminal, tolerance, temperature, rate, points, fed, day start,
+// one per feeding.
+#define DOUBLE_ARRAYS (8 + MEAD_FERMENT_MAX_FEEDS)
+// Int arrays: finished_day, one day per feeding.
+#define INT_ARRAYS (1 + MEAD_FERMENT_MAX_FEEDS)
+
+/**
+ * @brief Allocates a cellar of count batches in one block, with no feedings, 20 C and
+ * every batch at 1.000. The state is reset, ready for mead_ferment_run().
+ * @param batches Cellar to fill.
+ * @param count Number of batches (> 0).
+ * @param abv_factor ABV per 1000 points fermented, e.g. ABV_FACTOR.
+ * @return int 0 on success, -1 if memory could not be obtained.
+ */
+int mead_ferment_alloc(MeadFermentBatches *batches, size_t count, double abv_factor) {
+    memset(batches, 0, sizeof(*batches));
+    if (count == 0 || count > SIZE_MAX / (DOUBLE_ARRAYS * sizeof(double) + INT_ARRAYS * sizeof(int))) {
+        return -1;
+    }
+
+    double *d = malloc(count * (DOUBLE_ARRAYS * sizeof(double) + INT_ARRAYS * sizeof(int)));
+    if (!d) {
+        return -1;
+    }
+    int *n = (int *)(d + DOUBLE_ARRAYS * count);
+
+    batches->count = count;
+    batches->abv_factor = abv_factor;
+    batches->og_points = d;
+    batches->terminal_points = d + count;
+    batches->tolerance_abv = d + 2 * count;
+    batches->temperature = d + 3 * count;
+    batches->rate = d + 4 * count;
+    batches->points = d + 5 * count;
+    batches->fed_points = d + 6 * count;
+    batches->day_start = d + 7 * count;
+    batches->finished_day = n;
+    for (int k = 0; k < MEAD_FERMENT_MAX_FEEDS; k++) {
+        batches->feed_points[k] = d + (size_t)(8 + k) * count;
+        batches->feed_day[k] = n + (size_t)(1 + k) * count;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        mead_ferment_set_batch(batches, i, 0, MEAD_MAX_ABV, 1, 20.0);
+    }
+    return 0;
+}
+
+void mead_ferment_free(MeadFermentBatches *batches) {
+    free(batches->og_points); // Start of the single block
+    memset(batches, 0, sizeof(*batches));
+}
+
+/**
+ * @brief Sets up one batch from a recipe and resets its state to day 0.
+ * Standard yeast is given the target ABV as its tolerance, so without feedings it
+ * stops at the FG the recipe calculation assumed; turbo yeast ferments to dryness.
+ * Feedings are cleared.
+ * @param batches Cellar from mead_ferment_alloc().
+ * @param i Batch index.
+ * @param og_points Starting gravity, e.g. from mead_og_points().
+ * @param target_abv Target ABV of the recipe.
+ * @param is_turbo Flag: 1 for Standard, 2 for Turbo Yeast.
+ * @param temperature Fermentation temperature, degrees Celsius.
+ */
+void mead_ferment_set_batch(MeadFermentBatches *batches, size_t i, int32_t og_points, double target_abv,
+                            int is_turbo, double temperature) {
+    batches->og_points[i] = og_points;
+    batches->terminal_points[i] = 0.0;
+    batches->tolerance_abv[i] = (is_turbo == 1) ? target_abv : MEAD_FERMENT_TURBO_TOLERANCE;
+    batches->temperature[i] = temperature;
+    batches->rate[i] = 0.0;
+    batches->points[i] = og_points;
+    batches->fed_points[i] = og_points;
+    batches->finished_day[i] = -1;
+    for (int k = 0; k < MEAD_FERMENT_MAX_FEEDS; k++) {
+        batches->feed_day[k][i] = -1;
+        batches->feed_points[k][i] = 0.0;
+    }
+    batches->day = 0;
+}
+
+/**
+ * @brief Returns the alcohol a batch has made so far, percent by volume.
+ */
+double mead_ferment_abv(const MeadFermentBatches *batches, size_t i) {
+    return (batches->fed_points[i] - batches->points[i]) / MEAD_SG_SCALE * batches->abv_factor;
+}
+
+// Rate constant per day at a temperature: Q10 scaling around 20 C, zero outside the active range.
+static double temperature_rate(double temperature) {
+    if (!(temperature >= MEAD_FERMENT_MIN_TEMP && temperature <= MEAD_FERMENT_MAX_TEMP)) {
+        return 0.0;
+    }
+    return MEAD_FERMENT_RATE_20C * pow(MEAD_FERMENT_Q10, (temperature - 20.0) / 10.0);
+}
+
+/**
+ * @brief Applies the feedings scheduled for the current day to every batch.
+ */
+static void apply_feeds(MeadFermentBatches *b) {
+    for (int k = 0; k < MEAD_FERMENT_MAX_FEEDS; k++) {
+        const int *feed_day = b->feed_day[k];
+        const double *feed_points = b->feed_points[k];
+        for (size_t i = 0; i < b->count; i++) {
+            double add = (feed_day[i] == b->day) ? feed_points[i] : 0.0;
+            b->points[i] += add;
+            b->fed_points[i] += add;
+            if (add > 0.0) {
+                b->finished_day[i] = -1; // Fresh sugar restarts the fermentation
+            }
+        }
+    }
+}
+
+// --- Substep Kernels ---
+
+// Every variant performs the same IEEE operations per batch as substep_scalar(), in
+// the same order, so the curves do not depend on the CPU (build with -ffp-contract=off).
+
+/**
+ * @brief Advances every batch by one Euler substep; activity is the growth-phase ramp
+ * shared by the whole cellar.
+ */
+static void substep_scalar(MeadFermentBatches *b, size_t first, double activity) {
+    const double dt = 1.0 / MEAD_FERMENT_STEPS_PER_DAY;
+    const double points_per_abv = MEAD_SG_SCALE / b->abv_factor;
+
+    for (size_t i = first; i < b->count; i++) {
+        // Points the yeast can still ferment before reaching its tolerance
+        double capacity = b->tolerance_abv[i] * points_per_abv - (b->fed_points[i] - b->points[i]);
+        double fermentable = b->points[i] - b->terminal_points[i];
+        double limit = (fermentable < capacity) ? fermentable : capacity;
+        limit = (limit > 0.0) ? limit : 0.0;
+        b->points[i] -= b->rate[i] * activity * limit * dt;
+    }
+}
+
+#ifdef MEAD_HAVE_X86
+
+__attribute__((target("sse2")))
+static void substep_sse2(MeadFermentBatches *b, double activity) {
+    const __m128d dt = _mm_set1_pd(1.0 / MEAD_FERMENT_STEPS_PER_DAY);
+    const __m128d points_per_abv = _mm_set1_pd(MEAD_SG_SCALE / b->abv_factor);
+    const __m128d act = _mm_set1_pd(activity);
+    const __m128d zero = _mm_setzero_pd();
+    size_t i = 0;
+
+    for (; i + 2 <= b->count; i += 2) {
+        __m128d p = _mm_loadu_pd(b->points + i);
+        __m128d capacity = _mm_sub_pd(_mm_mul_pd(_mm_loadu_pd(b->tolerance_abv + i), points_per_abv),
+                                      _mm_sub_pd(_mm_loadu_pd(b->fed_points + i), p));
+        __m128d fermentable = _mm_sub_pd(p, _mm_loadu_pd(b->terminal_points + i));
+        // minpd/maxpd return their second operand for NaN and ties, matching the scalar selects
+        __m128d limit = _mm_max_pd(_mm_min_pd(fermentable, capacity), zero);
+        __m128d drop = _mm_mul_pd(_mm_mul_pd(_mm_mul_pd(_mm_loadu_pd(b->rate + i), act), limit), dt);
+        _mm_storeu_pd(b->points + i, _mm_sub_pd(p, drop));
+    }
+    substep_scalar(b, i, activity);
+}
+
+__attribute__((target("avx2")))
+static void substep_avx2(MeadFermentBatches *b, double activity) {
+    const __m256d dt = _mm256_set1_pd(1.0 / MEAD_FERMENT_STEPS_PER_DAY);
+    const __m256d points_per_abv = _mm256_set1_pd(MEAD_SG_SCALE / b->abv_factor);
+    const __m256d act = _mm256_set1_pd(activity);
+    const __m256d zero = _mm256_setzero_pd();
+    size_t i = 0;
+
+    for (; i + 4 <= b->count; i += 4) {
+        __m256d p = _mm256_loadu_pd(b->points + i);
+        __m256d capacity = _mm256_sub_pd(_mm256_mul_pd(_mm256_loadu_pd(b->tolerance_abv + i), points_per_abv),
+                                         _mm256_sub_pd(_mm256_loadu_pd(b->fed_points + i), p));
+        __m256d fermentable = _mm256_sub_pd(p, _mm256_loadu_pd(b->terminal_points + i));
+        __m256d limit = _mm256_max_pd(_mm256_min_pd(fermentable, capacity), zero);
+        __m256d drop = _mm256_mul_pd(_mm256_mul_pd(_mm256_mul_pd(_mm256_loadu_pd(b->rate + i), act), limit), dt);
+        _mm256_storeu_pd(b->points + i, _mm256_sub_pd(p, drop));
+    }
+    substep_scalar(b, i, activity);
+}
+
+#endif // MEAD_HAVE_X86
+
+#ifdef MEAD_HAVE_NEON
+
+static void substep_neon(MeadFermentBatches *b, double activity) {
+    const float64x2_t dt = vdupq_n_f64(1.0 / MEAD_FERMENT_STEPS_PER_DAY);
+    const float64x2_t points_per_abv = vdupq_n_f64(MEAD_SG_SCALE / b->abv_factor);
+    const float64x2_t act = vdupq_n_f64(activity);
+    const float64x2_t zero = vdupq_n_f64(0.0);
+    size_t i = 0;
+
+    for (; i + 2 <= b->count; i += 2) {
+        float64x2_t p = vld1q_f64(b->points + i);
+        float64x2_t capacity = vsubq_f64(vmulq_f64(vld1q_f64(b->tolerance_abv + i), points_per_abv),
+                                         vsubq_f64(vld1q_f64(b->fed_points + i), p));
+        float64x2_t fermentable = vsubq_f64(p, vld1q_f64(b->terminal_points + i));
+        // vminq/vmaxq propagate NaN, so select with compares like the scalar code does
+        float64x2_t limit = vbslq_f64(vcltq_f64(fermentable, capacity), fermentable, capacity);
+        limit = vbslq_f64(vcgtq_f64(limit, zero), limit, zero);
+        float64x2_t drop = vmulq_f64(vmulq_f64(vmulq_f64(vld1q_f64(b->rate + i), act), limit), dt);
+        vst1q_f64(b->points + i, vsubq_f64(p, drop));
+    }
+    substep_scalar(b, i, activity);
+}
+
+#endif // MEAD_HAVE_NEON
+
+static void substep(MeadKernel kernel, MeadFermentBatches *b, double activity) {
+    switch (kernel) {
+#ifdef MEAD_HAVE_X86
+    case MEAD_KERNEL_AVX2:
+        substep_avx2(b, activity);
+        return;
+    case MEAD_KERNEL_SSE2:
+        substep_sse2(b, activity);
+        return;
+#endif
+#ifdef MEAD_HAVE_NEON
+    case MEAD_KERNEL_NEON:
+        substep_neon(b, activity);
+        return;
+#endif
+    default:
+        substep_scalar(b, 0, activity);
+        return;
+    }
+}
+
+// --- Simulation ---
+
+/**
+ * @brief Simulates days more days for every batch in the cellar.
+ * Each day applies that day's feedings, then MEAD_FERMENT_STEPS_PER_DAY substeps run
+ * over all batches with the widest SIMD kernel the CPU supports (see mead_kernel.h).
+ * @param batches Cellar; batches->day advances by days.
+ * @param days Number of days (capped so the total stays within MEAD_FERMENT_MAX_DAYS).
+ * @param curve Output: gravity points at the end of each simulated day, day-major
+ * (curve[d * count + i]), or NULL if only the final state is wanted.
+ */
+void mead_ferment_run(MeadFermentBatches *batches, int days, double *curve) {
+    size_t count = batches->count;
+    MeadKernel kernel = mead_kernel_detect();
+
+    if (days > MEAD_FERMENT_MAX_DAYS - batches->day) {
+        days = MEAD_FERMENT_MAX_DAYS - batches->day;
+    }
+    for (size_t i = 0; i < count; i++) {
+        batches->rate[i] = temperature_rate(batches->temperature[i]);
+    }
+
+    for (int d = 0; d < days; d++) {
+        apply_feeds(batches);
+        memcpy(batches->day_start, batches->points, count * sizeof(double));
+
+        for (int s = 0; s < MEAD_FERMENT_STEPS_PER_DAY; s++) {
+            double elapsed = batches->day + (s + 1.0) / MEAD_FERMENT_STEPS_PER_DAY;
+            double activity = (elapsed < MEAD_FERMENT_LAG_DAYS) ? elapsed / MEAD_FERMENT_LAG_DAYS : 1.0;
+            substep(kernel, batches, activity);
+        }
+
+        int past_lag = batches->day + 1 >= MEAD_FERMENT_LAG_DAYS;
+        for (size_t i = 0; i < count; i++) {
+            int done = batches->day_start[i] - batches->points[i] < MEAD_FERMENT_DONE_POINTS;
+            if (done && past_lag && batches->finished_day[i] < 0) {
+                batches->finished_day[i] = batches->day + 1;
+            }
+        }
+        if (curve) {
+            memcpy(curve + (size_t)d * count, batches->points, count * sizeof(double));
+        }
+        batches->day++;
+    }
+}
@@ -0,0 +1,70 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+#ifndef MEAD_FERMENT_H
+#define MEAD_FERMENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mead_core.h"
+
+// Time-stepped fermentation simulator. Each batch starts at its OG and loses gravity
+// points at a rate set by its temperature and by whichever runs out first: the sugar
+// above its terminal gravity, or the alcohol the yeast can still tolerate (both in
+// points). Step feedings add points on given days. Batches are held in
+// structure-of-arrays form and every substep updates all of them in one branch-free
+// SIMD loop (the mead_kernel.h variants), so a whole cellar advances together.
+//
+// Gravity is held in gravity points ((SG - 1.000) * 1000, see MEAD_SG_SCALE).
+
+#define MEAD_FERMENT_STEPS_PER_DAY 24   // Hourly Euler substeps
+#define MEAD_FERMENT_MAX_DAYS 365
+#define MEAD_FERMENT_MAX_FEEDS 4        // Step feedings per batch
+
+// Kinetics: at 20 C a fully active culture consumes this fraction of the remaining
+// fermentable points per day. The rate doubles every 10 C (Q10) between
+// MIN_TEMP and MAX_TEMP; outside that range the yeast is dormant.
+#define MEAD_FERMENT_RATE_20C 0.35
+#define MEAD_FERMENT_Q10 2.0
+#define MEAD_FERMENT_MIN_TEMP 8.0
+#define MEAD_FERMENT_MAX_TEMP 35.0
+#define MEAD_FERMENT_LAG_DAYS 1.5       // Growth phase: activity ramps up linearly over this period
+#define MEAD_FERMENT_DONE_POINTS 0.5    // A batch is finished once it drops less than this per day
+
+// Turbo yeast is modelled as tolerating more alcohol than any supported target, so it
+// ferments to its terminal gravity of 1.000 (the FG mead_final_gravity() assumes).
+#define MEAD_FERMENT_TURBO_TOLERANCE (MEAD_MAX_ABV + 1.0)
+
+// A cellar of batches, one array element per batch. Inputs are set with
+// mead_ferment_set_batch() (or directly); state is updated by mead_ferment_run().
+typedef struct {
+    size_t count;
+    double abv_factor;                              // ABV = points dropped / 1000 * abv_factor
+    // Inputs
+    double *og_points;                              // Starting gravity points
+    double *terminal_points;                        // Gravity at which the sugar is gone (FG of dry)
+    double *tolerance_abv;                          // Alcohol at which the yeast stops
+    double *temperature;                            // Degrees Celsius
+    int *feed_day[MEAD_FERMENT_MAX_FEEDS];          // Day of each feeding (-1 for none)
+    double *feed_points[MEAD_FERMENT_MAX_FEEDS];    // Points added by each feeding
+    // State
+    double *rate;                                   // Rate constant per day at the batch temperature
+    double *points;                                 // Current gravity points
+    double *fed_points;                             // OG plus all points fed so far
+    double *day_start;                              // Gravity after today's feedings (scratch)
+    int *finished_day;                              // First day below MEAD_FERMENT_DONE_POINTS, or -1
+    int day;                                        // Days simulated so far
+} MeadFermentBatches;
+
+int mead_ferment_alloc(MeadFermentBatches *batches, size_t count, double abv_factor);
+void mead_ferment_free(MeadFermentBatches *batches);
+void mead_ferment_set_batch(MeadFermentBatches *batches, size_t i, int32_t og_points, double target_abv,
+                            int is_turbo, double temperature);
+void mead_ferment_run(MeadFermentBatches *batches, int days, double *curve);
+double mead_ferment_abv(const MeadFermentBatches *batches, size_t i);
+
+#endif // MEAD_FERMENT_H
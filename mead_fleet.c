@@ -0,0 +1,491 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "mead_fleet.h"
+#include "mead_record.h"
+
+// A lot with less than this many point-gallons left counts as used up, so rounding
+// residue never becomes a separate assignment.
+#define FLEET_POINTS_EPSILON 1e-9
+
+// Volumes closer than this (in liters) count as equal when comparing plans.
+#define FLEET_VOLUME_EPSILON 1e-6
+
+// Knapsack size: at most FLEET_DP_MAX_CELLS capacity cells, fewer when there are so many
+// fermenters that the choice bits would pass FLEET_DP_BITS (8 MB).
+#define FLEET_DP_MAX_CELLS (1u << 20)
+#define FLEET_DP_BITS ((size_t)1 << 26)
+
+// --- Inventory ---
+
+/**
+ * @brief Parses an objective name: "volume" or "cost".
+ * @return int 0 on success, -1 if unknown.
+ */
+int mead_fleet_parse_objective(const char *s, MeadFleetObjective *out) {
+    if (strcasecmp(s, "volume") == 0) {
+        *out = MEAD_FLEET_MAX_VOLUME;
+    } else if (strcasecmp(s, "cost") == 0) {
+        *out = MEAD_FLEET_MIN_COST;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Finds a lot in an inventory by ID.
+ * @return long The lot's index, or -1 if it is not in the inventory.
+ */
+long mead_fleet_find_lot(const MeadFleetLot *lots, size_t count, const char *lot_id) {
+    for (size_t i = 0; i < count; i++) {
+        if (strncmp(lots[i].lot_id, lot_id, MEAD_LOT_ID_MAX) == 0) {
+            return (long)i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Parses one inventory line: lot_id,kg,cost_per_kg.
+ * @return int 0 on success, -1 if a field is missing or out of range.
+ */
+static int parse_inventory_line(char *line, MeadFleetLot *lot) {
+    char *fields[3];
+    int count = 0;
+
+    for (char *field = line; field && count < 3; count++) {
+        fields[count] = field;
+        field = strchr(field, ',');
+        if (field) *field++ = '\0';
+    }
+    if (count != 3 || strchr(fields[2], ',')) {
+        return -1;
+    }
+    for (int i = 0; i < 3; i++) {
+        fields[i] = mead_trim_field(fields[i]);
+    }
+
+    char *end[2];
+    if (*fields[0] == '\0' || strlen(fields[0]) >= MEAD_LOT_ID_MAX) {
+        return -1;
+    }
+    memset(lot->lot_id, 0, sizeof(lot->lot_id));
+    strcpy(lot->lot_id, fields[0]);
+    lot->stock_kg = strtod(fields[1], &end[0]);
+    lot->cost_per_kg = strtod(fields[2], &end[1]);
+
+    for (int i = 0; i < 2; i++) {
+        if (end[i] == fields[i + 1] || *end[i] != '\0') {
+            return -1;
+        }
+    }
+    return (lot->stock_kg >= 0.0 && lot->cost_per_kg >= 0.0) ? 0 : -1;
+}
+
+/**
+ * @brief Reads a honey inventory. Blank lines, '#' comments and a "lot_id,..." header
+ * row are skipped. With a database, every lot must be in it and takes its measured PPG
+ * and density; without one, every lot uses the default 35 PPG model.
+ * @param path Inventory CSV: lot_id,kg,cost_per_kg.
+ * @param db Honey database, or NULL.
+ * @param lots Output: malloc'd lot array (free() it).
+ * @param count Output: number of lots.
+ * @param error_line Output: the offending line on a parse error, unknown or duplicate lot, else 0.
+ * @return int 0 on success, -1 on error.
+ */
+int mead_fleet_load_inventory(const char *path, const MeadHoneyDb *db, MeadFleetLot **lots, size_t *count,
+                              long *error_line) {
+    FILE *in = (strcmp(path, "-") == 0) ? stdin : fopen(path, "r");
+    MeadFleetLot *entries = NULL;
+    size_t n = 0, cap = 0;
+    char line[256];
+    long line_no = 0;
+
+    *error_line = 0;
+    if (!in) {
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), in)) {
+        line_no++;
+        char *text = mead_trim_space(line);
+        if (*text == '\0' || *text == '#' || (line_no == 1 && strncasecmp(text, "lot_id", 6) == 0)) {
+            continue;
+        }
+
+        if (n == cap) {
+            cap = cap ? cap * 2 : 64;
+            MeadFleetLot *grown = realloc(entries, cap * sizeof(*entries));
+            if (!grown) {
+                goto fail;
+            }
+            entries = grown;
+        }
+        MeadFleetLot *lot = &entries[n];
+        const MeadHoneyLot *measured = NULL;
+        if (parse_inventory_line(text, lot) != 0 || mead_fleet_find_lot(entries, n, lot->lot_id) >= 0 ||
+            (db && !(measured = mead_honeydb_find(db, lot->lot_id)))) {
+            *error_line = line_no;
+            goto fail;
+        }
+        if (measured) {
+            mead_honey_lot_model(measured, &MEAD_DEFAULT_MODEL, &lot->model);
+        } else {
+            mead_model_init(&lot->model);
+        }
+        lot->remaining_kg = lot->stock_kg;
+        n++;
+    }
+    if (ferror(in)) {
+        goto fail;
+    }
+    if (in != stdin) {
+        fclose(in);
+    }
+    *lots = entries;
+    *count = n;
+    return 0;
+
+fail:
+    if (in != stdin) {
+        fclose(in);
+    }
+    free(entries);
+    return -1;
+}
+
+// --- Allocation ---
+
+// Sort keys for the fermenter and lot orders (qsort has no context argument).
+typedef struct {
+    double key;
+    size_t index;
+} FleetOrder;
+
+static int compare_order(const void *a, const void *b) {
+    const FleetOrder *x = a, *y = b;
+    if (x->key != y->key) {
+        return (x->key < y->key) ? -1 : 1;
+    }
+    return (x->index < y->index) ? -1 : (x->index > y->index);
+}
+
+// Closed-form honey requirement: gravity points per gallon times US gallons.
+static double point_gallons(const MeadFleetFermenter *f) {
+    double gallons = (f->unit == MEAD_UNIT_US_IMPERIAL) ? f->volume : f->volume * MEAD_DEFAULT_MODEL.l_to_gal;
+    return (double)f->og_points * gallons;
+}
+
+// Point-gallons supplied by one kg of a lot.
+static double points_per_kg(const MeadFleetLot *lot) {
+    return lot->model.ppg * lot->model.kg_to_lbs;
+}
+
+/**
+ * @brief Takes honey from one lot for one fermenter and records the assignment.
+ */
+static void take(MeadFleetFermenter *fermenters, size_t f, MeadFleetLot *lots, size_t l, double kg,
+                 MeadFleetAssignment *assignments, MeadFleetPlan *plan) {
+    MeadFleetFermenter *ferm = &fermenters[f];
+    const MeadModel *model = &lots[l].model;
+
+    MeadFleetAssignment *a = &assignments[plan->assignments++];
+    a->fermenter = f;
+    a->lot = l;
+    a->kg = kg;
+    ferm->assignment_count++;
+    lots[l].remaining_kg = (kg < lots[l].remaining_kg) ? lots[l].remaining_kg - kg : 0.0;
+    ferm->cost += kg * lots[l].cost_per_kg;
+
+    // Same displacement rules as the core calculation, per lot
+    if (ferm->unit == MEAD_UNIT_US_IMPERIAL) {
+        double lbs = kg * model->kg_to_lbs;
+        ferm->honey += lbs;
+        ferm->water -= lbs / 10.0 * model->displacement_gal_per_10_lbs;
+    } else {
+        ferm->honey += kg;
+        ferm->water -= kg * model->displacement_l_per_kg;
+    }
+}
+
+/**
+ * @brief Marks a fermenter filled and adds it to the plan totals.
+ */
+static void finish(MeadFleetFermenter *f, MeadFleetPlan *plan) {
+    f->filled = 1;
+    if (!(f->water > 0.0)) {
+        f->water = 0.0;
+    }
+    plan->filled++;
+    plan->volume_l += (f->unit == MEAD_UNIT_US_IMPERIAL) ? f->volume / MEAD_DEFAULT_MODEL.l_to_gal : f->volume;
+    plan->cost += f->cost;
+}
+
+/**
+ * @brief Adds fermenters in the given order while they fit, skipping ones already chosen.
+ * @param room Point-gallons left; reduced by what is added.
+ * @return double The volume added, in liters.
+ */
+static double fill_in_order(const double *need, const double *volume, size_t n, double *room,
+                            unsigned char *chosen) {
+    double added = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        if (chosen[i] || need[i] > *room * (1.0 + FLEET_POINTS_EPSILON)) {
+            continue;
+        }
+        chosen[i] = 1;
+        *room = (need[i] < *room) ? *room - need[i] : 0.0;
+        added += volume[i];
+    }
+    return added;
+}
+
+/**
+ * @brief Chooses which of n fermenters to fill from capacity point-gallons so the filled
+ * volume is as large as possible: a 0/1 knapsack over the point-gallons scaled to at most
+ * FLEET_DP_MAX_CELLS cells. Weights round up, so a chosen set always fits; the honey lost
+ * to rounding is handed out afterwards in the given order, and a plain in-order fill is
+ * kept instead if it happens to fill more. For MEAD_FLEET_MIN_COST, ties in volume go to
+ * the set that needs the fewest points, which is also the cheapest one.
+ * @param need Point-gallons per fermenter, in the order used for ties and leftovers.
+ * @param volume Volume per fermenter in liters.
+ * @param chosen Output: 1 for each fermenter to fill.
+ * @return int 0 on success, -1 if out of memory.
+ */
+static int select_fermenters(const double *need, const double *volume, size_t n, double capacity,
+                             MeadFleetObjective objective, unsigned char *chosen) {
+    memset(chosen, 0, n);
+    if (n == 0) {
+        return 0;
+    }
+
+    size_t cells = FLEET_DP_BITS / n;
+    if (cells > FLEET_DP_MAX_CELLS) cells = FLEET_DP_MAX_CELLS;
+    if (cells < 1) cells = 1;
+    size_t stride = cells / 8 + 1; // Bytes per fermenter row of cells + 1 "took" bits
+
+    unsigned char *greedy = calloc(n, 1);
+    size_t *weight = malloc(sizeof(size_t) * n);
+    double *best = calloc(cells + 1, sizeof(double));
+    unsigned char *took = calloc(n, stride);
+    if (!greedy || !weight || !best || !took) {
+        free(greedy);
+        free(weight);
+        free(best);
+        free(took);
+        return -1;
+    }
+
+    double room = capacity;
+    double greedy_volume = fill_in_order(need, volume, n, &room, greedy);
+    double greedy_points = capacity - room;
+
+    if (capacity > 0.0) {
+        double unit = capacity / (double)cells;
+        for (size_t i = 0; i < n; i++) {
+            double w = ceil(need[i] / unit * (1.0 - FLEET_POINTS_EPSILON));
+            if (!(w <= (double)cells)) {
+                weight[i] = SIZE_MAX;
+                continue;
+            }
+            weight[i] = (size_t)w;
+            unsigned char *row = took + i * stride;
+            for (size_t c = cells + 1; c-- > weight[i];) {
+                double v = best[c - weight[i]] + volume[i];
+                if (v > best[c] + FLEET_VOLUME_EPSILON) {
+                    best[c] = v;
+                    row[c / 8] |= (unsigned char)(1u << (c % 8));
+                }
+            }
+        }
+
+        // best[c] is the most volume within c cells, so the first c that reaches the
+        // maximum is the lightest set that fills it
+        size_t c = cells;
+        if (objective == MEAD_FLEET_MIN_COST) {
+            while (c > 0 && best[c - 1] >= best[cells] - FLEET_VOLUME_EPSILON) {
+                c--;
+            }
+        }
+        for (size_t i = n; i-- > 0;) {
+            if (took[i * stride + c / 8] & (1u << (c % 8))) {
+                chosen[i] = 1;
+                c -= weight[i];
+            }
+        }
+    }
+
+    room = capacity;
+    double chosen_volume = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        if (chosen[i]) {
+            room -= need[i];
+            chosen_volume += volume[i];
+        }
+    }
+    room = (room > 0.0) ? room : 0.0;
+    chosen_volume += fill_in_order(need, volume, n, &room, chosen);
+    double chosen_points = capacity - room;
+
+    if (greedy_volume > chosen_volume + FLEET_VOLUME_EPSILON ||
+        (greedy_volume >= chosen_volume - FLEET_VOLUME_EPSILON && greedy_points < chosen_points)) {
+        memcpy(chosen, greedy, n);
+    }
+
+    free(greedy);
+    free(weight);
+    free(best);
+    free(took);
+    return 0;
+}
+
+/**
+ * @brief Assigns the inventory to the fermenters. Each fermenter is one closed-form demand
+ * of gravity point-gallons, so choosing which to fill is a 0/1 knapsack: once per lot over
+ * the fermenters pinned to it, then once over the rest against the pooled remainder.
+ * @param fermenters Fermenters with unit, volume, og_points and pinned_lot set.
+ * @param lots Inventory from mead_fleet_load_inventory(); remaining_kg is updated.
+ * @param objective MEAD_FLEET_MAX_VOLUME or MEAD_FLEET_MIN_COST.
+ * @param assignments Output, room for MEAD_FLEET_MAX_ASSIGNMENTS(fermenter_count, lot_count).
+ * @param plan Output: totals.
+ * @return int 0 on success, -1 if out of memory.
+ */
+int mead_fleet_allocate(MeadFleetFermenter *fermenters, size_t fermenter_count, MeadFleetLot *lots,
+                        size_t lot_count, MeadFleetObjective objective, MeadFleetAssignment *assignments,
+                        MeadFleetPlan *plan) {
+    size_t n = fermenter_count ? fermenter_count : 1;
+    FleetOrder *ferm_order = malloc(sizeof(FleetOrder) * n);
+    FleetOrder *lot_order = malloc(sizeof(FleetOrder) * (lot_count ? lot_count : 1));
+    double *supply = malloc(sizeof(double) * (lot_count ? lot_count : 1));
+    size_t *group_start = calloc(lot_count + 2, sizeof(size_t));
+    size_t *grouped = malloc(sizeof(size_t) * n);
+    double *need = malloc(sizeof(double) * n);
+    double *volume = malloc(sizeof(double) * n);
+    unsigned char *chosen = malloc(n);
+    int status = -1;
+    if (!ferm_order || !lot_order || !supply || !group_start || !grouped || !need || !volume || !chosen) {
+        goto done;
+    }
+    memset(plan, 0, sizeof(*plan));
+
+    for (size_t i = 0; i < fermenter_count; i++) {
+        MeadFleetFermenter *f = &fermenters[i];
+        f->filled = 0;
+        f->honey = 0.0;
+        f->water = f->volume;
+        f->cost = 0.0;
+        f->assignment_count = 0;
+        // Gravity per gallon is also honey per liter: ties and leftovers go to the
+        // fermenters that get the most volume per point
+        ferm_order[i].key = (double)f->og_points;
+        ferm_order[i].index = i;
+    }
+    for (size_t i = 0; i < lot_count; i++) {
+        supply[i] = lots[i].remaining_kg * points_per_kg(&lots[i]);
+        lot_order[i].key = lots[i].cost_per_kg / points_per_kg(&lots[i]);
+        lot_order[i].index = i;
+    }
+    qsort(ferm_order, fermenter_count, sizeof(*ferm_order), compare_order);
+    qsort(lot_order, lot_count, sizeof(*lot_order), compare_order);
+
+    // Group the fermenters by pinned lot, keeping the sorted order: group l holds the
+    // fermenters pinned to lot l, group lot_count the unpinned ones
+    for (size_t i = 0; i < fermenter_count; i++) {
+        long pin = fermenters[i].pinned_lot;
+        group_start[(pin < 0 ? lot_count : (size_t)pin) + 1]++;
+    }
+    for (size_t g = 0; g <= lot_count; g++) {
+        group_start[g + 1] += group_start[g];
+    }
+    for (size_t k = 0; k < fermenter_count; k++) {
+        size_t i = ferm_order[k].index;
+        long pin = fermenters[i].pinned_lot;
+        size_t g = pin < 0 ? lot_count : (size_t)pin;
+        grouped[group_start[g]++] = i;
+    }
+    for (size_t g = lot_count + 1; g > 0; g--) {
+        group_start[g] = group_start[g - 1];
+    }
+    group_start[0] = 0;
+
+    for (size_t k = 0; k < fermenter_count; k++) {
+        const MeadFleetFermenter *f = &fermenters[grouped[k]];
+        need[k] = point_gallons(f);
+        volume[k] = (f->unit == MEAD_UNIT_US_IMPERIAL) ? f->volume / MEAD_DEFAULT_MODEL.l_to_gal : f->volume;
+    }
+
+    // Pinned fermenters draw only on their own lot and go first
+    for (size_t l = 0; l < lot_count; l++) {
+        size_t first = group_start[l], count = group_start[l + 1] - first;
+        if (select_fermenters(need + first, volume + first, count, supply[l], objective, chosen) != 0) {
+            goto done;
+        }
+        for (size_t k = 0; k < count; k++) {
+            if (!chosen[k]) {
+                continue;
+            }
+            size_t i = grouped[first + k];
+            double demand = need[first + k];
+            fermenters[i].first_assignment = plan->assignments;
+            take(fermenters, i, lots, l, demand / points_per_kg(&lots[l]), assignments, plan);
+            supply[l] = (demand < supply[l]) ? supply[l] - demand : 0.0;
+            finish(&fermenters[i], plan);
+        }
+    }
+
+    // The rest share one pool, used cheapest point first. Lots are consumed in lot_order,
+    // so a cursor marks the cheapest lot that still has honey.
+    double pool = 0.0;
+    for (size_t l = 0; l < lot_count; l++) {
+        pool += supply[l];
+    }
+    size_t first = group_start[lot_count], count = fermenter_count - first;
+    if (select_fermenters(need + first, volume + first, count, pool, objective, chosen) != 0) {
+        goto done;
+    }
+    size_t cursor = 0;
+    for (size_t k = 0; k < count; k++) {
+        if (!chosen[k]) {
+            continue;
+        }
+        size_t i = grouped[first + k];
+        double left = need[first + k];
+        fermenters[i].first_assignment = plan->assignments;
+        while (left > FLEET_POINTS_EPSILON && cursor < lot_count) {
+            size_t l = lot_order[cursor].index;
+            double points = (left < supply[l]) ? left : supply[l];
+            if (points > 0.0) {
+                take(fermenters, i, lots, l, points / points_per_kg(&lots[l]), assignments, plan);
+            }
+            left -= points;
+            supply[l] -= points;
+            if (supply[l] <= FLEET_POINTS_EPSILON) {
+                cursor++;
+            }
+        }
+        finish(&fermenters[i], plan);
+    }
+    status = 0;
+
+done:
+    free(ferm_order);
+    free(lot_order);
+    free(supply);
+    free(group_start);
+    free(grouped);
+    free(need);
+    free(volume);
+    free(chosen);
+    return status;
+}
@@ -0,0 +1,85 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+#ifndef MEAD_FLEET_H
+#define MEAD_FLEET_H
+
+#include <stddef.h>
+
+#include "mead_core.h"
+#include "mead_honeydb.h"
+
+// Fleet planning: assigns a limited honey inventory to many fermenters. The closed-form
+// honey requirement of a recipe is its gravity points times its volume in US gallons
+// ("point-gallons", MeadResult.gravity_points), and one kg of a lot supplies
+// ppg * kg_to_lbs of them. Points from different lots add up, so the search never
+// re-runs a recipe calculation: each fermenter is one demand figure, each lot one
+// supply figure and one price per point.
+//
+// Fermenters are filled whole or not at all. Which ones is a 0/1 knapsack over
+// point-gallons that fills the most volume, and each filled fermenter draws from the
+// cheapest lots first. A fermenter may be pinned to one lot, in which case only that
+// lot is used; pinned fermenters are chosen per lot before the rest so the shared pool
+// cannot starve them.
+
+typedef enum {
+    MEAD_FLEET_MAX_VOLUME = 0, // Most filled volume
+    MEAD_FLEET_MIN_COST        // Most filled volume at the lowest honey cost: of the plans
+                               // that fill the most, the one drawing the fewest points
+} MeadFleetObjective;
+
+// One honey lot in stock. remaining_kg is set by mead_fleet_allocate().
+typedef struct {
+    char lot_id[MEAD_LOT_ID_MAX];
+    MeadModel model;       // PPG and displacement of this lot (mead_honey_lot_model())
+    double stock_kg;
+    double cost_per_kg;
+    double remaining_kg;
+} MeadFleetLot;
+
+// One fermenter. Inputs come from a batch record; the rest is filled by mead_fleet_allocate().
+typedef struct {
+    MeadUnit unit;
+    double volume;          // Gallons or Liters, depending on unit
+    int32_t og_points;      // Target OG as gravity points (mead_og_points())
+    long pinned_lot;        // Index into the lot array, or -1 for any lot
+    // Results
+    int filled;
+    double honey;           // lbs or kg, depending on unit
+    double water;           // gallons or liters, depending on unit
+    double cost;
+    size_t first_assignment; // This fermenter's assignments, if filled
+    size_t assignment_count;
+} MeadFleetFermenter;
+
+// Honey taken from one lot for one fermenter.
+typedef struct {
+    size_t fermenter;
+    size_t lot;
+    double kg;
+} MeadFleetAssignment;
+
+// Totals over the whole plan.
+typedef struct {
+    size_t filled;
+    double volume_l;  // Filled volume in liters
+    double cost;
+    size_t assignments;
+} MeadFleetPlan;
+
+// Upper bound on the assignments mead_fleet_allocate() writes: one per fermenter, plus
+// one each time a lot runs out part way through a fermenter.
+#define MEAD_FLEET_MAX_ASSIGNMENTS(fermenters, lots) ((fermenters) + (lots))
+
+int mead_fleet_parse_objective(const char *s, MeadFleetObjective *out);
+int mead_fleet_load_inventory(const char *path, const MeadHoneyDb *db, MeadFleetLot **lots, size_t *count,
+                              long *error_line);
+long mead_fleet_find_lot(const MeadFleetLot *lots, size_t count, const char *lot_id);
+int mead_fleet_allocate(MeadFleetFermenter *fermenters, size_t fermenter_count, MeadFleetLot *lots,
+                        size_t lot_count, MeadFleetObjective objective, MeadFleetAssignment *assignments,
+                        MeadFleetPlan *plan);
+
+#endif // MEAD_FLEET_H
@@ -0,0 +1,156 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// Checks for the fleet allocator: a fixed inventory where filling the lowest gravity
+// first gives up volume, and small random fleets against an exhaustive search.
+// Prints one line per failed check and exits non-zero if any failed.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mead_core.h"
+#include "mead_fleet.h"
+
+#define RANDOM_FLEETS 500
+#define RANDOM_MAX_FERMENTERS 10
+
+static int failures;
+
+static void check(int ok, const char *what, double got, double want) {
+    if (!ok) {
+        printf("FAIL %s: got %.4f, want %.4f\n", what, got, want);
+        failures++;
+    }
+}
+
+static void add_lot(MeadFleetLot *lot, const char *id, double kg, double cost_per_kg) {
+    memset(lot, 0, sizeof(*lot));
+    snprintf(lot->lot_id, sizeof(lot->lot_id), "%s", id);
+    mead_model_init(&lot->model);
+    lot->stock_kg = kg;
+    lot->remaining_kg = kg;
+    lot->cost_per_kg = cost_per_kg;
+}
+
+static void add_fermenter(MeadFleetFermenter *f, MeadUnit unit, double volume, double abv,
+                          MeadSweetness sweetness, long pinned_lot) {
+    memset(f, 0, sizeof(*f));
+    f->unit = unit;
+    f->volume = volume;
+    f->og_points = mead_og_points(MEAD_DEFAULT_FG_TABLE, abv, sweetness, 1);
+    f->pinned_lot = pinned_lot;
+}
+
+static double liters(const MeadFleetFermenter *f) {
+    return (f->unit == MEAD_UNIT_US_IMPERIAL) ? f->volume / MEAD_DEFAULT_MODEL.l_to_gal : f->volume;
+}
+
+static double point_gallons(const MeadFleetFermenter *f) {
+    double gallons = (f->unit == MEAD_UNIT_US_IMPERIAL) ? f->volume : f->volume * MEAD_DEFAULT_MODEL.l_to_gal;
+    return (double)f->og_points * gallons;
+}
+
+static int plan(MeadFleetFermenter *fermenters, size_t n, MeadFleetLot *lots, size_t lot_count,
+                MeadFleetObjective objective, MeadFleetPlan *out) {
+    MeadFleetAssignment assignments[MEAD_FLEET_MAX_ASSIGNMENTS(RANDOM_MAX_FERMENTERS, 2)];
+    for (size_t l = 0; l < lot_count; l++) {
+        lots[l].remaining_kg = lots[l].stock_kg;
+    }
+    return mead_fleet_allocate(fermenters, n, lots, lot_count, objective, assignments, out);
+}
+
+/**
+ * @brief A = 10 kg, B = 30 kg; the fourth fermenter is pinned to B. Filling the lowest
+ * gravity first takes the 5 gallon batch and leaves no room for the 50 liter one
+ * (58.93 L); the best plan skips the 5 gallons instead (90 L).
+ */
+static void test_review_inventory(void) {
+    MeadFleetLot lots[2];
+    MeadFleetFermenter fermenters[4];
+    MeadFleetPlan volume_plan, cost_plan;
+
+    add_lot(&lots[0], "A", 10.0, 5.0);
+    add_lot(&lots[1], "B", 30.0, 4.0);
+    add_fermenter(&fermenters[0], MEAD_UNIT_METRIC, 20.0, 14.0, MEAD_SWEETNESS_DRY, -1);
+    add_fermenter(&fermenters[1], MEAD_UNIT_METRIC, 50.0, 14.0, MEAD_SWEETNESS_SWEET, -1);
+    add_fermenter(&fermenters[2], MEAD_UNIT_US_IMPERIAL, 5.0, 12.0, MEAD_SWEETNESS_DRY, -1);
+    add_fermenter(&fermenters[3], MEAD_UNIT_METRIC, 20.0, 14.0, MEAD_SWEETNESS_DRY, 1);
+
+    if (plan(fermenters, 4, lots, 2, MEAD_FLEET_MAX_VOLUME, &volume_plan) != 0 ||
+        plan(fermenters, 4, lots, 2, MEAD_FLEET_MIN_COST, &cost_plan) != 0) {
+        check(0, "review inventory: allocate", -1.0, 0.0);
+        return;
+    }
+    check(fabs(volume_plan.volume_l - 90.0) < 1e-6, "review inventory: volume objective", volume_plan.volume_l, 90.0);
+    check(fabs(cost_plan.volume_l - 90.0) < 1e-6, "review inventory: cost objective", cost_plan.volume_l, 90.0);
+    check(!fermenters[2].filled, "review inventory: 5 gallons left unfilled", fermenters[2].filled, 0.0);
+    check(cost_plan.cost <= volume_plan.cost + 1e-9, "review inventory: cost objective is cheapest",
+          cost_plan.cost, volume_plan.cost);
+}
+
+/**
+ * @brief Random unpinned fleets: both objectives must fill the exhaustive-search maximum,
+ * and the cost objective must not cost more than the volume objective.
+ */
+static void test_random_fleets(void) {
+    static const MeadSweetness levels[] = { MEAD_SWEETNESS_DRY, MEAD_SWEETNESS_SEMI_SWEET,
+                                            MEAD_SWEETNESS_SWEET, MEAD_SWEETNESS_DESSERT };
+    MeadFleetLot lots[2];
+    MeadFleetFermenter fermenters[RANDOM_MAX_FERMENTERS];
+
+    srand(42);
+    for (int run = 0; run < RANDOM_FLEETS; run++) {
+        size_t n = 1 + (size_t)(rand() % RANDOM_MAX_FERMENTERS);
+        add_lot(&lots[0], "A", 1.0 + rand() % 40, 3.0 + rand() % 5);
+        add_lot(&lots[1], "B", 1.0 + rand() % 40, 3.0 + rand() % 5);
+        for (size_t i = 0; i < n; i++) {
+            MeadUnit unit = (rand() % 2) ? MEAD_UNIT_METRIC : MEAD_UNIT_US_IMPERIAL;
+            add_fermenter(&fermenters[i], unit, 1.0 + rand() % 60, 8.0 + rand() % 11, levels[rand() % 4], -1);
+        }
+
+        double pool = 0.0;
+        for (size_t l = 0; l < 2; l++) {
+            pool += lots[l].stock_kg * lots[l].model.ppg * lots[l].model.kg_to_lbs;
+        }
+        double best = 0.0;
+        for (unsigned mask = 0; mask < (1u << n); mask++) {
+            double need = 0.0, volume = 0.0;
+            for (size_t i = 0; i < n; i++) {
+                if (mask & (1u << i)) {
+                    need += point_gallons(&fermenters[i]);
+                    volume += liters(&fermenters[i]);
+                }
+            }
+            if (need <= pool * (1.0 + 1e-9) && volume > best) {
+                best = volume;
+            }
+        }
+
+        MeadFleetPlan volume_plan, cost_plan;
+        if (plan(fermenters, n, lots, 2, MEAD_FLEET_MAX_VOLUME, &volume_plan) != 0 ||
+            plan(fermenters, n, lots, 2, MEAD_FLEET_MIN_COST, &cost_plan) != 0) {
+            check(0, "random fleet: allocate", -1.0, 0.0);
+            return;
+        }
+        check(volume_plan.volume_l >= best - 1e-6, "random fleet: volume objective", volume_plan.volume_l, best);
+        check(cost_plan.volume_l >= best - 1e-6, "random fleet: cost objective", cost_plan.volume_l, best);
+        check(cost_plan.cost <= volume_plan.cost + 1e-6, "random fleet: cost objective is cheapest",
+              cost_plan.cost, volume_plan.cost);
+    }
+}
+
+int main(void) {
+    test_review_inventory();
+    test_random_fleets();
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("fleet: all checks passed\n");
+    return 0;
+}
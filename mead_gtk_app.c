@@ -1,34 +1,177 @@
 #include <gtk/gtk.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
-
-// --- Global Constants and Calculation Logic (Adapted from mead_calculator.c) ---
-
-#define GRAVITY_POINTS_PER_UNIT 35.0
-#define KG_TO_LBS 2.20462
-#define L_TO_GAL 0.264172
-
-// Global Widget Pointers to access UI elements in the callback function
-GtkWidget *volume_entry;
-GtkWidget *abv_entry;
-GtkWidget *unit_combobox;
-GtkWidget *sweetness_combobox;
-GtkWidget *turbo_switch;
-
-GtkWidget *og_label;
-GtkWidget *fg_label;
-GtkWidget *honey_label;
-GtkWidget *water_label;
-GtkWidget *message_label; // For error messages
-
-// Pikkuna tarvitaan dialogien ankkurointiin
-GtkWidget *main_window;
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Calculation constants and logic are shared with meadGenerator.c
+#include "mead_core.h"
+#include "mead_ferment.h"
+#include "mead_sweep.h"
+#include "mead_output.h"
+#include "mead_stats.h"
+#include "mead_telemetry.h"
+#include "mead_history.h"
+
+// Days shown by the fermentation simulation
+#define GTK_FERMENT_DAYS 90
+
+// Live recalculation waits this long after the last input change, so typing or
+// scrubbing a value recalculates once instead of on every keystroke.
+#define GTK_RECALC_DELAY_MS 150
+
+// Longest markup of a result label
+#define GTK_LABEL_MARKUP_MAX 160
+
+// Scenario comparison: the sweep shown in the table (volume START:STOP:STEP in the
+// selected unit, every supported ABV), about 67 000 rows.
+#define GTK_COMPARE_VOLUME_START 5.0
+#define GTK_COMPARE_VOLUME_STOP 2000.0
+#define GTK_COMPARE_VOLUME_STEP 5.0
+#define GTK_COMPARE_COLUMN_WIDTH 90
+
+// Honey/OG chart: plot margins (room for axis labels), OG axis top and grid rows
+#define GTK_CHART_MARGIN_LEFT 48
+#define GTK_CHART_MARGIN_RIGHT 48
+#define GTK_CHART_MARGIN_TOP 10
+#define GTK_CHART_MARGIN_BOTTOM 22
+#define GTK_CHART_OG_MAX 1.250
+#define GTK_CHART_Y_DIVISIONS 5
+
+// Background export: rows between cancellation checks and progress updates
+#define GTK_EXPORT_PROGRESS_ROWS 4096
+
+// Live fermenter telemetry (--telemetry-port): label refresh interval and rows shown
+#define GTK_TELEMETRY_REFRESH_S 1
+#define GTK_TELEMETRY_ROWS 8
+
+// Recipe history (--history FILE): latest recipes shown, newest first
+#define GTK_HISTORY_ROWS 5
+
+typedef enum {
+    COMPARE_COL_VOLUME = 0,
+    COMPARE_COL_ABV,
+    COMPARE_COL_SWEETNESS,
+    COMPARE_COL_YEAST,
+    COMPARE_COL_OG,       // Sortable
+    COMPARE_COL_HONEY,    // Sortable
+    COMPARE_COL_WATER,    // Sortable
+    COMPARE_COLUMNS
+} CompareColumn;
+
+// Sweep results in the sweep engine's columnar layout, plus the order they are shown
+// in. Sorting permutes order only; the tree view's model holds nothing but view
+// positions, and cells are formatted from these arrays when a row is drawn.
+typedef struct {
+    MeadUnit unit;
+    size_t count;                 // 0 until the first sweep
+    double *volume;
+    int *abv;
+    unsigned char *sweetness;     // MeadSweetness
+    unsigned char *yeast_mode;    // 1 for Standard, 2 for Turbo
+    double *og;
+    double *honey;
+    double *water;
+    double *gravity_points;
+    guint *order;                 // Row shown at each view position
+    int sort_column;              // CompareColumn the rows are sorted by, or -1 for sweep order
+    gboolean descending;
+} ScenarioTable;
+
+// Honey and OG against ABV for the current inputs. The axes, grid and labels are
+// rendered once into an offscreen surface; a redraw paints that surface and strokes
+// the two curves on top of it.
+typedef struct {
+    GtkWidget *area;
+    cairo_surface_t *background;  // Cached axes and grid, or NULL to redraw them
+    int width, height;            // Widget size the background was drawn for
+    double honey_max;             // Top of the honey axis (a 1/2/5 x 10^n value)
+    MeadUnit unit;                // Unit of the honey axis
+    gboolean valid;               // The curves match valid inputs
+    double og[MEAD_ABV_COUNT];    // Indexed by abv - MEAD_MIN_ABV
+    double honey[MEAD_ABV_COUNT];
+} HoneyChart;
+
+typedef enum {
+    BACKGROUND_JOB_SWEEP = 0, // Comparison sweep into table
+    BACKGROUND_JOB_EXPORT     // Writes table to path
+} BackgroundJobKind;
+
+typedef struct BackgroundJob BackgroundJob;
+
+// A result label plus the markup last given to it. Updates with unchanged markup are
+// skipped, since every gtk_label_set_markup() reparses the markup and relayouts.
+typedef struct {
+    GtkWidget *widget;
+    char markup[GTK_LABEL_MARKUP_MAX];
+} ResultLabel;
+
+// Widgets and model of one calculator window. Created in main() and handed to every
+// callback as user_data, so the file has no mutable globals.
+typedef struct {
+    // Pikkuna tarvitaan dialogien ankkurointiin
+    GtkWidget *main_window;
+
+    GtkWidget *volume_entry;
+    GtkWidget *abv_entry;
+    GtkWidget *unit_combobox;
+    GtkWidget *sweetness_combobox;
+    GtkWidget *turbo_switch;
+    GtkWidget *temperature_entry;
+
+    ResultLabel og_label;
+    ResultLabel fg_label;
+    ResultLabel honey_label;
+    ResultLabel water_label;
+    ResultLabel message_label; // For error messages
+    GtkWidget *ferment_label; // Fermentation simulation summary
+    GtkWidget *water_dialog;  // Info dialogs, created on first use; NULL until then
+    GtkWidget *honey_dialog;
+    GtkWidget *compare_window; // Scenario comparison, created on first use; NULL until then
+    GtkWidget *compare_view;
+    ScenarioTable scenarios;
+    GtkWidget *volume_scale;   // Drives volume_entry
+    HoneyChart chart;
+    GtkWidget *progress_bar;   // Progress and outcome of background jobs
+    GtkWidget *cancel_button;
+
+    BackgroundJob *job;        // Running background job, or NULL
+    GCancellable *job_cancel;  // Cancels job
+    MeadTelemetry *telemetry;  // Sensor telemetry started from the command line, or NULL
+    GtkWidget *telemetry_label;
+    guint telemetry_source;    // Periodic telemetry_label refresh, or 0
+    const char *history_path;  // History file from the command line, or NULL
+    MeadHistoryWriter history; // Recipes history; open if history_path is set
+    GtkWidget *history_label;
+    MeadHistoryRecipe recipe;  // Latest calculated recipe (time_ms is set when it is recorded)
+    gboolean recipe_valid;     // FALSE if the latest calculation failed
+    guint recalc_source;      // Pending debounced recalculation, or 0
+    MeadModel model;          // Honey model used for every calculation in this window
+} MeadApp;
+
+// One heavy job run on a worker thread through GTask (see start_background_job()).
+// The job owns everything the worker reads or writes; the window's own state is only
+// touched on the main thread, in on_job_done().
+struct BackgroundJob {
+    MeadApp *app;
+    BackgroundJobKind kind;
+    GTask *task;                 // The task running this job
+    ScenarioTable table;         // Sweep: filled by the worker; export: a copy of the shown table
+    MeadOutputFormat format;     // Export only
+    char *path;                  // Export only
+    size_t chunks_done;          // Sweep progress (worker only)
+    gint progress;               // Per mille done; atomic
+    gint progress_pending;       // Non-zero while a progress idle callback is queued; atomic
+};
 
 // --- Info Dialog Content Definitions ---
 
-const char *WATER_INFO =
+static const char *const WATER_INFO =
     "<b>Veden laatu simanvalmistuksessa</b>\n\n"
     "Veden laatu on ratkaiseva kymisen onnistumiselle ja lopulliselle maulle. Se vaikuttaa hiivan toimintaan, suutuntumaan ja mausteiden tai hedelmien aromin irtoamiseen.\n\n"
     "<b>Trkeimmt huomiot:</b>\n"
@@ -36,7 +179,7 @@ const char *WATER_INFO =
     " <b>Mineraalipitoisuus (Kovuus):</b> Kalsiumin ja magnesiumin kaltaiset mineraalit ovat hiivaravinteita. Tysin tislattu vesi voi vaatia mineraalilisyksi.\n"
     " <b>pH:</b> Hiiva suosii hieman hapanta ymprist (pH 3.04.0). Korkea alkaliniteetti vesijohtovedess voi stressata hiivaa.\n";
 
-const char *HONEY_INFO =
+static const char *const HONEY_INFO =
     "<b>Trkeimmt hunajalajikkeet siman valmistukseen</b>\n\n"
     "Hunajan kukkaislhde mritt siman vrin, aromin ja lopullisen maun.\n\n"
     "<b>Yleisimmt lajikkeet:</b>\n"
@@ -46,232 +189,1100 @@ const char *HONEY_INFO =
     " <b>Tattari (Buckwheat):</b> Erittin tumma, rikas ja voimakas, usein melassimainen. Vaatii pitk kypsytyst.\n";
 
 /**
- * @brief Opens a new GTK dialog window to display information.
+ * @brief Shows an information dialog without blocking the main loop. The dialog is
+ * built (and its markup parsed) on the first call only; closing it just hides it,
+ * and later calls present the same dialog again.
  * @param parent_window The main window to anchor the dialog to.
+ * @param dialog Where the dialog is kept; NULL until the first call, and reset to
+ * NULL when the dialog is destroyed together with its parent.
  * @param title The title of the dialog.
  * @param message The content of the dialog (can use Pango markup).
  */
-void show_info_dialog(GtkWidget *parent_window, const char *title, const char *message) {
-    GtkWidget *dialog, *content_area, *label;
-
-    // Create a new dialog with OK button
-    dialog = gtk_dialog_new_with_buttons(
-        title,
-        GTK_WINDOW(parent_window),
-        GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
-        "OK", GTK_RESPONSE_ACCEPT,
-        NULL
-    );
-    gtk_window_set_default_size(GTK_WINDOW(dialog), 400, 300);
-
-    // Get the content area and add the label
-    content_area = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
-    label = gtk_label_new(NULL);
-    gtk_label_set_markup(GTK_LABEL(label), message);
-    gtk_label_set_line_wrap(GTK_LABEL(label), TRUE); // Enable text wrapping
-    gtk_label_set_xalign(GTK_LABEL(label), 0.0); // Align text to left
-    gtk_container_set_border_width(GTK_CONTAINER(content_area), 10);
-
-    gtk_container_add(GTK_CONTAINER(content_area), label);
-
-    // Show the dialog and wait for response
-    gtk_widget_show_all(dialog);
-    gtk_dialog_run(GTK_DIALOG(dialog));
+void show_info_dialog(GtkWidget *parent_window, GtkWidget **dialog, const char *title, const char *message) {
+    GtkWidget *content_area, *label;
+
+    if (!*dialog) {
+        // Non-modal dialog with OK button
+        *dialog = gtk_dialog_new_with_buttons(
+            title,
+            GTK_WINDOW(parent_window),
+            GTK_DIALOG_DESTROY_WITH_PARENT,
+            "OK", GTK_RESPONSE_ACCEPT,
+            NULL
+        );
+        gtk_window_set_default_size(GTK_WINDOW(*dialog), 400, 300);
+
+        // Get the content area and add the label
+        content_area = gtk_dialog_get_content_area(GTK_DIALOG(*dialog));
+        label = gtk_label_new(NULL);
+        gtk_label_set_markup(GTK_LABEL(label), message);
+        gtk_label_set_line_wrap(GTK_LABEL(label), TRUE); // Enable text wrapping
+        gtk_label_set_xalign(GTK_LABEL(label), 0.0); // Align text to left
+        gtk_container_set_border_width(GTK_CONTAINER(content_area), 10);
+
+        gtk_container_add(GTK_CONTAINER(content_area), label);
+        gtk_widget_show_all(content_area);
+
+        // OK and the window close button hide the dialog instead of destroying it
+        g_signal_connect(*dialog, "response", G_CALLBACK(gtk_widget_hide), NULL);
+        g_signal_connect(*dialog, "delete-event", G_CALLBACK(gtk_widget_hide_on_delete), NULL);
+        g_signal_connect(*dialog, "destroy", G_CALLBACK(gtk_widget_destroyed), dialog);
+    }
 
-    // Destroy the dialog when closed
-    gtk_widget_destroy(dialog);
+    gtk_window_present(GTK_WINDOW(*dialog));
 }
 
 /**
  * @brief Callback for the Water Info button.
  */
 static void on_water_info_clicked(GtkWidget *widget, gpointer data) {
-    show_info_dialog(main_window, "Veden laatu", WATER_INFO);
+    MeadApp *app = data;
+    show_info_dialog(app->main_window, &app->water_dialog, "Veden laatu", WATER_INFO);
 }
 
 /**
  * @brief Callback for the Honey Info button.
  */
 static void on_honey_info_clicked(GtkWidget *widget, gpointer data) {
-    show_info_dialog(main_window, "Hunajalajikkeet", HONEY_INFO);
+    MeadApp *app = data;
+    show_info_dialog(app->main_window, &app->honey_dialog, "Hunajalajikkeet", HONEY_INFO);
 }
 
 
 /**
- * @brief Calculates the required Original Gravity (OG) based on target ABV and sweetness.
- * @param abv Target Alcohol by Volume percentage.
- * @param sweetness String representing the desired sweetness level.
- * @param is_turbo Flag: 1 for Standard, 2 for Turbo Yeast.
- * @return double The required Original Gravity (e.g., 1.100), or 0.0 on error.
+ * @brief Creates a result label showing markup and remembers it.
  */
-double get_target_og(int abv, const char* sweetness, int is_turbo) {
-    double fg;
+static GtkWidget *result_label_init(ResultLabel *label, const char *markup) {
+    label->widget = gtk_label_new(NULL);
+    gtk_label_set_markup(GTK_LABEL(label->widget), markup);
+    g_strlcpy(label->markup, markup, sizeof(label->markup));
+    return label->widget;
+}
 
-    // Standard FG estimates for different sweetness levels (used only if not turbo)
-    if (is_turbo == 1) {
-        if (strcasecmp(sweetness, "Dry") == 0) {
-            fg = 1.000;
-        } else if (strcasecmp(sweetness, "Semi-Sweet") == 0) {
-            fg = 1.010;
-        } else if (strcasecmp(sweetness, "Sweet") == 0) {
-            fg = 1.020;
-        } else if (strcasecmp(sweetness, "Dessert") == 0) {
-            fg = 1.030;
-        } else {
-            return 0.0; // Invalid sweetness
-        }
-    } else {
-        // TURBO YEAST MODE: Assumes fermentation goes to bone dry
-        fg = 1.000;
+/**
+ * @brief Sets the markup of a result label unless it already shows exactly that.
+ */
+static void result_label_set(ResultLabel *label, const char *markup) {
+    if (strcmp(label->markup, markup) != 0) {
+        g_strlcpy(label->markup, markup, sizeof(label->markup));
+        gtk_label_set_markup(GTK_LABEL(label->widget), markup);
     }
+}
 
-    // Mead/Wine ABV formula approximation: ABV = (OG - FG) * 131.25
-    // Rearranging for OG: OG = FG + (ABV / 131.25)
-    double og = fg + ((double)abv / 131.25);
-
-    // OG is represented as 1.XXX, so we round the result
-    return round(og * 1000.0) / 1000.0;
+/**
+ * @brief Formats markup with printf-style arguments and sets it on a result label
+ * (see result_label_set()).
+ */
+static void result_label_printf(ResultLabel *label, const char *format, ...) G_GNUC_PRINTF(2, 3);
+static void result_label_printf(ResultLabel *label, const char *format, ...) {
+    char buffer[GTK_LABEL_MARKUP_MAX];
+    va_list args;
+
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    result_label_set(label, buffer);
 }
 
 /**
  * @brief Performs the core ingredient calculations based on the user inputs
- * and updates the global GTK labels.
+ * and updates the result labels of the window. Labels whose text does not change
+ * are left untouched.
+ * @param app The calculator window.
  * @param volume_val Batch volume value.
  * @param abv_val Target ABV value.
  * @param unit_str Unit string ("Gallons" or "Liters").
- * @param sweetness_str Sweetness string ("Dry", "Sweet", etc.).
+ * @param sweetness Sweetness level (the combobox index maps directly to MeadSweetness).
  * @param is_turbo_mode 1 for standard, 2 for turbo.
  */
-void calculate_ingredients(double volume_val, int abv_val, const char* unit_str, const char* sweetness_str, int is_turbo_mode) {
-    double target_og = get_target_og(abv_val, sweetness_str, is_turbo_mode);
+void calculate_ingredients(MeadApp *app, double volume_val, int abv_val, const char* unit_str, MeadSweetness sweetness, int is_turbo_mode) {
+    MeadUnit unit = (strcasecmp(unit_str, "Gallons") == 0) ? MEAD_UNIT_US_IMPERIAL : MEAD_UNIT_METRIC;
+    MeadResult result;
 
-    if (target_og == 0.0) {
-        gtk_label_set_text(GTK_LABEL(message_label), "Virhe: Virheellinen makeustaso. Kyt Dry, Semi-Sweet, Sweet tai Dessert.");
+    app->recipe_valid = FALSE;
+    if (mead_model_calculate(&app->model, unit, volume_val, abv_val, sweetness, is_turbo_mode, &result) != MEAD_OK) {
+        result_label_set(&app->message_label, "Virhe: Virheellinen makeustaso. Kyt Dry, Semi-Sweet, Sweet tai Dessert.");
         return;
     }
+    MeadHistoryRecipe recipe = { 0, unit, volume_val, abv_val, sweetness, is_turbo_mode,
+                                 result.og, result.honey, result.water };
+    app->recipe = recipe;
+    app->recipe_valid = !result.og_too_high;
 
-    // Sanity Check
-    if (target_og > 1.225) {
-        gtk_label_set_markup(GTK_LABEL(message_label), "<span foreground='orange'>VAROITUS: Laskettu OG (1.225+) on erittin korkea. Kokeile pienemp ABV:t.</span>");
-        // Do not return, let the calculation continue but warn the user.
+    const char* honeyUnit = (unit == MEAD_UNIT_US_IMPERIAL) ? "lbs" : "kg";
+    const char* waterUnit = (unit == MEAD_UNIT_US_IMPERIAL) ? "gallons" : "liters";
+
+    // --- Update GTK Labels ---
+    result_label_printf(&app->og_label, "OG (Ominaispaino): <b>%.3f</b>", result.og);
+    result_label_printf(&app->fg_label, "FG (Loppupaino): <b>%.3f</b>", result.fg);
+    result_label_printf(&app->honey_label, "Tarvittava hunaja: <b>%.2f %s</b>", result.honey, honeyUnit);
+    result_label_printf(&app->water_label, "Vesi tyttn: <b>%.2f %s</b>", result.water, waterUnit);
+
+    // Final Message Label; the OG sanity warning does not stop the calculation
+    if (is_turbo_mode == 2) {
+        result_label_set(&app->message_label, "<span foreground='red'>Laskelma valmis. (Turbo-hiiva: FG pakotettu 1.000)</span>");
+    } else if (result.og_too_high) {
+        result_label_set(&app->message_label, "<span foreground='orange'>VAROITUS: Laskettu OG (1.225+) on erittin korkea. Kokeile pienemp ABV:t.</span>");
     } else {
-        gtk_label_set_text(GTK_LABEL(message_label), ""); // Clear previous error
+        result_label_set(&app->message_label, "Laskelma valmis.");
     }
+}
 
-    // --- Core Calculation ---
-    double fg = is_turbo_mode == 1 ? (strcasecmp(sweetness_str, "Dry") == 0 ? 1.000 : strcasecmp(sweetness_str, "Semi-Sweet") == 0 ? 1.010 : strcasecmp(sweetness_str, "Sweet") == 0 ? 1.020 : 1.030) : 1.000;
+/**
+ * @brief Reads the inputs of the window and recalculates the results.
+ */
+static void recalculate(MeadApp *app) {
+    const char *volume_str = gtk_entry_get_text(GTK_ENTRY(app->volume_entry));
+    const char *abv_str = gtk_entry_get_text(GTK_ENTRY(app->abv_entry));
+    // get_active_text returns a new copy on every call; freed below
+    gchar *unit_str = gtk_combo_box_text_get_active_text(GTK_COMBO_BOX_TEXT(app->unit_combobox));
+    // Combobox entries are appended in MeadSweetness order, so the index is the enum value
+    MeadSweetness sweetness = (MeadSweetness)gtk_combo_box_get_active(GTK_COMBO_BOX(app->sweetness_combobox));
+    gboolean is_turbo_active = gtk_switch_get_active(GTK_SWITCH(app->turbo_switch));
 
-    double honeyAmount;
-    double waterAmount;
-    const char* honeyUnit;
-    const char* waterUnit;
+    // Input validation
+    double volume_val = atof(volume_str);
+    int abv_val = atoi(abv_str);
 
-    if (strcasecmp(unit_str, "Gallons") == 0) {
-        double volume_gal = volume_val;
-        double gravity_points_needed = (target_og - 1.000) * 1000.0 * volume_gal;
-        double honey_lbs = gravity_points_needed / GRAVITY_POINTS_PER_UNIT;
+    if (volume_val <= 0.0 || abv_val <= 0 || !unit_str) {
+        app->recipe_valid = FALSE;
+        result_label_set(&app->message_label, "Virhe: Syt kelvolliset tilavuus ja ABV.");
+        g_free(unit_str);
+        return;
+    }
 
-        // Honey displacement: assume 0.65 gallons per 10 lbs.
-        double honey_volume_gal = (honey_lbs / 10.0) * 0.65;
-        double water_gal = volume_gal - honey_volume_gal;
+    // Turbo mode: 1 (Standard) or 2 (Turbo)
+    int is_turbo_mode = is_turbo_active ? 2 : 1;
 
-        honeyAmount = honey_lbs;
-        waterAmount = fmax(0.0, water_gal); // Use fmax for non-negative
-        honeyUnit = "lbs";
-        waterUnit = "gallons";
+    // If turbo is active, sweetness is ignored for calculation but we use the current selection for the prompt.
+    // For calculation purposes, we only need the sweetness for Standard mode (is_turbo_mode == 1).
+    MeadSweetness calculated_sweetness = sweetness;
+    if (is_turbo_mode == 2) {
+        // In Turbo mode, the FG is always 1.000 (Dry)
+        calculated_sweetness = MEAD_SWEETNESS_DRY;
+    }
 
-    } else { // Metric (Liters/Kg)
-        double volume_L = volume_val;
-        double volume_gal = volume_L * L_TO_GAL;
+    calculate_ingredients(app, volume_val, abv_val, unit_str, calculated_sweetness, is_turbo_mode);
+    g_free(unit_str);
+}
+
+// --- Honey/OG Chart ---
+
+// Plot area inside the chart widget, in pixels.
+typedef struct {
+    double left, top, width, height;
+} ChartRect;
+
+static ChartRect chart_plot_rect(int width, int height) {
+    ChartRect r = { GTK_CHART_MARGIN_LEFT, GTK_CHART_MARGIN_TOP,
+                    width - GTK_CHART_MARGIN_LEFT - GTK_CHART_MARGIN_RIGHT,
+                    height - GTK_CHART_MARGIN_TOP - GTK_CHART_MARGIN_BOTTOM };
+    return r;
+}
+
+static double chart_x(const ChartRect *r, int abv) {
+    return r->left + r->width * (abv - MEAD_MIN_ABV) / (double)(MEAD_MAX_ABV - MEAD_MIN_ABV);
+}
+
+static double chart_og_y(const ChartRect *r, double og) {
+    return r->top + r->height * (1.0 - (og - 1.0) / (GTK_CHART_OG_MAX - 1.0));
+}
 
-        double gravity_points_needed = (target_og - 1.000) * 1000.0 * volume_gal;
-        double honey_lbs_calc = gravity_points_needed / GRAVITY_POINTS_PER_UNIT;
+static double chart_honey_y(const ChartRect *r, double honey, double honey_max) {
+    return r->top + r->height * (1.0 - honey / honey_max);
+}
 
-        // Convert honey from Lbs to Kilograms
-        double honey_kg = honey_lbs_calc / KG_TO_LBS;
+/**
+ * @brief Smallest 1, 2 or 5 x 10^n that is at least value, used as the honey axis top
+ * so the axis (and the cached background) only changes when the curve outgrows it.
+ */
+static double chart_nice_ceiling(double value) {
+    if (!(value > 0.0)) {
+        return 1.0;
+    }
+    double power = pow(10.0, floor(log10(value)));
+    double mantissa = value / power;
+    double step = (mantissa <= 1.0) ? 1.0 : (mantissa <= 2.0) ? 2.0 : (mantissa <= 5.0) ? 5.0 : 10.0;
+    return step * power;
+}
 
-        // Honey displacement: assume 1 kg displaces ~0.74 Liters
-        double honey_volume_L = honey_kg * 0.74;
-        double water_L = volume_L - honey_volume_L;
+static void chart_text(cairo_t *cr, double x, double y, double align, const char *text) {
+    cairo_text_extents_t extents;
+    cairo_text_extents(cr, text, &extents);
+    cairo_move_to(cr, x - extents.width * align, y);
+    cairo_show_text(cr, text);
+}
 
-        honeyAmount = honey_kg;
-        waterAmount = fmax(0.0, water_L);
-        honeyUnit = "kg";
-        waterUnit = "liters";
+/**
+ * @brief Renders what does not depend on the curves: background, grid, axis labels,
+ * the OG limit line and the legend. Drawn once into chart->background.
+ */
+static void chart_draw_background(const HoneyChart *chart, cairo_t *cr, int width, int height) {
+    ChartRect r = chart_plot_rect(width, height);
+    char text[32];
+
+    cairo_set_source_rgb(cr, 1.0, 1.0, 1.0);
+    cairo_paint(cr);
+    cairo_set_font_size(cr, 10.0);
+    cairo_set_line_width(cr, 1.0);
+
+    // Vertical grid every 5 % ABV
+    for (int abv = MEAD_MIN_ABV; abv <= MEAD_MAX_ABV; abv += 5) {
+        double x = chart_x(&r, abv);
+        cairo_set_source_rgb(cr, 0.85, 0.85, 0.85);
+        cairo_move_to(cr, x, r.top);
+        cairo_line_to(cr, x, r.top + r.height);
+        cairo_stroke(cr);
+        snprintf(text, sizeof(text), "%d %%", abv);
+        cairo_set_source_rgb(cr, 0.3, 0.3, 0.3);
+        chart_text(cr, x, r.top + r.height + 14, 0.5, text);
     }
 
-    // --- Update GTK Labels ---
-    char buffer[100];
+    // Horizontal grid: OG on the left axis, honey on the right
+    for (int i = 0; i <= GTK_CHART_Y_DIVISIONS; i++) {
+        double fraction = (double)i / GTK_CHART_Y_DIVISIONS;
+        double y = r.top + r.height * (1.0 - fraction);
+        cairo_set_source_rgb(cr, 0.85, 0.85, 0.85);
+        cairo_move_to(cr, r.left, y);
+        cairo_line_to(cr, r.left + r.width, y);
+        cairo_stroke(cr);
+        cairo_set_source_rgb(cr, 0.55, 0.27, 0.07);
+        snprintf(text, sizeof(text), "%.3f", 1.0 + fraction * (GTK_CHART_OG_MAX - 1.0));
+        chart_text(cr, r.left - 4, y + 3, 1.0, text);
+        cairo_set_source_rgb(cr, 0.8, 0.6, 0.0);
+        snprintf(text, sizeof(text), "%g", fraction * chart->honey_max);
+        chart_text(cr, r.left + r.width + 4, y + 3, 0.0, text);
+    }
 
-    // OG/FG Labels
-    snprintf(buffer, sizeof(buffer), "OG (Ominaispaino): <b>%.3f</b>", target_og);
-    gtk_label_set_markup(GTK_LABEL(og_label), buffer);
-    snprintf(buffer, sizeof(buffer), "FG (Loppupaino): <b>%.3f</b>", fg);
-    gtk_label_set_markup(GTK_LABEL(fg_label), buffer);
+    // OG sanity limit
+    double dash[] = { 4.0, 3.0 };
+    cairo_set_source_rgb(cr, 0.9, 0.2, 0.2);
+    cairo_set_dash(cr, dash, 2, 0.0);
+    cairo_move_to(cr, r.left, chart_og_y(&r, MEAD_MAX_OG));
+    cairo_line_to(cr, r.left + r.width, chart_og_y(&r, MEAD_MAX_OG));
+    cairo_stroke(cr);
+    cairo_set_dash(cr, NULL, 0, 0.0);
+
+    // Legend and frame
+    cairo_set_source_rgb(cr, 0.55, 0.27, 0.07);
+    chart_text(cr, r.left + 6, r.top + 12, 0.0, "OG");
+    cairo_set_source_rgb(cr, 0.8, 0.6, 0.0);
+    chart_text(cr, r.left + 30, r.top + 12,
+               0.0, (chart->unit == MEAD_UNIT_US_IMPERIAL) ? "Hunaja (lbs)" : "Hunaja (kg)");
+    cairo_set_source_rgb(cr, 0.3, 0.3, 0.3);
+    cairo_rectangle(cr, r.left, r.top, r.width, r.height);
+    cairo_stroke(cr);
+}
 
-    // Honey Label
-    snprintf(buffer, sizeof(buffer), "Tarvittava hunaja: <b>%.2f %s</b>", honeyAmount, honeyUnit);
-    gtk_label_set_markup(GTK_LABEL(honey_label), buffer);
+/**
+ * @brief "draw" handler: paints the cached background (rebuilding it after a resize or
+ * an axis change) and strokes the two curves on top.
+ */
+static gboolean on_chart_draw(GtkWidget *widget, cairo_t *cr, gpointer data) {
+    MeadApp *app = data;
+    HoneyChart *chart = &app->chart;
+    int width = gtk_widget_get_allocated_width(widget);
+    int height = gtk_widget_get_allocated_height(widget);
+
+    if (!chart->background || chart->width != width || chart->height != height) {
+        if (chart->background) {
+            cairo_surface_destroy(chart->background);
+        }
+        chart->background = gdk_window_create_similar_surface(gtk_widget_get_window(widget),
+                                                              CAIRO_CONTENT_COLOR, width, height);
+        chart->width = width;
+        chart->height = height;
+        cairo_t *bg = cairo_create(chart->background);
+        chart_draw_background(chart, bg, width, height);
+        cairo_destroy(bg);
+    }
+    cairo_set_source_surface(cr, chart->background, 0, 0);
+    cairo_paint(cr);
 
-    // Water Label
-    snprintf(buffer, sizeof(buffer), "Vesi tyttn: <b>%.2f %s</b>", waterAmount, waterUnit);
-    gtk_label_set_markup(GTK_LABEL(water_label), buffer);
+    if (!chart->valid) {
+        return FALSE;
+    }
+    ChartRect r = chart_plot_rect(width, height);
+    cairo_rectangle(cr, r.left, r.top, r.width, r.height);
+    cairo_clip(cr);
+    cairo_set_line_width(cr, 2.0);
+
+    cairo_set_source_rgb(cr, 0.55, 0.27, 0.07);
+    for (int i = 0; i < MEAD_ABV_COUNT; i++) {
+        cairo_line_to(cr, chart_x(&r, MEAD_MIN_ABV + i), chart_og_y(&r, chart->og[i]));
+    }
+    cairo_stroke(cr);
 
-    // Final Message Label
-    if (is_turbo_mode == 2) {
-        gtk_label_set_markup(GTK_LABEL(message_label), "<span foreground='red'>Laskelma valmis. (Turbo-hiiva: FG pakotettu 1.000)</span>");
-    } else if (target_og <= 1.225) {
-        gtk_label_set_text(GTK_LABEL(message_label), "Laskelma valmis.");
+    cairo_set_source_rgb(cr, 0.8, 0.6, 0.0);
+    for (int i = 0; i < MEAD_ABV_COUNT; i++) {
+        cairo_line_to(cr, chart_x(&r, MEAD_MIN_ABV + i), chart_honey_y(&r, chart->honey[i], chart->honey_max));
+    }
+    cairo_stroke(cr);
+    return FALSE;
+}
+
+/**
+ * @brief Recomputes the curves for the current inputs from the precomputed OG table
+ * and queues a redraw. Runs on every input change (not debounced): it is only
+ * MEAD_ABV_COUNT table lookups and honey calculations. The background is dropped
+ * only when the unit or the honey axis top changes.
+ */
+static void chart_update(MeadApp *app) {
+    HoneyChart *chart = &app->chart;
+    double volume = atof(gtk_entry_get_text(GTK_ENTRY(app->volume_entry)));
+    // Unit combobox entries: 0 Gallons, 1 Liters
+    MeadUnit unit = (gtk_combo_box_get_active(GTK_COMBO_BOX(app->unit_combobox)) == 0) ? MEAD_UNIT_US_IMPERIAL
+                                                                                       : MEAD_UNIT_METRIC;
+    MeadSweetness sweetness = (MeadSweetness)gtk_combo_box_get_active(GTK_COMBO_BOX(app->sweetness_combobox));
+    int is_turbo_mode = gtk_switch_get_active(GTK_SWITCH(app->turbo_switch)) ? 2 : 1;
+    double honey_max = chart->honey_max;
+
+    chart->valid = (volume > 0.0 && (unsigned)sweetness < MEAD_SWEETNESS_COUNT);
+    if (chart->valid) {
+        if (is_turbo_mode == 2) {
+            sweetness = MEAD_SWEETNESS_DRY;
+        }
+        double highest = 0.0;
+        for (int i = 0; i < MEAD_ABV_COUNT; i++) {
+            MeadResult result;
+            chart->og[i] = MEAD_OG_TABLE[is_turbo_mode != 1][sweetness][i].og;
+            mead_model_compute_ingredients(&app->model, unit, volume, chart->og[i], &result);
+            chart->honey[i] = result.honey;
+            highest = (result.honey > highest) ? result.honey : highest;
+        }
+        honey_max = chart_nice_ceiling(highest);
+    }
+
+    if (chart->background && (honey_max != chart->honey_max || unit != chart->unit)) {
+        cairo_surface_destroy(chart->background);
+        chart->background = NULL;
     }
+    chart->honey_max = honey_max;
+    chart->unit = unit;
+    gtk_widget_queue_draw(chart->area);
 }
 
 /**
- * @brief Callback function when the 'Laske' button is clicked.
+ * @brief Volume slider: writes the value into the volume entry, whose "changed"
+ * signal then updates the chart and schedules the recalculation.
+ */
+static void on_volume_scale_changed(GtkRange *range, gpointer data) {
+    MeadApp *app = data;
+    char text[32];
+    snprintf(text, sizeof(text), "%.1f", gtk_range_get_value(range));
+    gtk_entry_set_text(GTK_ENTRY(app->volume_entry), text);
+}
+
+/**
+ * @brief Main loop timeout: runs the recalculation scheduled by on_input_changed().
+ */
+static gboolean on_recalc_timeout(gpointer data) {
+    MeadApp *app = data;
+    app->recalc_source = 0;
+    recalculate(app);
+    return G_SOURCE_REMOVE;
+}
+
+/**
+ * @brief Callback for every input change (connected swapped, so app comes first):
+ * updates the chart at once and restarts the debounce timer, so only the last of a
+ * quick run of changes recalculates the result labels.
+ */
+static void on_input_changed(MeadApp *app) {
+    chart_update(app);
+    if (app->recalc_source) {
+        g_source_remove(app->recalc_source);
+    }
+    app->recalc_source = g_timeout_add(GTK_RECALC_DELAY_MS, on_recalc_timeout, app);
+}
+
+/**
+ * @brief Window destroy: drops a pending recalculation so it never touches freed widgets.
+ */
+static void on_window_destroy(MeadApp *app) {
+    if (app->recalc_source) {
+        g_source_remove(app->recalc_source);
+        app->recalc_source = 0;
+    }
+    if (app->job) {
+        // The job finishes on its own; on_job_done() then ignores it
+        g_cancellable_cancel(app->job_cancel);
+        g_clear_object(&app->job_cancel);
+        app->job = NULL;
+    }
+    if (app->chart.background) {
+        cairo_surface_destroy(app->chart.background);
+        app->chart.background = NULL;
+    }
+    if (app->telemetry_source) {
+        g_source_remove(app->telemetry_source);
+        app->telemetry_source = 0;
+    }
+}
+
+/**
+ * @brief Periodic refresh of the telemetry label from the latest fermenter states.
+ * Each state is a lock-free copy, so this never waits for the ingest threads.
+ */
+static gboolean on_telemetry_refresh(gpointer data) {
+    MeadApp *app = data;
+    size_t count = mead_telemetry_count(app->telemetry);
+    uint64_t now = mead_stats_now();
+    GString *text = g_string_new(NULL);
+
+    if (count == 0) {
+        g_string_append(text, "Ei lukemia viel.");
+    }
+    for (size_t i = 0; i < count && i < GTK_TELEMETRY_ROWS; i++) {
+        MeadFermenterState st;
+        mead_telemetry_get(app->telemetry, i, &st);
+        g_string_append_printf(text, "%s%s: OG %.3f, SG %.3f, ABV %.1f %%", i ? "\n" : "",
+                               st.id, st.og, st.sg, st.abv);
+        if (!isnan(st.temperature)) {
+            g_string_append_printf(text, ", %.1f C", st.temperature);
+        }
+        g_string_append_printf(text, " (%.0f s sitten)",
+                               (st.updated_ns < now) ? (double)(now - st.updated_ns) / 1e9 : 0.0);
+    }
+    if (count > GTK_TELEMETRY_ROWS) {
+        g_string_append_printf(text, "\n... ja %zu muuta", count - GTK_TELEMETRY_ROWS);
+    }
+    if (strcmp(gtk_label_get_text(GTK_LABEL(app->telemetry_label)), text->str) != 0) {
+        gtk_label_set_text(GTK_LABEL(app->telemetry_label), text->str);
+    }
+    g_string_free(text, TRUE);
+    return G_SOURCE_CONTINUE;
+}
+
+/**
+ * @brief Shows the latest recipes of the history file, newest first.
+ * Only the last blocks of the file are decoded (mead_history_latest_recipes()).
+ */
+static void history_label_update(MeadApp *app) {
+    MeadHistoryRecipe recipes[GTK_HISTORY_ROWS];
+    MeadHistory history;
+    size_t count = 0;
+    GString *text = g_string_new(NULL);
+
+    if (mead_history_open(&history, app->history_path) == 0) {
+        count = mead_history_latest_recipes(&history, recipes, GTK_HISTORY_ROWS);
+        mead_history_close(&history);
+    }
+    if (count == 0) {
+        g_string_append(text, "Ei tallennettuja laskelmia.");
+    }
+    for (size_t i = count; i-- > 0;) {
+        const MeadHistoryRecipe *r = &recipes[i];
+        int imperial = (r->unit == MEAD_UNIT_US_IMPERIAL);
+        time_t seconds = (time_t)(r->time_ms / 1000);
+        struct tm tm;
+        char when[32];
+
+        localtime_r(&seconds, &tm);
+        strftime(when, sizeof(when), "%Y-%m-%d %H:%M", &tm);
+        g_string_append_printf(text, "%s%s: %.2f %s, ABV %.0f %%, %s%s, OG %.3f, hunaja %.2f %s",
+                               (i + 1 < count) ? "\n" : "", when, r->volume, imperial ? "gal" : "L",
+                               r->abv, mead_sweetness_name(r->sweetness), (r->yeast_mode == 2) ? " (turbo)" : "",
+                               r->og, r->honey, imperial ? "lbs" : "kg");
+    }
+    gtk_label_set_text(GTK_LABEL(app->history_label), text->str);
+    g_string_free(text, TRUE);
+}
+
+/**
+ * @brief Callback function when the 'Laske' button is clicked. With a history file,
+ * the calculated recipe is appended to it and written out at once.
  */
 static void on_calculate_button_clicked(GtkWidget *widget, gpointer data) {
-    const char *volume_str = gtk_entry_get_text(GTK_ENTRY(volume_entry));
-    const char *abv_str = gtk_entry_get_text(GTK_ENTRY(abv_entry));
-    const char *unit_str = gtk_combo_box_text_get_active_text(GTK_COMBO_BOX_TEXT(unit_combobox));
-    const char *sweetness_str = gtk_combo_box_text_get_active_text(GTK_COMBO_BOX_TEXT(sweetness_combobox));
-    gboolean is_turbo_active = gtk_switch_get_active(GTK_SWITCH(turbo_switch));
+    MeadApp *app = data;
+    if (app->recalc_source) {
+        g_source_remove(app->recalc_source);
+        app->recalc_source = 0;
+    }
+    recalculate(app);
+
+    if (app->history_path && app->recipe_valid) {
+        app->recipe.time_ms = mead_history_now_ms();
+        if (mead_history_append_recipe(&app->history, &app->recipe) != 0 ||
+            mead_history_writer_flush(&app->history) != 0) {
+            result_label_set(&app->message_label, "<span foreground='red'>Virhe: Laskelman tallennus eponnistui.</span>");
+            return;
+        }
+        history_label_update(app);
+    }
+}
 
-    // Input validation
-    double volume_val = atof(volume_str);
-    int abv_val = atoi(abv_str);
+/**
+ * @brief Callback for the 'Simuloi kyminen' button: runs the fermentation simulator
+ * for the current recipe and shows the finishing day, final SG and a weekly SG curve.
+ */
+static void on_simulate_button_clicked(GtkWidget *widget, gpointer data) {
+    MeadApp *app = data;
+    MeadSweetness sweetness = (MeadSweetness)gtk_combo_box_get_active(GTK_COMBO_BOX(app->sweetness_combobox));
+    int is_turbo_mode = gtk_switch_get_active(GTK_SWITCH(app->turbo_switch)) ? 2 : 1;
+    int abv_val = atoi(gtk_entry_get_text(GTK_ENTRY(app->abv_entry)));
+    double temperature = atof(gtk_entry_get_text(GTK_ENTRY(app->temperature_entry)));
+
+    if (abv_val <= 0 || (unsigned)sweetness >= MEAD_SWEETNESS_COUNT) {
+        gtk_label_set_text(GTK_LABEL(app->ferment_label), "Virhe: Syt kelvollinen ABV.");
+        return;
+    }
+    if (is_turbo_mode == 2) {
+        sweetness = MEAD_SWEETNESS_DRY;
+    }
 
-    if (volume_val <= 0.0 || abv_val <= 0) {
-        gtk_label_set_text(GTK_LABEL(message_label), "Virhe: Syt kelvolliset tilavuus ja ABV.");
+    MeadFermentBatches cellar;
+    double curve[GTK_FERMENT_DAYS];
+    if (mead_ferment_alloc(&cellar, 1, app->model.abv_factor) != 0) {
         return;
     }
+    mead_ferment_set_batch(&cellar, 0, mead_model_og_points(&app->model, abv_val, sweetness, is_turbo_mode),
+                           abv_val, is_turbo_mode, temperature);
+    mead_ferment_run(&cellar, GTK_FERMENT_DAYS, curve);
+
+    char buffer[512];
+    int n;
+    if (cellar.finished_day[0] >= 0) {
+        n = snprintf(buffer, sizeof(buffer), "Kyminen valmis pivn <b>%d</b>: SG <b>%.3f</b>, ABV <b>%.1f %%</b>",
+                     cellar.finished_day[0], 1.0 + cellar.points[0] / MEAD_SG_SCALE, mead_ferment_abv(&cellar, 0));
+    } else {
+        n = snprintf(buffer, sizeof(buffer), "Kyminen kesken %d pivn jlkeen: SG <b>%.3f</b>, ABV <b>%.1f %%</b>",
+                     GTK_FERMENT_DAYS, 1.0 + cellar.points[0] / MEAD_SG_SCALE, mead_ferment_abv(&cellar, 0));
+    }
+    n += snprintf(buffer + n, sizeof(buffer) - (size_t)n, "\nSG viikoittain:");
+    for (int day = 7; day <= GTK_FERMENT_DAYS && (size_t)n < sizeof(buffer); day += 7) {
+        n += snprintf(buffer + n, sizeof(buffer) - (size_t)n, " %.3f", 1.0 + curve[day - 1] / MEAD_SG_SCALE);
+    }
+    gtk_label_set_markup(GTK_LABEL(app->ferment_label), buffer);
+    mead_ferment_free(&cellar);
+}
 
-    // Turbo mode: 1 (Standard) or 2 (Turbo)
-    int is_turbo_mode = is_turbo_active ? 2 : 1;
+// --- Scenario Comparison ---
+
+// Allocates count rows of every column (contents undefined, order unset).
+static void scenario_table_alloc(ScenarioTable *table, size_t count) {
+    table->volume = g_new(double, count);
+    table->abv = g_new(int, count);
+    table->sweetness = g_new(unsigned char, count);
+    table->yeast_mode = g_new(unsigned char, count);
+    table->og = g_new(double, count);
+    table->honey = g_new(double, count);
+    table->water = g_new(double, count);
+    table->gravity_points = g_new(double, count);
+    table->order = g_new(guint, count);
+    table->count = count;
+}
 
-    // If turbo is active, sweetness is ignored for calculation but we use the current selection for the prompt.
-    // For calculation purposes, we only need the string value of sweetness for Standard mode (is_turbo_mode == 1).
-    const char* calculated_sweetness_str = sweetness_str;
-    if (is_turbo_mode == 2) {
-        // In Turbo mode, the FG is always 1.000 (Dry)
-        calculated_sweetness_str = "Dry";
+static void scenario_table_free(ScenarioTable *table) {
+    g_free(table->volume);
+    g_free(table->abv);
+    g_free(table->sweetness);
+    g_free(table->yeast_mode);
+    g_free(table->og);
+    g_free(table->honey);
+    g_free(table->water);
+    g_free(table->gravity_points);
+    g_free(table->order);
+    memset(table, 0, sizeof(*table));
+}
+
+/**
+ * @brief Copies a table, including its current view order, so a background job can
+ * read it while the window keeps sorting the original.
+ */
+static void scenario_table_copy(ScenarioTable *dst, const ScenarioTable *src) {
+    size_t n = src->count;
+
+    scenario_table_alloc(dst, n);
+    memcpy(dst->volume, src->volume, n * sizeof(*src->volume));
+    memcpy(dst->abv, src->abv, n * sizeof(*src->abv));
+    memcpy(dst->sweetness, src->sweetness, n * sizeof(*src->sweetness));
+    memcpy(dst->yeast_mode, src->yeast_mode, n * sizeof(*src->yeast_mode));
+    memcpy(dst->og, src->og, n * sizeof(*src->og));
+    memcpy(dst->honey, src->honey, n * sizeof(*src->honey));
+    memcpy(dst->water, src->water, n * sizeof(*src->water));
+    memcpy(dst->gravity_points, src->gravity_points, n * sizeof(*src->gravity_points));
+    memcpy(dst->order, src->order, n * sizeof(*src->order));
+    dst->unit = src->unit;
+    dst->sort_column = src->sort_column;
+    dst->descending = src->descending;
+}
+
+// Sort key of one row: key first, then the sweep position, so equal keys keep sweep order.
+typedef struct {
+    double key;
+    guint row;
+} ScenarioKey;
+
+static int compare_scenario_keys(const void *a, const void *b) {
+    const ScenarioKey *x = a, *y = b;
+    if (x->key != y->key) {
+        return (x->key < y->key) ? -1 : 1;
+    }
+    return (x->row > y->row) - (x->row < y->row);
+}
+
+/**
+ * @brief Sorts the table's view order by one of the numeric result columns.
+ */
+static void scenario_table_sort(ScenarioTable *table, CompareColumn column, gboolean descending) {
+    const double *values = (column == COMPARE_COL_OG) ? table->og
+                         : (column == COMPARE_COL_HONEY) ? table->honey : table->water;
+    ScenarioKey *keys = g_new(ScenarioKey, table->count);
+
+    for (size_t i = 0; i < table->count; i++) {
+        keys[i].key = descending ? -values[i] : values[i];
+        keys[i].row = (guint)i;
+    }
+    qsort(keys, table->count, sizeof(*keys), compare_scenario_keys);
+    for (size_t i = 0; i < table->count; i++) {
+        table->order[i] = keys[i].row;
     }
+    g_free(keys);
+    table->sort_column = column;
+    table->descending = descending;
+}
+
+/**
+ * @brief Cell data function: formats one value of the row at this view position from
+ * the columnar arrays. Only rows being drawn are ever formatted.
+ */
+static void render_scenario_cell(GtkTreeViewColumn *column, GtkCellRenderer *cell, GtkTreeModel *model,
+                                 GtkTreeIter *iter, gpointer data) {
+    MeadApp *app = data;
+    const ScenarioTable *table = &app->scenarios;
+    gint position;
+    char text[32];
+
+    gtk_tree_model_get(model, iter, 0, &position, -1);
+    if ((size_t)position >= table->count) {
+        g_object_set(cell, "text", "", NULL);
+        return;
+    }
+    guint row = table->order[position];
+
+    switch ((CompareColumn)GPOINTER_TO_INT(g_object_get_data(G_OBJECT(column), "compare-column"))) {
+    case COMPARE_COL_VOLUME:
+        snprintf(text, sizeof(text), "%.1f", table->volume[row]);
+        break;
+    case COMPARE_COL_ABV:
+        snprintf(text, sizeof(text), "%d %%", table->abv[row]);
+        break;
+    case COMPARE_COL_SWEETNESS:
+        g_strlcpy(text, mead_sweetness_name((MeadSweetness)table->sweetness[row]), sizeof(text));
+        break;
+    case COMPARE_COL_YEAST:
+        g_strlcpy(text, (table->yeast_mode[row] == 2) ? "Turbo" : "Standard", sizeof(text));
+        break;
+    case COMPARE_COL_OG:
+        snprintf(text, sizeof(text), "%.3f", table->og[row]);
+        break;
+    case COMPARE_COL_HONEY:
+        snprintf(text, sizeof(text), "%.2f", table->honey[row]);
+        break;
+    default:
+        snprintf(text, sizeof(text), "%.2f", table->water[row]);
+        break;
+    }
+    g_object_set(cell, "text", text, NULL);
+}
+
+/**
+ * @brief Column header click: sorts by that column, toggling the direction when it is
+ * already the sort column, and redraws the visible rows.
+ */
+static void on_compare_header_clicked(GtkTreeViewColumn *column, gpointer data) {
+    MeadApp *app = data;
+    CompareColumn id = (CompareColumn)GPOINTER_TO_INT(g_object_get_data(G_OBJECT(column), "compare-column"));
+    gboolean descending = (app->scenarios.sort_column == (int)id) ? !app->scenarios.descending : FALSE;
+
+    scenario_table_sort(&app->scenarios, id, descending);
+    for (int i = COMPARE_COL_OG; i <= COMPARE_COL_WATER; i++) {
+        GtkTreeViewColumn *other = gtk_tree_view_get_column(GTK_TREE_VIEW(app->compare_view), i);
+        gtk_tree_view_column_set_sort_indicator(other, other == column);
+    }
+    gtk_tree_view_column_set_sort_order(column, descending ? GTK_SORT_DESCENDING : GTK_SORT_ASCENDING);
+    gtk_widget_queue_draw(app->compare_view);
+}
+
+// --- Background Jobs ---
+
+// Worker side: publishes progress and queues at most one idle callback to show it.
+static gboolean on_job_progress(gpointer data);
+
+static void report_progress(BackgroundJob *job, double fraction) {
+    g_atomic_int_set(&job->progress, (gint)(fraction * 1000.0));
+    if (g_atomic_int_compare_and_exchange(&job->progress_pending, 0, 1)) {
+        g_idle_add(on_job_progress, g_object_ref(job->task));
+    }
+}
+
+/**
+ * @brief Idle callback (main thread): moves the progress bar of the running job.
+ */
+static gboolean on_job_progress(gpointer data) {
+    GTask *task = data;
+    BackgroundJob *job = g_task_get_task_data(task);
+
+    g_atomic_int_set(&job->progress_pending, 0);
+    if (job->app->job == job) {
+        gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(job->app->progress_bar),
+                                      g_atomic_int_get(&job->progress) / 1000.0);
+    }
+    g_object_unref(task);
+    return G_SOURCE_REMOVE;
+}
+
+static void background_job_free(gpointer data) {
+    BackgroundJob *job = data;
+    scenario_table_free(&job->table);
+    g_free(job->path);
+    g_free(job);
+}
+
+/**
+ * @brief Sweep sink: copies one chunk into the job's table columns (runs on the
+ * sweep's worker threads; chunks never overlap, so no locking is needed).
+ */
+static size_t store_sweep_chunk(const MeadSweepChunk *chunk, char *buf, size_t capacity, void *user) {
+    ScenarioTable *table = &((BackgroundJob *)user)->table;
+    size_t first = chunk->first;
+
+    for (size_t i = 0; i < chunk->count; i++) {
+        table->volume[first + i] = chunk->volume[i];
+        table->abv[first + i] = chunk->abv[i];
+        table->sweetness[first + i] = (unsigned char)chunk->sweetness[i];
+        table->yeast_mode[first + i] = chunk->yeast_mode[i];
+        table->og[first + i] = chunk->og[i];
+        table->honey[first + i] = chunk->honey[i];
+        table->water[first + i] = chunk->water[i];
+        table->gravity_points[first + i] = chunk->gravity_points[i];
+    }
+    return 0;
+}
+
+/**
+ * @brief Sweep sink write stage (called once per chunk, in order): reports progress
+ * and stops the sweep once the job has been cancelled.
+ * @return int 0 to continue, -1 to stop.
+ */
+static int sweep_chunk_done(const char *buf, size_t len, void *user) {
+    BackgroundJob *job = user;
+    size_t chunks = (job->table.count + MEAD_SWEEP_CHUNK - 1) / MEAD_SWEEP_CHUNK;
+
+    job->chunks_done++;
+    report_progress(job, (double)job->chunks_done / (double)chunks);
+    return g_cancellable_is_cancelled(g_task_get_cancellable(job->task)) ? -1 : 0;
+}
+
+/**
+ * @brief Worker thread: runs the comparison sweep for job->table.unit into job->table.
+ */
+static void run_sweep_job(GTask *task, gpointer source, gpointer task_data, GCancellable *cancellable) {
+    BackgroundJob *job = task_data;
+    ScenarioTable *table = &job->table;
+    MeadSweepSpec spec = { table->unit, GTK_COMPARE_VOLUME_START, GTK_COMPARE_VOLUME_STOP, GTK_COMPARE_VOLUME_STEP,
+                           MEAD_MIN_ABV, MEAD_MAX_ABV };
+    MeadSweepSink sink = { store_sweep_chunk, sweep_chunk_done, job };
+
+    scenario_table_alloc(table, mead_sweep_cell_count(&spec));
+    table->sort_column = -1;
+    for (size_t i = 0; i < table->count; i++) {
+        table->order[i] = (guint)i;
+    }
+
+    if (mead_sweep_run(&spec, 0, &sink) == 0) {
+        g_task_return_boolean(task, TRUE);
+    } else if (!g_task_return_error_if_cancelled(task)) {
+        g_task_return_new_error(task, G_IO_ERROR, G_IO_ERROR_FAILED, "Skenaarioiden laskenta eponnistui.");
+    }
+}
+
+/**
+ * @brief Worker thread: streams job->table, in view order, to job->path as CSV or
+ * NDJSON. A cancelled or failed export removes the partial file.
+ */
+static void run_export_job(GTask *task, gpointer source, gpointer task_data, GCancellable *cancellable) {
+    BackgroundJob *job = task_data;
+    const ScenarioTable *table = &job->table;
+    int fd = open(job->path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0) {
+        g_task_return_new_error(task, G_IO_ERROR, g_io_error_from_errno(errno), "Tiedostoa ei voi avata: %s",
+                                g_strerror(errno));
+        return;
+    }
+
+    MeadWriter *out = g_new(MeadWriter, 1);
+    size_t i;
+    mead_writer_init(out, fd);
+    mead_write_header(out, job->format);
+    for (i = 0; i < table->count && !out->error; i++) {
+        if (i % GTK_EXPORT_PROGRESS_ROWS == 0) {
+            if (g_cancellable_is_cancelled(cancellable)) {
+                break;
+            }
+            report_progress(job, (double)i / (double)table->count);
+        }
+        guint r = table->order[i];
+        MeadOutputRecord row = { (long)i + 1, 1, table->unit, table->volume[r], table->abv[r],
+                                 (MeadSweetness)table->sweetness[r], table->yeast_mode[r], NULL,
+                                 table->og[r], table->honey[r], table->water[r], table->gravity_points[r], NULL, 0 };
+        mead_write_record(out, job->format, &row);
+    }
+    int failed = (mead_writer_flush(out) != 0);
+    failed |= (close(fd) != 0);
+    g_free(out);
+
+    if (i < table->count || failed) {
+        unlink(job->path);
+        if (!g_task_return_error_if_cancelled(task)) {
+            g_task_return_new_error(task, G_IO_ERROR, G_IO_ERROR_FAILED, "Vienti eponnistui.");
+        }
+        return;
+    }
+    g_task_return_boolean(task, TRUE);
+}
+
+static void show_compare_window(MeadApp *app);
+
+/**
+ * @brief Task completion (main thread): shows the outcome and, for a sweep, installs
+ * the new table in the comparison window.
+ */
+static void on_job_done(GObject *source, GAsyncResult *result, gpointer data) {
+    MeadApp *app = data;
+    GTask *task = G_TASK(result);
+    BackgroundJob *job = g_task_get_task_data(task);
+    GError *error = NULL;
+    gboolean ok = g_task_propagate_boolean(task, &error);
+
+    if (app->job != job) {
+        g_clear_error(&error); // The window was closed while the job ran
+        return;
+    }
+    app->job = NULL;
+    g_clear_object(&app->job_cancel);
+    gtk_widget_set_sensitive(app->cancel_button, FALSE);
+
+    GtkProgressBar *bar = GTK_PROGRESS_BAR(app->progress_bar);
+    if (!ok) {
+        gtk_progress_bar_set_fraction(bar, 0.0);
+        gtk_progress_bar_set_text(bar, g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED) ? "Peruutettu."
+                                                                                                 : error->message);
+        g_error_free(error);
+        return;
+    }
+    gtk_progress_bar_set_fraction(bar, 1.0);
+    gtk_progress_bar_set_text(bar, "Valmis.");
+
+    if (job->kind == BACKGROUND_JOB_SWEEP) {
+        scenario_table_free(&app->scenarios);
+        app->scenarios = job->table;
+        memset(&job->table, 0, sizeof(job->table));
+        if (app->compare_window) {
+            // Same row count, new values in sweep order: clear the sort indicator
+            for (int i = COMPARE_COL_OG; i <= COMPARE_COL_WATER; i++) {
+                gtk_tree_view_column_set_sort_indicator(
+                    gtk_tree_view_get_column(GTK_TREE_VIEW(app->compare_view), i), FALSE);
+            }
+            gtk_widget_queue_draw(app->compare_view);
+        }
+        show_compare_window(app);
+    }
+}
+
+/**
+ * @brief Runs job on a worker thread via GTask; progress and the result come back
+ * through the main loop, and the cancel button stops it. Only one job runs at a time.
+ * @param job Job to run; owned by the task from here on.
+ * @param text Progress bar text while the job runs.
+ * @param func Worker function.
+ */
+static void start_background_job(MeadApp *app, BackgroundJob *job, const char *text, GTaskThreadFunc func) {
+    job->app = app;
+    app->job = job;
+    app->job_cancel = g_cancellable_new();
+
+    GTask *task = g_task_new(NULL, app->job_cancel, on_job_done, app);
+    job->task = task;
+    g_task_set_task_data(task, job, background_job_free);
+
+    gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(app->progress_bar), 0.0);
+    gtk_progress_bar_set_text(GTK_PROGRESS_BAR(app->progress_bar), text);
+    gtk_widget_set_sensitive(app->cancel_button, TRUE);
+
+    g_task_run_in_thread(task, func);
+    g_object_unref(task);
+}
+
+/**
+ * @brief Reports that another job has to finish first.
+ * @return gboolean TRUE if a job is running.
+ */
+static gboolean job_busy(MeadApp *app) {
+    if (app->job) {
+        gtk_progress_bar_set_text(GTK_PROGRESS_BAR(app->progress_bar), "Edellinen ty on kesken.");
+    }
+    return app->job != NULL;
+}
 
-    calculate_ingredients(volume_val, abv_val, unit_str, calculated_sweetness_str, is_turbo_mode);
+/**
+ * @brief Callback for the 'Peruuta' button: cancels the running job.
+ */
+static void on_cancel_button_clicked(GtkWidget *widget, gpointer data) {
+    MeadApp *app = data;
+    if (app->job_cancel) {
+        g_cancellable_cancel(app->job_cancel);
+    }
+}
+
+/**
+ * @brief File chooser response: exports the shown table to the chosen file.
+ */
+static void on_export_response(GtkNativeDialog *dialog, gint response, gpointer data) {
+    MeadApp *app = data;
+
+    if (response == GTK_RESPONSE_ACCEPT && !job_busy(app)) {
+        BackgroundJob *job = g_new0(BackgroundJob, 1);
+        job->kind = BACKGROUND_JOB_EXPORT;
+        job->format = (MeadOutputFormat)GPOINTER_TO_INT(g_object_get_data(G_OBJECT(dialog), "export-format"));
+        job->path = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(dialog));
+        scenario_table_copy(&job->table, &app->scenarios);
+        start_background_job(app, job, "Viedn tiedostoon...", run_export_job);
+    }
+    g_object_unref(dialog);
+}
+
+/**
+ * @brief Callback for the 'Vie CSV' and 'Vie JSON' buttons: asks for a file name.
+ */
+static void on_export_clicked(GtkWidget *widget, gpointer data) {
+    MeadApp *app = data;
+    MeadOutputFormat format = (MeadOutputFormat)GPOINTER_TO_INT(g_object_get_data(G_OBJECT(widget), "export-format"));
+    GtkFileChooserNative *chooser = gtk_file_chooser_native_new("Vie skenaariot", GTK_WINDOW(app->compare_window),
+                                                                GTK_FILE_CHOOSER_ACTION_SAVE, "Tallenna", "Peruuta");
+
+    gtk_file_chooser_set_do_overwrite_confirmation(GTK_FILE_CHOOSER(chooser), TRUE);
+    gtk_file_chooser_set_current_name(GTK_FILE_CHOOSER(chooser),
+                                      (format == MEAD_FORMAT_JSON) ? "skenaariot.ndjson" : "skenaariot.csv");
+    g_object_set_data(G_OBJECT(chooser), "export-format", GINT_TO_POINTER(format));
+    g_signal_connect(chooser, "response", G_CALLBACK(on_export_response), app);
+    gtk_native_dialog_show(GTK_NATIVE_DIALOG(chooser));
+}
+
+/**
+ * @brief Builds the comparison window: export buttons above a fixed-height tree view
+ * over a list of view positions, so only the rows on screen are realized and formatted.
+ */
+static void create_compare_window(MeadApp *app) {
+    static const char *const titles[COMPARE_COLUMNS] = {
+        "Tilavuus", "ABV", "Makeus", "Hiiva", "OG", "Hunaja", "Vesi"
+    };
+    GtkListStore *store = gtk_list_store_new(1, G_TYPE_INT);
+    GtkTreeIter iter;
+
+    for (size_t i = 0; i < app->scenarios.count; i++) {
+        gtk_list_store_insert_with_values(store, &iter, -1, 0, (gint)i, -1);
+    }
+
+    app->compare_view = gtk_tree_view_new_with_model(GTK_TREE_MODEL(store));
+    g_object_unref(store); // The view keeps its own reference
+    gtk_tree_view_set_fixed_height_mode(GTK_TREE_VIEW(app->compare_view), TRUE);
+
+    for (int i = 0; i < COMPARE_COLUMNS; i++) {
+        GtkCellRenderer *cell = gtk_cell_renderer_text_new();
+        GtkTreeViewColumn *column = gtk_tree_view_column_new();
+        gtk_tree_view_column_set_title(column, titles[i]);
+        gtk_tree_view_column_pack_start(column, cell, TRUE);
+        gtk_tree_view_column_set_cell_data_func(column, cell, render_scenario_cell, app, NULL);
+        // Fixed-height mode needs fixed-width columns
+        gtk_tree_view_column_set_sizing(column, GTK_TREE_VIEW_COLUMN_FIXED);
+        gtk_tree_view_column_set_fixed_width(column, GTK_COMPARE_COLUMN_WIDTH);
+        g_object_set_data(G_OBJECT(column), "compare-column", GINT_TO_POINTER(i));
+        if (i >= COMPARE_COL_OG) {
+            gtk_tree_view_column_set_clickable(column, TRUE);
+            g_signal_connect(column, "clicked", G_CALLBACK(on_compare_header_clicked), app);
+        }
+        gtk_tree_view_append_column(GTK_TREE_VIEW(app->compare_view), column);
+    }
+
+    GtkWidget *scrolled = gtk_scrolled_window_new(NULL, NULL);
+    gtk_container_add(GTK_CONTAINER(scrolled), app->compare_view);
+
+    GtkWidget *buttons = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 5);
+    GtkWidget *button = gtk_button_new_with_label("Vie CSV");
+    g_object_set_data(G_OBJECT(button), "export-format", GINT_TO_POINTER(MEAD_FORMAT_CSV));
+    g_signal_connect(button, "clicked", G_CALLBACK(on_export_clicked), app);
+    gtk_box_pack_start(GTK_BOX(buttons), button, FALSE, FALSE, 0);
+    button = gtk_button_new_with_label("Vie JSON");
+    g_object_set_data(G_OBJECT(button), "export-format", GINT_TO_POINTER(MEAD_FORMAT_JSON));
+    g_signal_connect(button, "clicked", G_CALLBACK(on_export_clicked), app);
+    gtk_box_pack_start(GTK_BOX(buttons), button, FALSE, FALSE, 0);
+
+    GtkWidget *vbox = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
+    gtk_box_pack_start(GTK_BOX(vbox), buttons, FALSE, FALSE, 0);
+    gtk_box_pack_start(GTK_BOX(vbox), scrolled, TRUE, TRUE, 0);
+
+    app->compare_window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+    gtk_window_set_default_size(GTK_WINDOW(app->compare_window), 7 * GTK_COMPARE_COLUMN_WIDTH + 40, 500);
+    gtk_window_set_transient_for(GTK_WINDOW(app->compare_window), GTK_WINDOW(app->main_window));
+    gtk_window_set_destroy_with_parent(GTK_WINDOW(app->compare_window), TRUE);
+    gtk_container_set_border_width(GTK_CONTAINER(app->compare_window), 5);
+    gtk_container_add(GTK_CONTAINER(app->compare_window), vbox);
+    gtk_widget_show_all(vbox);
+
+    // Closing hides the window; the table is kept for the next time
+    g_signal_connect(app->compare_window, "delete-event", G_CALLBACK(gtk_widget_hide_on_delete), NULL);
+    g_signal_connect(app->compare_window, "destroy", G_CALLBACK(gtk_widget_destroyed), &app->compare_window);
+}
+
+static void show_compare_window(MeadApp *app) {
+    if (!app->compare_window) {
+        create_compare_window(app);
+    }
+    gtk_window_set_title(GTK_WINDOW(app->compare_window), (app->scenarios.unit == MEAD_UNIT_US_IMPERIAL)
+                                                              ? "Skenaariot (gallons, lbs)" : "Skenaariot (liters, kg)");
+    gtk_window_present(GTK_WINDOW(app->compare_window));
+}
+
+/**
+ * @brief Callback for the 'Vertaa skenaarioita' button: shows the table, first running
+ * the comparison sweep in the background if there is none yet for the selected unit.
+ */
+static void on_compare_button_clicked(GtkWidget *widget, gpointer data) {
+    MeadApp *app = data;
+    // Unit combobox entries: 0 Gallons, 1 Liters
+    MeadUnit unit = (gtk_combo_box_get_active(GTK_COMBO_BOX(app->unit_combobox)) == 0) ? MEAD_UNIT_US_IMPERIAL
+                                                                                       : MEAD_UNIT_METRIC;
+
+    if (app->scenarios.count > 0 && app->scenarios.unit == unit) {
+        show_compare_window(app);
+    } else if (!job_busy(app)) {
+        BackgroundJob *job = g_new0(BackgroundJob, 1);
+        job->kind = BACKGROUND_JOB_SWEEP;
+        job->table.unit = unit;
+        start_background_job(app, job, "Lasketaan skenaarioita...", run_sweep_job);
+    }
 }
 
 /**
  * @brief Creates the main application window and UI elements.
  */
-static void activate(GtkApplication *app, gpointer user_data) {
+static void activate(GtkApplication *gtk_app, gpointer user_data) {
+    MeadApp *app = user_data;
+    GtkWidget *main_window;
     GtkWidget *grid;
     GtkWidget *button;
     GtkWidget *label;
     GtkWidget *hbox;
 
-    // 1. Create Window and assign to global variable
-    main_window = gtk_application_window_new(app);
+    // 1. Create Window and store it in the app state
+    main_window = app->main_window = gtk_application_window_new(gtk_app);
     gtk_window_set_title(GTK_WINDOW(main_window), "Mead Master Laskuri");
     gtk_window_set_default_size(GTK_WINDOW(main_window), 450, 400);
     gtk_container_set_border_width(GTK_CONTAINER(main_window), 15);
+    g_signal_connect_swapped(main_window, "destroy", G_CALLBACK(on_window_destroy), app);
 
     // 2. Create Main Grid (container for all elements)
     grid = gtk_grid_new();
@@ -293,18 +1304,18 @@ static void activate(GtkApplication *app, gpointer user_data) {
     gtk_grid_attach(GTK_GRID(grid), label, 0, row, 1, 1);
 
     hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 5);
-    volume_entry = gtk_entry_new();
-    gtk_entry_set_text(GTK_ENTRY(volume_entry), "5.0");
-    gtk_box_pack_start(GTK_BOX(hbox), volume_entry, TRUE, TRUE, 0);
+    app->volume_entry = gtk_entry_new();
+    gtk_entry_set_text(GTK_ENTRY(app->volume_entry), "5.0");
+    gtk_box_pack_start(GTK_BOX(hbox), app->volume_entry, TRUE, TRUE, 0);
 
-    unit_combobox = gtk_combo_box_text_new();
-    gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(unit_combobox), "Gallons");
-    gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(unit_combobox), "Liters");
-    gtk_combo_box_set_active(GTK_COMBO_BOX(unit_combobox), 0);
-    gtk_box_pack_start(GTK_BOX(hbox), unit_combobox, FALSE, FALSE, 0);
+    app->unit_combobox = gtk_combo_box_text_new();
+    gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(app->unit_combobox), "Gallons");
+    gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(app->unit_combobox), "Liters");
+    gtk_combo_box_set_active(GTK_COMBO_BOX(app->unit_combobox), 0);
+    gtk_box_pack_start(GTK_BOX(hbox), app->unit_combobox, FALSE, FALSE, 0);
 
     button = gtk_button_new_with_label("Vesi-Info");
-    g_signal_connect(button, "clicked", G_CALLBACK(on_water_info_clicked), NULL);
+    g_signal_connect(button, "clicked", G_CALLBACK(on_water_info_clicked), app);
     gtk_box_pack_start(GTK_BOX(hbox), button, FALSE, FALSE, 0);
 
     gtk_grid_attach(GTK_GRID(grid), hbox, 1, row++, 1, 1);
@@ -314,9 +1325,9 @@ static void activate(GtkApplication *app, gpointer user_data) {
     label = gtk_label_new("Tavoite ABV (%):");
     gtk_label_set_xalign(GTK_LABEL(label), 0.0);
     gtk_grid_attach(GTK_GRID(grid), label, 0, row, 1, 1);
-    abv_entry = gtk_entry_new();
-    gtk_entry_set_text(GTK_ENTRY(abv_entry), "14");
-    gtk_grid_attach(GTK_GRID(grid), abv_entry, 1, row++, 1, 1);
+    app->abv_entry = gtk_entry_new();
+    gtk_entry_set_text(GTK_ENTRY(app->abv_entry), "14");
+    gtk_grid_attach(GTK_GRID(grid), app->abv_entry, 1, row++, 1, 1);
 
     // --- Sweetness Combobox + Honey Info Button ---
     label = gtk_label_new("Makeustaso:");
@@ -324,16 +1335,16 @@ static void activate(GtkApplication *app, gpointer user_data) {
     gtk_grid_attach(GTK_GRID(grid), label, 0, row, 1, 1);
 
     hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 5);
-    sweetness_combobox = gtk_combo_box_text_new();
-    gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(sweetness_combobox), "Dry");
-    gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(sweetness_combobox), "Semi-Sweet");
-    gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(sweetness_combobox), "Sweet");
-    gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(sweetness_combobox), "Dessert");
-    gtk_combo_box_set_active(GTK_COMBO_BOX(sweetness_combobox), 1);
-    gtk_box_pack_start(GTK_BOX(hbox), sweetness_combobox, TRUE, TRUE, 0);
+    app->sweetness_combobox = gtk_combo_box_text_new();
+    gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(app->sweetness_combobox), "Dry");
+    gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(app->sweetness_combobox), "Semi-Sweet");
+    gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(app->sweetness_combobox), "Sweet");
+    gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(app->sweetness_combobox), "Dessert");
+    gtk_combo_box_set_active(GTK_COMBO_BOX(app->sweetness_combobox), 1);
+    gtk_box_pack_start(GTK_BOX(hbox), app->sweetness_combobox, TRUE, TRUE, 0);
 
     button = gtk_button_new_with_label("Hunaja-Info");
-    g_signal_connect(button, "clicked", G_CALLBACK(on_honey_info_clicked), NULL);
+    g_signal_connect(button, "clicked", G_CALLBACK(on_honey_info_clicked), app);
     gtk_box_pack_start(GTK_BOX(hbox), button, FALSE, FALSE, 0);
 
     gtk_grid_attach(GTK_GRID(grid), hbox, 1, row++, 1, 1);
@@ -342,13 +1353,21 @@ static void activate(GtkApplication *app, gpointer user_data) {
     label = gtk_label_new("Kyt Turbo-hiivaa:");
     gtk_label_set_xalign(GTK_LABEL(label), 0.0);
     gtk_grid_attach(GTK_GRID(grid), label, 0, row, 1, 1);
-    turbo_switch = gtk_switch_new();
-    gtk_switch_set_active(GTK_SWITCH(turbo_switch), FALSE);
-    gtk_grid_attach(GTK_GRID(grid), turbo_switch, 1, row++, 1, 1);
+    app->turbo_switch = gtk_switch_new();
+    gtk_switch_set_active(GTK_SWITCH(app->turbo_switch), FALSE);
+    gtk_grid_attach(GTK_GRID(grid), app->turbo_switch, 1, row++, 1, 1);
+
+    // --- Fermentation Temperature ---
+    label = gtk_label_new("Kymislmptila (C):");
+    gtk_label_set_xalign(GTK_LABEL(label), 0.0);
+    gtk_grid_attach(GTK_GRID(grid), label, 0, row, 1, 1);
+    app->temperature_entry = gtk_entry_new();
+    gtk_entry_set_text(GTK_ENTRY(app->temperature_entry), "20");
+    gtk_grid_attach(GTK_GRID(grid), app->temperature_entry, 1, row++, 1, 1);
 
     // --- Calculate Button ---
     button = gtk_button_new_with_label("Laske Ainesosat");
-    g_signal_connect(button, "clicked", G_CALLBACK(on_calculate_button_clicked), NULL);
+    g_signal_connect(button, "clicked", G_CALLBACK(on_calculate_button_clicked), app);
     gtk_grid_attach(GTK_GRID(grid), button, 0, row++, 2, 1);
 
     // --- Separator ---
@@ -362,44 +1381,186 @@ static void activate(GtkApplication *app, gpointer user_data) {
     gtk_grid_attach(GTK_GRID(grid), label, 0, row++, 2, 1);
 
     // Results Labels initialization
-    og_label = gtk_label_new("OG (Ominaispaino):");
-    gtk_label_set_xalign(GTK_LABEL(og_label), 0.0);
-    gtk_grid_attach(GTK_GRID(grid), og_label, 0, row++, 2, 1);
+    label = result_label_init(&app->og_label, "OG (Ominaispaino):");
+    gtk_label_set_xalign(GTK_LABEL(label), 0.0);
+    gtk_grid_attach(GTK_GRID(grid), label, 0, row++, 2, 1);
 
-    fg_label = gtk_label_new("FG (Loppupaino):");
-    gtk_label_set_xalign(GTK_LABEL(fg_label), 0.0);
-    gtk_grid_attach(GTK_GRID(grid), fg_label, 0, row++, 2, 1);
+    label = result_label_init(&app->fg_label, "FG (Loppupaino):");
+    gtk_label_set_xalign(GTK_LABEL(label), 0.0);
+    gtk_grid_attach(GTK_GRID(grid), label, 0, row++, 2, 1);
 
-    honey_label = gtk_label_new("Tarvittava hunaja:");
-    gtk_label_set_xalign(GTK_LABEL(honey_label), 0.0);
-    gtk_grid_attach(GTK_GRID(grid), honey_label, 0, row++, 2, 1);
+    label = result_label_init(&app->honey_label, "Tarvittava hunaja:");
+    gtk_label_set_xalign(GTK_LABEL(label), 0.0);
+    gtk_grid_attach(GTK_GRID(grid), label, 0, row++, 2, 1);
 
-    water_label = gtk_label_new("Vesi tyttn:");
-    gtk_label_set_xalign(GTK_LABEL(water_label), 0.0);
-    gtk_grid_attach(GTK_GRID(grid), water_label, 0, row++, 2, 1);
+    label = result_label_init(&app->water_label, "Vesi tyttn:");
+    gtk_label_set_xalign(GTK_LABEL(label), 0.0);
+    gtk_grid_attach(GTK_GRID(grid), label, 0, row++, 2, 1);
 
     // Message Label (for warnings and errors)
-    message_label = gtk_label_new("Paina 'Laske Ainesosat' nhdksesi tulokset.");
-    gtk_label_set_xalign(GTK_LABEL(message_label), 0.0);
-    gtk_grid_attach(GTK_GRID(grid), message_label, 0, row++, 2, 1);
+    label = result_label_init(&app->message_label, "Paina 'Laske Ainesosat' nhdksesi tulokset.");
+    gtk_label_set_xalign(GTK_LABEL(label), 0.0);
+    gtk_grid_attach(GTK_GRID(grid), label, 0, row++, 2, 1);
+
+    // Live recalculation: every input that affects the results schedules one
+    g_signal_connect_swapped(app->volume_entry, "changed", G_CALLBACK(on_input_changed), app);
+    g_signal_connect_swapped(app->abv_entry, "changed", G_CALLBACK(on_input_changed), app);
+    g_signal_connect_swapped(app->unit_combobox, "changed", G_CALLBACK(on_input_changed), app);
+    g_signal_connect_swapped(app->sweetness_combobox, "changed", G_CALLBACK(on_input_changed), app);
+    g_signal_connect_swapped(app->turbo_switch, "notify::active", G_CALLBACK(on_input_changed), app);
+
+    // --- Honey/OG Chart ---
+    label = gtk_label_new("Sd tilavuutta:");
+    gtk_label_set_xalign(GTK_LABEL(label), 0.0);
+    gtk_grid_attach(GTK_GRID(grid), label, 0, row, 1, 1);
+    app->volume_scale = gtk_scale_new_with_range(GTK_ORIENTATION_HORIZONTAL, 1.0, 100.0, 0.5);
+    gtk_range_set_value(GTK_RANGE(app->volume_scale), 5.0);
+    g_signal_connect(app->volume_scale, "value-changed", G_CALLBACK(on_volume_scale_changed), app);
+    gtk_grid_attach(GTK_GRID(grid), app->volume_scale, 1, row++, 1, 1);
+
+    app->chart.area = gtk_drawing_area_new();
+    gtk_widget_set_size_request(app->chart.area, 420, 220);
+    g_signal_connect(app->chart.area, "draw", G_CALLBACK(on_chart_draw), app);
+    gtk_grid_attach(GTK_GRID(grid), app->chart.area, 0, row++, 2, 1);
+    chart_update(app);
+
+    // --- Fermentation Simulation ---
+    button = gtk_button_new_with_label("Simuloi kyminen");
+    g_signal_connect(button, "clicked", G_CALLBACK(on_simulate_button_clicked), app);
+    gtk_grid_attach(GTK_GRID(grid), button, 0, row++, 2, 1);
+
+    app->ferment_label = gtk_label_new("");
+    gtk_label_set_xalign(GTK_LABEL(app->ferment_label), 0.0);
+    gtk_label_set_line_wrap(GTK_LABEL(app->ferment_label), TRUE);
+    gtk_grid_attach(GTK_GRID(grid), app->ferment_label, 0, row++, 2, 1);
+
+    // --- Scenario Comparison ---
+    button = gtk_button_new_with_label("Vertaa skenaarioita");
+    g_signal_connect(button, "clicked", G_CALLBACK(on_compare_button_clicked), app);
+    gtk_grid_attach(GTK_GRID(grid), button, 0, row++, 2, 1);
+
+    // --- Background Job Progress ---
+    hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 5);
+    app->progress_bar = gtk_progress_bar_new();
+    gtk_progress_bar_set_show_text(GTK_PROGRESS_BAR(app->progress_bar), TRUE);
+    gtk_progress_bar_set_text(GTK_PROGRESS_BAR(app->progress_bar), "");
+    gtk_box_pack_start(GTK_BOX(hbox), app->progress_bar, TRUE, TRUE, 0);
+    app->cancel_button = gtk_button_new_with_label("Peruuta");
+    gtk_widget_set_sensitive(app->cancel_button, FALSE);
+    g_signal_connect(app->cancel_button, "clicked", G_CALLBACK(on_cancel_button_clicked), app);
+    gtk_box_pack_start(GTK_BOX(hbox), app->cancel_button, FALSE, FALSE, 0);
+    gtk_grid_attach(GTK_GRID(grid), hbox, 0, row++, 2, 1);
+
+    // --- Live Telemetry ---
+    if (app->telemetry) {
+        label = gtk_label_new("<b>Kymisseuranta</b>");
+        gtk_label_set_use_markup(GTK_LABEL(label), TRUE);
+        gtk_label_set_xalign(GTK_LABEL(label), 0.0);
+        gtk_grid_attach(GTK_GRID(grid), label, 0, row++, 2, 1);
+
+        app->telemetry_label = gtk_label_new("");
+        gtk_label_set_xalign(GTK_LABEL(app->telemetry_label), 0.0);
+        gtk_grid_attach(GTK_GRID(grid), app->telemetry_label, 0, row++, 2, 1);
+        on_telemetry_refresh(app);
+        app->telemetry_source = g_timeout_add_seconds(GTK_TELEMETRY_REFRESH_S, on_telemetry_refresh, app);
+    }
+
+    // --- Recipe History ---
+    if (app->history_path) {
+        label = gtk_label_new("<b>Viimeisimmt laskelmat</b>");
+        gtk_label_set_use_markup(GTK_LABEL(label), TRUE);
+        gtk_label_set_xalign(GTK_LABEL(label), 0.0);
+        gtk_grid_attach(GTK_GRID(grid), label, 0, row++, 2, 1);
+
+        app->history_label = gtk_label_new("");
+        gtk_label_set_xalign(GTK_LABEL(app->history_label), 0.0);
+        gtk_grid_attach(GTK_GRID(grid), app->history_label, 0, row++, 2, 1);
+        history_label_update(app);
+    }
 
     // Initial calculation on startup to populate labels
-    calculate_ingredients(5.0, 14, "Gallons", "Semi-Sweet", 1);
+    calculate_ingredients(app, 5.0, 14, "Gallons", MEAD_SWEETNESS_SEMI_SWEET, 1);
 
 
     // 3. Show Window
     gtk_widget_show_all(main_window);
 }
 
+/**
+ * @brief Handles and removes "--telemetry-port N" and "--history FILE" from argv;
+ * GApplication would reject the unknown options. Opens the history file for the
+ * recipes calculated with 'Laske' and starts telemetry on the UDP port, which also
+ * appends its readings to the history file.
+ * @return int 0 on success (also without the options), -1 after printing an error.
+ */
+static int start_command_line_options(MeadApp *state, int *argc, char **argv) {
+    long port = 0;
+
+    for (int i = 1; i < *argc;) {
+        const char *value = (i + 1 < *argc) ? argv[i + 1] : "";
+        char *end;
+        if (strcmp(argv[i], "--telemetry-port") == 0) {
+            port = strtol(value, &end, 10);
+            if (end == value || *end != '\0' || port < 1 || port > 65535) {
+                g_printerr("Error: Invalid telemetry port '%s'.\n", value);
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--history") == 0) {
+            if (*value == '\0') {
+                g_printerr("Error: Missing value for '--history'.\n");
+                return -1;
+            }
+            state->history_path = value;
+        } else {
+            i++;
+            continue;
+        }
+        memmove(&argv[i], &argv[i + 2], (size_t)(*argc - i - 1) * sizeof(*argv)); // Keeps the NULL
+        *argc -= 2;
+    }
+
+    if (state->history_path &&
+        mead_history_writer_open(&state->history, state->history_path, MEAD_HISTORY_RECIPES) != 0) {
+        g_printerr("Error: Cannot open history '%s'.\n", state->history_path);
+        return -1;
+    }
+    if (port) {
+        MeadTelemetryConfig config = { (int)port, 1, state->model.abv_factor, state->history_path };
+        state->telemetry = mead_telemetry_start(&config);
+        if (!state->telemetry) {
+            g_printerr("Error: Cannot receive telemetry on UDP port %ld: %s\n", port, g_strerror(errno));
+            if (state->history_path) {
+                mead_history_writer_close(&state->history);
+            }
+            return -1;
+        }
+    }
+    return 0;
+}
+
 // --- Main function for GTK application ---
 int main(int argc, char **argv) {
     GtkApplication *app;
+    MeadApp *state = g_new0(MeadApp, 1);
     int status;
 
+    mead_model_init(&state->model);
+    if (start_command_line_options(state, &argc, argv) != 0) {
+        g_free(state);
+        return 1;
+    }
+
     app = gtk_application_new("com.example.meadcalculator", G_APPLICATION_DEFAULT_FLAGS);
-    g_signal_connect(app, "activate", G_CALLBACK(activate), NULL);
+    g_signal_connect(app, "activate", G_CALLBACK(activate), state);
     status = g_application_run(G_APPLICATION(app), argc, argv);
     g_object_unref(app);
+    mead_telemetry_stop(state->telemetry);
+    if (state->history_path && mead_history_writer_close(&state->history) != 0) {
+        g_printerr("Error: Failed writing history '%s'.\n", state->history_path);
+        status = 1;
+    }
+    scenario_table_free(&state->scenarios);
+    g_free(state);
 
     return status;
 }
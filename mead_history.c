@@ -0,0 +1,813 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mead_history.h"
+#include "mead_output.h"
+
+#define HISTORY_SERIES_COLUMNS 3  // Per fermenter: time, gravity, temperature
+#define HISTORY_RECIPE_COLUMNS 7  // time, flags, volume, abv, og, honey, water
+#define HISTORY_VARINT_MAX 10     // Bytes of the longest 64-bit varint
+
+// Largest directory: per series a name, the row count, column sizes and a checksum
+#define HISTORY_SERIES_ENTRY_MAX (MEAD_HISTORY_ID_MAX + (1 + HISTORY_SERIES_COLUMNS) * HISTORY_VARINT_MAX + 4)
+#define HISTORY_DIRECTORY_MAX (MEAD_HISTORY_DICT_MAX * HISTORY_SERIES_ENTRY_MAX)
+#define HISTORY_ENCODED_MAX (sizeof(MeadHistoryBlock) + HISTORY_DIRECTORY_MAX + \
+                             MEAD_HISTORY_BLOCK_ROWS * HISTORY_RECIPE_COLUMNS * HISTORY_VARINT_MAX)
+
+// Recipe flags column: one byte per row
+#define FLAG_METRIC 0x01
+#define FLAG_TURBO 0x02
+#define FLAG_SWEETNESS_SHIFT 2
+
+// Buffered rows of a writer, one array per column, as fixed-point integers.
+typedef struct {
+    uint16_t fermenter[MEAD_HISTORY_BLOCK_ROWS]; // Index into the writer's dictionary
+    int64_t time[MEAD_HISTORY_BLOCK_ROWS];
+    int64_t gravity[MEAD_HISTORY_BLOCK_ROWS];
+    int64_t temperature[MEAD_HISTORY_BLOCK_ROWS];
+    unsigned char has_temperature[MEAD_HISTORY_BLOCK_ROWS];
+    uint16_t order[MEAD_HISTORY_BLOCK_ROWS];     // Rows grouped by fermenter (built when encoding)
+} ReadingColumns;
+
+typedef struct {
+    int64_t time[MEAD_HISTORY_BLOCK_ROWS];
+    unsigned char flags[MEAD_HISTORY_BLOCK_ROWS];
+    int64_t volume[MEAD_HISTORY_BLOCK_ROWS];
+    int64_t abv[MEAD_HISTORY_BLOCK_ROWS];
+    int64_t og[MEAD_HISTORY_BLOCK_ROWS];
+    int64_t honey[MEAD_HISTORY_BLOCK_ROWS];
+    int64_t water[MEAD_HISTORY_BLOCK_ROWS];
+} RecipeColumns;
+
+/**
+ * @brief Returns the wall clock time in milliseconds since the epoch (history timestamps).
+ */
+int64_t mead_history_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// --- Encoding ---
+
+static uint64_t zigzag(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static unsigned char *put_varint(unsigned char *p, uint64_t v) {
+    while (v >= 0x80) {
+        *p++ = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (unsigned char)v;
+    return p;
+}
+
+static uint32_t checksum(const unsigned char *p, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+
+static int64_t to_fixed(double value, int scale) {
+    double scaled = value * scale;
+    return isfinite(scaled) && fabs(scaled) < 9e18 ? llround(scaled) : 0;
+}
+
+/**
+ * @brief Encodes the buffered readings as one series per fermenter: the directory at
+ * p, then every series' time, gravity and temperature columns.
+ * @return unsigned char* The end of the payload.
+ */
+static unsigned char *encode_readings(MeadHistoryWriter *w, unsigned char *p) {
+    ReadingColumns *col = w->columns;
+    uint32_t first[MEAD_HISTORY_DICT_MAX + 1];
+
+    // Counting sort of the rows by fermenter; rows keep their order within a series
+    memset(first, 0, sizeof(first));
+    for (uint32_t i = 0; i < w->rows; i++) {
+        first[col->fermenter[i] + 1]++;
+    }
+    for (int d = 0; d < w->dict_count; d++) {
+        first[d + 1] += first[d];
+    }
+    uint32_t fill[MEAD_HISTORY_DICT_MAX];
+    memcpy(fill, first, sizeof(fill));
+    for (uint32_t i = 0; i < w->rows; i++) {
+        col->order[fill[col->fermenter[i]]++] = (uint16_t)i;
+    }
+
+    // Series go after room for the largest directory and are moved down behind it
+    unsigned char *directory = p;
+    unsigned char *series = p + HISTORY_DIRECTORY_MAX;
+    unsigned char *s = series;
+    for (int d = 0; d < w->dict_count; d++) {
+        const uint16_t *rows = &col->order[first[d]];
+        uint32_t count = first[d + 1] - first[d];
+        unsigned char *start[HISTORY_SERIES_COLUMNS + 1];
+
+        // Times: delta of delta, which is zero for a sensor reporting at a steady rate
+        start[0] = s;
+        int64_t prev = w->t_min, prev_delta = 0;
+        for (uint32_t r = 0; r < count; r++) {
+            int64_t delta = col->time[rows[r]] - prev;
+            s = put_varint(s, zigzag(delta - prev_delta));
+            prev = col->time[rows[r]];
+            prev_delta = delta;
+        }
+        start[1] = s;
+        prev = MEAD_HISTORY_SG_SCALE;
+        for (uint32_t r = 0; r < count; r++) {
+            s = put_varint(s, zigzag(col->gravity[rows[r]] - prev));
+            prev = col->gravity[rows[r]];
+        }
+        // 0 marks a missing temperature, so deltas are stored plus one
+        start[2] = s;
+        prev = 0;
+        for (uint32_t r = 0; r < count; r++) {
+            if (!col->has_temperature[rows[r]]) {
+                *s++ = 0;
+                continue;
+            }
+            s = put_varint(s, zigzag(col->temperature[rows[r]] - prev) + 1);
+            prev = col->temperature[rows[r]];
+        }
+        start[3] = s;
+
+        size_t len = strlen(w->dict[d]);
+        *p++ = (unsigned char)len;
+        memcpy(p, w->dict[d], len);
+        p += len;
+        p = put_varint(p, count);
+        for (int c = 0; c < HISTORY_SERIES_COLUMNS; c++) {
+            p = put_varint(p, (uint64_t)(start[c + 1] - start[c]));
+        }
+        uint32_t sum = checksum(start[0], (size_t)(s - start[0]));
+        memcpy(p, &sum, sizeof(sum));
+        p += sizeof(sum);
+    }
+
+    w->directory_size = (size_t)(p - directory);
+    memmove(p, series, (size_t)(s - series));
+    return p + (s - series);
+}
+
+static unsigned char *put_delta_column(unsigned char *p, const int64_t *values, uint32_t rows, int64_t first,
+                                       size_t *size) {
+    unsigned char *start = p;
+    int64_t prev = first;
+
+    for (uint32_t i = 0; i < rows; i++) {
+        p = put_varint(p, zigzag(values[i] - prev));
+        prev = values[i];
+    }
+    *size = (size_t)(p - start);
+    return p;
+}
+
+/**
+ * @brief Encodes the buffered recipes: the column sizes at p, then the columns. The
+ * whole payload counts as the directory, so it is checked as a whole.
+ * @return unsigned char* The end of the payload.
+ */
+static unsigned char *encode_recipes(MeadHistoryWriter *w, unsigned char *p) {
+    const RecipeColumns *col = w->columns;
+    size_t sizes[HISTORY_RECIPE_COLUMNS];
+    unsigned char *payload = p;
+
+    // Columns go after room for their sizes and are moved down behind them
+    unsigned char *start = p + HISTORY_RECIPE_COLUMNS * HISTORY_VARINT_MAX;
+    unsigned char *c = start;
+    c = put_delta_column(c, col->time, w->rows, w->t_min, &sizes[0]);
+    memcpy(c, col->flags, w->rows);
+    c += w->rows;
+    sizes[1] = w->rows;
+    c = put_delta_column(c, col->volume, w->rows, 0, &sizes[2]);
+    c = put_delta_column(c, col->abv, w->rows, 0, &sizes[3]);
+    c = put_delta_column(c, col->og, w->rows, MEAD_HISTORY_SG_SCALE, &sizes[4]);
+    c = put_delta_column(c, col->honey, w->rows, 0, &sizes[5]);
+    c = put_delta_column(c, col->water, w->rows, 0, &sizes[6]);
+
+    for (int i = 0; i < HISTORY_RECIPE_COLUMNS; i++) {
+        p = put_varint(p, sizes[i]);
+    }
+    memmove(p, start, (size_t)(c - start));
+    p += c - start;
+    w->directory_size = (size_t)(p - payload);
+    return p;
+}
+
+// --- Decoding ---
+
+typedef struct {
+    const unsigned char *p;
+    const unsigned char *end;
+} Cursor;
+
+static int get_varint(Cursor *c, uint64_t *out) {
+    uint64_t v = 0;
+
+    for (int shift = 0; c->p < c->end && shift < 64; shift += 7) {
+        unsigned char b = *c->p++;
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *out = v;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int get_delta(Cursor *c, int64_t *value) {
+    uint64_t v;
+    if (get_varint(c, &v) != 0) {
+        return -1;
+    }
+    *value += unzigzag(v);
+    return 0;
+}
+
+// One fermenter's series in a readings block, located from the directory.
+typedef struct {
+    const unsigned char *name;        // Length byte, then the name
+    uint32_t rows;
+    uint32_t checksum;                // Of the three columns together
+    Cursor columns[HISTORY_SERIES_COLUMNS];
+} SeriesView;
+
+// A block whose directory has been checked and split into its series or columns.
+typedef struct {
+    const MeadHistoryBlock *header;
+    int series_count;
+    SeriesView series[MEAD_HISTORY_DICT_MAX];  // Readings blocks
+    Cursor columns[HISTORY_RECIPE_COLUMNS];    // Recipes blocks
+} BlockView;
+
+// Splits the data at *data into count columns whose sizes are read from c.
+static int split_columns(Cursor *c, const unsigned char **data, const unsigned char *end, Cursor *columns,
+                         int count) {
+    for (int i = 0; i < count; i++) {
+        uint64_t size;
+        if (get_varint(c, &size) != 0 || size > (uint64_t)(end - *data)) {
+            return -1;
+        }
+        columns[i].p = *data;
+        columns[i].end = *data + size;
+        *data += size;
+    }
+    return 0;
+}
+
+/**
+ * @brief Verifies a block's directory and locates its series (readings) or columns
+ * (recipes). Series data is verified later, and only if it is decoded.
+ * @return int 0 on success, -1 if the block is damaged.
+ */
+static int open_block(const MeadHistory *history, const MeadHistoryIndexEntry *entry, BlockView *view) {
+    const MeadHistoryBlock *header = (const MeadHistoryBlock *)((const char *)history->map + entry->offset);
+    const unsigned char *payload = (const unsigned char *)(header + 1);
+    const unsigned char *end = payload + header->payload_size;
+
+    if (header->directory_size > header->payload_size || header->series_count > MEAD_HISTORY_DICT_MAX ||
+        checksum(payload, header->directory_size) != header->checksum) {
+        return -1;
+    }
+    view->header = header;
+    view->series_count = 0;
+
+    Cursor c = { payload, payload + header->directory_size };
+    if (header->kind == MEAD_HISTORY_RECIPES) {
+        // Column sizes lead the payload; the columns follow them
+        Cursor sizes = c;
+        uint64_t size;
+        for (int i = 0; i < HISTORY_RECIPE_COLUMNS; i++) {
+            if (get_varint(&sizes, &size) != 0) {
+                return -1;
+            }
+        }
+        const unsigned char *data = sizes.p;
+        return (split_columns(&c, &data, end, view->columns, HISTORY_RECIPE_COLUMNS) == 0 && data == end) ? 0 : -1;
+    }
+
+    const unsigned char *data = c.end;
+    for (int d = 0; d < header->series_count; d++) {
+        SeriesView *s = &view->series[d];
+        uint64_t rows;
+        if (c.p >= c.end || *c.p >= MEAD_HISTORY_ID_MAX || (size_t)(c.end - c.p) <= *c.p) {
+            return -1;
+        }
+        s->name = c.p;
+        c.p += 1 + *c.p;
+        if (get_varint(&c, &rows) != 0 || rows > MEAD_HISTORY_BLOCK_ROWS ||
+            split_columns(&c, &data, end, s->columns, HISTORY_SERIES_COLUMNS) != 0 ||
+            (size_t)(c.end - c.p) < sizeof(s->checksum)) {
+            return -1;
+        }
+        s->rows = (uint32_t)rows;
+        memcpy(&s->checksum, c.p, sizeof(s->checksum));
+        c.p += sizeof(s->checksum);
+        view->series_count++;
+    }
+    return (c.p == c.end && data == end) ? 0 : -1;
+}
+
+static int series_is(const SeriesView *s, const char *fermenter) {
+    size_t len = strlen(fermenter);
+    return s->name[0] == len && memcmp(s->name + 1, fermenter, len) == 0;
+}
+
+/**
+ * @brief Decodes one series and passes the readings matching query to fn.
+ * @return int 1 if fn stopped the scan, 0 when the series is done, -1 if it is damaged.
+ */
+static int scan_series(const MeadHistoryBlock *header, const SeriesView *s, const MeadHistoryQuery *query,
+                       long *matched, MeadHistoryReadingFn fn, void *user) {
+    Cursor c[HISTORY_SERIES_COLUMNS];
+    int64_t time = header->t_min, delta = 0, gravity = MEAD_HISTORY_SG_SCALE, temperature = 0;
+    MeadHistoryReading reading;
+
+    memcpy(c, s->columns, sizeof(c));
+    if (checksum(c[0].p, (size_t)(c[2].end - c[0].p)) != s->checksum) {
+        return -1;
+    }
+    memcpy(reading.fermenter, s->name + 1, s->name[0]);
+    reading.fermenter[s->name[0]] = '\0';
+
+    for (uint32_t i = 0; i < s->rows; i++) {
+        uint64_t temp_code;
+        if (get_delta(&c[0], &delta) != 0 || get_delta(&c[1], &gravity) != 0 ||
+            get_varint(&c[2], &temp_code) != 0) {
+            return -1;
+        }
+        time += delta;
+        if (temp_code) {
+            temperature += unzigzag(temp_code - 1);
+        }
+        if (time < query->from_ms || time > query->to_ms) {
+            continue;
+        }
+        reading.time_ms = time;
+        reading.gravity = (double)gravity / MEAD_HISTORY_SG_SCALE;
+        reading.temperature = temp_code ? (double)temperature / MEAD_HISTORY_TEMP_SCALE : NAN;
+        (*matched)++;
+        if (fn(&reading, user) != 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Decodes a recipes block row by row and passes the rows matching query to fn;
+ * rows before skip are decoded but not passed on.
+ * @return int 1 if fn stopped the scan, 0 when the block is done, -1 if it is damaged.
+ */
+static int scan_recipe_block(const BlockView *view, const MeadHistoryQuery *query, uint32_t skip, long *matched,
+                             MeadHistoryRecipeFn fn, void *user) {
+    Cursor c[HISTORY_RECIPE_COLUMNS];
+    int64_t time = view->header->t_min, volume = 0, abv = 0, og = MEAD_HISTORY_SG_SCALE, honey = 0, water = 0;
+
+    memcpy(c, view->columns, sizeof(c));
+    for (uint32_t i = 0; i < view->header->rows; i++) {
+        if (get_delta(&c[0], &time) != 0 || c[1].p == c[1].end || get_delta(&c[2], &volume) != 0 ||
+            get_delta(&c[3], &abv) != 0 || get_delta(&c[4], &og) != 0 || get_delta(&c[5], &honey) != 0 ||
+            get_delta(&c[6], &water) != 0) {
+            return -1;
+        }
+        unsigned char flags = *c[1].p++;
+        if (i < skip || time < query->from_ms || time > query->to_ms) {
+            continue;
+        }
+
+        MeadHistoryRecipe recipe;
+        recipe.time_ms = time;
+        recipe.unit = (flags & FLAG_METRIC) ? MEAD_UNIT_METRIC : MEAD_UNIT_US_IMPERIAL;
+        recipe.yeast_mode = (flags & FLAG_TURBO) ? 2 : 1;
+        recipe.sweetness = (MeadSweetness)(flags >> FLAG_SWEETNESS_SHIFT);
+        recipe.volume = (double)volume / MEAD_HISTORY_INPUT_SCALE;
+        recipe.abv = (double)abv / MEAD_HISTORY_INPUT_SCALE;
+        recipe.og = (double)og / MEAD_HISTORY_SG_SCALE;
+        recipe.honey = (double)honey / MEAD_HISTORY_AMOUNT_SCALE;
+        recipe.water = (double)water / MEAD_HISTORY_AMOUNT_SCALE;
+        (*matched)++;
+        if (fn(&recipe, user) != 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// --- Reading ---
+
+/**
+ * @brief Maps a history file and indexes its blocks from their headers. A damaged or
+ * partly written block ends the index (nothing after it is reachable).
+ * @param history Handle to fill; unchanged on failure.
+ * @return int 0 on success, -1 if the file cannot be mapped or is not a history file.
+ */
+int mead_history_open(MeadHistory *history, const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(MeadHistoryHeader)) {
+        close(fd);
+        return -1;
+    }
+    size_t size = (size_t)st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // The mapping keeps the file alive
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+
+    const MeadHistoryHeader *header = map;
+    if (strncmp(header->magic, MEAD_HISTORY_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != MEAD_HISTORY_VERSION || header->byte_order != MEAD_HISTORY_BYTE_ORDER) {
+        munmap(map, size);
+        return -1;
+    }
+
+    MeadHistoryIndexEntry *index = NULL;
+    size_t blocks = 0, cap = 0;
+    size_t offset = sizeof(MeadHistoryHeader);
+    while (size - offset >= sizeof(MeadHistoryBlock)) {
+        const MeadHistoryBlock *block = (const MeadHistoryBlock *)((const char *)map + offset);
+        if (block->magic != MEAD_HISTORY_BLOCK_MAGIC || block->payload_size > size - offset - sizeof(*block) ||
+            (block->kind != MEAD_HISTORY_READINGS && block->kind != MEAD_HISTORY_RECIPES)) {
+            break;
+        }
+        if (blocks == cap) {
+            cap = cap ? cap * 2 : 256;
+            MeadHistoryIndexEntry *grown = realloc(index, cap * sizeof(*index));
+            if (!grown) {
+                free(index);
+                munmap(map, size);
+                return -1;
+            }
+            index = grown;
+        }
+        index[blocks++] = (MeadHistoryIndexEntry){ offset, block->t_min, block->t_max, block->rows, block->kind };
+        offset += sizeof(*block) + block->payload_size;
+    }
+
+    // Range queries touch a few blocks each, wherever they are in the file
+    madvise(map, size, MADV_RANDOM);
+    history->map = map;
+    history->size = size;
+    history->index = index;
+    history->blocks = blocks;
+    return 0;
+}
+
+void mead_history_close(MeadHistory *history) {
+    if (history->map) {
+        munmap(history->map, history->size);
+    }
+    free(history->index);
+    memset(history, 0, sizeof(*history));
+}
+
+static int entry_matches(const MeadHistoryIndexEntry *entry, MeadHistoryKind kind, const MeadHistoryQuery *query) {
+    return entry->kind == kind && entry->t_max >= query->from_ms && entry->t_min <= query->to_ms;
+}
+
+/**
+ * @brief Passes every reading matching query to fn. Only blocks whose time range
+ * overlaps the query are opened, and for one fermenter only its series is decoded.
+ * Damaged blocks and series are skipped.
+ * @return long The number of readings passed to fn.
+ */
+long mead_history_scan_readings(const MeadHistory *history, const MeadHistoryQuery *query,
+                                MeadHistoryReadingFn fn, void *user) {
+    static _Thread_local BlockView view; // Too large for small thread stacks
+    long matched = 0;
+
+    for (size_t b = 0; b < history->blocks; b++) {
+        if (!entry_matches(&history->index[b], MEAD_HISTORY_READINGS, query) ||
+            open_block(history, &history->index[b], &view) != 0) {
+            continue;
+        }
+        for (int d = 0; d < view.series_count; d++) {
+            if (query->fermenter && !series_is(&view.series[d], query->fermenter)) {
+                continue;
+            }
+            if (scan_series(view.header, &view.series[d], query, &matched, fn, user) == 1) {
+                return matched;
+            }
+        }
+    }
+    return matched;
+}
+
+/**
+ * @brief Passes every recipe matching query to fn, in file order (see
+ * mead_history_scan_readings()). query->fermenter is ignored.
+ * @return long The number of recipes passed to fn.
+ */
+long mead_history_scan_recipes(const MeadHistory *history, const MeadHistoryQuery *query,
+                               MeadHistoryRecipeFn fn, void *user) {
+    static _Thread_local BlockView view;
+    long matched = 0;
+
+    for (size_t b = 0; b < history->blocks; b++) {
+        if (entry_matches(&history->index[b], MEAD_HISTORY_RECIPES, query) &&
+            open_block(history, &history->index[b], &view) == 0 &&
+            scan_recipe_block(&view, query, 0, &matched, fn, user) == 1) {
+            break;
+        }
+    }
+    return matched;
+}
+
+typedef struct {
+    MeadHistoryRecipe *out;
+    size_t next;
+} LatestCursor;
+
+static int collect_recipe(const MeadHistoryRecipe *recipe, void *user) {
+    LatestCursor *cursor = user;
+    cursor->out[cursor->next++] = *recipe;
+    return 0;
+}
+
+/**
+ * @brief Copies the last max recipes appended to the file, oldest first. Decodes
+ * blocks backwards from the end of the file, so the cost depends on max, not on
+ * the size of the history.
+ * @return size_t The number of recipes copied.
+ */
+size_t mead_history_latest_recipes(const MeadHistory *history, MeadHistoryRecipe *out, size_t max) {
+    static _Thread_local BlockView view;
+    MeadHistoryQuery all = { INT64_MIN, INT64_MAX, NULL };
+    size_t found = 0;
+    size_t b = history->blocks;
+
+    // Each block's rows go right before the newer ones already found
+    while (b > 0 && found < max) {
+        const MeadHistoryIndexEntry *entry = &history->index[--b];
+        if (entry->kind != MEAD_HISTORY_RECIPES || open_block(history, entry, &view) != 0) {
+            continue;
+        }
+        size_t take = (entry->rows < max - found) ? entry->rows : max - found;
+        LatestCursor cursor = { out + (max - found - take), 0 };
+        long matched = 0;
+        if (scan_recipe_block(&view, &all, entry->rows - (uint32_t)take, &matched, collect_recipe, &cursor) == 0) {
+            found += take;
+        }
+    }
+    if (found < max) {
+        memmove(out, out + (max - found), found * sizeof(*out));
+    }
+    return found;
+}
+
+// --- Writing ---
+
+// Offset just past the last intact block, reading from fd (which starts with a valid header).
+static off_t intact_end(int fd, off_t size) {
+    off_t offset = sizeof(MeadHistoryHeader);
+    unsigned char *directory = NULL;
+
+    while (size - offset >= (off_t)sizeof(MeadHistoryBlock)) {
+        MeadHistoryBlock block;
+        if (pread(fd, &block, sizeof(block), offset) != (ssize_t)sizeof(block) ||
+            block.magic != MEAD_HISTORY_BLOCK_MAGIC || block.directory_size > block.payload_size ||
+            (off_t)block.payload_size > size - offset - (off_t)sizeof(block)) {
+            break;
+        }
+        off_t next = offset + (off_t)sizeof(block) + block.payload_size;
+        if (next == size) {
+            // Only the last block can be torn, so only its directory is read back
+            directory = malloc(block.directory_size ? block.directory_size : 1);
+            if (!directory ||
+                pread(fd, directory, block.directory_size, offset + (off_t)sizeof(block)) !=
+                    (ssize_t)block.directory_size ||
+                checksum(directory, block.directory_size) != block.checksum) {
+                break;
+            }
+        }
+        offset = next;
+    }
+    free(directory);
+    return offset;
+}
+
+/**
+ * @brief Opens (or creates) a history file for appending rows of one kind. A torn
+ * block at the end of the file, left by a crash, is cut off.
+ * @return int 0 on success, -1 if the file cannot be opened, is not a history file,
+ * or memory runs out.
+ */
+int mead_history_writer_open(MeadHistoryWriter *w, const char *path, MeadHistoryKind kind) {
+    memset(w, 0, sizeof(*w));
+    w->kind = kind;
+    w->fd = open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (w->fd < 0) {
+        return -1;
+    }
+
+    // Exclusive while checking the tail, so no other writer is halfway through an append
+    flock(w->fd, LOCK_EX);
+    struct stat st;
+    MeadHistoryHeader header;
+    int ok = fstat(w->fd, &st) == 0;
+    if (ok && st.st_size == 0) {
+        memset(&header, 0, sizeof(header));
+        strncpy(header.magic, MEAD_HISTORY_MAGIC, sizeof(header.magic));
+        header.version = MEAD_HISTORY_VERSION;
+        header.byte_order = MEAD_HISTORY_BYTE_ORDER;
+        ok = mead_write_all(w->fd, (const char *)&header, sizeof(header)) == 0;
+    } else if (ok) {
+        ok = pread(w->fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+             strncmp(header.magic, MEAD_HISTORY_MAGIC, sizeof(header.magic)) == 0 &&
+             header.version == MEAD_HISTORY_VERSION && header.byte_order == MEAD_HISTORY_BYTE_ORDER;
+        off_t end = ok ? intact_end(w->fd, st.st_size) : st.st_size;
+        if (ok && end < st.st_size) {
+            ok = ftruncate(w->fd, end) == 0;
+        }
+    }
+    flock(w->fd, LOCK_UN);
+
+    size_t columns = (kind == MEAD_HISTORY_READINGS) ? sizeof(ReadingColumns) : sizeof(RecipeColumns);
+    w->columns = ok ? malloc(columns) : NULL;
+    w->encoded = ok ? malloc(HISTORY_ENCODED_MAX) : NULL;
+    w->dict = (ok && kind == MEAD_HISTORY_READINGS) ? malloc(MEAD_HISTORY_DICT_MAX * sizeof(*w->dict)) : NULL;
+    if (!w->columns || !w->encoded || (kind == MEAD_HISTORY_READINGS && !w->dict)) {
+        int saved = ok ? ENOMEM : EINVAL;
+        free(w->columns);
+        free(w->encoded);
+        free(w->dict);
+        close(w->fd);
+        memset(w, 0, sizeof(*w));
+        w->fd = -1;
+        errno = saved;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Encodes the buffered rows as one block and appends it. A failed append is
+ * truncated away again, so the file never holds a partial block.
+ * @return int 0 on success, -1 if this or an earlier append failed.
+ */
+int mead_history_writer_flush(MeadHistoryWriter *w) {
+    if (w->rows == 0 || w->error) {
+        w->rows = 0;
+        w->dict_count = 0;
+        return w->error ? -1 : 0;
+    }
+
+    MeadHistoryBlock *header = (MeadHistoryBlock *)w->encoded;
+    unsigned char *payload = w->encoded + sizeof(*header);
+    unsigned char *p = (w->kind == MEAD_HISTORY_READINGS) ? encode_readings(w, payload) : encode_recipes(w, payload);
+
+    memset(header, 0, sizeof(*header));
+    header->magic = MEAD_HISTORY_BLOCK_MAGIC;
+    header->kind = (uint16_t)w->kind;
+    header->series_count = (uint16_t)w->dict_count;
+    header->rows = w->rows;
+    header->payload_size = (uint32_t)(p - payload);
+    header->t_min = w->t_min;
+    header->t_max = w->t_max;
+    header->directory_size = (uint32_t)w->directory_size;
+    header->checksum = checksum(payload, w->directory_size);
+
+    flock(w->fd, LOCK_EX);
+    off_t start = lseek(w->fd, 0, SEEK_END);
+    if (start < 0 || mead_write_all(w->fd, (const char *)w->encoded, (size_t)(p - w->encoded)) != 0) {
+        if (start >= 0 && ftruncate(w->fd, start) != 0) {
+            // Left for the next mead_history_writer_open() to cut off
+        }
+        w->error = 1;
+    }
+    flock(w->fd, LOCK_UN);
+
+    w->rows = 0;
+    w->dict_count = 0;
+    return w->error ? -1 : 0;
+}
+
+// Records the time of a new row, flushing first if the block is full.
+static int begin_row(MeadHistoryWriter *w, int64_t time_ms) {
+    if (w->rows == MEAD_HISTORY_BLOCK_ROWS && mead_history_writer_flush(w) != 0) {
+        return -1;
+    }
+    if (w->rows == 0 || time_ms < w->t_min) w->t_min = time_ms;
+    if (w->rows == 0 || time_ms > w->t_max) w->t_max = time_ms;
+    return 0;
+}
+
+/**
+ * @brief Buffers one reading (gravity and temperature are rounded to the stored scales).
+ * @return int 0 on success, -1 if the writer holds recipes or an append has failed.
+ */
+int mead_history_append_reading(MeadHistoryWriter *w, const MeadHistoryReading *reading) {
+    if (w->kind != MEAD_HISTORY_READINGS || w->error) {
+        return -1;
+    }
+    int slot = -1;
+    for (int d = 0; d < w->dict_count && slot < 0; d++) {
+        if (strcmp(w->dict[d], reading->fermenter) == 0) {
+            slot = d;
+        }
+    }
+    if (slot < 0 && w->dict_count == MEAD_HISTORY_DICT_MAX && mead_history_writer_flush(w) != 0) {
+        return -1;
+    }
+    if (begin_row(w, reading->time_ms) != 0) {
+        return -1;
+    }
+    if (slot < 0 || w->dict_count == 0) {
+        // New name, or the dictionary was emptied by a flush
+        slot = w->dict_count++;
+        size_t len = strnlen(reading->fermenter, MEAD_HISTORY_ID_MAX - 1);
+        memcpy(w->dict[slot], reading->fermenter, len);
+        w->dict[slot][len] = '\0';
+    }
+
+    ReadingColumns *col = w->columns;
+    uint32_t i = w->rows++;
+    col->fermenter[i] = (uint16_t)slot;
+    col->time[i] = reading->time_ms;
+    col->gravity[i] = to_fixed(reading->gravity, MEAD_HISTORY_SG_SCALE);
+    col->has_temperature[i] = !isnan(reading->temperature);
+    col->temperature[i] = col->has_temperature[i] ? to_fixed(reading->temperature, MEAD_HISTORY_TEMP_SCALE) : 0;
+    return 0;
+}
+
+/**
+ * @brief Buffers one calculated recipe (values are rounded to the stored scales).
+ * @return int 0 on success, -1 if the writer holds readings or an append has failed.
+ */
+int mead_history_append_recipe(MeadHistoryWriter *w, const MeadHistoryRecipe *recipe) {
+    if (w->kind != MEAD_HISTORY_RECIPES || w->error || begin_row(w, recipe->time_ms) != 0) {
+        return -1;
+    }
+
+    RecipeColumns *col = w->columns;
+    uint32_t i = w->rows++;
+    col->time[i] = recipe->time_ms;
+    col->flags[i] = (unsigned char)((recipe->unit == MEAD_UNIT_METRIC ? FLAG_METRIC : 0) |
+                                    (recipe->yeast_mode == 2 ? FLAG_TURBO : 0) |
+                                    ((recipe->sweetness & 3) << FLAG_SWEETNESS_SHIFT));
+    col->volume[i] = to_fixed(recipe->volume, MEAD_HISTORY_INPUT_SCALE);
+    col->abv[i] = to_fixed(recipe->abv, MEAD_HISTORY_INPUT_SCALE);
+    col->og[i] = to_fixed(recipe->og, MEAD_HISTORY_SG_SCALE);
+    col->honey[i] = to_fixed(recipe->honey, MEAD_HISTORY_AMOUNT_SCALE);
+    col->water[i] = to_fixed(recipe->water, MEAD_HISTORY_AMOUNT_SCALE);
+    return 0;
+}
+
+/**
+ * @brief Appends the buffered rows if the oldest is MEAD_HISTORY_FLUSH_MS old, so an
+ * idle writer does not hold rows indefinitely. Cheap to call often.
+ * @return int 0 on success, -1 if an append has failed.
+ */
+int mead_history_writer_sync(MeadHistoryWriter *w, int64_t now_ms) {
+    if (w->rows && now_ms - w->t_min >= MEAD_HISTORY_FLUSH_MS) {
+        return mead_history_writer_flush(w);
+    }
+    return w->error ? -1 : 0;
+}
+
+/**
+ * @brief Appends the buffered rows and closes the file.
+ * @return int 0 on success, -1 if any append failed.
+ */
+int mead_history_writer_close(MeadHistoryWriter *w) {
+    if (w->fd < 0) {
+        return 0;
+    }
+    int rc = mead_history_writer_flush(w);
+    close(w->fd);
+    free(w->columns);
+    free(w->encoded);
+    free(w->dict);
+    memset(w, 0, sizeof(*w));
+    w->fd = -1;
+    return rc;
+}
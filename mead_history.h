@@ -0,0 +1,153 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+#ifndef MEAD_HISTORY_H
+#define MEAD_HISTORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mead_core.h"
+
+// Long-term history of telemetry readings and calculated recipes. The file is a
+// header followed by self-contained blocks that are only ever appended. Each block
+// holds up to MEAD_HISTORY_BLOCK_ROWS rows of one kind, stored column by column:
+// values become fixed-point integers, each column is delta-encoded and every delta
+// is a zigzag varint. Readings are split into one series per fermenter, each with
+// its own time (delta of delta), gravity and temperature columns, so a sensor
+// reporting at a steady rate costs a few bytes per reading.
+//
+// A block's header records its time range and the size of its directory: the
+// column sizes, plus the name, row count and checksum of every series in a
+// readings block. Readers map the file read-only and build a sparse index of one
+// entry per block from the headers alone. A range query decodes only the blocks
+// whose time range overlaps it, and a query for one fermenter decodes only that
+// fermenter's series in them. Readings come out block by block, grouped by
+// fermenter within a block.
+//
+// Writers buffer one block in memory and append it with a single write() to a file
+// opened with O_APPEND, so several writers (threads or processes) may share a file.
+// A block torn by a crash is cut off the next time a writer opens the file. Files
+// use the byte order of the machine that wrote them.
+
+#define MEAD_HISTORY_MAGIC "MEADHST"
+#define MEAD_HISTORY_VERSION 1
+#define MEAD_HISTORY_BYTE_ORDER 0x01020304u
+#define MEAD_HISTORY_BLOCK_MAGIC 0x4b4c4248u // "HBLK"
+
+#define MEAD_HISTORY_BLOCK_ROWS 4096   // Rows per block
+#define MEAD_HISTORY_DICT_MAX 256      // Fermenter series per readings block
+#define MEAD_HISTORY_ID_MAX 32         // Longest fermenter name, including the NUL
+#define MEAD_HISTORY_FLUSH_MS 10000    // mead_history_writer_sync() appends rows older than this
+
+// Fixed-point scales of the stored columns (values are rounded to these)
+#define MEAD_HISTORY_SG_SCALE 10000    // Gravity and OG: 0.0001
+#define MEAD_HISTORY_TEMP_SCALE 100    // Temperature: 0.01 degrees
+#define MEAD_HISTORY_INPUT_SCALE 100   // Volume and ABV: 0.01
+#define MEAD_HISTORY_AMOUNT_SCALE 1000 // Honey and water: 0.001
+
+typedef enum {
+    MEAD_HISTORY_READINGS = 1, // MeadHistoryReading rows
+    MEAD_HISTORY_RECIPES = 2   // MeadHistoryRecipe rows
+} MeadHistoryKind;
+
+typedef struct {
+    char magic[8];         // MEAD_HISTORY_MAGIC, NUL-padded
+    uint32_t version;      // MEAD_HISTORY_VERSION
+    uint32_t byte_order;   // MEAD_HISTORY_BYTE_ORDER as stored by the writer
+    uint64_t reserved[2];
+} MeadHistoryHeader;
+
+typedef struct {
+    uint32_t magic;        // MEAD_HISTORY_BLOCK_MAGIC
+    uint16_t kind;         // MeadHistoryKind
+    uint16_t series_count; // Fermenter series (readings blocks)
+    uint32_t rows;
+    uint32_t payload_size; // Bytes after this header
+    int64_t t_min;         // Earliest and latest row time, ms since the epoch
+    int64_t t_max;
+    uint32_t checksum;     // FNV-1a of the directory (a recipes block: the whole payload)
+    uint32_t directory_size; // Bytes at the start of the payload
+} MeadHistoryBlock;
+
+typedef struct {
+    char fermenter[MEAD_HISTORY_ID_MAX];
+    int64_t time_ms;       // Milliseconds since the epoch (UTC)
+    double gravity;        // SG
+    double temperature;    // Celsius, or NAN if not reported
+} MeadHistoryReading;
+
+typedef struct {
+    int64_t time_ms;       // When the recipe was calculated
+    MeadUnit unit;
+    double volume;
+    double abv;
+    MeadSweetness sweetness;
+    int yeast_mode;        // 1 for Standard Yeast, 2 for Turbo Yeast
+    double og;
+    double honey;          // lbs or kg, like MeadResult
+    double water;          // gallons or liters
+} MeadHistoryRecipe;
+
+// One index entry per block.
+typedef struct {
+    size_t offset;         // Of the block header in the mapping
+    int64_t t_min;
+    int64_t t_max;
+    uint32_t rows;
+    uint16_t kind;
+} MeadHistoryIndexEntry;
+
+typedef struct {
+    void *map;
+    size_t size;
+    MeadHistoryIndexEntry *index; // In file order
+    size_t blocks;
+} MeadHistory;
+
+// Rows to return: times in [from_ms, to_ms], and only one fermenter if not NULL.
+typedef struct {
+    int64_t from_ms;
+    int64_t to_ms;
+    const char *fermenter;
+} MeadHistoryQuery;
+
+// Called once per matching row, in file order; a non-zero return stops the scan.
+typedef int (*MeadHistoryReadingFn)(const MeadHistoryReading *reading, void *user);
+typedef int (*MeadHistoryRecipeFn)(const MeadHistoryRecipe *recipe, void *user);
+
+typedef struct {
+    int fd;
+    int error;                     // Sticky: non-zero once an append has failed
+    MeadHistoryKind kind;
+    uint32_t rows;                 // Buffered rows
+    int64_t t_min;
+    int64_t t_max;
+    int dict_count;
+    char (*dict)[MEAD_HISTORY_ID_MAX]; // Fermenter names of the buffered readings
+    void *columns;                 // Buffered rows, column by column (see mead_history.c)
+    size_t directory_size;         // Of the block being encoded
+    unsigned char *encoded;        // Space for one encoded block
+} MeadHistoryWriter;
+
+int64_t mead_history_now_ms(void);
+
+int mead_history_open(MeadHistory *history, const char *path);
+void mead_history_close(MeadHistory *history);
+long mead_history_scan_readings(const MeadHistory *history, const MeadHistoryQuery *query,
+                                MeadHistoryReadingFn fn, void *user);
+long mead_history_scan_recipes(const MeadHistory *history, const MeadHistoryQuery *query,
+                               MeadHistoryRecipeFn fn, void *user);
+size_t mead_history_latest_recipes(const MeadHistory *history, MeadHistoryRecipe *out, size_t max);
+
+int mead_history_writer_open(MeadHistoryWriter *w, const char *path, MeadHistoryKind kind);
+int mead_history_append_reading(MeadHistoryWriter *w, const MeadHistoryReading *reading);
+int mead_history_append_recipe(MeadHistoryWriter *w, const MeadHistoryRecipe *recipe);
+int mead_history_writer_flush(MeadHistoryWriter *w);
+int mead_history_writer_sync(MeadHistoryWriter *w, int64_t now_ms);
+int mead_history_writer_close(MeadHistoryWriter *w);
+
+#endif // MEAD_HISTORY_H
@@ -0,0 +1,278 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mead_honeydb.h"
+#include "mead_record.h"
+
+// Largest measured PPG accepted when building; pure sucrose is about 46.
+#define HONEYDB_MAX_PPG 50.0
+
+// --- Reading ---
+
+/**
+ * @brief Maps a honey database file and validates its header.
+ * @param db Handle to fill; unchanged on failure.
+ * @param path Database file built by mead_honeydb_build().
+ * @return int 0 on success, -1 if the file cannot be mapped or is not a valid database.
+ */
+int mead_honeydb_open(MeadHoneyDb *db, const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(MeadHoneyDbHeader)) {
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // The mapping keeps the file alive
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+
+    const MeadHoneyDbHeader *header = map;
+    size_t size = (size_t)st.st_size;
+    if (strncmp(header->magic, MEAD_HONEYDB_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != MEAD_HONEYDB_VERSION || header->byte_order != MEAD_HONEYDB_BYTE_ORDER ||
+        header->record_size != sizeof(MeadHoneyLot) ||
+        (size - sizeof(*header)) / sizeof(MeadHoneyLot) < header->count) {
+        munmap(map, size);
+        return -1;
+    }
+
+    db->map = map;
+    db->size = size;
+    db->lots = (const MeadHoneyLot *)(header + 1);
+    db->count = header->count;
+    return 0;
+}
+
+void mead_honeydb_close(MeadHoneyDb *db) {
+    if (db->map) {
+        munmap(db->map, db->size);
+    }
+    memset(db, 0, sizeof(*db));
+}
+
+static int compare_lot_id(const char *lot_id, const MeadHoneyLot *lot) {
+    return strncmp(lot_id, lot->lot_id, MEAD_LOT_ID_MAX);
+}
+
+/**
+ * @brief Finds a lot by ID with a binary search over the mapped records.
+ * @return const MeadHoneyLot* The lot (pointing into the mapping), or NULL if not found.
+ */
+const MeadHoneyLot *mead_honeydb_find(const MeadHoneyDb *db, const char *lot_id) {
+    size_t lo = 0, hi = db->count;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int cmp = compare_lot_id(lot_id, &db->lots[mid]);
+        if (cmp == 0) {
+            return &db->lots[mid];
+        }
+        if (cmp < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Builds the model for a lot: its measured PPG, and honey displacement from its
+ * density (1 kg displaces 1/density liters). Everything else is copied from base.
+ * @param lot A lot from mead_honeydb_find().
+ * @param base Model supplying the remaining parameters, e.g. &MEAD_DEFAULT_MODEL.
+ * @param out Model to fill (may be the same object as base).
+ */
+void mead_honey_lot_model(const MeadHoneyLot *lot, const MeadModel *base, MeadModel *out) {
+    if (out != base) {
+        *out = *base;
+    }
+    out->ppg = lot->ppg;
+    out->displacement_l_per_kg = 1.0 / lot->density;
+    out->displacement_gal_per_10_lbs = 10.0 / base->kg_to_lbs / lot->density * base->l_to_gal;
+}
+
+/**
+ * @brief Resolves a record's lot ID for the batch, service and co-process paths.
+ * @param db Open database, or NULL if none was loaded.
+ * @param lot_id Lot ID from the record; "" means the default model.
+ * @param lot Output: the lot, or NULL for the default model.
+ * @return const char* NULL on success, otherwise an error message.
+ */
+const char *mead_honeydb_resolve(const MeadHoneyDb *db, const char *lot_id, const MeadHoneyLot **lot) {
+    *lot = NULL;
+    if (*lot_id == '\0') {
+        return NULL;
+    }
+    if (!db) {
+        return "honey lot given but no honey database loaded (use --honeydb)";
+    }
+    *lot = mead_honeydb_find(db, lot_id);
+    return *lot ? NULL : "unknown honey lot";
+}
+
+// --- Building ---
+
+// A parsed lot and the CSV line it came from (for duplicate ID errors after sorting).
+typedef struct {
+    MeadHoneyLot lot;
+    long line;
+} BuildEntry;
+
+static int compare_entries(const void *a, const void *b) {
+    return strncmp(((const BuildEntry *)a)->lot.lot_id, ((const BuildEntry *)b)->lot.lot_id, MEAD_LOT_ID_MAX);
+}
+
+/**
+ * @brief Parses one CSV line: lot_id,varietal,ppg,moisture,density.
+ * @return int 0 on success, -1 if a field is missing or out of range.
+ */
+static int parse_lot_line(char *line, MeadHoneyLot *lot) {
+    char *fields[5];
+    int count = 0;
+
+    for (char *field = line; field && count < 5; count++) {
+        fields[count] = field;
+        field = strchr(field, ',');
+        if (field) *field++ = '\0';
+    }
+    if (count != 5 || strchr(fields[4], ',')) {
+        return -1;
+    }
+    for (int i = 0; i < 5; i++) {
+        fields[i] = mead_trim_field(fields[i]);
+    }
+
+    char *end[3];
+    memset(lot, 0, sizeof(*lot));
+    if (*fields[0] == '\0' || strlen(fields[0]) >= MEAD_LOT_ID_MAX || strlen(fields[1]) >= MEAD_VARIETAL_MAX) {
+        return -1;
+    }
+    strcpy(lot->lot_id, fields[0]);
+    strcpy(lot->varietal, fields[1]);
+    lot->ppg = strtod(fields[2], &end[0]);
+    lot->moisture = strtod(fields[3], &end[1]);
+    lot->density = strtod(fields[4], &end[2]);
+
+    for (int i = 0; i < 3; i++) {
+        if (end[i] == fields[i + 2] || *end[i] != '\0') {
+            return -1;
+        }
+    }
+    if (!(lot->ppg > 0.0 && lot->ppg <= HONEYDB_MAX_PPG) || !(lot->moisture >= 0.0 && lot->moisture < 100.0) ||
+        !(lot->density > 0.0)) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Converts a CSV lot list into a database file. The file is written next to
+ * db_path and renamed into place, so a running service never maps a half-written file.
+ * Blank lines, '#' comments and a "lot_id,..." header row are skipped.
+ * @param csv_path Input CSV: lot_id,varietal,ppg,moisture,density.
+ * @param db_path Output database file.
+ * @param error_line Output: the offending line on a parse error or duplicate lot ID, else 0.
+ * @return int The number of lots written, or -1 on error.
+ */
+int mead_honeydb_build(const char *csv_path, const char *db_path, long *error_line) {
+    FILE *in = fopen(csv_path, "r");
+    BuildEntry *entries = NULL;
+    size_t count = 0, cap = 0;
+    char line[256];
+    long line_no = 0;
+
+    *error_line = 0;
+    if (!in) {
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), in)) {
+        line_no++;
+        char *text = mead_trim_space(line);
+        if (*text == '\0' || *text == '#' || (line_no == 1 && strncasecmp(text, "lot_id", 6) == 0)) {
+            continue;
+        }
+
+        if (count == cap) {
+            cap = cap ? cap * 2 : 64;
+            BuildEntry *grown = realloc(entries, cap * sizeof(*entries));
+            if (!grown) {
+                goto fail;
+            }
+            entries = grown;
+        }
+        if (parse_lot_line(text, &entries[count].lot) != 0) {
+            *error_line = line_no;
+            goto fail;
+        }
+        entries[count++].line = line_no;
+    }
+    if (ferror(in) || count > UINT32_MAX) {
+        goto fail;
+    }
+    fclose(in);
+    in = NULL;
+
+    qsort(entries, count, sizeof(*entries), compare_entries);
+    for (size_t i = 1; i < count; i++) {
+        if (compare_entries(&entries[i - 1], &entries[i]) == 0) {
+            *error_line = (entries[i - 1].line > entries[i].line) ? entries[i - 1].line : entries[i].line;
+            goto fail;
+        }
+    }
+
+    char tmp_path[4096];
+    if ((size_t)snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", db_path) >= sizeof(tmp_path)) {
+        goto fail;
+    }
+    FILE *out = fopen(tmp_path, "wb");
+    if (!out) {
+        goto fail;
+    }
+
+    MeadHoneyDbHeader header;
+    memset(&header, 0, sizeof(header));
+    strncpy(header.magic, MEAD_HONEYDB_MAGIC, sizeof(header.magic));
+    header.version = MEAD_HONEYDB_VERSION;
+    header.byte_order = MEAD_HONEYDB_BYTE_ORDER;
+    header.count = (uint32_t)count;
+    header.record_size = sizeof(MeadHoneyLot);
+
+    int ok = fwrite(&header, sizeof(header), 1, out) == 1;
+    for (size_t i = 0; i < count && ok; i++) {
+        ok = fwrite(&entries[i].lot, sizeof(MeadHoneyLot), 1, out) == 1;
+    }
+    if (fclose(out) != 0 || !ok || rename(tmp_path, db_path) != 0) {
+        unlink(tmp_path);
+        goto fail;
+    }
+    free(entries);
+    return (int)count;
+
+fail:
+    if (in) {
+        fclose(in);
+    }
+    free(entries);
+    return -1;
+}
+
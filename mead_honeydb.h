@@ -0,0 +1,62 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+#ifndef MEAD_HONEYDB_H
+#define MEAD_HONEYDB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mead_core.h"
+
+// Honey lot database. Measured properties per lot replace the fixed 35 PPG and
+// displacement assumptions. The on-disk file is a header followed by fixed-size
+// lot records sorted by lot ID; it is memory-mapped read-only, so opening it costs
+// one mmap() regardless of size, lookups are a binary search over the mapping, and
+// any number of threads may read it without locking.
+//
+// Files are built from CSV (lot_id,varietal,ppg,moisture,density) with
+// mead_honeydb_build(). They use the byte order of the machine that built them.
+
+#define MEAD_HONEYDB_MAGIC "MEADHDB"
+#define MEAD_HONEYDB_VERSION 1
+#define MEAD_HONEYDB_BYTE_ORDER 0x01020304u
+
+#define MEAD_LOT_ID_MAX 24   // Including the terminating NUL
+#define MEAD_VARIETAL_MAX 24 // Including the terminating NUL
+
+typedef struct {
+    char magic[8];         // MEAD_HONEYDB_MAGIC, NUL-padded
+    uint32_t version;      // MEAD_HONEYDB_VERSION
+    uint32_t byte_order;   // MEAD_HONEYDB_BYTE_ORDER as stored by the writer
+    uint32_t count;        // Number of lot records
+    uint32_t record_size;  // sizeof(MeadHoneyLot)
+    uint64_t reserved;
+} MeadHoneyDbHeader;
+
+typedef struct {
+    char lot_id[MEAD_LOT_ID_MAX];      // Sort key, NUL-padded
+    char varietal[MEAD_VARIETAL_MAX];  // e.g. "Clover", "Buckwheat"
+    double ppg;                        // Measured gravity points per lb per US gallon
+    double moisture;                   // Water content, percent (informational)
+    double density;                    // kg per liter
+} MeadHoneyLot;
+
+typedef struct {
+    void *map;
+    size_t size;
+    const MeadHoneyLot *lots;
+    uint32_t count;
+} MeadHoneyDb;
+
+int mead_honeydb_open(MeadHoneyDb *db, const char *path);
+void mead_honeydb_close(MeadHoneyDb *db);
+const MeadHoneyLot *mead_honeydb_find(const MeadHoneyDb *db, const char *lot_id);
+const char *mead_honeydb_resolve(const MeadHoneyDb *db, const char *lot_id, const MeadHoneyLot **lot);
+void mead_honey_lot_model(const MeadHoneyLot *lot, const MeadModel *base, MeadModel *out);
+int mead_honeydb_build(const char *csv_path, const char *db_path, long *error_line);
+
+#endif // MEAD_HONEYDB_H
@@ -0,0 +1,131 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+#include "mead_core.h"
+#include "mead_inverse.h"
+
+// Per-element helpers shared by the single and bulk solvers. "metric" is 0 or 1 and
+// only selects constants, so the bulk loops below stay branch-free. Like the forward
+// calculation, everything stays in the recipe's own units (see MEAD_IMPERIAL_YIELD).
+
+// Point-volumes (gravity points per gallon times gallons or liters) the honey supplies.
+static inline double honey_points(int metric, double honey) {
+    return honey * (metric ? MEAD_METRIC_YIELD : MEAD_IMPERIAL_YIELD);
+}
+
+static inline double water_left(int metric, double volume, double honey) {
+    double water = volume - honey / (metric ? MEAD_METRIC_HONEY_STEP : MEAD_IMPERIAL_HONEY_STEP) *
+                            (metric ? MEAD_METRIC_DISPLACEMENT : MEAD_IMPERIAL_DISPLACEMENT);
+    return (water > 0.0) ? water : 0.0;
+}
+
+/**
+ * @brief Largest batch volume the honey can bring to the table OG for the target ABV.
+ * @param unit Unit system of honey (lbs/kg) and of the returned volume (gallons/liters).
+ * @param honey Honey available, > 0.
+ * @param abv Target ABV, > 0 (fractional values use the formula path).
+ * @param sweetness Sweetness level.
+ * @param is_turbo Flag: 1 for Standard, 2 for Turbo Yeast.
+ * @param fg_table FG per sweetness level, e.g. MEAD_DEFAULT_FG_TABLE.
+ * @param out Result struct to fill.
+ * @return MeadStatus MEAD_OK, MEAD_ERR_SWEETNESS or MEAD_ERR_RANGE.
+ */
+MeadStatus mead_solve_volume(MeadUnit unit, double honey, double abv, MeadSweetness sweetness, int is_turbo,
+                             const double *fg_table, MeadInverseResult *out) {
+    if ((unsigned)sweetness >= MEAD_SWEETNESS_COUNT) {
+        return MEAD_ERR_SWEETNESS;
+    }
+    if (!(honey > 0.0) || !(abv > 0.0)) {
+        return MEAD_ERR_RANGE;
+    }
+
+    int metric = (unit == MEAD_UNIT_METRIC);
+    MeadOgEntry entry = mead_og_entry(fg_table, abv, sweetness, is_turbo);
+
+    // volume = honey point-volumes / gravity points per gallon
+    out->volume = honey_points(metric, honey) / entry.gravity_points;
+    out->abv = abv;
+    out->og = entry.og;
+    out->fg = mead_final_gravity(fg_table, sweetness, is_turbo);
+    out->water = water_left(metric, out->volume, honey);
+    out->water_clamped = !(out->water > 0.0);
+    out->og_too_high = entry.og > MEAD_MAX_OG;
+    return MEAD_OK;
+}
+
+/**
+ * @brief ABV reached when all of the honey goes into a batch of the given volume.
+ * The OG is not rounded to 1.XXX here, so the ABV is exact for the given inputs.
+ * @param unit Unit system of honey (lbs/kg) and volume (gallons/liters).
+ * @param honey Honey available, > 0.
+ * @param volume Batch volume, > 0.
+ * @param sweetness Sweetness level.
+ * @param is_turbo Flag: 1 for Standard, 2 for Turbo Yeast.
+ * @param fg_table FG per sweetness level, e.g. MEAD_DEFAULT_FG_TABLE.
+ * @param out Result struct to fill; out->abv is negative if the honey cannot even reach the FG.
+ * @return MeadStatus MEAD_OK, MEAD_ERR_SWEETNESS or MEAD_ERR_RANGE.
+ */
+MeadStatus mead_solve_abv(MeadUnit unit, double honey, double volume, MeadSweetness sweetness, int is_turbo,
+                          const double *fg_table, MeadInverseResult *out) {
+    if ((unsigned)sweetness >= MEAD_SWEETNESS_COUNT) {
+        return MEAD_ERR_SWEETNESS;
+    }
+    if (!(honey > 0.0) || !(volume > 0.0)) {
+        return MEAD_ERR_RANGE;
+    }
+
+    double fg = mead_final_gravity(fg_table, sweetness, is_turbo);
+    mead_solve_abv_batch(1, (const unsigned char[]){ (unsigned char)unit }, &honey, &volume, &fg,
+                         &out->og, &out->abv, &out->water);
+    out->volume = volume;
+    out->fg = fg;
+    out->water_clamped = !(out->water > 0.0);
+    out->og_too_high = out->og > MEAD_MAX_OG;
+    return MEAD_OK;
+}
+
+/**
+ * @brief Bulk mead_solve_volume() over an inventory list with precomputed OGs.
+ * @param count Number of entries.
+ * @param units MeadUnit value per entry.
+ * @param honey Honey available per entry, lbs or kg.
+ * @param og Target OG per entry (> 1.000).
+ * @param volume Output: largest batch volume, gallons or liters.
+ * @param water Output: water to top off, clamped at zero.
+ */
+void mead_solve_volume_batch(size_t count, const unsigned char *units, const double *honey, const double *og,
+                             double *volume, double *water) {
+    for (size_t i = 0; i < count; i++) {
+        int metric = (units[i] == MEAD_UNIT_METRIC);
+        double gravity_points = (og[i] - 1.000) * 1000.0;
+
+        volume[i] = honey_points(metric, honey[i]) / gravity_points;
+        water[i] = water_left(metric, volume[i], honey[i]);
+    }
+}
+
+/**
+ * @brief Bulk mead_solve_abv() over an inventory list.
+ * @param count Number of entries.
+ * @param units MeadUnit value per entry.
+ * @param honey Honey available per entry, lbs or kg.
+ * @param volume Batch volume per entry, gallons or liters.
+ * @param fg Assumed FG per entry.
+ * @param og Output: resulting Original Gravity (unrounded).
+ * @param abv Output: ABV reached, (OG - FG) * 131.25.
+ * @param water Output: water to top off, clamped at zero.
+ */
+void mead_solve_abv_batch(size_t count, const unsigned char *units, const double *honey, const double *volume,
+                          const double *fg, double *og, double *abv, double *water) {
+    for (size_t i = 0; i < count; i++) {
+        int metric = (units[i] == MEAD_UNIT_METRIC);
+        double gravity_points = honey_points(metric, honey[i]) / volume[i];
+
+        og[i] = 1.000 + gravity_points / 1000.0;
+        abv[i] = (og[i] - fg[i]) * ABV_FACTOR;
+        water[i] = water_left(metric, volume[i], honey[i]);
+    }
+}
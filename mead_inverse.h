@@ -0,0 +1,42 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+#ifndef MEAD_INVERSE_H
+#define MEAD_INVERSE_H
+
+#include <stddef.h>
+
+#include "mead_core.h"
+
+// Inverse solver: starts from the honey on hand instead of the target ABV.
+// The forward relations in mead_compute_ingredients() are linear in volume and
+// gravity points, so both questions have closed-form answers:
+//   honey = (OG - 1.000) * 1000 * volume_gal / PPG   (lbs; kg divides by KG_TO_LBS)
+//   ABV   = (OG - FG) * 131.25
+
+typedef struct {
+    double volume;     // Batch volume, Gallons or Liters
+    double abv;        // ABV reached
+    double og;         // Original Gravity (table value when solving for volume)
+    double fg;         // Assumed Final Gravity
+    double water;      // Water to top off, clamped at zero
+    int water_clamped; // Non-zero if the honey alone meets or exceeds the batch volume
+    int og_too_high;   // Non-zero if og > MEAD_MAX_OG
+} MeadInverseResult;
+
+MeadStatus mead_solve_volume(MeadUnit unit, double honey, double abv, MeadSweetness sweetness, int is_turbo,
+                             const double *fg_table, MeadInverseResult *out);
+MeadStatus mead_solve_abv(MeadUnit unit, double honey, double volume, MeadSweetness sweetness, int is_turbo,
+                          const double *fg_table, MeadInverseResult *out);
+
+// Bulk variants over structure-of-arrays inventory lists. The loops are branch-free so
+// the compiler can vectorize them; og/fg come from mead_og_entry()/mead_final_gravity().
+void mead_solve_volume_batch(size_t count, const unsigned char *units, const double *honey, const double *og,
+                             double *volume, double *water);
+void mead_solve_abv_batch(size_t count, const unsigned char *units, const double *honey, const double *volume,
+                          const double *fg, double *og, double *abv, double *water);
+
+#endif // MEAD_INVERSE_H
@@ -0,0 +1,461 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+#include <stdint.h>
+#include <string.h>
+
+#include "mead_core.h"
+#include "mead_kernel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MEAD_HAVE_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define MEAD_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Elements checked at a time for a single unit system
+#define GROUP_TILE 256
+
+// --- Element Steps ---
+
+// Every step takes the gravity points per gallon of its elements and unit system
+// coefficients (see MEAD_IMPERIAL_YIELD). The unit-specialized loops below pass the
+// coefficients as literal constants, so each is folded to its unit; the mixed-unit
+// loops pick them per lane, which gives the same values and the same results.
+
+/**
+ * @brief Computes one element; the reference every SIMD step must match bit for bit
+ * (it is also the order mead_compute_ingredients() uses).
+ */
+static inline void step_one(double volume, double points_per_gal, double yield, double honey_step,
+                            double displacement, double to_gal, double *honey, double *water, double *gravity_points) {
+    double point_volumes = points_per_gal * volume;
+    double honey_amount = point_volumes / yield;
+    double water_left = volume - honey_amount / honey_step * displacement;
+
+    *honey = honey_amount;
+    *water = (water_left > 0.0) ? water_left : 0.0;
+    if (gravity_points) {
+        *gravity_points = point_volumes * to_gal;
+    }
+}
+
+// Scalar input conversions: target OG or integer points to gravity points per gallon.
+static inline double og_ppg(const double *og, size_t i) {
+    return (og[i] - 1.000) * 1000.0;
+}
+
+static inline double points_ppg(const int32_t *og_points, size_t i) {
+    return (double)og_points[i];
+}
+
+#ifdef MEAD_HAVE_X86
+
+__attribute__((target("sse2")))
+static inline void step_two_sse2(const double *volume, __m128d points_per_gal, __m128d yield, __m128d honey_step,
+                                 __m128d displacement, __m128d to_gal, double *honey, double *water,
+                                 double *gravity_points) {
+    __m128d v = _mm_loadu_pd(volume);
+    __m128d point_volumes = _mm_mul_pd(points_per_gal, v);
+    __m128d honey_amount = _mm_div_pd(point_volumes, yield);
+    __m128d honey_volume = _mm_mul_pd(_mm_div_pd(honey_amount, honey_step), displacement);
+
+    _mm_storeu_pd(honey, honey_amount);
+    // maxpd returns its second operand for NaN and +-0.0, matching the scalar clamp
+    _mm_storeu_pd(water, _mm_max_pd(_mm_sub_pd(v, honey_volume), _mm_setzero_pd()));
+    if (gravity_points) {
+        _mm_storeu_pd(gravity_points, _mm_mul_pd(point_volumes, to_gal));
+    }
+}
+
+__attribute__((target("sse2")))
+static inline __m128d og_ppg_sse2(const double *og) {
+    return _mm_mul_pd(_mm_sub_pd(_mm_loadu_pd(og), _mm_set1_pd(1.000)), _mm_set1_pd(1000.0));
+}
+
+__attribute__((target("sse2")))
+static inline __m128d points_ppg_sse2(const int32_t *og_points) {
+    return _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i *)og_points));
+}
+
+// All-ones lanes for Metric elements
+__attribute__((target("sse2")))
+static inline __m128d metric_mask_sse2(const unsigned char *units) {
+    return _mm_castsi128_pd(_mm_set_epi64x(-(int64_t)(units[1] == MEAD_UNIT_METRIC),
+                                           -(int64_t)(units[0] == MEAD_UNIT_METRIC)));
+}
+
+// SSE2 has no blendv, so lanes are selected with and/andnot/or.
+__attribute__((target("sse2")))
+static inline __m128d pick_sse2(__m128d metric, double if_metric, double if_imperial) {
+    return _mm_or_pd(_mm_and_pd(metric, _mm_set1_pd(if_metric)), _mm_andnot_pd(metric, _mm_set1_pd(if_imperial)));
+}
+
+__attribute__((target("avx2")))
+static inline void step_four_avx2(const double *volume, __m256d points_per_gal, __m256d yield, __m256d honey_step,
+                                  __m256d displacement, __m256d to_gal, double *honey, double *water,
+                                  double *gravity_points) {
+    __m256d v = _mm256_loadu_pd(volume);
+    __m256d point_volumes = _mm256_mul_pd(points_per_gal, v);
+    __m256d honey_amount = _mm256_div_pd(point_volumes, yield);
+    __m256d honey_volume = _mm256_mul_pd(_mm256_div_pd(honey_amount, honey_step), displacement);
+
+    _mm256_storeu_pd(honey, honey_amount);
+    // maxpd returns its second operand for NaN and +-0.0, matching the scalar clamp
+    _mm256_storeu_pd(water, _mm256_max_pd(_mm256_sub_pd(v, honey_volume), _mm256_setzero_pd()));
+    if (gravity_points) {
+        _mm256_storeu_pd(gravity_points, _mm256_mul_pd(point_volumes, to_gal));
+    }
+}
+
+__attribute__((target("avx2")))
+static inline __m256d og_ppg_avx2(const double *og) {
+    return _mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(og), _mm256_set1_pd(1.000)), _mm256_set1_pd(1000.0));
+}
+
+// Four int32 points fill one 128-bit load where four double OGs need 256 bits
+__attribute__((target("avx2")))
+static inline __m256d points_ppg_avx2(const int32_t *og_points) {
+    return _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *)og_points));
+}
+
+__attribute__((target("avx2")))
+static inline __m256d metric_mask_avx2(const unsigned char *units) {
+    int32_t unit_bytes;
+    memcpy(&unit_bytes, units, sizeof(unit_bytes));
+    __m256i unit_lanes = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(unit_bytes));
+    return _mm256_castsi256_pd(_mm256_cmpeq_epi64(unit_lanes, _mm256_set1_epi64x(MEAD_UNIT_METRIC)));
+}
+
+__attribute__((target("avx2")))
+static inline __m256d pick_avx2(__m256d metric, double if_metric, double if_imperial) {
+    return _mm256_blendv_pd(_mm256_set1_pd(if_imperial), _mm256_set1_pd(if_metric), metric);
+}
+
+#endif // MEAD_HAVE_X86
+
+#ifdef MEAD_HAVE_NEON
+
+static inline void step_two_neon(const double *volume, float64x2_t points_per_gal, float64x2_t yield,
+                                 float64x2_t honey_step, float64x2_t displacement, float64x2_t to_gal,
+                                 double *honey, double *water, double *gravity_points) {
+    const float64x2_t zero = vdupq_n_f64(0.0);
+    float64x2_t v = vld1q_f64(volume);
+    float64x2_t point_volumes = vmulq_f64(points_per_gal, v);
+    float64x2_t honey_amount = vdivq_f64(point_volumes, yield);
+    float64x2_t honey_volume = vmulq_f64(vdivq_f64(honey_amount, honey_step), displacement);
+    float64x2_t water_left = vsubq_f64(v, honey_volume);
+
+    vst1q_f64(honey, honey_amount);
+    // vmaxq_f64 propagates NaN, so clamp with a compare like the scalar code does
+    vst1q_f64(water, vbslq_f64(vcgtq_f64(water_left, zero), water_left, zero));
+    if (gravity_points) {
+        vst1q_f64(gravity_points, vmulq_f64(point_volumes, to_gal));
+    }
+}
+
+static inline float64x2_t og_ppg_neon(const double *og) {
+    return vmulq_f64(vsubq_f64(vld1q_f64(og), vdupq_n_f64(1.000)), vdupq_n_f64(1000.0));
+}
+
+static inline float64x2_t points_ppg_neon(const int32_t *og_points) {
+    return vcvtq_f64_s64(vmovl_s32(vld1_s32(og_points)));
+}
+
+static inline uint64x2_t metric_mask_neon(const unsigned char *units) {
+    return vcombine_u64(vcreate_u64(units[0] == MEAD_UNIT_METRIC ? UINT64_MAX : 0),
+                        vcreate_u64(units[1] == MEAD_UNIT_METRIC ? UINT64_MAX : 0));
+}
+
+static inline float64x2_t pick_neon(uint64x2_t metric, double if_metric, double if_imperial) {
+    return vbslq_f64(metric, vdupq_n_f64(if_metric), vdupq_n_f64(if_imperial));
+}
+
+#endif // MEAD_HAVE_NEON
+
+// --- Unit-Specialized Kernels ---
+
+// A loop over count elements of one unit system. in is the double OGs or the int32
+// gravity points, per the kernel's input type.
+typedef void (*UnitLoop)(size_t count, const double *volume, const void *in, double *honey, double *water,
+                         double *gravity_points);
+
+#define DEFINE_SCALAR_LOOP(name, in_t, LOAD, YIELD, HONEY_STEP, DISPLACEMENT, TO_GAL)                                   \
+    static void name(size_t count, const double *volume, const void *input, double *honey, double *water,   \
+                     double *gravity_points) {                                                              \
+        const in_t *in = input;                                                                             \
+        for (size_t i = 0; i < count; i++) {                                                                \
+            step_one(volume[i], LOAD(in, i), YIELD, HONEY_STEP, DISPLACEMENT, TO_GAL, &honey[i], &water[i],             \
+                     gravity_points ? &gravity_points[i] : NULL);                                           \
+        }                                                                                                   \
+    }
+
+// WIDTH elements per STEP, with the coefficients broadcast by SPLAT; the remainder goes
+// through the unit's scalar loop TAIL.
+#define DEFINE_SIMD_LOOP(name, target, in_t, WIDTH, STEP, LOAD, SPLAT, TAIL, YIELD, HONEY_STEP, DISPLACEMENT,    \
+                         TO_GAL)                                                                                \
+    target static void name(size_t count, const double *volume, const void *input, double *honey,           \
+                            double *water, double *gravity_points) {                                        \
+        const in_t *in = input;                                                                             \
+        size_t i = 0;                                                                                       \
+        for (; i + WIDTH <= count; i += WIDTH) {                                                            \
+            STEP(volume + i, LOAD(in + i), SPLAT(YIELD), SPLAT(HONEY_STEP), SPLAT(DISPLACEMENT), SPLAT(TO_GAL), \
+                 honey + i, water + i, gravity_points ? gravity_points + i : NULL);                             \
+        }                                                                                                   \
+        TAIL(count - i, volume + i, in + i, honey + i, water + i, gravity_points ? gravity_points + i : NULL); \
+    }
+
+#ifdef MEAD_HAVE_X86
+#define DEFINE_X86_LOOPS(unit, YIELD, HONEY_STEP, DISPLACEMENT, TO_GAL)                                                   \
+    DEFINE_SIMD_LOOP(og_##unit##_sse2, __attribute__((target("sse2"))), double, 2, step_two_sse2, og_ppg_sse2,   \
+                     _mm_set1_pd, og_##unit##_scalar, YIELD, HONEY_STEP, DISPLACEMENT, TO_GAL)                  \
+    DEFINE_SIMD_LOOP(points_##unit##_sse2, __attribute__((target("sse2"))), int32_t, 2, step_two_sse2,      \
+                     points_ppg_sse2, _mm_set1_pd, points_##unit##_scalar, YIELD, HONEY_STEP, DISPLACEMENT,     \
+                     TO_GAL)                                                                                    \
+    DEFINE_SIMD_LOOP(og_##unit##_avx2, __attribute__((target("avx2"))), double, 4, step_four_avx2, og_ppg_avx2,  \
+                     _mm256_set1_pd, og_##unit##_scalar, YIELD, HONEY_STEP, DISPLACEMENT, TO_GAL)               \
+    DEFINE_SIMD_LOOP(points_##unit##_avx2, __attribute__((target("avx2"))), int32_t, 4, step_four_avx2,     \
+                     points_ppg_avx2, _mm256_set1_pd, points_##unit##_scalar, YIELD, HONEY_STEP, DISPLACEMENT,  \
+                     TO_GAL)
+#else
+#define DEFINE_X86_LOOPS(unit, YIELD, HONEY_STEP, DISPLACEMENT, TO_GAL)
+#endif
+
+#ifdef MEAD_HAVE_NEON
+#define DEFINE_NEON_LOOPS(unit, YIELD, HONEY_STEP, DISPLACEMENT, TO_GAL)                                                  \
+    DEFINE_SIMD_LOOP(og_##unit##_neon, , double, 2, step_two_neon, og_ppg_neon, vdupq_n_f64,                    \
+                     og_##unit##_scalar, YIELD, HONEY_STEP, DISPLACEMENT, TO_GAL)                               \
+    DEFINE_SIMD_LOOP(points_##unit##_neon, , int32_t, 2, step_two_neon, points_ppg_neon, vdupq_n_f64,           \
+                     points_##unit##_scalar, YIELD, HONEY_STEP, DISPLACEMENT, TO_GAL)
+#else
+#define DEFINE_NEON_LOOPS(unit, YIELD, HONEY_STEP, DISPLACEMENT, TO_GAL)
+#endif
+
+// Every loop of one unit system: {og, points} x {scalar, SSE2, AVX2, NEON}.
+#define DEFINE_UNIT_LOOPS(unit, YIELD, HONEY_STEP, DISPLACEMENT, TO_GAL)                                                  \
+    DEFINE_SCALAR_LOOP(og_##unit##_scalar, double, og_ppg, YIELD, HONEY_STEP, DISPLACEMENT, TO_GAL)                     \
+    DEFINE_SCALAR_LOOP(points_##unit##_scalar, int32_t, points_ppg, YIELD, HONEY_STEP, DISPLACEMENT, TO_GAL)            \
+    DEFINE_X86_LOOPS(unit, YIELD, HONEY_STEP, DISPLACEMENT, TO_GAL)                                                     \
+    DEFINE_NEON_LOOPS(unit, YIELD, HONEY_STEP, DISPLACEMENT, TO_GAL)
+
+DEFINE_UNIT_LOOPS(imperial, MEAD_IMPERIAL_YIELD, MEAD_IMPERIAL_HONEY_STEP, MEAD_IMPERIAL_DISPLACEMENT,
+                  MEAD_IMPERIAL_TO_GAL)
+DEFINE_UNIT_LOOPS(metric, MEAD_METRIC_YIELD, MEAD_METRIC_HONEY_STEP, MEAD_METRIC_DISPLACEMENT, MEAD_METRIC_TO_GAL)
+
+// --- Mixed-Unit Kernels ---
+
+// A loop over count elements of either unit system, per units[i].
+typedef void (*MixedLoop)(size_t count, const double *volume, const void *in, const unsigned char *units,
+                          double *honey, double *water, double *gravity_points);
+
+// Coefficients by [metric], for the scalar mixed loops
+static const MeadUnitCoeffs UNIT_COEFFS[2] = {
+    { MEAD_IMPERIAL_YIELD, MEAD_IMPERIAL_HONEY_STEP, MEAD_IMPERIAL_DISPLACEMENT, MEAD_IMPERIAL_TO_GAL },
+    { MEAD_METRIC_YIELD, MEAD_METRIC_HONEY_STEP, MEAD_METRIC_DISPLACEMENT, MEAD_METRIC_TO_GAL },
+};
+
+#define DEFINE_SCALAR_MIXED_LOOP(name, in_t, LOAD)                                                               \
+    static void name(size_t count, const double *volume, const void *input, const unsigned char *units,         \
+                     double *honey, double *water, double *gravity_points) {                                    \
+        const in_t *in = input;                                                                                 \
+        for (size_t i = 0; i < count; i++) {                                                                    \
+            const MeadUnitCoeffs *c = &UNIT_COEFFS[units[i] == MEAD_UNIT_METRIC];                               \
+            step_one(volume[i], LOAD(in, i), c->yield, c->honey_step, c->displacement, c->to_gallons,           \
+                     &honey[i], &water[i], gravity_points ? &gravity_points[i] : NULL);                         \
+        }                                                                                                       \
+    }
+
+// WIDTH elements per STEP, with the coefficients of each lane picked by its MASK lane.
+#define DEFINE_SIMD_MIXED_LOOP(name, target, in_t, WIDTH, STEP, LOAD, MASK, PICK, TAIL)                          \
+    target static void name(size_t count, const double *volume, const void *input, const unsigned char *units,  \
+                            double *honey, double *water, double *gravity_points) {                             \
+        const in_t *in = input;                                                                                 \
+        size_t i = 0;                                                                                           \
+        for (; i + WIDTH <= count; i += WIDTH) {                                                                \
+            __typeof__(MASK(units)) metric = MASK(units + i);                                                   \
+            STEP(volume + i, LOAD(in + i), PICK(metric, MEAD_METRIC_YIELD, MEAD_IMPERIAL_YIELD),                \
+                 PICK(metric, MEAD_METRIC_HONEY_STEP, MEAD_IMPERIAL_HONEY_STEP),                                \
+                 PICK(metric, MEAD_METRIC_DISPLACEMENT, MEAD_IMPERIAL_DISPLACEMENT),                            \
+                 PICK(metric, MEAD_METRIC_TO_GAL, MEAD_IMPERIAL_TO_GAL), honey + i, water + i,                  \
+                 gravity_points ? gravity_points + i : NULL);                                                   \
+        }                                                                                                       \
+        TAIL(count - i, volume + i, in + i, units + i, honey + i, water + i,                                    \
+             gravity_points ? gravity_points + i : NULL);                                                       \
+    }
+
+DEFINE_SCALAR_MIXED_LOOP(og_mixed_scalar, double, og_ppg)
+DEFINE_SCALAR_MIXED_LOOP(points_mixed_scalar, int32_t, points_ppg)
+#ifdef MEAD_HAVE_X86
+DEFINE_SIMD_MIXED_LOOP(og_mixed_sse2, __attribute__((target("sse2"))), double, 2, step_two_sse2, og_ppg_sse2,
+                       metric_mask_sse2, pick_sse2, og_mixed_scalar)
+DEFINE_SIMD_MIXED_LOOP(points_mixed_sse2, __attribute__((target("sse2"))), int32_t, 2, step_two_sse2,
+                       points_ppg_sse2, metric_mask_sse2, pick_sse2, points_mixed_scalar)
+DEFINE_SIMD_MIXED_LOOP(og_mixed_avx2, __attribute__((target("avx2"))), double, 4, step_four_avx2, og_ppg_avx2,
+                       metric_mask_avx2, pick_avx2, og_mixed_scalar)
+DEFINE_SIMD_MIXED_LOOP(points_mixed_avx2, __attribute__((target("avx2"))), int32_t, 4, step_four_avx2,
+                       points_ppg_avx2, metric_mask_avx2, pick_avx2, points_mixed_scalar)
+#endif
+#ifdef MEAD_HAVE_NEON
+DEFINE_SIMD_MIXED_LOOP(og_mixed_neon, , double, 2, step_two_neon, og_ppg_neon, metric_mask_neon, pick_neon,
+                       og_mixed_scalar)
+DEFINE_SIMD_MIXED_LOOP(points_mixed_neon, , int32_t, 2, step_two_neon, points_ppg_neon, metric_mask_neon,
+                       pick_neon, points_mixed_scalar)
+#endif
+
+// The loops of one input type: unit[metric] (0 for US Imperial, 1 for Metric) and mixed.
+typedef struct {
+    UnitLoop unit[2];
+    MixedLoop mixed;
+} InputLoops;
+
+typedef struct {
+    InputLoops og;
+    InputLoops points;
+} KernelLoops;
+
+#define KERNEL_LOOPS_OF(isa)                                                                                     \
+    { { { og_imperial_##isa, og_metric_##isa }, og_mixed_##isa },                                               \
+      { { points_imperial_##isa, points_metric_##isa }, points_mixed_##isa } }
+
+static const KernelLoops KERNEL_LOOPS[] = {
+    [MEAD_KERNEL_SCALAR] = KERNEL_LOOPS_OF(scalar),
+#ifdef MEAD_HAVE_X86
+    [MEAD_KERNEL_SSE2] = KERNEL_LOOPS_OF(sse2),
+    [MEAD_KERNEL_AVX2] = KERNEL_LOOPS_OF(avx2),
+#endif
+#ifdef MEAD_HAVE_NEON
+    [MEAD_KERNEL_NEON] = KERNEL_LOOPS_OF(neon),
+#endif
+};
+
+// --- Grouping ---
+
+/**
+ * @brief Runs a batch in tiles of GROUP_TILE elements. A tile of one unit system (the
+ * usual case for real batches) goes to that system's specialized loop; a mixed tile
+ * goes to the mixed loop, which picks the coefficients per lane.
+ * @param loops Loops of the kernel and input type.
+ * @param in Input array (double OGs or int32 points) of in_size-byte elements.
+ */
+static void run_grouped(const InputLoops *loops, size_t count, const double *volume, const void *in,
+                        size_t in_size, const unsigned char *units, double *honey, double *water,
+                        double *gravity_points) {
+    const char *in_bytes = in;
+
+    for (size_t start = 0; start < count; start += GROUP_TILE) {
+        size_t n = (count - start < GROUP_TILE) ? count - start : GROUP_TILE;
+        const unsigned char *tile_units = units + start;
+        double *gp = gravity_points ? gravity_points + start : NULL;
+        int uniform = (tile_units[0] == MEAD_UNIT_METRIC || tile_units[0] == MEAD_UNIT_US_IMPERIAL);
+        for (size_t i = 1; uniform && i < n; i++) {
+            uniform = (tile_units[i] == tile_units[0]);
+        }
+        if (uniform) {
+            loops->unit[tile_units[0] == MEAD_UNIT_METRIC](n, volume + start, in_bytes + start * in_size,
+                                                           honey + start, water + start, gp);
+        } else {
+            loops->mixed(n, volume + start, in_bytes + start * in_size, tile_units, honey + start, water + start,
+                         gp);
+        }
+    }
+}
+
+// --- Dispatch ---
+
+/**
+ * @brief Returns non-zero if the kernel was compiled in and the running CPU supports it.
+ */
+int mead_kernel_supported(MeadKernel kernel) {
+    switch (kernel) {
+    case MEAD_KERNEL_SCALAR:
+        return 1;
+#ifdef MEAD_HAVE_X86
+    case MEAD_KERNEL_SSE2:
+        return __builtin_cpu_supports("sse2");
+    case MEAD_KERNEL_AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+#ifdef MEAD_HAVE_NEON
+    case MEAD_KERNEL_NEON:
+        return 1; // Advanced SIMD is mandatory on AArch64
+#endif
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @brief Picks the widest kernel supported by the running CPU.
+ */
+MeadKernel mead_kernel_detect(void) {
+    if (mead_kernel_supported(MEAD_KERNEL_AVX2)) return MEAD_KERNEL_AVX2;
+    if (mead_kernel_supported(MEAD_KERNEL_NEON)) return MEAD_KERNEL_NEON;
+    if (mead_kernel_supported(MEAD_KERNEL_SSE2)) return MEAD_KERNEL_SSE2;
+    return MEAD_KERNEL_SCALAR;
+}
+
+/**
+ * @brief Returns a short name for a kernel ("scalar", "sse2", "avx2" or "neon").
+ */
+const char *mead_kernel_name(MeadKernel kernel) {
+    static const char *const names[] = { "scalar", "sse2", "avx2", "neon" };
+    return ((unsigned)kernel < sizeof(names) / sizeof(names[0])) ? names[kernel] : "unknown";
+}
+
+// The loops of a kernel, or of the scalar kernel if it is not supported.
+static const KernelLoops *kernel_loops(MeadKernel kernel) {
+    return mead_kernel_supported(kernel) ? &KERNEL_LOOPS[kernel] : &KERNEL_LOOPS[MEAD_KERNEL_SCALAR];
+}
+
+/**
+ * @brief Computes honey and water for count recipes with a specific kernel.
+ * Falls back to the scalar kernel if the requested one is not supported.
+ * @param kernel Kernel to run.
+ * @param count Number of recipes.
+ * @param volume Batch volumes, Gallons or Liters per units[i].
+ * @param og Target Original Gravities.
+ * @param units MeadUnit value per recipe (MEAD_UNIT_US_IMPERIAL or MEAD_UNIT_METRIC).
+ * @param honey Output: required honey, lbs or kg.
+ * @param water Output: water to top off, gallons or liters, clamped at zero.
+ * @param gravity_points Output: total gravity points needed, or NULL if not wanted.
+ */
+void mead_compute_batch_kernel(MeadKernel kernel, size_t count, const double *volume, const double *og,
+                               const unsigned char *units, double *honey, double *water, double *gravity_points) {
+    run_grouped(&kernel_loops(kernel)->og, count, volume, og, sizeof(*og), units, honey, water, gravity_points);
+}
+
+/**
+ * @brief Computes honey and water for count recipes with the best kernel for this CPU.
+ * See mead_compute_batch_kernel() for the parameters.
+ */
+void mead_compute_batch(size_t count, const double *volume, const double *og, const unsigned char *units,
+                        double *honey, double *water, double *gravity_points) {
+    mead_compute_batch_kernel(mead_kernel_detect(), count, volume, og, units, honey, water, gravity_points);
+}
+
+/**
+ * @brief Computes honey and water from integer gravity points with a specific kernel.
+ * Falls back to the scalar kernel if the requested one is not supported.
+ * @param og_points Target OG per recipe as gravity points per gallon (mead_og_points()).
+ * See mead_compute_batch_kernel() for the other parameters.
+ */
+void mead_compute_batch_points_kernel(MeadKernel kernel, size_t count, const double *volume,
+                                      const int32_t *og_points, const unsigned char *units, double *honey,
+                                      double *water, double *gravity_points) {
+    run_grouped(&kernel_loops(kernel)->points, count, volume, og_points, sizeof(*og_points), units, honey, water,
+                gravity_points);
+}
+
+/**
+ * @brief Computes honey and water from integer gravity points with the best kernel for this CPU.
+ */
+void mead_compute_batch_points(size_t count, const double *volume, const int32_t *og_points,
+                               const unsigned char *units, double *honey, double *water, double *gravity_points) {
+    mead_compute_batch_points_kernel(mead_kernel_detect(), count, volume, og_points, units, honey, water,
+                                     gravity_points);
+}
@@ -0,0 +1,48 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+#ifndef MEAD_KERNEL_H
+#define MEAD_KERNEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Batch honey/water kernels over structure-of-arrays inputs. Every variant performs
+// exactly the same IEEE operations per element as mead_compute_ingredients(), so the
+// SIMD results are bit-identical to the scalar fallback (build with -ffp-contract=off
+// so the compiler cannot fuse multiplies and adds differently in each variant).
+//
+// Each variant is stamped out once per unit system with that system's coefficients
+// (MeadUnitCoeffs) as compile-time constants, so the inner loops never branch on units.
+// Batches are taken a tile at a time: single-unit tiles run the specialized loops and
+// mixed tiles a loop that picks the same coefficients per lane.
+//
+// The _points kernels take the target OG as int32_t gravity points (mead_og_points())
+// instead of a double OG. That skips the (og - 1.000) * 1000 step, halves the OG input
+// bandwidth, and gives results that depend only on the integer points.
+
+typedef enum {
+    MEAD_KERNEL_SCALAR = 0,
+    MEAD_KERNEL_SSE2,
+    MEAD_KERNEL_AVX2,
+    MEAD_KERNEL_NEON
+} MeadKernel;
+
+MeadKernel mead_kernel_detect(void);
+const char *mead_kernel_name(MeadKernel kernel);
+int mead_kernel_supported(MeadKernel kernel);
+
+void mead_compute_batch(size_t count, const double *volume, const double *og, const unsigned char *units,
+                        double *honey, double *water, double *gravity_points);
+void mead_compute_batch_kernel(MeadKernel kernel, size_t count, const double *volume, const double *og,
+                               const unsigned char *units, double *honey, double *water, double *gravity_points);
+void mead_compute_batch_points(size_t count, const double *volume, const int32_t *og_points,
+                               const unsigned char *units, double *honey, double *water, double *gravity_points);
+void mead_compute_batch_points_kernel(MeadKernel kernel, size_t count, const double *volume,
+                                      const int32_t *og_points, const unsigned char *units, double *honey,
+                                      double *water, double *gravity_points);
+
+#endif // MEAD_KERNEL_H
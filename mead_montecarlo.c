@@ -0,0 +1,576 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "mead_core.h"
+#include "mead_sweep.h"
+#include "mead_montecarlo.h"
+
+#define SKETCH_GAMMA ((1.0 + MEAD_SKETCH_ALPHA) / (1.0 - MEAD_SKETCH_ALPHA))
+
+// Random draws per trial: two per sampled parameter (Box-Muller needs a pair)
+#define DRAWS_PER_TRIAL 8
+
+// --- Quantile Sketch ---
+
+void mead_sketch_init(MeadQuantileSketch *sketch) {
+    memset(sketch, 0, sizeof(*sketch));
+    sketch->min = INFINITY;
+    sketch->max = -INFINITY;
+}
+
+/**
+ * @brief Adds one value: a single log() and a counter increment, no allocation.
+ */
+void mead_sketch_add(MeadQuantileSketch *sketch, double value) {
+    sketch->count++;
+    if (value < sketch->min) sketch->min = value;
+    if (value > sketch->max) sketch->max = value;
+
+    if (!(value > 0.0)) {
+        sketch->zero_count++;
+        return;
+    }
+    double index = ceil(log(value) / log(SKETCH_GAMMA)) + MEAD_SKETCH_OFFSET;
+    if (index < 0.0) index = 0.0;
+    if (index > MEAD_SKETCH_BINS - 1) index = MEAD_SKETCH_BINS - 1;
+    sketch->bins[(int)index]++;
+}
+
+/**
+ * @brief Adds every value of one sketch to another. Bucket counts simply add, so the
+ * result is the same in whatever order per-thread sketches are merged.
+ */
+void mead_sketch_merge(MeadQuantileSketch *into, const MeadQuantileSketch *from) {
+    into->count += from->count;
+    into->zero_count += from->zero_count;
+    if (from->min < into->min) into->min = from->min;
+    if (from->max > into->max) into->max = from->max;
+    for (int i = 0; i < MEAD_SKETCH_BINS; i++) {
+        into->bins[i] += from->bins[i];
+    }
+}
+
+/**
+ * @brief Estimates the q-quantile (0 <= q <= 1) within MEAD_SKETCH_ALPHA relative error.
+ * @return double The estimate, clamped to the observed min/max; NAN for an empty sketch.
+ */
+double mead_sketch_quantile(const MeadQuantileSketch *sketch, double q) {
+    if (sketch->count == 0) {
+        return NAN;
+    }
+
+    uint64_t rank = (uint64_t)(q * (double)(sketch->count - 1));
+    uint64_t seen = sketch->zero_count;
+    double value = sketch->max;
+    if (rank < seen) {
+        return sketch->min;
+    }
+    for (int i = 0; i < MEAD_SKETCH_BINS; i++) {
+        seen += sketch->bins[i];
+        if (rank < seen) {
+            // Midpoint of (gamma^(i-1), gamma^i] in relative terms
+            value = 2.0 * pow(SKETCH_GAMMA, i - MEAD_SKETCH_OFFSET) / (SKETCH_GAMMA + 1.0);
+            break;
+        }
+    }
+    if (value < sketch->min) value = sketch->min;
+    if (value > sketch->max) value = sketch->max;
+    return value;
+}
+
+// --- Distributions ---
+
+// SplitMix64 finalizer. Hashing key + counter * golden ratio gives the SplitMix64
+// sequence indexed directly by counter, so any draw is available without state.
+static uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// Uniform on the open interval (0, 1).
+static double uniform_draw(uint64_t key, uint64_t counter) {
+    return ((double)(mix64(key + counter * 0x9e3779b97f4a7c15ull) >> 11) + 0.5) * 0x1.0p-53;
+}
+
+static double sample(const MeadDistribution *dist, uint64_t key, uint64_t counter) {
+    switch (dist->kind) {
+    case MEAD_DIST_UNIFORM:
+        return dist->a + (dist->b - dist->a) * uniform_draw(key, counter);
+    case MEAD_DIST_NORMAL: {
+        double u1 = uniform_draw(key, counter);
+        double u2 = uniform_draw(key, counter + 1);
+        double z = sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+        if (z > 4.0) z = 4.0;
+        if (z < -4.0) z = -4.0;
+        return dist->a + dist->b * z;
+    }
+    case MEAD_DIST_TRIANGULAR: {
+        double u = uniform_draw(key, counter);
+        double width = dist->c - dist->a;
+        if (width <= 0.0) {
+            return dist->a;
+        }
+        if (u < (dist->b - dist->a) / width) {
+            return dist->a + sqrt(u * width * (dist->b - dist->a));
+        }
+        return dist->c - sqrt((1.0 - u) * width * (dist->c - dist->b));
+    }
+    default:
+        return dist->a;
+    }
+}
+
+// Every sample must be positive: the parameters divide or scale honey.
+static int distribution_valid(const MeadDistribution *dist) {
+    switch (dist->kind) {
+    case MEAD_DIST_FIXED:
+        return dist->a > 0.0;
+    case MEAD_DIST_UNIFORM:
+        return dist->a > 0.0 && dist->b >= dist->a;
+    case MEAD_DIST_NORMAL:
+        return dist->b >= 0.0 && dist->a - 4.0 * dist->b > 0.0;
+    case MEAD_DIST_TRIANGULAR:
+        return dist->a > 0.0 && dist->b >= dist->a && dist->c >= dist->b;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @brief Parses a distribution: "35" or "fixed:35", "uniform:MIN:MAX",
+ * "normal:MEAN:SD" or "triangular:MIN:MODE:MAX".
+ * @return int 0 on success, -1 if malformed or if it could produce a non-positive sample.
+ */
+int mead_parse_distribution(const char *s, MeadDistribution *out) {
+    static const struct { const char *name; MeadDistKind kind; int values; } kinds[] = {
+        { "fixed:", MEAD_DIST_FIXED, 1 },
+        { "uniform:", MEAD_DIST_UNIFORM, 2 },
+        { "normal:", MEAD_DIST_NORMAL, 2 },
+        { "triangular:", MEAD_DIST_TRIANGULAR, 3 },
+    };
+    MeadDistribution dist = { MEAD_DIST_FIXED, 0.0, 0.0, 0.0 };
+    const char *values = s;
+    int expected = 1;
+    char tail;
+
+    for (size_t i = 0; i < sizeof(kinds) / sizeof(kinds[0]); i++) {
+        size_t len = strlen(kinds[i].name);
+        if (strncmp(s, kinds[i].name, len) == 0) {
+            dist.kind = kinds[i].kind;
+            expected = kinds[i].values;
+            values = s + len;
+            break;
+        }
+    }
+
+    int n = sscanf(values, "%lf:%lf:%lf%c", &dist.a, &dist.b, &dist.c, &tail);
+    if (n != expected || !distribution_valid(&dist)) {
+        return -1;
+    }
+    *out = dist;
+    return 0;
+}
+
+/**
+ * @brief Fills a configuration with the default uncertainty around the standard model:
+ * PPG normal(35, 1.5), displacement normal(0.74, 0.03) L/kg, ABV factor normal(131.25, 2).
+ */
+void mead_montecarlo_defaults(MeadMonteCarloConfig *config) {
+    config->ppg = (MeadDistribution){ MEAD_DIST_NORMAL, GRAVITY_POINTS_PER_UNIT, 1.5, 0.0 };
+    config->displacement = (MeadDistribution){ MEAD_DIST_NORMAL, MEAD_DEFAULT_MODEL.displacement_l_per_kg, 0.03, 0.0 };
+    config->abv_factor = (MeadDistribution){ MEAD_DIST_NORMAL, ABV_FACTOR, 2.0, 0.0 };
+    config->trials = MEAD_MC_DEFAULT_TRIALS;
+    config->seed = 1;
+    config->threads = 0;
+    config->scratch = NULL;
+    config->shard_index = 0;
+    config->shard_count = 0;
+}
+
+// --- Parallel Runner ---
+
+typedef struct {
+    const MeadMonteCarloConfig *config;
+    uint64_t key;                // RNG key of this recipe's stream
+    MeadUnit unit;
+    double volume;
+    double abv;
+    MeadSweetness sweetness;
+    int is_turbo;
+    size_t chunks;               // Chunks of this shard
+    size_t shard_index;          // Chunk k of this shard is trial chunk shard_index + k * shard_count
+    size_t shard_count;
+    atomic_size_t next_chunk;
+    double *chunk_sums;          // Honey and water sums per chunk, added up in chunk order
+    pthread_mutex_t lock;
+    MeadMonteCarloSummary *out;  // Sketches and og_too_high guarded by lock
+} MonteCarloJob;
+
+// Thread-local results, merged into the summary once per worker.
+typedef struct {
+    MeadQuantileSketch honey;
+    MeadQuantileSketch water;
+    uint64_t og_too_high;
+} MonteCarloLocal;
+
+// What one worker thread is started with.
+typedef struct {
+    MonteCarloJob *job;
+    MonteCarloLocal *local;
+} MonteCarloWorker;
+
+static void run_chunk(MonteCarloJob *job, size_t index, MonteCarloLocal *local) {
+    const MeadMonteCarloConfig *config = job->config;
+    uint64_t first = (uint64_t)(job->shard_index + index * job->shard_count) * MEAD_MC_CHUNK;
+    uint64_t last = first + MEAD_MC_CHUNK;
+    double honey_sum = 0.0, water_sum = 0.0;
+    MeadModel model = MEAD_DEFAULT_MODEL;
+
+    if (last > (uint64_t)config->trials) {
+        last = (uint64_t)config->trials;
+    }
+    for (uint64_t trial = first; trial < last; trial++) {
+        uint64_t counter = trial * DRAWS_PER_TRIAL;
+        double displacement = sample(&config->displacement, job->key, counter + 2);
+        MeadResult result;
+
+        model.ppg = sample(&config->ppg, job->key, counter);
+        model.displacement_l_per_kg = displacement;
+        model.displacement_gal_per_10_lbs = MEAD_DEFAULT_MODEL.displacement_gal_per_10_lbs * displacement /
+                                            MEAD_DEFAULT_MODEL.displacement_l_per_kg;
+        model.abv_factor = sample(&config->abv_factor, job->key, counter + 4);
+        mead_model_calculate(&model, job->unit, job->volume, job->abv, job->sweetness, job->is_turbo, &result);
+
+        mead_sketch_add(&local->honey, result.honey);
+        mead_sketch_add(&local->water, result.water);
+        local->og_too_high += (uint64_t)result.og_too_high;
+        honey_sum += result.honey;
+        water_sum += result.water;
+    }
+    job->chunk_sums[2 * index] = honey_sum;
+    job->chunk_sums[2 * index + 1] = water_sum;
+}
+
+static void *montecarlo_worker(void *arg) {
+    MonteCarloJob *job = ((MonteCarloWorker *)arg)->job;
+    MonteCarloLocal *local = ((MonteCarloWorker *)arg)->local;
+
+    mead_sketch_init(&local->honey);
+    mead_sketch_init(&local->water);
+    local->og_too_high = 0;
+
+    for (;;) {
+        size_t index = atomic_fetch_add(&job->next_chunk, 1);
+        if (index >= job->chunks) {
+            break;
+        }
+        run_chunk(job, index, local);
+    }
+
+    pthread_mutex_lock(&job->lock);
+    mead_sketch_merge(&job->out->honey, &local->honey);
+    mead_sketch_merge(&job->out->water, &local->water);
+    job->out->og_too_high += local->og_too_high;
+    pthread_mutex_unlock(&job->lock);
+    return NULL;
+}
+
+/**
+ * @brief Runs config->trials trials of one recipe across worker threads.
+ * Workers claim MEAD_MC_CHUNK-trial chunks from a shared counter and keep their own
+ * sketches, merged once at the end. Trial t always uses draws t * 8 .. t * 8 + 7 of
+ * the recipe's stream, and the means are summed in chunk order, so the summary is the
+ * same for any thread count. Worker state comes from config->scratch when given, so
+ * running record after record with one arena allocates nothing after the first.
+ * With config->shard_count > 1, only that shard's chunks are run (out->trials counts
+ * just those trials).
+ * @param config Distributions, trial count, seed, threads, scratch arena and shard.
+ * @param stream Stream number of this recipe (e.g. its input line), mixed into the seed.
+ * @param unit Unit system of volume and of the results.
+ * @param volume Batch volume in Gallons or Liters.
+ * @param abv Target Alcohol by Volume percentage.
+ * @param sweetness A valid sweetness level.
+ * @param is_turbo Flag: 1 for Standard, 2 for Turbo Yeast.
+ * @param out Summary to fill.
+ * @return int 0 on success, -1 if the configuration is invalid or memory could not be obtained.
+ */
+int mead_montecarlo_run(const MeadMonteCarloConfig *config, uint64_t stream, MeadUnit unit, double volume,
+                        double abv, MeadSweetness sweetness, int is_turbo, MeadMonteCarloSummary *out) {
+    if (config->trials <= 0 || config->trials > MEAD_MC_MAX_TRIALS || !distribution_valid(&config->ppg) ||
+        !distribution_valid(&config->displacement) || !distribution_valid(&config->abv_factor) ||
+        (unsigned)sweetness >= MEAD_SWEETNESS_COUNT ||
+        (config->shard_count > 1 && (config->shard_index < 0 || config->shard_index >= config->shard_count))) {
+        return -1;
+    }
+
+    MonteCarloJob job;
+    job.config = config;
+    job.key = mix64(config->seed) ^ mix64(stream * 0xd1b54a32d192ed03ull + 1);
+    job.unit = unit;
+    job.volume = volume;
+    job.abv = abv;
+    job.sweetness = sweetness;
+    job.is_turbo = is_turbo;
+    job.chunks = ((size_t)config->trials + MEAD_MC_CHUNK - 1) / MEAD_MC_CHUNK;
+    job.shard_index = 0;
+    job.shard_count = 1;
+    if (config->shard_count > 1) {
+        job.shard_index = (size_t)config->shard_index;
+        job.shard_count = (size_t)config->shard_count;
+        job.chunks = (job.chunks > job.shard_index) ? (job.chunks - job.shard_index - 1) / job.shard_count + 1 : 0;
+    }
+    atomic_init(&job.next_chunk, 0);
+    job.out = out;
+
+    int threads = (config->threads > 0) ? config->threads : mead_sweep_default_threads();
+    if ((size_t)threads > job.chunks) {
+        threads = (job.chunks > 0) ? (int)job.chunks : 1; // A shard may have no chunks at all
+    }
+
+    // Everything the workers need is carved from one arena up front. Locals are
+    // cache-line aligned so no two workers write to the same line.
+    MeadArena own;
+    MeadArena *arena = config->scratch;
+    if (arena) {
+        mead_arena_reset(arena);
+    } else {
+        mead_arena_init(&own, 0, 0);
+        arena = &own;
+    }
+    job.chunk_sums = mead_arena_alloc(arena, sizeof(double) * 2 * job.chunks);
+    MonteCarloWorker *workers = mead_arena_alloc(arena, sizeof(MonteCarloWorker) * (size_t)threads);
+    pthread_t *handles = mead_arena_alloc(arena, sizeof(pthread_t) * (size_t)threads);
+    for (int i = 0; workers && i < threads; i++) {
+        workers[i].job = &job;
+        workers[i].local = mead_arena_alloc_aligned(arena, sizeof(MonteCarloLocal), 64);
+        if (!workers[i].local) {
+            threads = i;
+        }
+    }
+    if (!job.chunk_sums || !workers || !handles || threads == 0) {
+        if (arena == &own) {
+            mead_arena_free(&own);
+        }
+        return -1;
+    }
+    pthread_mutex_init(&job.lock, NULL);
+
+    memset(out, 0, sizeof(*out));
+    mead_sketch_init(&out->honey);
+    mead_sketch_init(&out->water);
+
+    // The calling thread works too, so only threads - 1 extra workers are started
+    int started = 0;
+    while (started < threads - 1 &&
+           pthread_create(&handles[started], NULL, montecarlo_worker, &workers[started + 1]) == 0) {
+        started++;
+    }
+    montecarlo_worker(&workers[0]);
+    for (int i = 0; i < started; i++) {
+        pthread_join(handles[i], NULL);
+    }
+    pthread_mutex_destroy(&job.lock);
+
+    double honey_sum = 0.0, water_sum = 0.0;
+    for (size_t i = 0; i < job.chunks; i++) {
+        honey_sum += job.chunk_sums[2 * i];
+        water_sum += job.chunk_sums[2 * i + 1];
+    }
+    if (arena == &own) {
+        mead_arena_free(&own);
+    }
+
+    out->trials = out->honey.count;
+    out->honey_mean = honey_sum / (double)out->trials;
+    out->water_mean = water_sum / (double)out->trials;
+    out->chunks = job.chunks;
+    out->chunk_sums = (arena == &own) ? NULL : job.chunk_sums;
+    return 0;
+}
+
+// --- Sharded Runs ---
+
+// A packed summary, in the byte order of the machine that wrote it:
+//   trials, og_too_high, chunks (u64), then 2 * chunks chunk sums (double),
+//   then the honey and the water sketch, each as count, zero_count (u64), min, max
+//   (double), the number of non-empty bins (u64) and an (index, count) u64 pair per bin.
+
+static char *pack_u64(char *p, uint64_t value) {
+    memcpy(p, &value, sizeof(value));
+    return p + sizeof(value);
+}
+
+static char *pack_double(char *p, double value) {
+    memcpy(p, &value, sizeof(value));
+    return p + sizeof(value);
+}
+
+static size_t sketch_nonempty(const MeadQuantileSketch *sketch) {
+    size_t bins = 0;
+    for (int i = 0; i < MEAD_SKETCH_BINS; i++) {
+        bins += (sketch->bins[i] != 0);
+    }
+    return bins;
+}
+
+static char *pack_sketch(char *p, const MeadQuantileSketch *sketch) {
+    p = pack_u64(p, sketch->count);
+    p = pack_u64(p, sketch->zero_count);
+    p = pack_double(p, sketch->min);
+    p = pack_double(p, sketch->max);
+    p = pack_u64(p, sketch_nonempty(sketch));
+    for (int i = 0; i < MEAD_SKETCH_BINS; i++) {
+        if (sketch->bins[i] != 0) {
+            p = pack_u64(p, (uint64_t)i);
+            p = pack_u64(p, sketch->bins[i]);
+        }
+    }
+    return p;
+}
+
+/**
+ * @brief Returns the bytes mead_montecarlo_pack() writes for a summary.
+ */
+size_t mead_montecarlo_packed_size(const MeadMonteCarloSummary *summary) {
+    size_t words = 3 + 2 * summary->chunks + 2 * 5 +
+                   2 * (sketch_nonempty(&summary->honey) + sketch_nonempty(&summary->water));
+    return words * sizeof(uint64_t);
+}
+
+/**
+ * @brief Serializes the summary of one shard for mead_montecarlo_merge(). The summary
+ * must come from a run with a scratch arena (it needs the chunk sums).
+ * @param dst Space for mead_montecarlo_packed_size() bytes.
+ * @return size_t The number of bytes written.
+ */
+size_t mead_montecarlo_pack(const MeadMonteCarloSummary *summary, char *dst) {
+    char *p = pack_u64(dst, summary->trials);
+    p = pack_u64(p, summary->og_too_high);
+    p = pack_u64(p, summary->chunks);
+    for (size_t i = 0; i < 2 * summary->chunks; i++) {
+        p = pack_double(p, summary->chunk_sums[i]);
+    }
+    p = pack_sketch(p, &summary->honey);
+    p = pack_sketch(p, &summary->water);
+    return (size_t)(p - dst);
+}
+
+// Bounds-checked reader over one packed summary.
+typedef struct {
+    const char *p;
+    const char *end;
+} PackedReader;
+
+static int unpack_u64(PackedReader *r, uint64_t *value) {
+    if ((size_t)(r->end - r->p) < sizeof(*value)) {
+        return -1;
+    }
+    memcpy(value, r->p, sizeof(*value));
+    r->p += sizeof(*value);
+    return 0;
+}
+
+static int unpack_double(PackedReader *r, double *value) {
+    uint64_t bits;
+    if (unpack_u64(r, &bits) != 0) {
+        return -1;
+    }
+    memcpy(value, &bits, sizeof(*value));
+    return 0;
+}
+
+static int unpack_sketch(PackedReader *r, MeadQuantileSketch *sketch) {
+    uint64_t bins, index, count;
+
+    mead_sketch_init(sketch);
+    if (unpack_u64(r, &sketch->count) != 0 || unpack_u64(r, &sketch->zero_count) != 0 ||
+        unpack_double(r, &sketch->min) != 0 || unpack_double(r, &sketch->max) != 0 ||
+        unpack_u64(r, &bins) != 0 || bins > MEAD_SKETCH_BINS) {
+        return -1;
+    }
+    for (uint64_t i = 0; i < bins; i++) {
+        if (unpack_u64(r, &index) != 0 || unpack_u64(r, &count) != 0 || index >= MEAD_SKETCH_BINS) {
+            return -1;
+        }
+        sketch->bins[index] = count;
+    }
+    return 0;
+}
+
+/**
+ * @brief Combines the packed summaries of every shard of one record. Sketches and
+ * counts add up, and the chunk sums are added in trial chunk order, so the result is
+ * bit for bit the summary of the unsharded run.
+ * @param packed Packed summaries of shards 0 .. shards - 1, in shard order.
+ * @param sizes Their sizes in bytes.
+ * @param out Merged summary (chunk_sums is NULL).
+ * @return int 0 on success, -1 if a summary is malformed or the shards do not fit together.
+ */
+int mead_montecarlo_merge(const char *const *packed, const size_t *sizes, int shards, MeadMonteCarloSummary *out) {
+    static _Thread_local MeadQuantileSketch part;
+    PackedReader readers[shards];
+    uint64_t shard_chunks[shards];
+    uint64_t total_chunks = 0;
+
+    memset(out, 0, sizeof(*out));
+    mead_sketch_init(&out->honey);
+    mead_sketch_init(&out->water);
+    for (int s = 0; s < shards; s++) {
+        uint64_t trials, og_too_high, chunks;
+        readers[s].p = packed[s];
+        readers[s].end = packed[s] + sizes[s];
+        if (unpack_u64(&readers[s], &trials) != 0 || unpack_u64(&readers[s], &og_too_high) != 0 ||
+            unpack_u64(&readers[s], &chunks) != 0 || chunks > (uint64_t)(readers[s].end - readers[s].p) / 16) {
+            return -1;
+        }
+        out->trials += trials;
+        out->og_too_high += og_too_high;
+        shard_chunks[s] = chunks;
+        total_chunks += chunks;
+    }
+    for (int s = 0; s < shards; s++) {
+        uint64_t expected = (total_chunks > (uint64_t)s) ? (total_chunks - s - 1) / shards + 1 : 0;
+        if (shard_chunks[s] != expected) {
+            return -1; // Not the shards of one run
+        }
+    }
+
+    // Shard s holds trial chunks s, s + shards, ...: walk them in trial chunk order
+    double honey_sum = 0.0, water_sum = 0.0;
+    for (uint64_t c = 0; c < total_chunks; c++) {
+        double honey, water;
+        if (unpack_double(&readers[c % (uint64_t)shards], &honey) != 0 ||
+            unpack_double(&readers[c % (uint64_t)shards], &water) != 0) {
+            return -1;
+        }
+        honey_sum += honey;
+        water_sum += water;
+    }
+    for (int s = 0; s < shards; s++) {
+        if (unpack_sketch(&readers[s], &part) != 0) {
+            return -1;
+        }
+        mead_sketch_merge(&out->honey, &part);
+        if (unpack_sketch(&readers[s], &part) != 0 || readers[s].p != readers[s].end) {
+            return -1;
+        }
+        mead_sketch_merge(&out->water, &part);
+    }
+    if (out->trials == 0 || out->honey.count != out->trials) {
+        return -1;
+    }
+    out->honey_mean = honey_sum / (double)out->trials;
+    out->water_mean = water_sum / (double)out->trials;
+    return 0;
+}
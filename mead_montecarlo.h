@@ -0,0 +1,97 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+#ifndef MEAD_MONTECARLO_H
+#define MEAD_MONTECARLO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mead_core.h"
+#include "mead_arena.h"
+
+// Monte Carlo uncertainty for one recipe. Each trial draws honey PPG, honey
+// displacement and the ABV factor from their distributions and runs the normal
+// model calculation. Random numbers come from a counter-based generator: trial t of
+// stream s always sees the same numbers, whichever thread runs it, so the results
+// do not depend on the thread count. Honey and water are reduced to quantiles with
+// mergeable log-bucket sketches, so memory use does not grow with the trial count.
+//
+// A run can also be split into shards (for several machines): shard i of N runs only
+// the trial chunks c with c % N == i. mead_montecarlo_pack() serializes a shard's
+// summary, and mead_montecarlo_merge() combines the packed summaries of all N shards
+// into exactly the summary of an unsharded run.
+
+#define MEAD_MC_DEFAULT_TRIALS 1000000
+#define MEAD_MC_MAX_TRIALS 1000000000L
+#define MEAD_MC_CHUNK 16384 // Trials per scheduling chunk
+
+// Quantile sketch: bucket i holds values in (gamma^(i-1), gamma^i] with
+// gamma = (1 + alpha) / (1 - alpha), so every quantile is within alpha (relative)
+// of a true sample value. Values outside the bucket range land in the end buckets.
+#define MEAD_SKETCH_ALPHA 0.005
+#define MEAD_SKETCH_BINS 4096
+#define MEAD_SKETCH_OFFSET 2048 // Bucket 0 is gamma^-2048, about 1e-9
+
+typedef enum {
+    MEAD_DIST_FIXED = 0,  // Always a
+    MEAD_DIST_UNIFORM,    // Uniform on [a, b]
+    MEAD_DIST_NORMAL,     // Mean a, standard deviation b, truncated at +-4 b
+    MEAD_DIST_TRIANGULAR  // Minimum a, mode b, maximum c
+} MeadDistKind;
+
+typedef struct {
+    MeadDistKind kind;
+    double a, b, c;
+} MeadDistribution;
+
+typedef struct {
+    MeadDistribution ppg;          // Honey gravity points per lb per gallon
+    MeadDistribution displacement; // Liters displaced per kg of honey; the US figure scales with it
+    MeadDistribution abv_factor;   // ABV = (OG - FG) * abv_factor
+    long trials;                   // Trials per recipe
+    uint64_t seed;                 // Base seed; each recipe adds its own stream number
+    int threads;                   // Worker threads (<= 0 for one per online CPU)
+    MeadArena *scratch;            // Per-run worker state, reset by every run; NULL to allocate each time
+    int shard_index;               // Run only the chunks c with c % shard_count == shard_index
+    int shard_count;               // <= 1 to run every chunk
+} MeadMonteCarloConfig;
+
+typedef struct {
+    uint64_t count;
+    uint64_t zero_count; // Values <= 0 (e.g. water clamped to zero)
+    double min;
+    double max;
+    uint64_t bins[MEAD_SKETCH_BINS];
+} MeadQuantileSketch;
+
+// Trial results for one recipe. Honey and water are in the recipe's unit system.
+typedef struct {
+    uint64_t trials;
+    uint64_t og_too_high; // Trials whose OG exceeded MEAD_MAX_OG
+    double honey_mean;
+    double water_mean;
+    MeadQuantileSketch honey;
+    MeadQuantileSketch water;
+    size_t chunks;         // Trial chunks this run computed (only this shard's)
+    const double *chunk_sums; // Honey and water sums of each, in chunk order; in config->scratch,
+                              // valid until its next reset (NULL without a scratch arena)
+} MeadMonteCarloSummary;
+
+void mead_sketch_init(MeadQuantileSketch *sketch);
+void mead_sketch_add(MeadQuantileSketch *sketch, double value);
+void mead_sketch_merge(MeadQuantileSketch *into, const MeadQuantileSketch *from);
+double mead_sketch_quantile(const MeadQuantileSketch *sketch, double q);
+
+int mead_parse_distribution(const char *s, MeadDistribution *out);
+void mead_montecarlo_defaults(MeadMonteCarloConfig *config);
+int mead_montecarlo_run(const MeadMonteCarloConfig *config, uint64_t stream, MeadUnit unit, double volume,
+                        double abv, MeadSweetness sweetness, int is_turbo, MeadMonteCarloSummary *out);
+size_t mead_montecarlo_packed_size(const MeadMonteCarloSummary *summary);
+size_t mead_montecarlo_pack(const MeadMonteCarloSummary *summary, char *dst);
+int mead_montecarlo_merge(const char *const *packed, const size_t *sizes, int shards, MeadMonteCarloSummary *out);
+
+#endif // MEAD_MONTECARLO_H
@@ -0,0 +1,506 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "mead_output.h"
+#include "mead_stats.h"
+
+// --- Fixed-Precision Formatter ---
+
+static const double POW10[] = { 1.0, 10.0, 100.0, 1000.0 };
+static const uint64_t IPOW10[] = { 1, 10, 100, 1000 };
+
+/**
+ * @brief Writes value with a fixed number of decimals, exactly as printf("%.*f") would.
+ * Values below 1e9 with 0-3 decimals take an integer fast path. The scaled value can be
+ * off by rounding only near a ...5 tie, so those rare cases (and everything outside the
+ * fast range) fall back to snprintf to stay identical to printf.
+ * @param dst Output buffer with room for MEAD_FIXED_MAX bytes; not NUL-terminated.
+ * @param value Value to format.
+ * @param decimals Number of decimals.
+ * @return size_t Number of bytes written.
+ */
+size_t mead_format_fixed(char *dst, double value, int decimals) {
+    double magnitude = fabs(value);
+
+    if (decimals >= 0 && decimals <= 3 && magnitude < 1e9) {
+        double scaled = magnitude * POW10[decimals];
+        double whole = floor(scaled);
+        double frac = scaled - whole;
+        double tie_margin = scaled * 1e-15 + 1e-12;
+
+        if (fabs(frac - 0.5) > tie_margin) {
+            uint64_t digits = (uint64_t)whole + (frac > 0.5);
+            uint64_t int_part = digits / IPOW10[decimals];
+            uint64_t frac_part = digits % IPOW10[decimals];
+            char tmp[24];
+            size_t n = 0;
+
+            // Fraction digits, then integer digits, both built backwards
+            for (int i = 0; i < decimals; i++) {
+                tmp[n++] = (char)('0' + frac_part % 10);
+                frac_part /= 10;
+            }
+            if (decimals > 0) {
+                tmp[n++] = '.';
+            }
+            do {
+                tmp[n++] = (char)('0' + int_part % 10);
+                int_part /= 10;
+            } while (int_part);
+            if (signbit(value)) {
+                tmp[n++] = '-'; // printf keeps the sign of values that round to zero
+            }
+
+            for (size_t i = 0; i < n; i++) {
+                dst[i] = tmp[n - 1 - i];
+            }
+            return n;
+        }
+    }
+
+    char tmp[MEAD_FIXED_MAX + 1];
+    int n = snprintf(tmp, sizeof(tmp), "%.*f", decimals, value);
+    if (n < 0) {
+        return 0;
+    }
+    if ((size_t)n > MEAD_FIXED_MAX) {
+        n = MEAD_FIXED_MAX;
+    }
+    memcpy(dst, tmp, (size_t)n);
+    return (size_t)n;
+}
+
+/**
+ * @brief Parses "csv", "json", "human" or "binary" (case-insensitive).
+ * @return int 0 on success, -1 if the name is unknown.
+ */
+int mead_parse_output_format(const char *name, MeadOutputFormat *format) {
+    if (strcasecmp(name, "csv") == 0) {
+        *format = MEAD_FORMAT_CSV;
+    } else if (strcasecmp(name, "json") == 0 || strcasecmp(name, "ndjson") == 0) {
+        *format = MEAD_FORMAT_JSON;
+    } else if (strcasecmp(name, "human") == 0) {
+        *format = MEAD_FORMAT_HUMAN;
+    } else if (strcasecmp(name, "binary") == 0) {
+        *format = MEAD_FORMAT_BINARY;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+// --- Writer ---
+
+/**
+ * @brief Writes all of data to fd, retrying short writes and EINTR.
+ * @return int 0 on success, -1 on a write error.
+ */
+int mead_write_all(int fd, const char *data, size_t len) {
+    size_t done = 0;
+
+    while (done < len) {
+        ssize_t n = write(fd, data + done, len - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        done += (size_t)n;
+    }
+    return 0;
+}
+
+void mead_writer_init(MeadWriter *w, int fd) {
+    w->fd = fd;
+    w->error = 0;
+    w->len = 0;
+    w->mem = NULL;
+    w->mem_len = 0;
+    w->mem_cap = 0;
+}
+
+// Memory writers: moves the buffer to the end of mem, growing it geometrically.
+static int flush_to_memory(MeadWriter *w) {
+    if (w->mem_cap - w->mem_len < w->len) {
+        size_t cap = w->mem_cap ? w->mem_cap : MEAD_WRITER_BUFFER;
+        while (cap - w->mem_len < w->len) {
+            cap *= 2;
+        }
+        char *grown = realloc(w->mem, cap);
+        if (!grown) {
+            w->error = 1;
+            return -1;
+        }
+        w->mem = grown;
+        w->mem_cap = cap;
+    }
+    memcpy(w->mem + w->mem_len, w->buf, w->len);
+    w->mem_len += w->len;
+    return 0;
+}
+
+/**
+ * @brief Writes out everything buffered, normally with one write() call (memory
+ * writers append it to mem instead).
+ * @return int 0 on success, -1 if this or any earlier write failed.
+ */
+int mead_writer_flush(MeadWriter *w) {
+    if (w->fd < 0) {
+        if (w->len > 0 && !w->error) {
+            flush_to_memory(w);
+        }
+        w->len = 0;
+        return w->error ? -1 : 0;
+    }
+
+    MeadStats *stats = (w->len > 0) ? mead_stats_thread() : NULL;
+    uint64_t start = stats ? mead_stats_now() : 0;
+
+    if (w->len > 0 && !w->error && mead_write_all(w->fd, w->buf, w->len) != 0) {
+        w->error = 1;
+    }
+    w->len = 0;
+    mead_stats_record_since(stats, MEAD_STAGE_WRITE, start);
+    return w->error ? -1 : 0;
+}
+
+/**
+ * @brief Frees a memory writer's heap block; the writer is empty afterwards.
+ */
+void mead_writer_release(MeadWriter *w) {
+    free(w->mem);
+    w->mem = NULL;
+    w->mem_len = 0;
+    w->mem_cap = 0;
+    w->len = 0;
+}
+
+// Returns space for at least n bytes (n <= MEAD_WRITER_BUFFER), flushing first if needed.
+static char *reserve(MeadWriter *w, size_t n) {
+    if (MEAD_WRITER_BUFFER - w->len < n) {
+        mead_writer_flush(w);
+    }
+    return w->buf + w->len;
+}
+
+void mead_writer_put(MeadWriter *w, const char *data, size_t len) {
+    while (len > 0) {
+        size_t space = MEAD_WRITER_BUFFER - w->len;
+        if (space == 0) {
+            mead_writer_flush(w);
+            space = MEAD_WRITER_BUFFER;
+        }
+        size_t chunk = (len < space) ? len : space;
+        memcpy(w->buf + w->len, data, chunk);
+        w->len += chunk;
+        data += chunk;
+        len -= chunk;
+    }
+}
+
+void mead_writer_puts(MeadWriter *w, const char *s) {
+    mead_writer_put(w, s, strlen(s));
+}
+
+void mead_writer_fixed(MeadWriter *w, double value, int decimals) {
+    char *dst = reserve(w, MEAD_FIXED_MAX);
+    w->len += mead_format_fixed(dst, value, decimals);
+}
+
+void mead_writer_long(MeadWriter *w, long value) {
+    char tmp[24];
+    size_t n = 0;
+    unsigned long magnitude = (value < 0) ? 0UL - (unsigned long)value : (unsigned long)value;
+
+    do {
+        tmp[n++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+    if (value < 0) {
+        tmp[n++] = '-';
+    }
+
+    char *dst = reserve(w, n);
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = tmp[n - 1 - i];
+    }
+    w->len += n;
+}
+
+/**
+ * @brief Writes a number like printf("%g"): integers without decimals, others via snprintf.
+ */
+void mead_writer_number(MeadWriter *w, double value) {
+    if (fabs(value) < 1e6 && value == floor(value)) {
+        mead_writer_long(w, (long)value);
+        return;
+    }
+    char tmp[32];
+    int n = snprintf(tmp, sizeof(tmp), "%g", value);
+    if (n > 0) {
+        mead_writer_put(w, tmp, (size_t)n);
+    }
+}
+
+// Writes s as a JSON string literal.
+static void write_json_string(MeadWriter *w, const char *s) {
+    mead_writer_put(w, "\"", 1);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') {
+            mead_writer_put(w, "\\", 1);
+            mead_writer_put(w, s, 1);
+        } else if ((unsigned char)*s >= 0x20) {
+            mead_writer_put(w, s, 1);
+        }
+    }
+    mead_writer_put(w, "\"", 1);
+}
+
+// --- Binary Results ---
+
+// Little-endian stores; on a little-endian machine each compiles to one plain store.
+static char *put_le32(char *p, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        p[i] = (char)(value >> (8 * i));
+    }
+    return p + 4;
+}
+
+static char *put_le64(char *p, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        p[i] = (char)(value >> (8 * i));
+    }
+    return p + 8;
+}
+
+static char *put_double(char *p, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return put_le64(p, bits);
+}
+
+/**
+ * @brief Encodes the binary format header (sizeof(MeadBinaryHeader) bytes) into dst.
+ * @return size_t The number of bytes written.
+ */
+size_t mead_format_binary_header(char *dst) {
+    char *p = dst;
+
+    memset(p, 0, sizeof(MeadBinaryHeader));
+    memcpy(p, MEAD_BINARY_MAGIC, sizeof(MEAD_BINARY_MAGIC));
+    p = put_le32(p + 8, MEAD_BINARY_VERSION);
+    p = put_le32(p, sizeof(MeadBinaryHeader));
+    put_le32(p, sizeof(MeadBinaryRecord));
+    return sizeof(MeadBinaryHeader);
+}
+
+/**
+ * @brief Encodes one record (sizeof(MeadBinaryRecord) bytes, little-endian) into dst.
+ * @return size_t The number of bytes written.
+ */
+size_t mead_format_binary_record(char *dst, const MeadBinaryRecord *rec) {
+    char *p = put_le64(dst, (uint64_t)rec->line);
+
+    p = put_double(p, rec->volume);
+    p = put_double(p, rec->abv);
+    p = put_double(p, rec->og);
+    p = put_double(p, rec->fg);
+    p = put_double(p, rec->honey);
+    p = put_double(p, rec->water);
+    p = put_double(p, rec->gravity_points);
+    *p++ = (char)rec->unit;
+    *p++ = (char)rec->sweetness;
+    *p++ = (char)rec->yeast_mode;
+    *p++ = 0;
+    put_le32(p, rec->flags);
+    return sizeof(MeadBinaryRecord);
+}
+
+static void write_binary_record(MeadWriter *w, const MeadOutputRecord *rec) {
+    MeadBinaryRecord bin;
+
+    memset(&bin, 0, sizeof(bin));
+    bin.line = rec->line;
+    if (rec->has_inputs) {
+        bin.volume = rec->volume;
+        bin.abv = rec->abv;
+        bin.unit = (uint8_t)rec->unit;
+        bin.sweetness = (uint8_t)rec->sweetness;
+        bin.yeast_mode = (uint8_t)rec->yeast_mode;
+    } else {
+        bin.flags |= MEAD_BINARY_NO_INPUTS;
+    }
+    if (rec->error) {
+        bin.og = bin.fg = bin.honey = bin.water = bin.gravity_points = NAN;
+        bin.flags |= MEAD_BINARY_ERROR | (rec->og_too_high ? MEAD_BINARY_OG_TOO_HIGH : 0);
+    } else {
+        bin.og = rec->og;
+        bin.fg = mead_final_gravity(MEAD_DEFAULT_FG_TABLE, rec->sweetness, rec->yeast_mode);
+        bin.honey = rec->honey;
+        bin.water = rec->water;
+        bin.gravity_points = rec->gravity_points;
+        bin.flags |= (rec->water > 0.0) ? 0 : MEAD_BINARY_WATER_CLAMPED; // Same test as mead_compute_ingredients()
+    }
+    w->len += mead_format_binary_record(reserve(w, sizeof(MeadBinaryRecord)), &bin);
+}
+
+// --- Result Rows ---
+
+/**
+ * @brief Writes the header for a format (CSV column names, the binary header; nothing
+ * for JSON or human).
+ */
+void mead_write_header(MeadWriter *w, MeadOutputFormat format) {
+    if (format == MEAD_FORMAT_CSV) {
+        mead_writer_puts(w, "line,unit,volume,abv,sweetness,yeast,og,honey,honey_unit,water,water_unit,gravity_points,status\n");
+    } else if (format == MEAD_FORMAT_BINARY) {
+        w->len += mead_format_binary_header(reserve(w, sizeof(MeadBinaryHeader)));
+    }
+}
+
+static void write_csv_record(MeadWriter *w, const MeadOutputRecord *rec) {
+    int imperial = (rec->unit == MEAD_UNIT_US_IMPERIAL);
+
+    mead_writer_long(w, rec->line);
+    if (!rec->has_inputs) {
+        mead_writer_puts(w, ",,,,,,,,,,,,error: ");
+        mead_writer_puts(w, rec->error);
+        mead_writer_puts(w, "\n");
+        return;
+    }
+
+    mead_writer_puts(w, imperial ? ",Gallons," : ",Liters,");
+    mead_writer_fixed(w, rec->volume, 2);
+    mead_writer_puts(w, ",");
+    mead_writer_number(w, rec->abv);
+    mead_writer_puts(w, ",");
+    mead_writer_puts(w, mead_sweetness_name(rec->sweetness));
+    mead_writer_puts(w, (rec->yeast_mode == 1) ? ",Standard," : ",Turbo,");
+
+    if (rec->error) {
+        mead_writer_puts(w, ",,,,,,error: ");
+        mead_writer_puts(w, rec->error);
+        mead_writer_puts(w, "\n");
+        return;
+    }
+
+    mead_writer_fixed(w, rec->og, 3);
+    mead_writer_puts(w, ",");
+    mead_writer_fixed(w, rec->honey, 2);
+    mead_writer_puts(w, imperial ? ",lbs," : ",kg,");
+    mead_writer_fixed(w, rec->water, 2);
+    mead_writer_puts(w, imperial ? ",gallons," : ",liters,");
+    mead_writer_fixed(w, rec->gravity_points, 0);
+    mead_writer_puts(w, ",ok\n");
+}
+
+static void write_json_record(MeadWriter *w, const MeadOutputRecord *rec) {
+    int imperial = (rec->unit == MEAD_UNIT_US_IMPERIAL);
+
+    mead_writer_puts(w, "{\"line\":");
+    mead_writer_long(w, rec->line);
+    if (rec->has_inputs) {
+        mead_writer_puts(w, imperial ? ",\"unit\":\"Gallons\",\"volume\":" : ",\"unit\":\"Liters\",\"volume\":");
+        mead_writer_fixed(w, rec->volume, 2);
+        mead_writer_puts(w, ",\"abv\":");
+        mead_writer_number(w, rec->abv);
+        mead_writer_puts(w, ",\"sweetness\":");
+        write_json_string(w, mead_sweetness_name(rec->sweetness));
+        mead_writer_puts(w, (rec->yeast_mode == 1) ? ",\"yeast\":\"Standard\"" : ",\"yeast\":\"Turbo\"");
+        if (rec->lot && *rec->lot) {
+            mead_writer_puts(w, ",\"lot\":");
+            write_json_string(w, rec->lot);
+        }
+    }
+    if (rec->error) {
+        mead_writer_puts(w, ",\"status\":\"error\",\"error\":");
+        write_json_string(w, rec->error);
+        mead_writer_puts(w, "}\n");
+        return;
+    }
+
+    mead_writer_puts(w, ",\"og\":");
+    mead_writer_fixed(w, rec->og, 3);
+    mead_writer_puts(w, ",\"honey\":");
+    mead_writer_fixed(w, rec->honey, 2);
+    mead_writer_puts(w, imperial ? ",\"honey_unit\":\"lbs\",\"water\":" : ",\"honey_unit\":\"kg\",\"water\":");
+    mead_writer_fixed(w, rec->water, 2);
+    mead_writer_puts(w, imperial ? ",\"water_unit\":\"gallons\",\"gravity_points\":"
+                                 : ",\"water_unit\":\"liters\",\"gravity_points\":");
+    mead_writer_fixed(w, rec->gravity_points, 0);
+    mead_writer_puts(w, ",\"status\":\"ok\"}\n");
+}
+
+static void write_human_record(MeadWriter *w, const MeadOutputRecord *rec) {
+    int imperial = (rec->unit == MEAD_UNIT_US_IMPERIAL);
+
+    mead_writer_puts(w, "Line ");
+    mead_writer_long(w, rec->line);
+    if (rec->has_inputs) {
+        mead_writer_puts(w, ": ");
+        mead_writer_fixed(w, rec->volume, 2);
+        mead_writer_puts(w, imperial ? " gallons, ABV " : " liters, ABV ");
+        mead_writer_number(w, rec->abv);
+        mead_writer_puts(w, "%, ");
+        mead_writer_puts(w, mead_sweetness_name(rec->sweetness));
+        mead_writer_puts(w, (rec->yeast_mode == 1) ? ", Standard Yeast" : ", Turbo Yeast");
+        if (rec->lot && *rec->lot) {
+            mead_writer_puts(w, ", honey lot ");
+            mead_writer_puts(w, rec->lot);
+        }
+        mead_writer_puts(w, "\n");
+    } else {
+        mead_writer_puts(w, ":\n");
+    }
+    if (rec->error) {
+        mead_writer_puts(w, "  Error: ");
+        mead_writer_puts(w, rec->error);
+        mead_writer_puts(w, "\n\n");
+        return;
+    }
+
+    mead_writer_puts(w, "  Target Original Gravity (OG): ");
+    mead_writer_fixed(w, rec->og, 3);
+    mead_writer_puts(w, "\n  Required Honey:             ");
+    mead_writer_fixed(w, rec->honey, 2);
+    mead_writer_puts(w, imperial ? " lbs (pounds)\n" : " kg (kilograms)\n");
+    mead_writer_puts(w, "  Required Water (to top off):  ");
+    mead_writer_fixed(w, rec->water, 2);
+    mead_writer_puts(w, imperial ? " gallons\n" : " liters\n");
+    mead_writer_puts(w, "  Total Gravity Points Needed:  ");
+    mead_writer_fixed(w, rec->gravity_points, 0);
+    mead_writer_puts(w, "\n\n");
+}
+
+/**
+ * @brief Renders one result row in the given format.
+ */
+void mead_write_record(MeadWriter *w, MeadOutputFormat format, const MeadOutputRecord *rec) {
+    switch (format) {
+    case MEAD_FORMAT_JSON:
+        write_json_record(w, rec);
+        break;
+    case MEAD_FORMAT_HUMAN:
+        write_human_record(w, rec);
+        break;
+    case MEAD_FORMAT_BINARY:
+        write_binary_record(w, rec);
+        break;
+    default:
+        write_csv_record(w, rec);
+        break;
+    }
+}
@@ -0,0 +1,127 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+#ifndef MEAD_OUTPUT_H
+#define MEAD_OUTPUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mead_core.h"
+
+// Buffered result output for the high-volume CLI paths. Rows are rendered with a
+// fixed-precision formatter into one large reusable buffer, which is handed to the
+// kernel with a single write() per flush instead of going through stdio.
+//
+// A writer with fd < 0 keeps its output in memory instead: every flush appends the
+// buffer to a growable heap block (mem, mem_len), which the owner hands on and empties
+// when it likes. Parallel batch workers render whole chunks this way before their
+// turn to write comes round.
+//
+// The binary format (MEAD_FORMAT_BINARY) is for programs that read results without
+// parsing text: one MeadBinaryHeader, then one MeadBinaryRecord per result. Every
+// field is little-endian and fixed-width at the offsets of the structs below, so on a
+// little-endian machine a consumer can mmap the output and read the records in place.
+// A reader must check magic and version, and step by header_size and record_size so
+// later versions can grow either struct at the end. Results of a record that was not
+// calculated are NAN.
+
+#define MEAD_WRITER_BUFFER (1 << 16)
+
+// Space mead_format_fixed() may need: sign, up to 309 integer digits, point, decimals.
+#define MEAD_FIXED_MAX 320
+
+typedef enum {
+    MEAD_FORMAT_CSV = 0,
+    MEAD_FORMAT_JSON,  // One JSON object per line (NDJSON)
+    MEAD_FORMAT_HUMAN,
+    MEAD_FORMAT_BINARY // MeadBinaryHeader, then fixed-width MeadBinaryRecords
+} MeadOutputFormat;
+
+#define MEAD_BINARY_MAGIC "MEADRES"  // NUL-padded to 8 bytes
+#define MEAD_BINARY_VERSION 1
+
+// MeadBinaryRecord flags
+#define MEAD_BINARY_ERROR 0x1          // Not calculated (rejected or unparsable): results are NAN
+#define MEAD_BINARY_NO_INPUTS 0x2      // Not even parsed: inputs are zero as well
+#define MEAD_BINARY_WATER_CLAMPED 0x4  // Honey volume meets or exceeds the batch volume (water 0)
+#define MEAD_BINARY_OG_TOO_HIGH 0x8    // Target OG above MEAD_MAX_OG (1.225)
+
+typedef struct {
+    char magic[8];         // MEAD_BINARY_MAGIC
+    uint32_t version;      // MEAD_BINARY_VERSION
+    uint32_t header_size;  // Bytes before the first record (sizeof(MeadBinaryHeader))
+    uint32_t record_size;  // Bytes per record (sizeof(MeadBinaryRecord))
+    uint32_t reserved[3];
+} MeadBinaryHeader;
+
+typedef struct {
+    int64_t line;          // Input line (batch, service) or row number (sweep), from 1
+    double volume;         // Gallons or liters, per unit
+    double abv;
+    double og;
+    double fg;
+    double honey;          // lbs or kg
+    double water;          // gallons or liters
+    double gravity_points;
+    uint8_t unit;          // MeadUnit
+    uint8_t sweetness;     // MeadSweetness
+    uint8_t yeast_mode;    // 1 for Standard Yeast, 2 for Turbo Yeast
+    uint8_t reserved;
+    uint32_t flags;        // MEAD_BINARY_* flags
+} MeadBinaryRecord;
+
+_Static_assert(sizeof(MeadBinaryHeader) == 32, "MeadBinaryHeader layout is part of the format");
+_Static_assert(sizeof(MeadBinaryRecord) == 72, "MeadBinaryRecord layout is part of the format");
+
+typedef struct {
+    int fd;
+    int error;                      // Sticky: non-zero once a write() has failed
+    size_t len;
+    char *mem;                      // Memory writers (fd < 0): everything flushed so far
+    size_t mem_len;
+    size_t mem_cap;
+    char buf[MEAD_WRITER_BUFFER];
+} MeadWriter;
+
+// One batch result row. error is NULL for a successful calculation; has_inputs is
+// zero if the record could not be parsed at all (only line and error are then valid).
+typedef struct {
+    long line;
+    int has_inputs;
+    MeadUnit unit;
+    double volume;
+    double abv;
+    MeadSweetness sweetness;
+    int yeast_mode;
+    const char *error;
+    double og;
+    double honey;
+    double water;
+    double gravity_points;
+    const char *lot;       // Honey lot ID, or NULL/"" for the default model (JSON and human only)
+    int og_too_high;       // Rejected because og exceeded MEAD_MAX_OG (binary flag only)
+} MeadOutputRecord;
+
+size_t mead_format_fixed(char *dst, double value, int decimals);
+size_t mead_format_binary_header(char *dst);
+size_t mead_format_binary_record(char *dst, const MeadBinaryRecord *rec);
+int mead_parse_output_format(const char *name, MeadOutputFormat *format);
+
+int mead_write_all(int fd, const char *data, size_t len);
+void mead_writer_init(MeadWriter *w, int fd);
+int mead_writer_flush(MeadWriter *w);
+void mead_writer_release(MeadWriter *w);
+void mead_writer_put(MeadWriter *w, const char *data, size_t len);
+void mead_writer_puts(MeadWriter *w, const char *s);
+void mead_writer_fixed(MeadWriter *w, double value, int decimals);
+void mead_writer_long(MeadWriter *w, long value);
+void mead_writer_number(MeadWriter *w, double value);
+
+void mead_write_header(MeadWriter *w, MeadOutputFormat format);
+void mead_write_record(MeadWriter *w, MeadOutputFormat format, const MeadOutputRecord *rec);
+
+#endif // MEAD_OUTPUT_H
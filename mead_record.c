@@ -0,0 +1,190 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+
+#include "mead_record.h"
+
+/**
+ * @brief Strips leading and trailing whitespace in place. Use this for whole lines,
+ * where a leading or trailing quote belongs to the first or last field.
+ */
+char *mead_trim_space(char *s) {
+    while (isspace((unsigned char)*s)) s++;
+    char *end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1])) end--;
+    *end = '\0';
+    return s;
+}
+
+/**
+ * @brief Strips leading and trailing whitespace (and surrounding quotes) from a
+ * single field in place.
+ */
+char *mead_trim_field(char *s) {
+    s = mead_trim_space(s);
+    size_t len = strlen(s);
+    if (len >= 2 && *s == '"' && s[len - 1] == '"') {
+        s[len - 1] = '\0';
+        s++;
+    }
+    return s;
+}
+
+/**
+ * @brief Parses a unit field: "Gallons"/"gal"/"1" or "Liters"/"L"/"2".
+ * @return int 1 for US Imperial, 2 for Metric, or 0 if not recognised.
+ */
+int mead_parse_unit(const char *s) {
+    if (strcasecmp(s, "1") == 0 || strcasecmp(s, "Gallons") == 0 || strcasecmp(s, "gal") == 0) {
+        return 1;
+    }
+    if (strcasecmp(s, "2") == 0 || strcasecmp(s, "Liters") == 0 || strcasecmp(s, "L") == 0) {
+        return 2;
+    }
+    return 0;
+}
+
+/**
+ * @brief Parses a yeast mode field: "Standard"/"1" or "Turbo"/"2".
+ * @return int 1 for Standard, 2 for Turbo, or 0 if not recognised.
+ */
+int mead_parse_yeast_mode(const char *s) {
+    if (strcasecmp(s, "1") == 0 || strcasecmp(s, "Standard") == 0) {
+        return 1;
+    }
+    if (strcasecmp(s, "2") == 0 || strcasecmp(s, "Turbo") == 0) {
+        return 2;
+    }
+    return 0;
+}
+
+/**
+ * @brief Stores one named field value into a batch record.
+ * @param index Field position: 0 unit, 1 volume, 2 abv, 3 sweetness, 4 yeast, 5 lot.
+ * @return const char* NULL on success, otherwise an error message.
+ */
+const char *mead_set_record_field(MeadRecord *rec, int index, const char *value) {
+    char *end;
+
+    switch (index) {
+    case 0:
+        rec->unit = mead_parse_unit(value);
+        return rec->unit ? NULL : "invalid unit";
+    case 1:
+        rec->volume = strtod(value, &end);
+        return (end != value && *end == '\0' && rec->volume > 0.0) ? NULL : "invalid volume";
+    case 2:
+        rec->abv = strtod(value, &end);
+        if (end == value || *end != '\0' || !(rec->abv >= MEAD_MIN_ABV && rec->abv <= MEAD_MAX_ABV)) {
+            return "invalid ABV (must be between 5% and 25%)";
+        }
+        return NULL;
+    case 3:
+        rec->sweetness = mead_parse_sweetness(value);
+        return (rec->sweetness != MEAD_SWEETNESS_INVALID) ? NULL : "invalid sweetness level (use Dry/Semi-Sweet/Sweet/Dessert)";
+    case 4:
+        rec->yeast_mode = mead_parse_yeast_mode(value);
+        return rec->yeast_mode ? NULL : "invalid yeast mode";
+    case 5:
+        if (strlen(value) >= MEAD_LOT_ID_MAX) {
+            return "honey lot ID too long";
+        }
+        strcpy(rec->lot, value);
+        return NULL;
+    }
+    return "too many fields";
+}
+
+/**
+ * @brief Parses a CSV record: unit,volume,abv,sweetness,yeast[,lot].
+ * @return const char* NULL on success, otherwise an error message.
+ */
+const char *mead_parse_csv_record(char *line, MeadRecord *rec) {
+    int index = 0;
+    char *field = line;
+
+    rec->lot[0] = '\0';
+    for (;;) {
+        char *comma = strchr(field, ',');
+        if (comma) *comma = '\0';
+
+        const char *err = mead_set_record_field(rec, index++, mead_trim_field(field));
+        if (err) return err;
+
+        if (!comma) break;
+        field = comma + 1;
+    }
+    return (index == 5 || index == 6) ? NULL : "expected 5 fields (unit,volume,abv,sweetness,yeast) plus an optional lot";
+}
+
+/**
+ * @brief Parses a flat NDJSON object with the keys unit, volume, abv, sweetness, yeast
+ * and optionally lot. Values may be JSON strings or bare numbers; nesting and escapes
+ * are not supported.
+ * @return const char* NULL on success, otherwise an error message.
+ */
+const char *mead_parse_json_record(char *line, MeadRecord *rec) {
+    static const char *keys[] = { "unit", "volume", "abv", "sweetness", "yeast", "lot" };
+    int seen = 0;
+    char *p = strchr(line, '{') + 1;
+
+    rec->lot[0] = '\0';
+
+    for (;;) {
+        while (isspace((unsigned char)*p) || *p == ',') p++;
+        if (*p == '}') break;
+        if (*p != '"') return "malformed JSON record";
+
+        // Key
+        char *key = ++p;
+        p = strchr(p, '"');
+        if (!p) return "malformed JSON record";
+        *p++ = '\0';
+        while (isspace((unsigned char)*p)) p++;
+        if (*p++ != ':') return "malformed JSON record";
+        while (isspace((unsigned char)*p)) p++;
+
+        // Value: either a quoted string or a bare token up to ',' or '}'
+        char *value;
+        int last = 0;
+        if (*p == '"') {
+            value = ++p;
+            p = strchr(p, '"');
+            if (!p) return "malformed JSON record";
+            *p++ = '\0';
+        } else {
+            value = p;
+            p += strcspn(p, ",}");
+            if (*p == '\0') return "malformed JSON record";
+            last = (*p == '}');
+            *p++ = '\0';
+            value = mead_trim_field(value);
+        }
+
+        for (int i = 0; i < 6; i++) {
+            if (strcmp(key, keys[i]) == 0) {
+                const char *err = mead_set_record_field(rec, i, value);
+                if (err) return err;
+                seen |= 1 << i;
+            }
+        }
+        if (last) break;
+    }
+    return ((seen & 0x1f) == 0x1f) ? NULL : "missing field (need unit,volume,abv,sweetness,yeast)";
+}
+
+/**
+ * @brief Parses a record in either format: NDJSON if it starts with '{', CSV otherwise.
+ * @param line Trimmed record text; modified in place.
+ * @return const char* NULL on success, otherwise an error message.
+ */
+const char *mead_parse_record(char *line, MeadRecord *rec) {
+    return (*line == '{') ? mead_parse_json_record(line, rec) : mead_parse_csv_record(line, rec);
+}
@@ -0,0 +1,37 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+#ifndef MEAD_RECORD_H
+#define MEAD_RECORD_H
+
+#include "mead_core.h"
+#include "mead_honeydb.h"
+
+// Text record parsing shared by the CLI batch/inverse modes and the calculation service.
+// Records are CSV lines (unit,volume,abv,sweetness,yeast) or flat NDJSON objects with
+// the same keys, plus an optional honey lot ID (mead_honeydb.h). All parsers work in
+// place on a writable line buffer.
+
+// One parsed batch record: the same five values the interactive prompts ask for.
+typedef struct {
+    int unit;                          // 1 for US Imperial, 2 for Metric
+    double volume;                     // Gallons or Liters, depending on unit
+    double abv;                        // Target ABV, 5-25 (fractional values use the formula path)
+    MeadSweetness sweetness;           // Parsed once from Dry, Semi-Sweet, Sweet or Dessert
+    int yeast_mode;                    // 1 for Standard Yeast, 2 for Turbo Yeast
+    char lot[MEAD_LOT_ID_MAX];         // Honey lot ID, or "" for the default model
+} MeadRecord;
+
+char *mead_trim_space(char *s);
+char *mead_trim_field(char *s);
+int mead_parse_unit(const char *s);
+int mead_parse_yeast_mode(const char *s);
+const char *mead_set_record_field(MeadRecord *rec, int index, const char *value);
+const char *mead_parse_csv_record(char *line, MeadRecord *rec);
+const char *mead_parse_json_record(char *line, MeadRecord *rec);
+const char *mead_parse_record(char *line, MeadRecord *rec);
+
+#endif // MEAD_RECORD_H
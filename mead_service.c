@@ -0,0 +1,852 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+#define _GNU_SOURCE // accept4, memmem
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "mead_core.h"
+#include "mead_kernel.h"
+#include "mead_output.h"
+#include "mead_record.h"
+#include "mead_service.h"
+#include "mead_stats.h"
+
+// --- Buffers and Connections ---
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} Buffer;
+
+typedef enum {
+    PROTO_UNKNOWN = 0,
+    PROTO_LINE,
+    PROTO_HTTP
+} Protocol;
+
+// Common head of everything registered with epoll, so events can be told apart.
+typedef struct {
+    int fd;
+    int is_listener;
+} Endpoint;
+
+typedef struct Conn {
+    Endpoint ep;
+    Protocol proto;
+    Buffer in;
+    Buffer out;
+    Buffer body;            // HTTP: response body of the request being answered
+    int http_open;          // HTTP: a request is being answered (records may still be in the block)
+    int http_keep_alive;    // HTTP: keep the connection open after the current response
+    int http_binary;        // HTTP: answer the current request in MEAD_FORMAT_BINARY
+    long seq;               // Line protocol: records answered so far (the "line" of each reply)
+    int peer_closed;        // Read side hit EOF; close once everything is answered
+    int closing;            // Close once the output is written; read no further requests
+    int dead;               // I/O error: drop without writing
+    int touched;            // On this iteration's touched list
+    unsigned events;        // Events currently registered with epoll
+    struct Conn *prev;
+    struct Conn *next;
+} Conn;
+
+/**
+ * @brief Appends data to a buffer, growing it as needed.
+ * @return int 0 on success, -1 if out of memory.
+ */
+static int buffer_append(Buffer *b, const char *data, size_t len) {
+    if (b->cap - b->len < len) {
+        size_t cap = b->cap ? b->cap : 4096;
+        while (cap - b->len < len) {
+            cap *= 2;
+        }
+        char *p = realloc(b->data, cap);
+        if (!p) {
+            return -1;
+        }
+        b->data = p;
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+    return 0;
+}
+
+/**
+ * @brief Makes sure data[len] exists and is '\0', so the contents can be parsed as a string.
+ * @return int 0 on success, -1 if out of memory.
+ */
+static int buffer_terminate(Buffer *b) {
+    if (buffer_append(b, "", 1) != 0) {
+        return -1;
+    }
+    b->len--;
+    return 0;
+}
+
+static void buffer_consume(Buffer *b, size_t n) {
+    memmove(b->data, b->data + n, b->len - n);
+    b->len -= n;
+}
+
+static void buffer_free(Buffer *b) {
+    free(b->data);
+    b->data = NULL;
+    b->len = b->cap = 0;
+}
+
+// --- Service State ---
+
+// Records waiting for the kernel, tagged with the connection that gets the reply.
+typedef struct {
+    int count;
+    Conn *conn[MEAD_SERVICE_BATCH];
+    long line[MEAD_SERVICE_BATCH];
+    const char *error[MEAD_SERVICE_BATCH];
+    int has_inputs[MEAD_SERVICE_BATCH];
+    const MeadHoneyLot *lot[MEAD_SERVICE_BATCH];
+    unsigned char og_too_high[MEAD_SERVICE_BATCH];
+    MeadRecord rec[MEAD_SERVICE_BATCH];
+    double volume[MEAD_SERVICE_BATCH];
+    double og[MEAD_SERVICE_BATCH];
+    unsigned char units[MEAD_SERVICE_BATCH];
+    double honey[MEAD_SERVICE_BATCH];
+    double water[MEAD_SERVICE_BATCH];
+    double gravity_points[MEAD_SERVICE_BATCH];
+} ServiceBlock;
+
+typedef struct {
+    int epfd;
+    const MeadHoneyDb *honey_db;            // Read-only mapping; may be NULL
+    const MeadTelemetry *telemetry;         // Sensor state for GET /telemetry; may be NULL
+    MeadHistoryWriter *history;             // Recipes history; may be NULL
+    Conn *conns;                            // All open connections
+    Conn *pool;                             // Closed connections ready for reuse (singly linked)
+    int pool_count;
+    Conn *touched[MEAD_SERVICE_MAX_EVENTS]; // Connections with activity this iteration
+    int touched_count;
+    ServiceBlock block;
+    MeadWriter scratch;                     // Renders one reply at a time (never flushed)
+    MeadStats *stats;                       // Event loop thread's statistics (GET /metrics)
+} Service;
+
+static void conn_fail(Conn *c) {
+    c->dead = 1;
+    c->closing = 1;
+}
+
+static void append_out(Conn *c, const char *data, size_t len) {
+    if (!c->dead && buffer_append(&c->out, data, len) != 0) {
+        conn_fail(c);
+    }
+}
+
+/**
+ * @brief Runs the batch kernel over the queued records and renders every reply into
+ * its connection (the output buffer, or the pending HTTP body).
+ */
+static void block_flush(Service *svc) {
+    ServiceBlock *block = &svc->block;
+    uint64_t start = svc->stats ? mead_stats_now() : 0;
+
+    mead_stats_gauge_set(svc->stats, MEAD_GAUGE_QUEUE_DEPTH, block->count);
+    mead_compute_batch((size_t)block->count, block->volume, block->og, block->units,
+                       block->honey, block->water, block->gravity_points);
+
+    for (int i = 0; i < block->count; i++) {
+        const MeadRecord *rec = &block->rec[i];
+        if (block->lot[i] && !block->error[i] && !block->conn[i]->dead) {
+            // Lots have their own PPG and displacement (see batch_block_flush in meadGenerator.c)
+            MeadModel model;
+            MeadResult result;
+            mead_honey_lot_model(block->lot[i], &MEAD_DEFAULT_MODEL, &model);
+            mead_model_compute_ingredients(&model, (MeadUnit)rec->unit, rec->volume, block->og[i], &result);
+            block->honey[i] = result.honey;
+            block->water[i] = result.water;
+            block->gravity_points[i] = result.gravity_points;
+        }
+    }
+    mead_stats_record_since(svc->stats, MEAD_STAGE_COMPUTE, start);
+
+    if (svc->history) {
+        int64_t now_ms = mead_history_now_ms();
+        for (int i = 0; i < block->count; i++) {
+            const MeadRecord *rec = &block->rec[i];
+            if (!block->error[i] && !block->conn[i]->dead) {
+                MeadHistoryRecipe recipe = { now_ms, (MeadUnit)rec->unit, rec->volume, rec->abv, rec->sweetness,
+                                             rec->yeast_mode, block->og[i], block->honey[i], block->water[i] };
+                mead_history_append_recipe(svc->history, &recipe);
+            }
+        }
+    }
+
+    start = svc->stats ? mead_stats_now() : 0;
+    for (int i = 0; i < block->count; i++) {
+        Conn *c = block->conn[i];
+        const MeadRecord *rec = &block->rec[i];
+
+        if (c->dead) {
+            continue;
+        }
+        MeadOutputRecord row = { block->line[i], block->has_inputs[i], (MeadUnit)rec->unit, rec->volume,
+                                 rec->abv, rec->sweetness, rec->yeast_mode, block->error[i],
+                                 block->og[i], block->honey[i], block->water[i], block->gravity_points[i],
+                                 block->lot[i] ? rec->lot : NULL, block->og_too_high[i] };
+        svc->scratch.len = 0;
+        mead_write_record(&svc->scratch, c->http_binary ? MEAD_FORMAT_BINARY : MEAD_FORMAT_JSON, &row);
+        Buffer *target = (c->proto == PROTO_HTTP) ? &c->body : &c->out;
+        if (buffer_append(target, svc->scratch.buf, svc->scratch.len) != 0) {
+            conn_fail(c);
+        }
+    }
+    mead_stats_record_since(svc->stats, MEAD_STAGE_FORMAT, start);
+    block->count = 0;
+}
+
+/**
+ * @brief Queues one record (or a parse error) for the next kernel call.
+ */
+static void block_add(Service *svc, Conn *c, long line, const MeadRecord *rec, const char *err) {
+    ServiceBlock *block = &svc->block;
+
+    if (block->count == MEAD_SERVICE_BATCH) {
+        block_flush(svc);
+    }
+
+    int i = block->count++;
+    block->conn[i] = c;
+    block->line[i] = line;
+    block->error[i] = err;
+    block->has_inputs[i] = (rec != NULL);
+    block->lot[i] = NULL;
+    block->og_too_high[i] = 0;
+    block->volume[i] = 0.0;
+    block->og[i] = 1.000;
+    block->units[i] = MEAD_UNIT_US_IMPERIAL;
+    mead_stats_count(svc->stats, MEAD_STAT_RECORDS, 1);
+    if (!rec) {
+        mead_stats_count(svc->stats, MEAD_STAT_PARSE_ERRORS, 1);
+    }
+
+    if (rec) {
+        block->rec[i] = *rec;
+        double og = mead_target_og(MEAD_DEFAULT_FG_TABLE, rec->abv, rec->sweetness, rec->yeast_mode);
+        const char *lot_err = mead_honeydb_resolve(svc->honey_db, rec->lot, &block->lot[i]);
+        if (og > MEAD_MAX_OG) {
+            block->error[i] = "OG too high (above 1.225)";
+            block->og_too_high[i] = 1;
+            mead_stats_count(svc->stats, MEAD_STAT_OG_REJECTS, 1);
+        } else if (lot_err) {
+            block->error[i] = lot_err;
+            mead_stats_count(svc->stats, MEAD_STAT_LOT_ERRORS, 1);
+        } else if (!err) {
+            block->volume[i] = rec->volume;
+            block->og[i] = og;
+            block->units[i] = (unsigned char)rec->unit;
+        }
+    }
+}
+
+/**
+ * @brief Parses one record line and queues it. Blank lines and '#' comments are skipped.
+ * @return int 1 if a record was queued, 0 if the line was skipped.
+ */
+static int queue_record_line(Service *svc, Conn *c, char *line, long line_no) {
+    char *rec_str = mead_trim_space(line);
+    if (*rec_str == '\0' || *rec_str == '#') {
+        return 0;
+    }
+
+    MeadRecord rec;
+    uint64_t start = svc->stats ? mead_stats_now() : 0;
+    const char *err = mead_parse_record(rec_str, &rec);
+    mead_stats_record_since(svc->stats, MEAD_STAGE_PARSE, start);
+    block_add(svc, c, line_no, err ? NULL : &rec, err);
+    return 1;
+}
+
+// --- Line Protocol ---
+
+static void handle_line_input(Service *svc, Conn *c) {
+    size_t start = 0;
+
+    for (;;) {
+        char *line = c->in.data + start;
+        char *nl = memchr(line, '\n', c->in.len - start);
+
+        if (!nl) {
+            size_t rest = c->in.len - start;
+            if (rest > MEAD_SERVICE_LINE_MAX) {
+                block_add(svc, c, ++c->seq, NULL, "line too long");
+                c->closing = 1;
+                start = c->in.len;
+            } else if (rest > 0 && c->peer_closed) {
+                // Last record without a trailing newline (already NUL-terminated by conn_read)
+                c->seq += queue_record_line(svc, c, line, c->seq + 1);
+                start = c->in.len;
+            }
+            break;
+        }
+
+        *nl = '\0';
+        if (nl - line > MEAD_SERVICE_LINE_MAX) {
+            block_add(svc, c, ++c->seq, NULL, "line too long");
+        } else {
+            c->seq += queue_record_line(svc, c, line, c->seq + 1);
+        }
+        start = (size_t)(nl - c->in.data) + 1;
+    }
+    buffer_consume(&c->in, start);
+}
+
+// --- HTTP ---
+
+/**
+ * @brief Completes the HTTP request being answered: status line, headers and the body
+ * rendered so far. Replies still sitting in the block must be flushed first.
+ */
+static void http_finish(Conn *c, const char *status, const char *content_type) {
+    char head[256];
+    int n = snprintf(head, sizeof(head), "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n%s\r\n",
+                     status, content_type, c->body.len, c->http_keep_alive ? "" : "Connection: close\r\n");
+
+    append_out(c, head, (size_t)n);
+    append_out(c, c->body.data, c->body.len);
+    c->body.len = 0;
+    c->http_open = 0;
+    c->http_binary = 0;
+    if (!c->http_keep_alive) {
+        c->closing = 1;
+    }
+}
+
+// Content type of the POST /calculate response being rendered.
+static const char *http_results_type(const Conn *c) {
+    return c->http_binary ? MEAD_SERVICE_BINARY_TYPE : "application/x-ndjson";
+}
+
+// Answers a pipelined request that is still open, so replies stay in request order.
+static void http_complete_pending(Service *svc, Conn *c) {
+    if (c->http_open) {
+        block_flush(svc);
+        http_finish(c, "200 OK", http_results_type(c));
+    }
+}
+
+static void http_simple(Service *svc, Conn *c, const char *status, const char *text, int keep_alive) {
+    http_complete_pending(svc, c);
+    c->http_keep_alive = keep_alive;
+    if (buffer_append(&c->body, text, strlen(text)) != 0) {
+        conn_fail(c);
+        return;
+    }
+    http_finish(c, status, "text/plain");
+}
+
+// Answers GET /metrics with every thread's statistics in Prometheus text format.
+static void http_metrics(Service *svc, Conn *c, int keep_alive) {
+    static MeadStatsSnapshot snap;
+
+    http_complete_pending(svc, c);
+    c->http_keep_alive = keep_alive;
+    mead_stats_snapshot(&snap);
+    svc->scratch.len = 0;
+    mead_stats_write_prometheus(&svc->scratch, &snap);
+    if (buffer_append(&c->body, svc->scratch.buf, svc->scratch.len) != 0) {
+        conn_fail(c);
+        return;
+    }
+    http_finish(c, "200 OK", "text/plain; version=0.0.4");
+}
+
+// Answers GET /telemetry with one NDJSON object per fermenter. Each state is a
+// lock-free copy, so a busy ingest thread never stalls the event loop.
+static void http_telemetry(Service *svc, Conn *c, int keep_alive) {
+    if (!svc->telemetry) {
+        http_simple(svc, c, "404 Not Found", "telemetry not enabled (--telemetry-port)\n", keep_alive);
+        return;
+    }
+    size_t count = mead_telemetry_count(svc->telemetry);
+    uint64_t now = mead_stats_now();
+
+    http_complete_pending(svc, c);
+    c->http_keep_alive = keep_alive;
+    for (size_t i = 0; i < count; i++) {
+        MeadFermenterState st;
+        MeadWriter *w = &svc->scratch;
+
+        mead_telemetry_get(svc->telemetry, i, &st);
+        w->len = 0;
+        mead_writer_puts(w, "{\"fermenter\":\"");
+        mead_writer_puts(w, st.id); // Names with quotes or backslashes are rejected on ingest
+        mead_writer_puts(w, "\",\"og\":");
+        mead_writer_fixed(w, st.og, 3);
+        mead_writer_puts(w, ",\"sg\":");
+        mead_writer_fixed(w, st.sg, 3);
+        mead_writer_puts(w, ",\"abv\":");
+        mead_writer_fixed(w, st.abv, 2);
+        mead_writer_puts(w, ",\"temperature\":");
+        if (isnan(st.temperature)) {
+            mead_writer_puts(w, "null");
+        } else {
+            mead_writer_fixed(w, st.temperature, 1);
+        }
+        mead_writer_puts(w, ",\"readings\":");
+        mead_writer_long(w, (long)st.readings);
+        mead_writer_puts(w, ",\"age\":");
+        mead_writer_fixed(w, (st.updated_ns < now) ? (double)(now - st.updated_ns) / 1e9 : 0.0, 3);
+        mead_writer_puts(w, "}\n");
+        if (buffer_append(&c->body, w->buf, w->len) != 0) {
+            conn_fail(c);
+            return;
+        }
+    }
+    http_finish(c, "200 OK", "application/x-ndjson");
+}
+
+// Case-insensitive search for a header line; returns its value or NULL.
+static const char *http_header(const char *head, const char *name) {
+    size_t name_len = strlen(name);
+
+    for (const char *line = strstr(head, "\r\n"); line; line = strstr(line, "\r\n")) {
+        line += 2;
+        if (strncasecmp(line, name, name_len) == 0 && line[name_len] == ':') {
+            const char *value = line + name_len + 1;
+            while (*value == ' ' || *value == '\t') value++;
+            return value;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Parses as many complete HTTP requests as the input buffer holds and queues
+ * their records. A pipelined request waits for the previous response to complete.
+ */
+static void handle_http_input(Service *svc, Conn *c) {
+    while (!c->closing && !c->dead) {
+        char *head = c->in.data;
+        char *head_end = c->in.len ? memmem(head, c->in.len, "\r\n\r\n", 4) : NULL;
+
+        if (!head_end) {
+            if (c->in.len > MEAD_SERVICE_HEADER_MAX) {
+                http_simple(svc, c, "431 Request Header Fields Too Large", "request head too large\n", 0);
+            }
+            return;
+        }
+        size_t head_len = (size_t)(head_end - head) + 4;
+        head_end[2] = '\0'; // Keeps the last header's CRLF for http_header()
+
+        char method[8], path[64];
+        int minor = 1;
+        if (sscanf(head, "%7s %63s HTTP/1.%d", method, path, &minor) != 3) {
+            http_simple(svc, c, "400 Bad Request", "malformed request line\n", 0);
+            return;
+        }
+        if (http_header(head, "Transfer-Encoding")) {
+            http_simple(svc, c, "411 Length Required", "send the body with Content-Length\n", 0);
+            return;
+        }
+
+        const char *conn_hdr = http_header(head, "Connection");
+        int keep_alive = (minor >= 1);
+        if (conn_hdr && strncasecmp(conn_hdr, "close", 5) == 0) keep_alive = 0;
+        if (conn_hdr && strncasecmp(conn_hdr, "keep-alive", 10) == 0) keep_alive = 1;
+
+        const char *length_hdr = http_header(head, "Content-Length");
+        char *end = NULL;
+        long body_len = length_hdr ? strtol(length_hdr, &end, 10) : 0;
+        if (length_hdr && (end == length_hdr || body_len < 0 || body_len > MEAD_SERVICE_BODY_MAX)) {
+            http_simple(svc, c, "413 Content Too Large", "request body too large\n", 0);
+            return;
+        }
+        if (c->in.len - head_len < (size_t)body_len) {
+            head_end[2] = '\r';
+            return; // Wait for the rest of the body
+        }
+
+        if (strcmp(path, "/calculate") == 0 && strcmp(method, "POST") == 0) {
+            char *body = c->in.data + head_len;
+            char *body_end = body + body_len;
+            long line_no = 0;
+
+            const char *accept = http_header(head, "Accept");
+            size_t type_len = strlen(MEAD_SERVICE_BINARY_TYPE);
+
+            http_complete_pending(svc, c);
+            c->http_keep_alive = keep_alive;
+            c->http_open = 1;
+            c->http_binary = accept && strncasecmp(accept, MEAD_SERVICE_BINARY_TYPE, type_len) == 0 &&
+                             strchr(",; \t\r", accept[type_len]);
+            if (c->http_binary) {
+                char header[sizeof(MeadBinaryHeader)];
+                if (buffer_append(&c->body, header, mead_format_binary_header(header)) != 0) {
+                    conn_fail(c);
+                }
+            }
+            while (body < body_end) {
+                char *nl = memchr(body, '\n', (size_t)(body_end - body));
+                char *line_end = nl ? nl : body_end;
+                char saved = *line_end; // body_end may be the next request's first byte
+
+                *line_end = '\0';
+                line_no++;
+                if (line_end - body > MEAD_SERVICE_LINE_MAX) {
+                    block_add(svc, c, line_no, NULL, "line too long");
+                } else {
+                    queue_record_line(svc, c, body, line_no);
+                }
+                *line_end = saved;
+                body = line_end + 1;
+            }
+        } else if (strcmp(path, "/calculate") == 0) {
+            http_simple(svc, c, "405 Method Not Allowed", "use POST\n", keep_alive);
+        } else if (strcmp(path, "/health") == 0 && strcmp(method, "GET") == 0) {
+            http_simple(svc, c, "200 OK", "ok\n", keep_alive);
+        } else if (strcmp(path, "/metrics") == 0 && strcmp(method, "GET") == 0) {
+            http_metrics(svc, c, keep_alive);
+        } else if (strcmp(path, "/telemetry") == 0 && strcmp(method, "GET") == 0) {
+            http_telemetry(svc, c, keep_alive);
+        } else {
+            http_simple(svc, c, "404 Not Found", "not found\n", keep_alive);
+        }
+        buffer_consume(&c->in, head_len + (size_t)body_len);
+    }
+}
+
+// --- Event Loop ---
+
+static void touch(Service *svc, Conn *c) {
+    if (!c->touched) {
+        c->touched = 1;
+        svc->touched[svc->touched_count++] = c;
+    }
+}
+
+// Empties a buffer for reuse, releasing it if it grew past MEAD_SERVICE_POOL_BUFFER.
+static void buffer_recycle(Buffer *b) {
+    if (b->cap > MEAD_SERVICE_POOL_BUFFER) {
+        buffer_free(b);
+    }
+    b->len = 0;
+}
+
+/**
+ * @brief Puts a connection (off every list, socket closed) back in the pool, or frees
+ * it if the pool is full. Pooled connections keep their buffers, so short-lived
+ * clients cost no malloc() or free() once the pool has warmed up.
+ */
+static void conn_release(Service *svc, Conn *c) {
+    if (svc->pool_count >= MEAD_SERVICE_POOL_MAX) {
+        buffer_free(&c->in);
+        buffer_free(&c->out);
+        buffer_free(&c->body);
+        free(c);
+        return;
+    }
+    buffer_recycle(&c->in);
+    buffer_recycle(&c->out);
+    buffer_recycle(&c->body);
+    c->next = svc->pool;
+    svc->pool = c;
+    svc->pool_count++;
+}
+
+// Takes a connection from the pool (with its buffers) or allocates a new one.
+static Conn *conn_acquire(Service *svc) {
+    Conn *c = svc->pool;
+    if (!c) {
+        return calloc(1, sizeof(*c));
+    }
+    svc->pool = c->next;
+    svc->pool_count--;
+
+    Buffer in = c->in, out = c->out, body = c->body;
+    memset(c, 0, sizeof(*c));
+    c->in = in;
+    c->out = out;
+    c->body = body;
+    return c;
+}
+
+static void conn_close(Service *svc, Conn *c) {
+    if (c->prev) c->prev->next = c->next;
+    else svc->conns = c->next;
+    if (c->next) c->next->prev = c->prev;
+
+    mead_stats_gauge_add(svc->stats, MEAD_GAUGE_CONNECTIONS, -1);
+    close(c->ep.fd); // Also removes it from the epoll set
+    conn_release(svc, c);
+}
+
+static void accept_all(Service *svc, int listen_fd) {
+    for (;;) {
+        int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return; // EAGAIN, or a transient error; the listener stays registered
+        }
+
+        Conn *c = conn_acquire(svc);
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = c };
+        if (!c || epoll_ctl(svc->epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            if (c) conn_release(svc, c);
+            close(fd);
+            continue;
+        }
+        mead_stats_gauge_add(svc->stats, MEAD_GAUGE_CONNECTIONS, 1);
+        c->ep.fd = fd;
+        c->events = EPOLLIN;
+        c->next = svc->conns;
+        if (svc->conns) svc->conns->prev = c;
+        svc->conns = c;
+    }
+}
+
+static void conn_read(Service *svc, Conn *c) {
+    char buf[65536];
+    ssize_t n = read(c->ep.fd, buf, sizeof(buf));
+
+    if (n < 0) {
+        if (errno != EAGAIN && errno != EINTR) {
+            conn_fail(c);
+        }
+        return;
+    }
+    if (n == 0) {
+        c->peer_closed = 1;
+    } else if (buffer_append(&c->in, buf, (size_t)n) != 0) {
+        conn_fail(c);
+        return;
+    }
+    if (buffer_terminate(&c->in) != 0) {
+        conn_fail(c);
+        return;
+    }
+
+    if (c->proto == PROTO_UNKNOWN && c->in.len > 0) {
+        c->proto = (strncmp(c->in.data, "GET ", c->in.len < 4 ? c->in.len : 4) == 0 ||
+                    strncmp(c->in.data, "POST ", c->in.len < 5 ? c->in.len : 5) == 0)
+                       ? PROTO_HTTP : PROTO_LINE;
+        if (c->proto == PROTO_HTTP && c->in.len < 5 && !c->peer_closed) {
+            c->proto = PROTO_UNKNOWN; // Could still be either; wait for more bytes
+            return;
+        }
+    }
+    if (c->proto == PROTO_HTTP) {
+        handle_http_input(svc, c);
+    } else if (c->proto == PROTO_LINE) {
+        handle_line_input(svc, c);
+    }
+}
+
+static void conn_write(Service *svc, Conn *c) {
+    while (c->out.len > 0 && !c->dead) {
+        uint64_t start = svc->stats ? mead_stats_now() : 0;
+        ssize_t n = send(c->ep.fd, c->out.data, c->out.len, MSG_NOSIGNAL);
+        mead_stats_record_since(svc->stats, MEAD_STAGE_WRITE, start);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN) conn_fail(c);
+            return;
+        }
+        buffer_consume(&c->out, (size_t)n);
+    }
+}
+
+/**
+ * @brief End of an event loop iteration: runs the kernel on everything queued, writes
+ * the replies, and closes or re-arms each touched connection.
+ */
+static void finish_iteration(Service *svc) {
+    if (svc->block.count > 0) {
+        block_flush(svc);
+    }
+
+    for (int i = 0; i < svc->touched_count; i++) {
+        Conn *c = svc->touched[i];
+        c->touched = 0;
+
+        if (c->http_open && !c->dead) {
+            http_finish(c, "200 OK", http_results_type(c));
+        }
+        conn_write(svc, c);
+
+        int done_reading = c->closing || c->peer_closed;
+        if (c->dead || (done_reading && c->out.len == 0)) {
+            conn_close(svc, c);
+            continue;
+        }
+
+        // Stop reading once the client falls behind; resume when the output drains
+        unsigned events = (done_reading || c->out.len >= MEAD_SERVICE_OUT_HIGH) ? 0 : EPOLLIN;
+        if (c->out.len > 0) {
+            events |= EPOLLOUT;
+        }
+        if (events != c->events) {
+            struct epoll_event ev = { .events = events, .data.ptr = c };
+            epoll_ctl(svc->epfd, EPOLL_CTL_MOD, c->ep.fd, &ev);
+            c->events = events;
+        }
+    }
+    svc->touched_count = 0;
+}
+
+// --- Listeners ---
+
+static int listen_unix(const char *path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    unlink(path); // A stale socket from an earlier run
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+static int listen_tcp(int port) {
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons((uint16_t)port) };
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Serves calculation requests until *stop becomes non-zero.
+ * The caller installs the signal handlers that set *stop (without SA_RESTART, so a
+ * signal interrupts epoll_wait) and should ignore SIGPIPE.
+ * @param config Listening endpoints; at least one must be set.
+ * @param stop Flag polled between event loop iterations.
+ * @return int 0 after a clean shutdown, -1 if the service could not start.
+ */
+int mead_service_run(const MeadServiceConfig *config, volatile sig_atomic_t *stop) {
+    static Service svc;
+    Endpoint listeners[2];
+    int listener_count = 0;
+
+    memset(&svc, 0, sizeof(svc));
+    svc.honey_db = config->honey_db;
+    svc.telemetry = config->telemetry;
+    svc.history = config->history;
+    mead_stats_enable();
+    svc.stats = mead_stats_thread();
+    mead_writer_init(&svc.scratch, -1);
+    svc.epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (svc.epfd < 0) {
+        fprintf(stderr, "Error: Cannot create event loop: %s\n", strerror(errno));
+        return -1;
+    }
+
+    if (config->socket_path) {
+        int fd = listen_unix(config->socket_path);
+        if (fd < 0) {
+            fprintf(stderr, "Error: Cannot listen on socket '%s': %s\n", config->socket_path, strerror(errno));
+        } else {
+            listeners[listener_count++] = (Endpoint){ fd, 1 };
+        }
+    }
+    if (config->tcp_port > 0) {
+        int fd = listen_tcp(config->tcp_port);
+        if (fd < 0) {
+            fprintf(stderr, "Error: Cannot listen on 127.0.0.1:%d: %s\n", config->tcp_port, strerror(errno));
+        } else {
+            listeners[listener_count++] = (Endpoint){ fd, 1 };
+        }
+    }
+    if (listener_count == 0 || (config->socket_path && config->tcp_port > 0 && listener_count < 2)) {
+        for (int i = 0; i < listener_count; i++) close(listeners[i].fd);
+        close(svc.epfd);
+        return -1;
+    }
+    for (int i = 0; i < listener_count; i++) {
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = &listeners[i] };
+        epoll_ctl(svc.epfd, EPOLL_CTL_ADD, listeners[i].fd, &ev);
+    }
+
+    struct epoll_event events[MEAD_SERVICE_MAX_EVENTS];
+    int timeout = svc.history ? MEAD_HISTORY_FLUSH_MS : -1; // Wakes up to flush buffered history
+    while (!*stop) {
+        int n = epoll_wait(svc.epfd, events, MEAD_SERVICE_MAX_EVENTS, timeout);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "Error: Event loop failed: %s\n", strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            Endpoint *ep = events[i].data.ptr;
+            if (ep->is_listener) {
+                accept_all(&svc, ep->fd);
+                continue;
+            }
+
+            Conn *c = (Conn *)ep;
+            touch(&svc, c);
+            if (events[i].events & (EPOLLERR | EPOLLHUP) && !(events[i].events & EPOLLIN)) {
+                conn_fail(c);
+            } else if (events[i].events & EPOLLIN) {
+                conn_read(&svc, c);
+            }
+        }
+        finish_iteration(&svc);
+        if (svc.history) {
+            mead_history_writer_sync(svc.history, mead_history_now_ms());
+        }
+    }
+
+    while (svc.conns) {
+        conn_close(&svc, svc.conns);
+    }
+    svc.pool_count = MEAD_SERVICE_POOL_MAX; // Makes conn_release() free instead of pool
+    while (svc.pool) {
+        Conn *c = svc.pool;
+        svc.pool = c->next;
+        conn_release(&svc, c);
+    }
+    for (int i = 0; i < listener_count; i++) {
+        close(listeners[i].fd);
+    }
+    if (config->socket_path) {
+        unlink(config->socket_path);
+    }
+    close(svc.epfd);
+    return 0;
+}
@@ -0,0 +1,50 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+#ifndef MEAD_SERVICE_H
+#define MEAD_SERVICE_H
+
+#include <signal.h>
+
+#include "mead_history.h"
+#include "mead_honeydb.h"
+#include "mead_telemetry.h"
+
+// Long-running calculation service. One epoll event loop serves every connection on
+// a Unix domain socket and/or a loopback TCP port. Each connection speaks one of two
+// protocols, chosen from its first bytes:
+//   - Line protocol: one CSV or NDJSON record per line, one NDJSON result per line.
+//   - HTTP/1.1: "POST /calculate" with records in the body (NDJSON results back, or
+//     the binary result format of mead_output.h with "Accept: MEAD_SERVICE_BINARY_TYPE"),
+//     "GET /health", "GET /metrics" and "GET /telemetry" (the latest state of every
+//     fermenter, one NDJSON object each). Keep-alive and pipelined requests are supported.
+// Records that arrive in the same event loop iteration, from any connection, are
+// coalesced into one call to the batch kernel before the replies are written.
+// With a history writer, every calculated recipe is also appended to it; buffered
+// rows are written out at least every MEAD_HISTORY_FLUSH_MS, and at shutdown by
+// the owner of the writer.
+
+#define MEAD_SERVICE_MAX_EVENTS 64
+#define MEAD_SERVICE_BATCH 256          // Records per kernel call
+#define MEAD_SERVICE_LINE_MAX 1024      // Longest line protocol record
+#define MEAD_SERVICE_HEADER_MAX 8192    // Longest HTTP request head
+#define MEAD_SERVICE_BODY_MAX (1 << 20) // Largest HTTP request body
+#define MEAD_SERVICE_OUT_HIGH (1 << 20) // Stop reading from a client with this much unsent output
+#define MEAD_SERVICE_POOL_MAX 64        // Closed connections kept for reuse, buffers included
+#define MEAD_SERVICE_POOL_BUFFER (1 << 16) // Buffers larger than this are released, not pooled
+#define MEAD_SERVICE_BINARY_TYPE "application/x-mead-result" // Media type of binary results
+
+typedef struct {
+    const char *socket_path; // Unix socket to listen on, or NULL
+    int tcp_port;            // Port on 127.0.0.1 to listen on, or 0
+    const MeadHoneyDb *honey_db; // Lots that records may name, or NULL
+    const MeadTelemetry *telemetry; // Running sensor telemetry for GET /telemetry, or NULL
+    MeadHistoryWriter *history;  // Recipes history (used by the event loop thread only), or NULL
+} MeadServiceConfig;
+
+int mead_service_run(const MeadServiceConfig *config, volatile sig_atomic_t *stop);
+
+#endif // MEAD_SERVICE_H
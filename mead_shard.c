@@ -0,0 +1,173 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mead_shard.h"
+
+// --- Shard Selection ---
+
+/**
+ * @brief Parses a shard selection "i/N" (0 <= i < N <= MEAD_SHARD_MAX).
+ * @return int 0 on success, -1 if s is not a valid selection.
+ */
+int mead_parse_shard(const char *s, MeadShard *out) {
+    char *end;
+    long index = strtol(s, &end, 10);
+    if (end == s || *end != '/') {
+        return -1;
+    }
+    const char *count_str = end + 1;
+    long count = strtol(count_str, &end, 10);
+    if (end == count_str || *end != '\0' || count < 1 || count > MEAD_SHARD_MAX || index < 0 || index >= count) {
+        return -1;
+    }
+    out->index = (int)index;
+    out->count = (int)count;
+    return 0;
+}
+
+/**
+ * @brief Tells whether an item (numbered from 0) belongs to this shard when items are
+ * dealt out round-robin. Every item belongs to an unsharded run (shard NULL).
+ */
+int mead_shard_owns(const MeadShard *shard, uint64_t item) {
+    return !shard || item % (uint64_t)shard->count == (uint64_t)shard->index;
+}
+
+// --- Writing ---
+
+/**
+ * @brief Writes the header and job description of a partial result file.
+ * @param job Description of every option that affects the results; at most
+ * MEAD_SHARD_JOB_MAX - 1 bytes are kept.
+ */
+void mead_shard_write_header(MeadWriter *w, MeadShardKind kind, MeadOutputFormat format, const MeadShard *shard,
+                             const char *job) {
+    MeadShardHeader header;
+    size_t job_len = strnlen(job, MEAD_SHARD_JOB_MAX - 1);
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MEAD_SHARD_MAGIC, sizeof(MEAD_SHARD_MAGIC));
+    header.version = MEAD_SHARD_VERSION;
+    header.byte_order = MEAD_SHARD_BYTE_ORDER;
+    header.kind = (uint16_t)kind;
+    header.format = (uint16_t)format;
+    header.index = (uint32_t)shard->index;
+    header.count = (uint32_t)shard->count;
+    header.job_size = (uint32_t)job_len + 1;
+    mead_writer_put(w, (const char *)&header, sizeof(header));
+    mead_writer_put(w, job, job_len);
+    mead_writer_put(w, "", 1);
+}
+
+/**
+ * @brief Formats a frame header for size bytes of data.
+ * @param dst Space for sizeof(MeadShardFrame) bytes.
+ * @return size_t sizeof(MeadShardFrame).
+ */
+size_t mead_shard_format_frame(char *dst, uint64_t key, uint32_t flags, size_t size) {
+    MeadShardFrame frame = { key, (uint32_t)size, flags };
+    memcpy(dst, &frame, sizeof(frame));
+    return sizeof(frame);
+}
+
+/**
+ * @brief Writes one frame: its header, then the data.
+ */
+void mead_shard_write_frame(MeadWriter *w, uint64_t key, uint32_t flags, const char *data, size_t size) {
+    char frame[sizeof(MeadShardFrame)];
+    mead_writer_put(w, frame, mead_shard_format_frame(frame, key, flags, size));
+    mead_writer_put(w, data, size);
+}
+
+/**
+ * @brief Writes everything written to a memory writer so far as one frame, and empties it.
+ * @param rows Memory writer (fd -1) holding the rendered rows.
+ */
+void mead_shard_write_rows(MeadWriter *w, uint64_t key, uint32_t flags, MeadWriter *rows) {
+    mead_writer_flush(rows);
+    mead_shard_write_frame(w, key, flags, rows->mem, rows->mem_len);
+    rows->mem_len = 0;
+}
+
+// --- Reading ---
+
+/**
+ * @brief Maps a partial result file and checks its header.
+ * @return int 0 on success, -1 if it cannot be read or is not a partial file of this
+ * version and byte order.
+ */
+int mead_shard_open(MeadShardFile *file, const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(MeadShardHeader)) {
+        close(fd);
+        return -1;
+    }
+    size_t size = (size_t)st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping keeps the file alive
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    MeadShardHeader *header = &file->header;
+    memcpy(header, map, sizeof(*header));
+    const char *job = (const char *)map + sizeof(*header);
+    if (strncmp(header->magic, MEAD_SHARD_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != MEAD_SHARD_VERSION || header->byte_order != MEAD_SHARD_BYTE_ORDER ||
+        header->count < 1 || header->count > MEAD_SHARD_MAX || header->index >= header->count ||
+        header->job_size < 1 || header->job_size > MEAD_SHARD_JOB_MAX ||
+        header->job_size > size - sizeof(*header) || job[header->job_size - 1] != '\0') {
+        munmap(map, size);
+        return -1;
+    }
+    file->map = map;
+    file->size = size;
+    file->offset = sizeof(*header) + header->job_size;
+    file->job = job;
+    return 0;
+}
+
+/**
+ * @brief Reads the next frame.
+ * @param data Output: the frame's data, in the mapping (not aligned).
+ * @return int 1 for a frame, 0 at the end of the file, -1 if the file is truncated.
+ */
+int mead_shard_next(MeadShardFile *file, MeadShardFrame *frame, const char **data) {
+    size_t left = file->size - file->offset;
+    if (left == 0) {
+        return 0;
+    }
+    if (left < sizeof(*frame)) {
+        return -1;
+    }
+    memcpy(frame, (const char *)file->map + file->offset, sizeof(*frame));
+    if (frame->size > left - sizeof(*frame)) {
+        return -1;
+    }
+    *data = (const char *)file->map + file->offset + sizeof(*frame);
+    file->offset += sizeof(*frame) + frame->size;
+    return 1;
+}
+
+void mead_shard_close(MeadShardFile *file) {
+    if (file->map) {
+        munmap(file->map, file->size);
+        file->map = NULL;
+    }
+}
@@ -0,0 +1,100 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+#ifndef MEAD_SHARD_H
+#define MEAD_SHARD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mead_output.h"
+
+// Sharded runs. "--shard i/N" makes a sweep, batch or Monte Carlo run do only its
+// part of the work, and write a partial result file instead of the usual output:
+//   MeadShardHeader, then header.job_size bytes of job description (NUL-terminated),
+//   then frames: a MeadShardFrame followed by frame.size bytes of data.
+// The job description names every option that affects the results, so the merge can
+// refuse partial files of different runs. Frames are written in ascending key order.
+//
+// How the work is split (deterministic, from i and N alone):
+//   sweep       shard i runs sweep chunks [chunks * i / N, chunks * (i + 1) / N); a frame
+//               holds one chunk formatted as usual, keyed by its first cell.
+//   batch       shard i computes the records on input lines l with (l - 1) % N == i; a
+//               frame holds one formatted row, keyed by its line.
+//   montecarlo  every shard reads every record, and shard i runs trial chunks c with
+//               c % N == i (mead_montecarlo.h); a frame holds a record and its packed
+//               summary (MEAD_SHARD_SUMMARY), keyed by its line.
+// Rows of failed records carry MEAD_SHARD_FAILED. "--merge FILE..." reads the N partial
+// files and writes exactly what the unsharded run would have written; the Monte Carlo
+// quantile sketches are merged, so the raw data is never read again.
+//
+// Files use the byte order of the machine that wrote them.
+
+#define MEAD_SHARD_MAGIC "MEADSHD"
+#define MEAD_SHARD_VERSION 1
+#define MEAD_SHARD_BYTE_ORDER 0x01020304u
+#define MEAD_SHARD_MAX 4096            // Most shards of one run
+#define MEAD_SHARD_JOB_MAX 1024        // Longest job description, including the NUL
+
+// Frame flags
+#define MEAD_SHARD_FAILED 0x1u         // The record failed (the merge exits with 1)
+#define MEAD_SHARD_SUMMARY 0x2u        // Data is a MeadRecord and a packed Monte Carlo summary
+
+typedef enum {
+    MEAD_SHARD_SWEEP = 1,
+    MEAD_SHARD_BATCH = 2,
+    MEAD_SHARD_MONTECARLO = 3
+} MeadShardKind;
+
+typedef struct {
+    char magic[8];         // MEAD_SHARD_MAGIC, NUL-padded
+    uint32_t version;      // MEAD_SHARD_VERSION
+    uint32_t byte_order;   // MEAD_SHARD_BYTE_ORDER as stored by the writer
+    uint16_t kind;         // MeadShardKind
+    uint16_t format;       // MeadOutputFormat of the frames
+    uint32_t index;        // This shard, 0 <= index < count
+    uint32_t count;
+    uint32_t job_size;     // Bytes of job description after this header
+    uint64_t reserved;
+} MeadShardHeader;
+
+typedef struct {
+    uint64_t key;          // Cell (sweep) or input line (batch, Monte Carlo)
+    uint32_t size;         // Bytes of data after this header
+    uint32_t flags;        // MEAD_SHARD_* flags
+} MeadShardFrame;
+
+_Static_assert(sizeof(MeadShardHeader) == 40, "MeadShardHeader layout is part of the format");
+_Static_assert(sizeof(MeadShardFrame) == 16, "MeadShardFrame layout is part of the format");
+
+typedef struct {
+    int index;
+    int count;             // 1 for an unsharded run
+} MeadShard;
+
+// A partial file, mapped read-only.
+typedef struct {
+    void *map;
+    size_t size;
+    size_t offset;         // Of the next frame
+    MeadShardHeader header;
+    const char *job;       // Job description, in the mapping
+} MeadShardFile;
+
+int mead_parse_shard(const char *s, MeadShard *out);
+int mead_shard_owns(const MeadShard *shard, uint64_t item);
+
+void mead_shard_write_header(MeadWriter *w, MeadShardKind kind, MeadOutputFormat format, const MeadShard *shard,
+                             const char *job);
+size_t mead_shard_format_frame(char *dst, uint64_t key, uint32_t flags, size_t size);
+void mead_shard_write_frame(MeadWriter *w, uint64_t key, uint32_t flags, const char *data, size_t size);
+void mead_shard_write_rows(MeadWriter *w, uint64_t key, uint32_t flags, MeadWriter *rows);
+
+int mead_shard_open(MeadShardFile *file, const char *path);
+int mead_shard_next(MeadShardFile *file, MeadShardFrame *frame, const char **data);
+void mead_shard_close(MeadShardFile *file);
+
+#endif // MEAD_SHARD_H
@@ -0,0 +1,353 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "mead_stats.h"
+
+static atomic_int stats_enabled;
+static uint64_t stats_start_ns;
+static _Atomic(MeadStats *) stats_registry;  // Every block ever allocated (push-only list)
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER; // Serializes adoption of free blocks
+static pthread_key_t stats_key;
+static pthread_once_t stats_key_once = PTHREAD_ONCE_INIT;
+static _Thread_local MeadStats *stats_current;
+
+static const char *const COUNTER_NAMES[MEAD_STAT_COUNTERS] = {
+    "records", "parse_errors", "og_rejections", "lot_errors", "telemetry_readings", "telemetry_drops"
+};
+static const char *const COUNTER_HELP[MEAD_STAT_COUNTERS] = {
+    "Records received.",
+    "Records that could not be parsed.",
+    "Records rejected because the target OG is above 1.225.",
+    "Records naming a honey lot that could not be resolved.",
+    "Sensor readings applied to fermenter state.",
+    "Sensor readings rejected or dropped."
+};
+static const char *const GAUGE_NAMES[MEAD_GAUGE_COUNT] = { "queue_depth", "connections" };
+static const char *const GAUGE_HELP[MEAD_GAUGE_COUNT] = {
+    "Records handed to the last kernel call.",
+    "Open service connections."
+};
+static const char *const STAGE_NAMES[MEAD_STAGE_COUNT] = { "parse", "compute", "format", "write" };
+
+// Relaxed increment of a counter only the calling thread writes (no locked instruction).
+static void add_u64(atomic_uint_least64_t *v, uint64_t n) {
+    atomic_store_explicit(v, atomic_load_explicit(v, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+// --- Per-Thread Blocks ---
+
+uint64_t mead_stats_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// Thread exit: the block keeps its totals and becomes free for the next thread.
+static void release_block(void *block) {
+    atomic_store_explicit(&((MeadStats *)block)->in_use, 0, memory_order_release);
+}
+
+static void create_key(void) {
+    pthread_key_create(&stats_key, release_block);
+}
+
+/**
+ * @brief Turns statistics on and starts the uptime clock. Call before any
+ * instrumented threads start; later calls do nothing.
+ */
+void mead_stats_enable(void) {
+    pthread_once(&stats_key_once, create_key);
+    if (!atomic_load(&stats_enabled)) {
+        stats_start_ns = mead_stats_now();
+        atomic_store(&stats_enabled, 1);
+    }
+}
+
+/**
+ * @brief Returns the calling thread's statistics block, adopting a free block or
+ * registering a new one on first use.
+ * @return MeadStats* The block, or NULL if statistics are off (or out of memory).
+ */
+MeadStats *mead_stats_thread(void) {
+    if (stats_current || !atomic_load_explicit(&stats_enabled, memory_order_relaxed)) {
+        return stats_current;
+    }
+
+    MeadStats *block = NULL;
+    pthread_mutex_lock(&stats_lock);
+    for (MeadStats *s = atomic_load(&stats_registry); s; s = s->next) {
+        if (!atomic_load_explicit(&s->in_use, memory_order_acquire)) {
+            block = s;
+            break;
+        }
+    }
+    if (!block && (block = calloc(1, sizeof(*block))) != NULL) {
+        block->next = atomic_load(&stats_registry);
+        atomic_store(&stats_registry, block);
+    }
+    if (block) {
+        atomic_store_explicit(&block->in_use, 1, memory_order_relaxed);
+        pthread_setspecific(stats_key, block);
+    }
+    pthread_mutex_unlock(&stats_lock);
+
+    stats_current = block;
+    return block;
+}
+
+// Functions below accept NULL (statistics off) and then do nothing.
+
+void mead_stats_count(MeadStats *stats, MeadCounter counter, uint64_t n) {
+    if (stats) {
+        add_u64(&stats->counters[counter], n);
+    }
+}
+
+void mead_stats_gauge_add(MeadStats *stats, MeadGauge gauge, int64_t delta) {
+    if (stats) {
+        atomic_int_least64_t *g = &stats->gauges[gauge];
+        atomic_store_explicit(g, atomic_load_explicit(g, memory_order_relaxed) + delta, memory_order_relaxed);
+    }
+}
+
+void mead_stats_gauge_set(MeadStats *stats, MeadGauge gauge, int64_t value) {
+    if (stats) {
+        atomic_store_explicit(&stats->gauges[gauge], value, memory_order_relaxed);
+    }
+}
+
+// Bucket of a latency: exact below MEAD_HIST_SUB, then MEAD_HIST_SUB buckets per power of two.
+static unsigned bucket_of(uint64_t ns) {
+    if (ns < MEAD_HIST_SUB) {
+        return (unsigned)ns;
+    }
+    unsigned exp = 63u - (unsigned)__builtin_clzll(ns);
+    if (exp >= MEAD_HIST_MAX_EXP) {
+        return MEAD_HIST_BUCKETS - 1;
+    }
+    unsigned shift = exp - MEAD_HIST_SUB_BITS;
+    return (exp - MEAD_HIST_SUB_BITS + 1) * MEAD_HIST_SUB + (unsigned)((ns >> shift) - MEAD_HIST_SUB);
+}
+
+// Largest latency that lands in a bucket.
+static uint64_t bucket_upper(unsigned bucket) {
+    if (bucket < MEAD_HIST_SUB) {
+        return bucket;
+    }
+    unsigned shift = bucket / MEAD_HIST_SUB - 1;
+    uint64_t low = (uint64_t)(MEAD_HIST_SUB + bucket % MEAD_HIST_SUB) << shift;
+    return low + ((uint64_t)1 << shift) - 1;
+}
+
+/**
+ * @brief Adds one latency sample to a stage histogram.
+ */
+void mead_stats_record(MeadStats *stats, MeadStage stage, uint64_t ns) {
+    if (!stats) {
+        return;
+    }
+    MeadHistogram *h = &stats->stages[stage];
+    add_u64(&h->count, 1);
+    add_u64(&h->sum_ns, ns);
+    add_u64(&h->bins[bucket_of(ns)], 1);
+    if (ns > atomic_load_explicit(&h->max_ns, memory_order_relaxed)) {
+        atomic_store_explicit(&h->max_ns, ns, memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Records the time since start_ns (a mead_stats_now() value) for a stage.
+ */
+void mead_stats_record_since(MeadStats *stats, MeadStage stage, uint64_t start_ns) {
+    if (stats) {
+        mead_stats_record(stats, stage, mead_stats_now() - start_ns);
+    }
+}
+
+// --- Reading ---
+
+/**
+ * @brief Merges every thread's block into one snapshot. Safe to call while other
+ * threads keep recording; each value is read once.
+ */
+void mead_stats_snapshot(MeadStatsSnapshot *out) {
+    memset(out, 0, sizeof(*out));
+    if (atomic_load(&stats_enabled)) {
+        out->uptime = (double)(mead_stats_now() - stats_start_ns) / 1e9;
+    }
+
+    for (MeadStats *s = atomic_load(&stats_registry); s; s = s->next) {
+        for (int i = 0; i < MEAD_STAT_COUNTERS; i++) {
+            out->counters[i] += atomic_load_explicit(&s->counters[i], memory_order_relaxed);
+        }
+        for (int i = 0; i < MEAD_GAUGE_COUNT; i++) {
+            out->gauges[i] += atomic_load_explicit(&s->gauges[i], memory_order_relaxed);
+        }
+        for (int st = 0; st < MEAD_STAGE_COUNT; st++) {
+            const MeadHistogram *h = &s->stages[st];
+            MeadHistogramSnapshot *o = &out->stages[st];
+            uint64_t max = atomic_load_explicit(&h->max_ns, memory_order_relaxed);
+            o->count += atomic_load_explicit(&h->count, memory_order_relaxed);
+            o->sum_ns += atomic_load_explicit(&h->sum_ns, memory_order_relaxed);
+            o->max_ns = (max > o->max_ns) ? max : o->max_ns;
+            for (int b = 0; b < MEAD_HIST_BUCKETS; b++) {
+                o->bins[b] += atomic_load_explicit(&h->bins[b], memory_order_relaxed);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Returns the q-quantile (0..1) of a histogram as the upper bound of the
+ * bucket it falls in, capped at the largest sample.
+ * @return uint64_t Nanoseconds, or 0 for an empty histogram.
+ */
+uint64_t mead_histogram_quantile(const MeadHistogramSnapshot *hist, double q) {
+    if (hist->count == 0) {
+        return 0;
+    }
+    // Nearest rank: the ceil(q * count)-th smallest sample
+    double target = q * (double)hist->count;
+    uint64_t rank = (uint64_t)target;
+    rank += ((double)rank < target || rank == 0);
+    uint64_t seen = 0;
+    for (unsigned b = 0; b < MEAD_HIST_BUCKETS; b++) {
+        seen += hist->bins[b];
+        if (seen >= rank) {
+            uint64_t upper = bucket_upper(b);
+            return (upper < hist->max_ns) ? upper : hist->max_ns;
+        }
+    }
+    return hist->max_ns;
+}
+
+// Writes nanoseconds as microseconds with 2 decimals, the unit of the text report.
+static void write_us(MeadWriter *w, uint64_t ns) {
+    mead_writer_puts(w, " ");
+    mead_writer_fixed(w, (double)ns / 1000.0, 2);
+}
+
+/**
+ * @brief Writes a human-readable report (the --stats output).
+ */
+void mead_stats_write_text(MeadWriter *w, const MeadStatsSnapshot *snap) {
+    uint64_t records = snap->counters[MEAD_STAT_RECORDS];
+
+    mead_writer_puts(w, "--- Statistics ---\n");
+    mead_writer_puts(w, "elapsed ");
+    mead_writer_fixed(w, snap->uptime, 3);
+    mead_writer_puts(w, " s, ");
+    mead_writer_long(w, (long)records);
+    mead_writer_puts(w, " records (");
+    mead_writer_fixed(w, (snap->uptime > 0.0) ? (double)records / snap->uptime : 0.0, 0);
+    mead_writer_puts(w, "/s)\n");
+    for (int i = MEAD_STAT_PARSE_ERRORS; i < MEAD_STAT_COUNTERS; i++) {
+        mead_writer_puts(w, COUNTER_NAMES[i]);
+        mead_writer_puts(w, " ");
+        mead_writer_long(w, (long)snap->counters[i]);
+        mead_writer_puts(w, (i + 1 < MEAD_STAT_COUNTERS) ? ", " : "\n");
+    }
+    for (int i = 0; i < MEAD_GAUGE_COUNT; i++) {
+        mead_writer_puts(w, GAUGE_NAMES[i]);
+        mead_writer_puts(w, " ");
+        mead_writer_long(w, (long)snap->gauges[i]);
+        mead_writer_puts(w, (i + 1 < MEAD_GAUGE_COUNT) ? ", " : "\n");
+    }
+    mead_writer_puts(w, "stage count mean p50 p90 p99 max (microseconds)\n");
+    for (int st = 0; st < MEAD_STAGE_COUNT; st++) {
+        const MeadHistogramSnapshot *h = &snap->stages[st];
+        mead_writer_puts(w, STAGE_NAMES[st]);
+        mead_writer_puts(w, " ");
+        mead_writer_long(w, (long)h->count);
+        write_us(w, h->count ? h->sum_ns / h->count : 0);
+        write_us(w, mead_histogram_quantile(h, 0.50));
+        write_us(w, mead_histogram_quantile(h, 0.90));
+        write_us(w, mead_histogram_quantile(h, 0.99));
+        write_us(w, h->max_ns);
+        mead_writer_puts(w, "\n");
+    }
+}
+
+static void write_metric_head(MeadWriter *w, const char *name, const char *help, const char *type) {
+    mead_writer_puts(w, "# HELP mead_");
+    mead_writer_puts(w, name);
+    mead_writer_puts(w, " ");
+    mead_writer_puts(w, help);
+    mead_writer_puts(w, "\n# TYPE mead_");
+    mead_writer_puts(w, name);
+    mead_writer_puts(w, " ");
+    mead_writer_puts(w, type);
+    mead_writer_puts(w, "\n");
+}
+
+// Writes one stage series line: mead_stage_seconds<suffix>{stage="...",<label>} value
+static void write_stage_line(MeadWriter *w, const char *suffix, int stage, const char *label) {
+    mead_writer_puts(w, "mead_stage_seconds");
+    mead_writer_puts(w, suffix);
+    mead_writer_puts(w, "{stage=\"");
+    mead_writer_puts(w, STAGE_NAMES[stage]);
+    mead_writer_puts(w, label ? "\"," : "\"} ");
+    if (label) {
+        mead_writer_puts(w, label);
+        mead_writer_puts(w, "} ");
+    }
+}
+
+/**
+ * @brief Writes every metric in the Prometheus text exposition format (version 0.0.4).
+ * Stage latencies are summaries with the 0.5, 0.9, 0.99 and 0.999 quantiles.
+ */
+void mead_stats_write_prometheus(MeadWriter *w, const MeadStatsSnapshot *snap) {
+    static const double QUANTILES[] = { 0.5, 0.9, 0.99, 0.999 };
+    static const char *const QUANTILE_LABELS[] = {
+        "quantile=\"0.5\"", "quantile=\"0.9\"", "quantile=\"0.99\"", "quantile=\"0.999\""
+    };
+    char name[64];
+
+    for (int i = 0; i < MEAD_STAT_COUNTERS; i++) {
+        strcpy(name, COUNTER_NAMES[i]);
+        strcat(name, "_total");
+        write_metric_head(w, name, COUNTER_HELP[i], "counter");
+        mead_writer_puts(w, "mead_");
+        mead_writer_puts(w, name);
+        mead_writer_puts(w, " ");
+        mead_writer_long(w, (long)snap->counters[i]);
+        mead_writer_puts(w, "\n");
+    }
+    for (int i = 0; i < MEAD_GAUGE_COUNT; i++) {
+        write_metric_head(w, GAUGE_NAMES[i], GAUGE_HELP[i], "gauge");
+        mead_writer_puts(w, "mead_");
+        mead_writer_puts(w, GAUGE_NAMES[i]);
+        mead_writer_puts(w, " ");
+        mead_writer_long(w, (long)snap->gauges[i]);
+        mead_writer_puts(w, "\n");
+    }
+    write_metric_head(w, "uptime_seconds", "Seconds since statistics were enabled.", "gauge");
+    mead_writer_puts(w, "mead_uptime_seconds ");
+    mead_writer_fixed(w, snap->uptime, 3);
+    mead_writer_puts(w, "\n");
+
+    write_metric_head(w, "stage_seconds", "Latency of each processing stage.", "summary");
+    for (int st = 0; st < MEAD_STAGE_COUNT; st++) {
+        const MeadHistogramSnapshot *h = &snap->stages[st];
+        for (int q = 0; q < 4; q++) {
+            write_stage_line(w, "", st, QUANTILE_LABELS[q]);
+            mead_writer_fixed(w, (double)mead_histogram_quantile(h, QUANTILES[q]) / 1e9, 9);
+            mead_writer_puts(w, "\n");
+        }
+        write_stage_line(w, "_sum", st, NULL);
+        mead_writer_fixed(w, (double)h->sum_ns / 1e9, 9);
+        mead_writer_puts(w, "\n");
+        write_stage_line(w, "_count", st, NULL);
+        mead_writer_long(w, (long)h->count);
+        mead_writer_puts(w, "\n");
+    }
+}
@@ -0,0 +1,102 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+#ifndef MEAD_STATS_H
+#define MEAD_STATS_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "mead_output.h"
+
+// Run-time instrumentation: event counters, gauges and per-stage latency histograms.
+// Every thread updates its own MeadStats block (returned by mead_stats_thread()),
+// so the hot path takes no locks and shares no cache lines; readers merge all blocks
+// with mead_stats_snapshot(). Blocks of exited threads keep their totals and are
+// reused by the next thread that starts.
+//
+// Statistics are off until mead_stats_enable() is called; until then
+// mead_stats_thread() returns NULL and instrumented code skips its clock reads.
+
+// Latency histograms are log-linear (HDR style): values below 2^SUB_BITS ns get
+// their own bucket, and every power of two above that is split into 2^SUB_BITS
+// buckets, so each bucket is within 1/16 (about 6%) of the values it holds.
+#define MEAD_HIST_SUB_BITS 4
+#define MEAD_HIST_SUB (1 << MEAD_HIST_SUB_BITS)
+#define MEAD_HIST_MAX_EXP 40 // Values from 2^40 ns (about 18 minutes) up share the last bucket
+#define MEAD_HIST_BUCKETS ((MEAD_HIST_MAX_EXP - MEAD_HIST_SUB_BITS + 1) * MEAD_HIST_SUB)
+
+typedef enum {
+    MEAD_STAT_RECORDS = 0,   // Records received (valid or not)
+    MEAD_STAT_PARSE_ERRORS,  // Records that could not be parsed (including overlong lines)
+    MEAD_STAT_OG_REJECTS,    // Records rejected by the MEAD_MAX_OG sanity check
+    MEAD_STAT_LOT_ERRORS,    // Records naming a honey lot that could not be resolved
+    MEAD_STAT_TELEMETRY_READINGS, // Sensor readings applied to fermenter state
+    MEAD_STAT_TELEMETRY_DROPS,    // Sensor readings rejected or dropped (bad line, full ring)
+    MEAD_STAT_COUNTERS
+} MeadCounter;
+
+typedef enum {
+    MEAD_GAUGE_QUEUE_DEPTH = 0, // Records handed to the last kernel call
+    MEAD_GAUGE_CONNECTIONS,     // Open service connections
+    MEAD_GAUGE_COUNT
+} MeadGauge;
+
+typedef enum {
+    MEAD_STAGE_PARSE = 0, // One record: text to MeadRecord
+    MEAD_STAGE_COMPUTE,   // One kernel call (a block of records)
+    MEAD_STAGE_FORMAT,    // Rendering one block of results
+    MEAD_STAGE_WRITE,     // One write to the output (file, pipe or socket)
+    MEAD_STAGE_COUNT
+} MeadStage;
+
+typedef struct {
+    atomic_uint_least64_t count;
+    atomic_uint_least64_t sum_ns;
+    atomic_uint_least64_t max_ns;
+    atomic_uint_least64_t bins[MEAD_HIST_BUCKETS];
+} MeadHistogram;
+
+// One thread's statistics. Only the owning thread writes; loads and stores are
+// relaxed atomics, so a concurrent reader sees whole (if slightly stale) values.
+typedef struct MeadStats {
+    atomic_uint_least64_t counters[MEAD_STAT_COUNTERS];
+    atomic_int_least64_t gauges[MEAD_GAUGE_COUNT];
+    MeadHistogram stages[MEAD_STAGE_COUNT];
+    atomic_int in_use;        // Owned by a running thread
+    struct MeadStats *next;   // Registry list; never unlinked
+} MeadStats;
+
+typedef struct {
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t max_ns;
+    uint64_t bins[MEAD_HIST_BUCKETS];
+} MeadHistogramSnapshot;
+
+// All threads merged.
+typedef struct {
+    double uptime;            // Seconds since mead_stats_enable()
+    uint64_t counters[MEAD_STAT_COUNTERS];
+    int64_t gauges[MEAD_GAUGE_COUNT];
+    MeadHistogramSnapshot stages[MEAD_STAGE_COUNT];
+} MeadStatsSnapshot;
+
+void mead_stats_enable(void);
+MeadStats *mead_stats_thread(void);
+uint64_t mead_stats_now(void);
+void mead_stats_count(MeadStats *stats, MeadCounter counter, uint64_t n);
+void mead_stats_gauge_add(MeadStats *stats, MeadGauge gauge, int64_t delta);
+void mead_stats_gauge_set(MeadStats *stats, MeadGauge gauge, int64_t value);
+void mead_stats_record(MeadStats *stats, MeadStage stage, uint64_t ns);
+void mead_stats_record_since(MeadStats *stats, MeadStage stage, uint64_t start_ns);
+
+void mead_stats_snapshot(MeadStatsSnapshot *out);
+uint64_t mead_histogram_quantile(const MeadHistogramSnapshot *hist, double q);
+void mead_stats_write_text(MeadWriter *w, const MeadStatsSnapshot *snap);
+void mead_stats_write_prometheus(MeadWriter *w, const MeadStatsSnapshot *snap);
+
+#endif // MEAD_STATS_H
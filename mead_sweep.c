@@ -0,0 +1,236 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+#include "mead_core.h"
+#include "mead_kernel.h"
+#include "mead_sweep.h"
+#include "mead_stats.h"
+
+// Cells per batch volume: every ABV x every sweetness level x Standard/Turbo.
+static size_t cells_per_volume(const MeadSweepSpec *spec) {
+    return (size_t)(spec->abv_max - spec->abv_min + 1) * MEAD_SWEETNESS_COUNT * 2;
+}
+
+static size_t volume_count(const MeadSweepSpec *spec) {
+    // Small epsilon so that e.g. 5:2000:5 includes 2000 despite rounding in the division
+    return (size_t)floor((spec->volume_stop - spec->volume_start) / spec->volume_step + 1e-9) + 1;
+}
+
+/**
+ * @brief Checks that a sweep specification describes a non-empty, supported grid.
+ * @return int 0 if valid, -1 otherwise.
+ */
+int mead_sweep_validate(const MeadSweepSpec *spec) {
+    if (spec->unit != MEAD_UNIT_US_IMPERIAL && spec->unit != MEAD_UNIT_METRIC) return -1;
+    if (!(spec->volume_start > 0.0) || !(spec->volume_step > 0.0)) return -1;
+    if (!(spec->volume_stop >= spec->volume_start)) return -1;
+    if (spec->abv_min < MEAD_MIN_ABV || spec->abv_max > MEAD_MAX_ABV || spec->abv_min > spec->abv_max) return -1;
+    return 0;
+}
+
+/**
+ * @brief Returns the number of cells in the sweep grid (0 if the spec is invalid).
+ */
+size_t mead_sweep_cell_count(const MeadSweepSpec *spec) {
+    if (mead_sweep_validate(spec) != 0) {
+        return 0;
+    }
+    return volume_count(spec) * cells_per_volume(spec);
+}
+
+/**
+ * @brief Computes count consecutive cells starting at cell index first.
+ * OG comes from the precomputed table and honey/water from the SIMD batch kernel.
+ * @param spec A valid sweep specification.
+ * @param first Index of the first cell.
+ * @param count Number of cells, at most MEAD_SWEEP_CHUNK.
+ * @param out Chunk to fill.
+ */
+void mead_sweep_compute_chunk(const MeadSweepSpec *spec, size_t first, size_t count, MeadSweepChunk *out) {
+    size_t per_volume = cells_per_volume(spec);
+
+    out->first = first;
+    out->count = count;
+
+    for (size_t i = 0; i < count; i++) {
+        size_t cell = first + i;
+        size_t rest = cell % per_volume;
+        int is_turbo = (int)(rest % 2) + 1;
+        MeadSweetness sweetness = (MeadSweetness)((rest / 2) % MEAD_SWEETNESS_COUNT);
+        int abv = spec->abv_min + (int)(rest / (2 * MEAD_SWEETNESS_COUNT));
+
+        // Volumes are derived from the index, not accumulated, so no drift over long sweeps
+        out->volume[i] = spec->volume_start + (double)(cell / per_volume) * spec->volume_step;
+        out->abv[i] = abv;
+        out->sweetness[i] = sweetness;
+        out->yeast_mode[i] = (unsigned char)is_turbo;
+        out->units[i] = (unsigned char)spec->unit;
+        out->og[i] = MEAD_OG_TABLE[is_turbo != 1][sweetness][abv - MEAD_MIN_ABV].og;
+        out->fg[i] = mead_final_gravity(MEAD_DEFAULT_FG_TABLE, sweetness, is_turbo);
+    }
+
+    mead_compute_batch(count, out->volume, out->og, out->units, out->honey, out->water, out->gravity_points);
+}
+
+// --- Parallel Runner ---
+
+typedef struct {
+    const MeadSweepSpec *spec;
+    const MeadSweepSink *sink;
+    size_t cells;
+    size_t chunks;              // End of the chunk range to run
+    atomic_size_t next_chunk;   // Next chunk to claim (dynamic, chunked scheduling)
+    pthread_mutex_t lock;
+    pthread_cond_t turn;
+    size_t next_write;          // Next chunk allowed to write; guarded by lock
+    int failed;                 // Set on allocation or write failure; guarded by lock
+} SweepJob;
+
+static void sweep_fail(SweepJob *job) {
+    pthread_mutex_lock(&job->lock);
+    job->failed = 1;
+    pthread_cond_broadcast(&job->turn);
+    pthread_mutex_unlock(&job->lock);
+}
+
+static void *sweep_worker(void *arg) {
+    SweepJob *job = arg;
+    const MeadSweepSink *sink = job->sink;
+    size_t capacity = (size_t)MEAD_SWEEP_CHUNK * MEAD_SWEEP_ROW_MAX;
+    MeadStats *stats = mead_stats_thread();
+
+    // Per-thread chunk and output buffer, reused for every chunk this worker claims.
+    // Allocation happens before claiming work so a failure can never strand a chunk.
+    MeadSweepChunk *chunk = malloc(sizeof(*chunk));
+    char *buf = malloc(capacity);
+    if (!chunk || !buf) {
+        free(chunk);
+        free(buf);
+        sweep_fail(job);
+        return NULL;
+    }
+
+    for (;;) {
+        size_t index = atomic_fetch_add(&job->next_chunk, 1);
+        if (index >= job->chunks) {
+            break;
+        }
+
+        size_t first = index * MEAD_SWEEP_CHUNK;
+        size_t count = (job->cells - first < MEAD_SWEEP_CHUNK) ? job->cells - first : MEAD_SWEEP_CHUNK;
+        uint64_t start = stats ? mead_stats_now() : 0;
+        mead_sweep_compute_chunk(job->spec, first, count, chunk);
+        mead_stats_record_since(stats, MEAD_STAGE_COMPUTE, start);
+        mead_stats_count(stats, MEAD_STAT_RECORDS, count);
+        start = stats ? mead_stats_now() : 0;
+        size_t len = sink->format ? sink->format(chunk, buf, capacity, sink->user) : 0;
+        mead_stats_record_since(stats, MEAD_STAGE_FORMAT, start);
+
+        // Ordered commit: wait until every earlier chunk has been written
+        pthread_mutex_lock(&job->lock);
+        while (job->next_write != index && !job->failed) {
+            pthread_cond_wait(&job->turn, &job->lock);
+        }
+        int stop = job->failed;
+        start = stats ? mead_stats_now() : 0;
+        if (!stop && sink->write && sink->write(buf, len, sink->user) != 0) {
+            job->failed = stop = 1;
+        }
+        mead_stats_record_since(stats, MEAD_STAGE_WRITE, start);
+        job->next_write++;
+        pthread_cond_broadcast(&job->turn);
+        pthread_mutex_unlock(&job->lock);
+
+        if (stop) {
+            break;
+        }
+    }
+
+    free(chunk);
+    free(buf);
+    return NULL;
+}
+
+/**
+ * @brief Returns the number of online CPUs, used as the default worker count.
+ */
+int mead_sweep_default_threads(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return (cpus > 0) ? (int)cpus : 1;
+}
+
+/**
+ * @brief Runs a full sweep across worker threads and delivers the results to a sink.
+ * Workers claim MEAD_SWEEP_CHUNK-cell chunks from a shared counter, compute and format
+ * them in parallel, and hand them to sink->write in cell order.
+ * @param spec Sweep grid.
+ * @param threads Number of worker threads (<= 0 for one per online CPU).
+ * @param sink Output stage.
+ * @return int 0 on success, -1 if the spec is invalid, threads or memory could not be
+ * obtained, or sink->write failed.
+ */
+int mead_sweep_run(const MeadSweepSpec *spec, int threads, const MeadSweepSink *sink) {
+    return mead_sweep_run_shard(spec, 0, 1, threads, sink);
+}
+
+/**
+ * @brief Runs one shard of a sweep, like mead_sweep_run(). The chunks are split into
+ * shard_count contiguous ranges of (nearly) equal size, and only range shard_index is
+ * run, so the shards' outputs concatenated in shard order are the full sweep.
+ * @param shard_index Shard to run, 0 <= shard_index < shard_count.
+ * @return int 0 on success, -1 if the spec or shard is invalid, threads or memory could
+ * not be obtained, or sink->write failed.
+ */
+int mead_sweep_run_shard(const MeadSweepSpec *spec, int shard_index, int shard_count, int threads,
+                         const MeadSweepSink *sink) {
+    if (mead_sweep_validate(spec) != 0 || shard_count < 1 || shard_index < 0 || shard_index >= shard_count) {
+        return -1;
+    }
+
+    SweepJob job;
+    job.spec = spec;
+    job.sink = sink;
+    job.cells = mead_sweep_cell_count(spec);
+    size_t chunks = (job.cells + MEAD_SWEEP_CHUNK - 1) / MEAD_SWEEP_CHUNK;
+    size_t first = chunks * (size_t)shard_index / (size_t)shard_count;
+    job.chunks = chunks * (size_t)(shard_index + 1) / (size_t)shard_count;
+    atomic_init(&job.next_chunk, first);
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.turn, NULL);
+    job.next_write = first;
+    job.failed = 0;
+
+    if (threads <= 0) {
+        threads = mead_sweep_default_threads();
+    }
+    if ((size_t)threads > job.chunks - first) {
+        threads = (int)(job.chunks - first);
+    }
+
+    // The calling thread works too, so only threads - 1 extra workers are started
+    pthread_t *workers = (threads > 1) ? malloc(sizeof(pthread_t) * (size_t)(threads - 1)) : NULL;
+    int started = 0;
+    if (workers) {
+        while (started < threads - 1 && pthread_create(&workers[started], NULL, sweep_worker, &job) == 0) {
+            started++;
+        }
+    }
+    sweep_worker(&job);
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    free(workers);
+
+    pthread_cond_destroy(&job.turn);
+    pthread_mutex_destroy(&job.lock);
+    return (job.failed || job.next_write != job.chunks) ? -1 : 0;
+}
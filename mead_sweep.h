@@ -0,0 +1,67 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+#ifndef MEAD_SWEEP_H
+#define MEAD_SWEEP_H
+
+#include <stddef.h>
+
+#include "mead_core.h"
+
+// Parameter sweep over volume x ABV x sweetness x yeast mode. Cells are numbered
+// volume-major (then ABV, sweetness, Standard/Turbo), and results are always
+// delivered in that order regardless of the number of worker threads.
+
+// Cells per scheduling chunk. Each worker claims one chunk at a time.
+#define MEAD_SWEEP_CHUNK 1024
+
+// Upper bound on one formatted output row, used to size per-thread output buffers.
+#define MEAD_SWEEP_ROW_MAX 160
+
+typedef struct {
+    MeadUnit unit;       // Unit system of the volumes and results
+    double volume_start; // First batch volume, Gallons or Liters
+    double volume_stop;  // Last batch volume (inclusive)
+    double volume_step;  // Volume increment, > 0
+    int abv_min;         // First target ABV (>= MEAD_MIN_ABV)
+    int abv_max;         // Last target ABV (<= MEAD_MAX_ABV)
+} MeadSweepSpec;
+
+// Structure-of-arrays results for one chunk of consecutive cells.
+typedef struct {
+    size_t first;                                  // Index of the first cell in this chunk
+    size_t count;                                  // Number of valid entries
+    double volume[MEAD_SWEEP_CHUNK];
+    int abv[MEAD_SWEEP_CHUNK];
+    MeadSweetness sweetness[MEAD_SWEEP_CHUNK];
+    unsigned char yeast_mode[MEAD_SWEEP_CHUNK];    // 1 for Standard, 2 for Turbo
+    unsigned char units[MEAD_SWEEP_CHUNK];         // MeadUnit per cell (all equal to spec->unit)
+    double og[MEAD_SWEEP_CHUNK];
+    double fg[MEAD_SWEEP_CHUNK];
+    double honey[MEAD_SWEEP_CHUNK];
+    double water[MEAD_SWEEP_CHUNK];
+    double gravity_points[MEAD_SWEEP_CHUNK];
+} MeadSweepChunk;
+
+// Output stage of a sweep. format() runs on the worker threads in parallel, in any
+// chunk order, and renders a chunk into that worker's buffer. write() is called once
+// per chunk, serialized and in chunk order; it may be NULL if format() already stores
+// the results itself (for example into columnar arrays indexed by chunk->first).
+typedef struct {
+    size_t (*format)(const MeadSweepChunk *chunk, char *buf, size_t capacity, void *user);
+    int (*write)(const char *buf, size_t len, void *user); // Returns 0 on success
+    void *user;
+} MeadSweepSink;
+
+size_t mead_sweep_cell_count(const MeadSweepSpec *spec);
+int mead_sweep_validate(const MeadSweepSpec *spec);
+void mead_sweep_compute_chunk(const MeadSweepSpec *spec, size_t first, size_t count, MeadSweepChunk *out);
+int mead_sweep_run(const MeadSweepSpec *spec, int threads, const MeadSweepSink *sink);
+int mead_sweep_run_shard(const MeadSweepSpec *spec, int shard_index, int shard_count, int threads,
+                         const MeadSweepSink *sink);
+int mead_sweep_default_threads(void);
+
+#endif // MEAD_SWEEP_H
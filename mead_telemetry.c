@@ -0,0 +1,572 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+#define _GNU_SOURCE // recvmmsg
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "mead_core.h"
+#include "mead_history.h"
+#include "mead_record.h"
+#include "mead_stats.h"
+#include "mead_telemetry.h"
+
+#define TELEMETRY_BATCH 32            // Datagrams per recvmmsg() call
+#define TELEMETRY_POLL_MS 100         // Receive timeout, so receivers notice a stop request
+#define TELEMETRY_IDLE_NS 1000000     // Apply thread nap when every ring is empty
+#define TELEMETRY_INDEX_SIZE (2 * MEAD_TELEMETRY_MAX_FERMENTERS) // Hash slots, a power of two
+#define TELEMETRY_MIN_SG 0.900        // Readings outside this range are rejected
+#define TELEMETRY_MAX_SG 1.300
+
+_Static_assert(MEAD_TELEMETRY_ID_MAX == MEAD_HISTORY_ID_MAX, "history rows hold whole fermenter names");
+
+// --- Parsing ---
+
+// SG as a number, with readings of 500 and above taken as thousandths (1050 -> 1.050).
+static const char *parse_gravity(const char *value, double *out) {
+    char *end;
+    double sg = strtod(value, &end);
+
+    if (end == value || *end != '\0') {
+        return "invalid gravity";
+    }
+    if (sg >= 500.0) {
+        sg /= 1000.0;
+    }
+    if (!(sg >= TELEMETRY_MIN_SG && sg <= TELEMETRY_MAX_SG)) {
+        return "gravity out of range";
+    }
+    *out = sg;
+    return NULL;
+}
+
+/**
+ * @brief Sets one reading field from text.
+ * @param index 0 fermenter, 1 sg, 2 temperature, 3 og (2 and 3 may be empty).
+ */
+static const char *set_reading_field(MeadTelemetryReading *out, int index, const char *value) {
+    char *end;
+
+    switch (index) {
+    case 0:
+        if (*value == '\0') return "missing fermenter name";
+        if (strlen(value) >= MEAD_TELEMETRY_ID_MAX) return "fermenter name too long";
+        for (const char *p = value; *p; p++) {
+            // Names are echoed into JSON and markup unescaped
+            if (iscntrl((unsigned char)*p) || *p == '"' || *p == '\\' || *p == '<' || *p == '&') {
+                return "invalid fermenter name";
+            }
+        }
+        strcpy(out->id, value);
+        return NULL;
+    case 1:
+        return parse_gravity(value, &out->sg);
+    case 2:
+        if (*value == '\0') return NULL;
+        out->temperature = strtod(value, &end);
+        return (end == value || *end != '\0' || !isfinite(out->temperature)) ? "invalid temperature" : NULL;
+    default:
+        if (*value == '\0') return NULL;
+        return parse_gravity(value, &out->og);
+    }
+}
+
+// CSV reading: fermenter,sg[,temperature[,og]]
+static const char *parse_csv_reading(char *line, MeadTelemetryReading *out) {
+    int count = 0;
+
+    for (char *field = line; field; count++) {
+        char *comma = strchr(field, ',');
+        if (comma) {
+            *comma = '\0';
+        }
+        if (count == 4) {
+            return "expected 2 to 4 fields (fermenter,sg,temperature,og)";
+        }
+        const char *err = set_reading_field(out, count, mead_trim_field(field));
+        if (err) {
+            return err;
+        }
+        field = comma ? comma + 1 : NULL;
+    }
+    return (count >= 2) ? NULL : "expected 2 to 4 fields (fermenter,sg,temperature,og)";
+}
+
+// Flat JSON reading (iSpindel-style keys), scanned like mead_parse_json_record().
+static const char *parse_json_reading(char *line, MeadTelemetryReading *out) {
+    static const char *const keys[] = { "name", "gravity", "temperature", "og", "sg" };
+    int seen = 0;
+    char *p = line + 1;
+
+    for (;;) {
+        while (isspace((unsigned char)*p) || *p == ',') p++;
+        if (*p == '}') break;
+        if (*p != '"') return "malformed JSON reading";
+
+        char *key = ++p;
+        p = strchr(p, '"');
+        if (!p) return "malformed JSON reading";
+        *p++ = '\0';
+        while (isspace((unsigned char)*p)) p++;
+        if (*p++ != ':') return "malformed JSON reading";
+        while (isspace((unsigned char)*p)) p++;
+
+        char *value;
+        int last = 0;
+        if (*p == '"') {
+            value = ++p;
+            p = strchr(p, '"');
+            if (!p) return "malformed JSON reading";
+            *p++ = '\0';
+        } else {
+            value = p;
+            p += strcspn(p, ",}");
+            if (*p == '\0') return "malformed JSON reading";
+            last = (*p == '}');
+            *p++ = '\0';
+            value = mead_trim_field(value);
+        }
+
+        for (int i = 0; i < 5; i++) {
+            if (strcmp(key, keys[i]) == 0) {
+                int field = (i == 4) ? 1 : i; // "sg" is another name for "gravity"
+                const char *err = set_reading_field(out, field, value);
+                if (err) return err;
+                seen |= 1 << field;
+            }
+        }
+        if (last) break;
+    }
+    return ((seen & 0x3) == 0x3) ? NULL : "missing field (need name and gravity)";
+}
+
+/**
+ * @brief Parses one reading line, CSV or flat JSON (see mead_telemetry.h).
+ * @param line Reading text; modified in place.
+ * @return const char* NULL on success, otherwise an error message.
+ */
+const char *mead_telemetry_parse(char *line, MeadTelemetryReading *out) {
+    out->id[0] = '\0';
+    out->sg = 0.0;
+    out->temperature = NAN;
+    out->og = 0.0;
+
+    line = mead_trim_space(line);
+    return (*line == '{') ? parse_json_reading(line, out) : parse_csv_reading(line, out);
+}
+
+// --- Rings and Fermenter Slots ---
+
+// Single-producer/single-consumer ring. head and tail only ever grow; the slot of a
+// position is position % MEAD_TELEMETRY_RING. Each index has its own cache line, so
+// the receiver and the apply thread do not share one.
+typedef struct {
+    _Alignas(64) atomic_size_t head; // Next position the receiver writes
+    size_t tail_cache;               // Receiver's last view of tail (receiver only)
+    _Alignas(64) atomic_size_t tail; // Next position the apply thread reads
+    _Alignas(64) MeadTelemetryReading slots[MEAD_TELEMETRY_RING];
+} TelemetryRing;
+
+// One fermenter's state behind a sequence lock: seq is odd while the apply thread
+// writes. Readers copy state and retry if seq changed meanwhile, so they never block
+// the writer. (A torn copy may be read, but it is always thrown away.)
+typedef struct {
+    _Alignas(64) atomic_uint seq;
+    int og_reported;                 // OG came from a reading (apply thread only)
+    MeadFermenterState state;
+} FermenterSlot;
+
+typedef struct {
+    MeadTelemetry *telemetry;
+    TelemetryRing *ring;
+    int fd;
+    int started;                     // Thread is running
+    pthread_t thread;
+} TelemetryReceiver;
+
+struct MeadTelemetry {
+    double abv_factor;
+    atomic_int stop_receivers;
+    atomic_int stop_apply;           // Set once every receiver has exited
+    int receiver_count;
+    TelemetryReceiver receivers[MEAD_TELEMETRY_MAX_RECEIVERS];
+    int apply_started;
+    pthread_t apply_thread;
+    MeadHistoryWriter *history;      // Readings history, or NULL (apply thread only)
+    atomic_uint_least64_t dropped;
+    atomic_size_t count;             // Published slots; a slot's id is set before it is counted
+    int16_t index[TELEMETRY_INDEX_SIZE]; // Hash of id -> slot, or -1 (apply thread only)
+    FermenterSlot slots[MEAD_TELEMETRY_MAX_FERMENTERS];
+};
+
+static int ring_push(TelemetryRing *ring, const MeadTelemetryReading *reading) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+    if (head - ring->tail_cache == MEAD_TELEMETRY_RING) {
+        ring->tail_cache = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (head - ring->tail_cache == MEAD_TELEMETRY_RING) {
+            return -1; // Full
+        }
+    }
+    ring->slots[head % MEAD_TELEMETRY_RING] = *reading;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return 0;
+}
+
+static void count_drop(MeadTelemetry *telemetry, MeadStats *stats) {
+    atomic_fetch_add_explicit(&telemetry->dropped, 1, memory_order_relaxed);
+    mead_stats_count(stats, MEAD_STAT_TELEMETRY_DROPS, 1);
+}
+
+// FNV-1a of a fermenter name.
+static uint32_t hash_id(const char *id) {
+    uint32_t h = 2166136261u;
+    while (*id) {
+        h = (h ^ (unsigned char)*id++) * 16777619u;
+    }
+    return h;
+}
+
+// Slot of fermenter id, adding (and publishing) it if new. Apply thread only.
+static int find_or_add_slot(MeadTelemetry *telemetry, const char *id) {
+    size_t h = hash_id(id) & (TELEMETRY_INDEX_SIZE - 1);
+
+    for (;;) {
+        int slot = telemetry->index[h];
+        if (slot < 0) {
+            break;
+        }
+        if (strcmp(telemetry->slots[slot].state.id, id) == 0) {
+            return slot;
+        }
+        h = (h + 1) & (TELEMETRY_INDEX_SIZE - 1);
+    }
+
+    size_t count = atomic_load_explicit(&telemetry->count, memory_order_relaxed);
+    if (count == MEAD_TELEMETRY_MAX_FERMENTERS) {
+        return -1;
+    }
+    MeadFermenterState *state = &telemetry->slots[count].state;
+    strcpy(state->id, id);
+    state->temperature = NAN;
+    telemetry->index[h] = (int16_t)count;
+    atomic_store_explicit(&telemetry->count, count + 1, memory_order_release);
+    return (int)count;
+}
+
+static void apply_reading(MeadTelemetry *telemetry, const MeadTelemetryReading *reading, uint64_t now,
+                          int64_t now_ms, MeadStats *stats) {
+    int index = find_or_add_slot(telemetry, reading->id);
+    if (index < 0) {
+        count_drop(telemetry, stats);
+        return;
+    }
+    FermenterSlot *slot = &telemetry->slots[index];
+    MeadFermenterState *state = &slot->state;
+    unsigned seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+
+    atomic_store_explicit(&slot->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    if (reading->og > 0.0) {
+        state->og = reading->og;
+        slot->og_reported = 1;
+    } else if (!slot->og_reported && reading->sg > state->og) {
+        state->og = reading->sg; // Highest SG seen stands in for the OG
+    }
+    state->sg = reading->sg;
+    if (!isnan(reading->temperature)) {
+        state->temperature = reading->temperature;
+    }
+    double abv = (state->og - state->sg) * telemetry->abv_factor;
+    state->abv = (abv > 0.0) ? abv : 0.0;
+    state->readings++;
+    state->updated_ns = now;
+
+    atomic_store_explicit(&slot->seq, seq + 2, memory_order_release);
+
+    if (telemetry->history) {
+        MeadHistoryReading row = { "", now_ms, reading->sg, reading->temperature };
+        memcpy(row.fermenter, reading->id, sizeof(row.fermenter));
+        mead_history_append_reading(telemetry->history, &row);
+    }
+}
+
+// --- Threads ---
+
+/**
+ * @brief Receiver thread: reads batches of datagrams, parses every line and pushes the
+ * readings into this receiver's ring (dropping them if it is full).
+ */
+static void *telemetry_receive(void *arg) {
+    TelemetryReceiver *rx = arg;
+    MeadTelemetry *telemetry = rx->telemetry;
+    static _Thread_local char buffers[TELEMETRY_BATCH][MEAD_TELEMETRY_DATAGRAM_MAX + 1];
+    struct mmsghdr msgs[TELEMETRY_BATCH];
+    struct iovec iov[TELEMETRY_BATCH];
+
+    while (!atomic_load_explicit(&telemetry->stop_receivers, memory_order_relaxed)) {
+        memset(msgs, 0, sizeof(msgs));
+        for (int i = 0; i < TELEMETRY_BATCH; i++) {
+            iov[i].iov_base = buffers[i];
+            iov[i].iov_len = MEAD_TELEMETRY_DATAGRAM_MAX;
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        int n = recvmmsg(rx->fd, msgs, TELEMETRY_BATCH, MSG_WAITFORONE, NULL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                continue; // Timeout: check the stop flag
+            }
+            break;
+        }
+
+        // Looked up per batch: statistics may be enabled after the thread started
+        MeadStats *stats = mead_stats_thread();
+        for (int i = 0; i < n; i++) {
+            char *p = buffers[i];
+            p[msgs[i].msg_len] = '\0';
+            while (p) {
+                char *nl = strchr(p, '\n');
+                if (nl) {
+                    *nl = '\0';
+                }
+                MeadTelemetryReading reading;
+                char *line = mead_trim_space(p);
+                if (*line != '\0' && *line != '#') {
+                    if (mead_telemetry_parse(line, &reading) != NULL || ring_push(rx->ring, &reading) != 0) {
+                        count_drop(telemetry, stats);
+                    }
+                }
+                p = nl ? nl + 1 : NULL;
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Apply thread: drains every receiver ring into the fermenter slots, napping
+ * when all are empty. Makes a last pass after the receivers have stopped.
+ */
+static void *telemetry_apply(void *arg) {
+    MeadTelemetry *telemetry = arg;
+    struct timespec nap = { 0, TELEMETRY_IDLE_NS };
+
+    for (;;) {
+        int stopping = atomic_load_explicit(&telemetry->stop_apply, memory_order_acquire);
+        MeadStats *stats = mead_stats_thread();
+        uint64_t now = mead_stats_now();
+        int64_t now_ms = telemetry->history ? mead_history_now_ms() : 0;
+        size_t applied = 0;
+
+        for (int r = 0; r < telemetry->receiver_count; r++) {
+            TelemetryRing *ring = telemetry->receivers[r].ring;
+            size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+            size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+            for (; tail != head; tail++) {
+                apply_reading(telemetry, &ring->slots[tail % MEAD_TELEMETRY_RING], now, now_ms, stats);
+                applied++;
+            }
+            atomic_store_explicit(&ring->tail, tail, memory_order_release);
+        }
+        mead_stats_count(stats, MEAD_STAT_TELEMETRY_READINGS, applied);
+
+        if (stopping) {
+            break;
+        }
+        if (applied == 0) {
+            if (telemetry->history) {
+                mead_history_writer_sync(telemetry->history, now_ms);
+            }
+            nanosleep(&nap, NULL);
+        }
+    }
+    return NULL;
+}
+
+// --- Public API ---
+
+static int telemetry_socket(int port, int shared) {
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons((uint16_t)port) };
+    addr.sin_addr.s_addr = htonl(INADDR_ANY); // Sensors send from the network
+    struct timeval timeout = { 0, TELEMETRY_POLL_MS * 1000 };
+    int one = 1;
+
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    if ((shared && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0) ||
+        bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Opens the UDP port (and the history file, if any) and starts the receiver and
+ * apply threads.
+ * @return MeadTelemetry* The running subsystem, or NULL (with errno set) if the port or
+ * history could not be opened or the threads could not be started.
+ */
+MeadTelemetry *mead_telemetry_start(const MeadTelemetryConfig *config) {
+    int receivers = (config->receivers <= 0) ? 1 : config->receivers;
+    if (receivers > MEAD_TELEMETRY_MAX_RECEIVERS) {
+        receivers = MEAD_TELEMETRY_MAX_RECEIVERS;
+    }
+
+    // Rounded up to the slot alignment, as aligned_alloc() requires
+    size_t size = (sizeof(MeadTelemetry) + 63) & ~(size_t)63;
+    MeadTelemetry *telemetry = aligned_alloc(64, size);
+    if (!telemetry) {
+        return NULL;
+    }
+    memset(telemetry, 0, sizeof(*telemetry));
+    memset(telemetry->index, 0xff, sizeof(telemetry->index)); // Every entry -1
+    telemetry->abv_factor = (config->abv_factor > 0.0) ? config->abv_factor : MEAD_DEFAULT_MODEL.abv_factor;
+
+    if (config->history_path) {
+        telemetry->history = malloc(sizeof(MeadHistoryWriter));
+        if (!telemetry->history ||
+            mead_history_writer_open(telemetry->history, config->history_path, MEAD_HISTORY_READINGS) != 0) {
+            int saved = telemetry->history ? errno : ENOMEM;
+            free(telemetry->history);
+            free(telemetry);
+            errno = saved;
+            return NULL;
+        }
+    }
+
+    for (int i = 0; i < receivers; i++) {
+        TelemetryReceiver *rx = &telemetry->receivers[i];
+        rx->telemetry = telemetry;
+        rx->ring = aligned_alloc(64, sizeof(TelemetryRing));
+        rx->fd = rx->ring ? telemetry_socket(config->udp_port, receivers > 1) : -1;
+        if (rx->fd < 0) {
+            int saved = rx->ring ? errno : ENOMEM;
+            free(rx->ring);
+            mead_telemetry_stop(telemetry);
+            errno = saved;
+            return NULL;
+        }
+        memset(rx->ring, 0, sizeof(TelemetryRing));
+        telemetry->receiver_count++;
+    }
+
+    if (pthread_create(&telemetry->apply_thread, NULL, telemetry_apply, telemetry) != 0) {
+        mead_telemetry_stop(telemetry);
+        errno = EAGAIN;
+        return NULL;
+    }
+    telemetry->apply_started = 1;
+    for (int i = 0; i < receivers; i++) {
+        TelemetryReceiver *rx = &telemetry->receivers[i];
+        if (pthread_create(&rx->thread, NULL, telemetry_receive, rx) != 0) {
+            mead_telemetry_stop(telemetry);
+            errno = EAGAIN;
+            return NULL;
+        }
+        rx->started = 1;
+    }
+    return telemetry;
+}
+
+/**
+ * @brief Stops every thread (within TELEMETRY_POLL_MS), applies the readings still
+ * queued, appends the buffered history and frees the subsystem.
+ */
+void mead_telemetry_stop(MeadTelemetry *telemetry) {
+    if (!telemetry) {
+        return;
+    }
+    atomic_store(&telemetry->stop_receivers, 1);
+    for (int i = 0; i < telemetry->receiver_count; i++) {
+        if (telemetry->receivers[i].started) {
+            pthread_join(telemetry->receivers[i].thread, NULL);
+        }
+    }
+    atomic_store(&telemetry->stop_apply, 1);
+    if (telemetry->apply_started) {
+        pthread_join(telemetry->apply_thread, NULL);
+    }
+    for (int i = 0; i < telemetry->receiver_count; i++) {
+        close(telemetry->receivers[i].fd);
+        free(telemetry->receivers[i].ring);
+    }
+    if (telemetry->history) {
+        mead_history_writer_close(telemetry->history);
+        free(telemetry->history);
+    }
+    free(telemetry);
+}
+
+/**
+ * @brief Returns the number of fermenters seen so far; indexes below it are valid.
+ */
+size_t mead_telemetry_count(const MeadTelemetry *telemetry) {
+    return atomic_load_explicit(&((MeadTelemetry *)telemetry)->count, memory_order_acquire);
+}
+
+/**
+ * @brief Copies the latest state of the fermenter at index (in order of first reading).
+ * Never blocks the apply thread; retries only while that slot is being written.
+ * @return int 0 on success, -1 if index is out of range.
+ */
+int mead_telemetry_get(const MeadTelemetry *telemetry, size_t index, MeadFermenterState *out) {
+    if (index >= mead_telemetry_count(telemetry)) {
+        return -1;
+    }
+    FermenterSlot *slot = &((MeadTelemetry *)telemetry)->slots[index];
+    unsigned before, after;
+
+    do {
+        before = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        memcpy(out, &slot->state, sizeof(*out));
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+    } while ((before & 1) || before != after);
+    return 0;
+}
+
+/**
+ * @brief Copies the latest state of fermenter id.
+ * @return int 0 on success, -1 if no reading for id has been applied.
+ */
+int mead_telemetry_find(const MeadTelemetry *telemetry, const char *id, MeadFermenterState *out) {
+    size_t count = mead_telemetry_count(telemetry);
+
+    for (size_t i = 0; i < count; i++) {
+        // Names never change once a slot is counted, so they can be compared unlocked
+        if (strcmp(telemetry->slots[i].state.id, id) == 0) {
+            return mead_telemetry_get(telemetry, i, out);
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Returns the number of readings rejected or dropped: unparsable lines, full
+ * rings and fermenters beyond MEAD_TELEMETRY_MAX_FERMENTERS.
+ */
+uint64_t mead_telemetry_dropped(const MeadTelemetry *telemetry) {
+    return atomic_load_explicit(&((MeadTelemetry *)telemetry)->dropped, memory_order_relaxed);
+}
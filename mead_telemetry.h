@@ -0,0 +1,73 @@
+// Copyright (C) [2025] [Tuomas Lähteenmäki].
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+#ifndef MEAD_TELEMETRY_H
+#define MEAD_TELEMETRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Live hydrometer telemetry (Tilt/iSpindel-style gravity sensors). Receiver threads
+// read UDP datagrams, each holding one or more readings, one per line:
+//   fermenter,sg[,temperature[,og]]
+//   {"name":"fermenter","gravity":1.050,"temperature":20.5,"og":1.100}
+// SG values of 500 and above are taken as thousandths (1050 is 1.050). MQTT brokers
+// can feed the same lines through any MQTT-to-UDP bridge.
+//
+// Each receiver parses its datagrams and pushes the readings into its own
+// single-producer/single-consumer ring. One apply thread drains every ring and updates
+// the per-fermenter state. Each fermenter slot is published under a sequence lock, so
+// readers (the service, the GTK app) never block the apply thread or each other.
+// When a ring is full, new readings are dropped and counted; they never wait.
+//
+// The current ABV estimate uses the same relation as mead_target_og():
+// ABV = (OG - SG) * abv_factor. OG is the last reported og, or else the highest SG seen.
+//
+// With a history path, the apply thread also appends every reading to that history
+// file (mead_history.h), stamped with the time it was applied.
+
+#define MEAD_TELEMETRY_ID_MAX 32            // Longest fermenter name, including the NUL
+#define MEAD_TELEMETRY_MAX_FERMENTERS 1024  // Fermenters tracked; readings for more are dropped
+#define MEAD_TELEMETRY_RING 4096            // Readings per receiver ring (a power of two)
+#define MEAD_TELEMETRY_MAX_RECEIVERS 16
+#define MEAD_TELEMETRY_DATAGRAM_MAX 2048    // Longer datagrams are truncated by the kernel
+
+typedef struct {
+    char id[MEAD_TELEMETRY_ID_MAX];
+    double sg;
+    double temperature;   // Celsius, or NAN if not reported
+    double og;            // Reported OG, or 0 if not reported
+} MeadTelemetryReading;
+
+// Latest state of one fermenter, as a consistent copy.
+typedef struct {
+    char id[MEAD_TELEMETRY_ID_MAX];
+    double og;            // Reported OG, or the highest SG seen
+    double sg;            // Latest SG
+    double temperature;   // Latest reported temperature (Celsius), or NAN
+    double abv;           // Current ABV estimate, never negative
+    uint64_t readings;    // Readings applied so far
+    uint64_t updated_ns;  // mead_stats_now() when the latest reading was applied
+} MeadFermenterState;
+
+typedef struct {
+    int udp_port;         // Port to receive readings on (all interfaces)
+    int receivers;        // Receiver threads sharing the port (SO_REUSEPORT); <= 0 for one
+    double abv_factor;    // 0 for MEAD_DEFAULT_MODEL.abv_factor
+    const char *history_path; // History file to append readings to, or NULL
+} MeadTelemetryConfig;
+
+typedef struct MeadTelemetry MeadTelemetry;
+
+const char *mead_telemetry_parse(char *line, MeadTelemetryReading *out);
+MeadTelemetry *mead_telemetry_start(const MeadTelemetryConfig *config);
+void mead_telemetry_stop(MeadTelemetry *telemetry);
+size_t mead_telemetry_count(const MeadTelemetry *telemetry);
+int mead_telemetry_get(const MeadTelemetry *telemetry, size_t index, MeadFermenterState *out);
+int mead_telemetry_find(const MeadTelemetry *telemetry, const char *id, MeadFermenterState *out);
+uint64_t mead_telemetry_dropped(const MeadTelemetry *telemetry);
+
+#endif // MEAD_TELEMETRY_H